@@ -1,7 +1,10 @@
 #pragma once
 
 #include "common.h"
+#include "derived_cache.h"
+#include "gpu_memory.h"
 #include "scene_system.h"
+#include "startup_timeline.h"
 
 namespace Api {
     void Init();
@@ -12,7 +15,48 @@ namespace Api {
 
     bool LoadScene(const std::string& path);
 
-    SceneSystem::Entity* CreateEntity(const std::string& name, const glm::vec4& color);
+    // returns at once and loads the scene over the following frames, see
+    // SceneLoader. False when the file does not exist
+    bool StreamScene(const std::string& path);
+
+    SceneSystem::EntityId CreateEntity(const std::string& name, const glm::vec4& color);
+
+    // entities sharing the prototype's mesh, material and texture, one per
+    // transform. Unnamed unless a prefix is given, see SceneSystem::SpawnEntities
+    std::vector<SceneSystem::EntityId> SpawnEntities(
+        const SceneSystem::Render& prototype,
+        std::span<const TransformSystem::Trs> transforms,
+        std::span<const glm::vec4> colors = {}, const std::string& namePrefix = {});
+
+    void DestroyEntities(std::span<const SceneSystem::EntityId> entities);
+
+    size_t DestroyEntitiesIf(const std::function<bool(SceneSystem::EntityId)>& predicate);
+
+    // drawn entities by the world bounds of their meshes, see SceneSystem::QueryBox
+
+    std::vector<SceneSystem::EntityId> QueryBox(const Aabb& box);
+
+    std::vector<SceneSystem::EntityId> QuerySphere(const glm::vec3& center, float radius);
+
+    // MakeFrustum builds one from a camera's view-projection matrix
+    std::vector<SceneSystem::EntityId> QueryFrustum(const Frustum& frustum);
+
+    SceneSystem::RayHit Raycast(
+        const glm::vec3& origin, const glm::vec3& direction,
+        float maxDistance = std::numeric_limits<float>::infinity());
+
+    // per-category totals of every tracked GL allocation
+    GpuMemory::Stats GetGpuMemoryStats();
+
+    // textures and cached meshes are evicted least recently used first to fit
+    void SetGpuMemoryBudget(size_t bytes);
+
+    // hit and miss counts of the on-disk cache of imported meshes and textures
+    DerivedCache::Stats GetDerivedCacheStats();
+
+    // time to window, first frame and scene ready, with a span per subsystem.
+    // It is also logged once the scene is ready
+    StartupTimeline::Timeline GetStartupTimeline();
 
     float GetDeltaTime();
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "mapped_file.h"
+
+// single-file archive of loose assets, read through one mapping so loaders get
+// pointers straight into the file
+namespace AssetPack {
+    constexpr uint32_t Version = 1;
+
+    // entry data starts on a page boundary, so a view of an entry is page aligned
+    constexpr uint64_t EntryAlignment = 4096;
+
+    enum class Compression : uint32_t { None, Lz };
+
+    // on-disk layout: Header, the Entry table sorted by path hash, the path strings,
+    // then the entry data, each entry starting on an EntryAlignment boundary
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tableOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+
+    struct Entry {
+        uint64_t pathHash;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        Compression compression;
+        uint32_t reserved;
+    };
+
+    // FNV-1a 64 of a virtual path such as "Models/cube.obj"
+    uint64_t HashPath(std::string_view path);
+
+    class Pack {
+       public:
+        // maps and validates a pack, null when it is missing or malformed
+        static std::shared_ptr<Pack> Open(const std::filesystem::path &path);
+
+        // binary search of the hash table, null when path is not packed
+        const Entry *Find(std::string_view path) const;
+
+        std::string_view GetPath(const Entry &entry) const;
+
+        std::span<const Entry> GetEntries() const {
+            return m_entries;
+        }
+
+        // uncompressed entries are views into the mapping, compressed ones are
+        // decoded into a buffer owned by the view. Empty when decoding fails
+        FileView Read(const Entry &entry) const;
+
+       private:
+        std::shared_ptr<const MappedFile> m_file;
+        std::span<const Entry> m_entries;
+        const char *m_names = nullptr;
+    };
+
+    struct Source {
+        std::string path;
+        std::filesystem::path file;
+    };
+
+    struct BuildStats {
+        uint32_t entries;
+        uint32_t compressed;
+        uint64_t inputBytes;
+        uint64_t packBytes;
+    };
+
+    // writes every source under its virtual path. With compress set, entries are
+    // stored LZ compressed when that saves at least a tenth of their size
+    bool Build(const std::vector<Source> &sources, const std::filesystem::path &output,
+               bool compress, BuildStats *stats = nullptr);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+
+#include "common.h"
+#include "mesh_system.h"
+#include "texture_system.h"
+
+namespace AsyncLoader {
+    // runs on a worker thread and must not touch GL, returns false on failure
+    using MeshDecoder = std::function<bool(MeshSystem::MeshData &data)>;
+
+    // run on the main thread once the resource is resident on the GPU. It is
+    // created unnamed, the callback decides where it goes (usually Replace)
+    using TextureCallback = std::function<void(TextureSystem::TextureHandle texture)>;
+    using MeshCallback = std::function<void(MeshSystem::MeshHandle mesh)>;
+
+    // run on the main thread within the upload budget to refill the storage of an
+    // evicted resource from a fresh decode, returns false when it no longer fits
+    using TextureFiller = std::function<bool(const TextureSystem::Image &image)>;
+    using MeshFiller = std::function<bool(const MeshSystem::MeshData &data)>;
+
+    // run on the main thread once the refill is resident, or as soon as the
+    // decode or the fill fails
+    using RefillCallback = std::function<void(bool success)>;
+
+    struct Stats {
+        uint32_t decoding;
+        uint32_t waitingForUpload;
+        uint32_t uploading;
+        uint32_t completed;
+        uint32_t failed;
+        size_t uploadedBytes;
+    };
+
+    // workerCount 0 picks one from the hardware concurrency
+    void Init(uint32_t workerCount = 0);
+
+    void LoadTexture(const std::string &name, const std::string &path, bool generateMips,
+                     TextureCallback onLoaded);
+
+    void LoadMesh(const std::string &name, MeshDecoder decoder, MeshCallback onLoaded);
+
+    // decodes again into an existing resource instead of creating a new one, so
+    // handles to it stay valid
+    void RefillTexture(const std::string &name, const std::string &path,
+                       TextureFiller fill, RefillCallback onRefilled);
+
+    void RefillMesh(const std::string &name, MeshDecoder decoder, MeshFiller fill,
+                    RefillCallback onRefilled);
+
+    // uploads decoded resources within the frame budget and retires finished
+    // uploads, call once per frame on the thread owning the GL context
+    void Update();
+
+    // at least one resource is uploaded per frame, even if it exceeds the budget
+    void SetUploadBudget(size_t bytesPerFrame);
+
+    size_t GetUploadBudget();
+
+    bool IsIdle();
+
+    Stats GetStats();
+
+    void CleanUp();
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "common.h"
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+};
+
+// planes point inwards, xyz is the normal and w the distance
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+};
+
+// the six planes of a view-projection matrix (Gribb and Hartmann)
+Frustum MakeFrustum(const glm::mat4 &viewProjection);
+
+// world bounds of local bounds under an affine matrix (Arvo)
+Aabb TransformBounds(const Aabb &bounds, const glm::mat4 &matrix);
+
+// distance along direction at which the ray enters bounds, in units of
+// direction's length. Infinity for a miss
+float RayEntry(const Aabb &bounds, const glm::vec3 &origin, const glm::vec3 &direction);
+
+// bounding volume hierarchy over items with boxes, one item per leaf. Nodes sit
+// in one array with their children's indices, Build lays them out depth first
+// so a query walks memory mostly forwards. Items are small integers such as slot
+// indices, the item table grows to the largest one.
+//
+// Leaves hold their item's exact bounds, their parents enclose them widened by a
+// margin. A move that stays inside the margin only rewrites the leaf, one that
+// leaves is reinserted at the best sibling by surface area, or when many leave
+// at once the whole tree is refitted around them. Additions wait for Update,
+// which inserts a few into the tree and rebuilds it with a binned SAH split when
+// they are many against its size. Queries see an addition or a move past the
+// margin once Update has run
+class Bvh {
+   public:
+    struct RayHit {
+        uint32_t item = None;
+        float distance = std::numeric_limits<float>::infinity();
+    };
+
+    struct Stats {
+        uint32_t items;
+        uint32_t nodes;
+        uint32_t builds;
+        uint32_t refits;
+        // additions inserted into the tree since the last build
+        uint32_t inserted;
+        float buildMs;
+    };
+
+    static constexpr uint32_t None = UINT32_MAX;
+
+    // moves the item when it is already there
+    void Insert(uint32_t item, const Aabb &bounds);
+
+    void Move(uint32_t item, const Aabb &bounds);
+
+    void Remove(uint32_t item);
+
+    bool Contains(uint32_t item) const;
+
+    // applies the additions and moves since the last call
+    void Update();
+
+    // every item's leaf laid out again from scratch
+    void Build();
+
+    // queries append the items they find to results
+
+    void QueryBox(const Aabb &box, std::vector<uint32_t> &results) const;
+
+    void QuerySphere(const glm::vec3 &center, float radius,
+                     std::vector<uint32_t> &results) const;
+
+    // items not fully outside any plane, a box straddling a corner may be kept
+    void QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const;
+
+    // the nearest item whose bounds the ray enters. hitTest refines a candidate,
+    // returning the distance along direction or infinity for a miss. Distances are
+    // in units of direction's length
+    RayHit Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                   float maxDistance = std::numeric_limits<float>::infinity(),
+                   const std::function<float(uint32_t)> &hitTest = {}) const;
+
+    Stats GetStats() const;
+
+    void Clear();
+
+   private:
+    // 32 bytes. A leaf's right is None and its left is the item, an interior
+    // node's bounds enclose its leaves' widened bounds
+    struct Node {
+        glm::vec3 min;
+        uint32_t left;
+        glm::vec3 max;
+        uint32_t right;
+    };
+
+    enum class State : uint8_t { Absent, Pending, InTree };
+
+    struct Item {
+        Aabb bounds;
+        // what the leaf's ancestors enclose
+        Aabb widened;
+        // the leaf while in the tree, the position in m_pending while pending
+        uint32_t node = None;
+        State state = State::Absent;
+        bool moved = false;
+    };
+
+    uint32_t AllocateNode();
+
+    void FreeNode(uint32_t node);
+
+    void InsertLeaf(uint32_t leaf);
+
+    void RemoveLeaf(uint32_t leaf);
+
+    // recomputes node and its ancestors from their children
+    void RefitFrom(uint32_t node);
+
+    void RefitAll();
+
+    // a leaf's widened bounds, an interior node's own
+    Aabb GetOuterBounds(uint32_t node) const;
+
+    void RemovePending(uint32_t item);
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_freeNodes;
+    uint32_t m_root = None;
+
+    std::vector<Item> m_items;
+    std::vector<uint32_t> m_pending;
+    std::vector<uint32_t> m_moved;
+    uint32_t m_leafCount = 0;
+
+    uint32_t m_builds = 0;
+    uint32_t m_refits = 0;
+    uint32_t m_inserted = 0;
+    float m_buildMs = 0.0f;
+};
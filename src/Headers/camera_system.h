@@ -6,7 +6,7 @@
 namespace CameraSystem {
     struct Camera {
         std::string name;
-        TransformSystem::Transform *transform = nullptr;
+        TransformSystem::TransformHandle transform;
 
         glm::vec3 position{0.0f, 0.50f, 3.0f};
         glm::vec3 front{0.0f, 0.0f, -1.0f};
@@ -47,7 +47,7 @@ namespace CameraSystem {
 
     const glm::mat4 &GetProjectionMatrix(const Camera *camera);
 
-    TransformSystem::Transform *GetTransform(const Camera *camera);
+    TransformSystem::TransformHandle GetTransform(const Camera *camera);
 
     const glm::vec3 &GetPosition(const Camera *camera);
 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+
+#include "common.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+// content-addressed store for everything importers derive from source assets.
+// A key is the XXH64 of the source bytes, the importer version and its options,
+// so identical sources share one blob wherever they live. Blobs are written to a
+// temporary file and renamed into place, which keeps the directory safe to share
+// between several engine processes
+namespace DerivedCache {
+    struct Options {
+        std::filesystem::path directory = "Cache";
+        // least recently used blobs are deleted once the cache grows past this
+        uint64_t maxBytes = 2ull * 1024 * 1024 * 1024;
+    };
+
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t stores;
+        uint32_t evictions;
+        uint64_t bytes;
+    };
+
+    // scans the directory and trims it to the size limit
+    void Init(const Options &options = {});
+
+    // starts a key for kind with the importer's version, callers add the options
+    // that change the output and then the source bytes
+    Hash::Hasher BeginKey(DerivedAssetKind kind, uint32_t version);
+
+    // where the blob for key lives, whether or not it exists
+    std::filesystem::path GetPath(DerivedAssetKind kind, uint64_t key);
+
+    // path of a cached blob, empty on a miss. A hit marks the blob recently used
+    std::filesystem::path Find(DerivedAssetKind kind, uint64_t key);
+
+    // maps a cached blob, empty on a miss
+    FileView Load(DerivedAssetKind kind, uint64_t key);
+
+    // write fills the blob and returns false to abandon it. Safe to race with
+    // other threads and processes storing the same key
+    bool Store(DerivedAssetKind kind, uint64_t key,
+               const std::function<bool(std::ostream &)> &write);
+
+    // deletes least recently used blobs until the cache fits the size limit,
+    // along with temporaries left behind by crashed writers. Pinned blobs are kept
+    void Trim();
+
+    // keeps Trim in this process from deleting a blob something still reads from,
+    // pins nest and each needs its own Unpin
+    void Pin(const std::filesystem::path &path);
+
+    void Unpin(const std::filesystem::path &path);
+
+    void SetMaxBytes(uint64_t bytes);
+
+    Stats GetStats();
+
+    const char *GetName(DerivedAssetKind kind);
+
+    void CleanUp();
+}
@@ -3,3 +3,22 @@
 enum WindowedMode { WINDOWED, FULLSCREEN };
 
 enum ShaderType { VERTEX, FRAGMENT };
+
+enum class InstanceLayout { Full, Affine, Trs, TrsHalf };
+
+enum class VertexFormat { Standard, Packed };
+
+enum class TextureFormat { Uncompressed, BC1, BC3, BC5, BC7 };
+
+enum class GpuMemoryCategory {
+    Meshes,
+    Instances,
+    Textures,
+    RenderTargets,
+    Staging,
+    Count
+};
+
+enum class DerivedAssetKind { Mesh, Texture, Count };
+
+enum class StartupMilestone { Window, FirstFrame, SceneReady, Count };
@@ -23,6 +23,15 @@ namespace ErrorHandler {
         return oss.str();
     }
 
+    inline std::string FormatInfo(const std::string &message, const std::string &file,
+                                  const std::string &function, int line) {
+        std::ostringstream oss;
+        oss << "[INFO](" << function << "()," << file << "#" << line << "): " << message
+            << std::endl;
+
+        return oss.str();
+    }
+
     inline void ThrowError(const std::string &message, const std::string &file,
                            const std::string &function, int line) {
         std::cerr << FormatError(message, file, function, line);
@@ -33,4 +42,9 @@ namespace ErrorHandler {
                      const std::string &function, int line) {
         std::cerr << FormatWarning(message, file, function, line);
     }
+
+    inline void Info(const std::string &message, const std::string &file,
+                     const std::string &function, int line) {
+        std::cout << FormatInfo(message, file, function, line);
+    }
 }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "common.h"
+
+// change notifications for directory trees, backed by inotify. Other platforms
+// report nothing and Watch returns false
+namespace FileWatcher {
+    void Init();
+
+    // watches directory and every directory below it, including ones created
+    // later. Returns false when it is missing or watching is unsupported
+    bool Watch(const std::filesystem::path &directory);
+
+    // files written or moved into a watched directory since the last call. A file
+    // is reported once, after its events have settled, so a save that lands in
+    // several writes is only seen when complete. Never blocks
+    std::vector<std::filesystem::path> Poll();
+
+    void CleanUp();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+
+#include "common.h"
+
+namespace GpuMemory {
+    struct Usage {
+        size_t bytes;
+        uint32_t allocations;
+    };
+
+    struct Stats {
+        Usage categories[static_cast<size_t>(GpuMemoryCategory::Count)];
+        size_t total;
+        size_t budget;
+        size_t evictedBytes;
+        uint32_t evictions;
+        uint32_t reloads;
+        bool overBudget;
+    };
+
+    // evict frees the object's storage but keeps its name. reload queues it to be
+    // read back, reporting through Track once resident or ReloadFailed. restore
+    // reads it back at once for load time callers and may be empty. All run on
+    // the GL thread
+    struct Evictor {
+        std::function<void()> evict;
+        std::function<void()> reload;
+        std::function<bool()> restore;
+    };
+
+    void Init();
+
+    // records the bytes a GL object owns, replacing any earlier size for it. An
+    // evicted object is resident again
+    void Track(GpuMemoryCategory category, GLuint id, size_t bytes);
+
+    void Release(GpuMemoryCategory category, GLuint id);
+
+    // lets the budget evict the object when it has not been used recently
+    void SetEvictable(GpuMemoryCategory category, GLuint id, Evictor evictor);
+
+    // marks the object used this frame, queueing its reload if it was evicted.
+    // Returns false until it is resident again, draw a placeholder meanwhile
+    bool Touch(GpuMemoryCategory category, GLuint id);
+
+    // reads an evicted object back before returning, for callers that need its
+    // storage now rather than next frame. False when it could not
+    bool Restore(GpuMemoryCategory category, GLuint id);
+
+    // a queued reload could not complete, it is retried after a backoff
+    void ReloadFailed(GpuMemoryCategory category, GLuint id);
+
+    // true while the object is evicted, including while its reload is queued
+    bool IsEvicted(GpuMemoryCategory category, GLuint id);
+
+    // evicts least recently used objects until the total fits the budget. Objects
+    // used in the last few frames are never evicted. Call once per frame
+    void Update();
+
+    void SetBudget(size_t bytes);
+
+    size_t GetBudget();
+
+    size_t GetTotal();
+
+    Usage GetUsage(GpuMemoryCategory category);
+
+    Stats GetStats();
+
+    const char *GetName(GpuMemoryCategory category);
+
+    void CleanUp();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace Hash {
+    constexpr uint64_t FnvOffset = 14695981039346656037ull;
+
+    // FNV-1a 64, for short keys such as paths, names and single vertices
+    uint64_t Fnv1a(const void *data, size_t size, uint64_t hash = FnvOffset);
+
+    inline uint64_t Fnv1a(const std::string_view text, const uint64_t hash = FnvOffset) {
+        return Fnv1a(text.data(), text.size(), hash);
+    }
+
+    // FNV-1a 32, evaluated at compile time for literals, gives interned names
+    // their ids
+    constexpr uint32_t Fnv1a32(const std::string_view text) {
+        uint32_t hash = 2166136261u;
+        for (const char c : text) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    // XXH64, several GB/s, for whole files and derived asset keys
+    uint64_t XxHash64(const void *data, size_t size, uint64_t seed = 0);
+
+    // streaming XXH64, gives the same digest as one XxHash64 call over the
+    // concatenated input
+    class Hasher {
+       public:
+        explicit Hasher(uint64_t seed = 0);
+
+        void Update(const void *data, size_t size);
+
+        void Update(const std::string_view text) {
+            Update(text.data(), text.size());
+        }
+
+        // raw bytes of a plain value, hash struct members one by one so padding
+        // never reaches the digest
+        template <typename T>
+        void Add(const T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Update(&value, sizeof(T));
+        }
+
+        uint64_t Digest() const;
+
+       private:
+        uint64_t m_seed;
+        uint64_t m_lanes[4];
+        uint64_t m_length = 0;
+        uint8_t m_buffer[32];
+        size_t m_buffered = 0;
+    };
+}
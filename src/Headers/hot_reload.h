@@ -0,0 +1,15 @@
+#pragma once
+
+#include "common.h"
+
+// applies edits to assets while the engine runs: changed meshes and textures are
+// re-imported behind their existing handles, scene edits are applied as a diff
+namespace HotReload {
+    // watches the Models, Textures and Scenes mounts
+    void Init();
+
+    // call once per frame on the main thread, after ResourceManager::Update
+    void Update();
+
+    void CleanUp();
+}
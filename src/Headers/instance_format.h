@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+
+namespace InstanceFormat {
+    struct Attribute {
+        GLint components;
+        GLenum type;
+        GLboolean normalised;
+        size_t offset;
+    };
+
+    size_t GetStride(InstanceLayout layout);
+
+    const char *GetName(InstanceLayout layout);
+
+    // attributes for locations 3..7, components == 0 means the location is unused
+    void GetAttributes(InstanceLayout layout, Attribute (&attributes)[5]);
+
+    // layout, or Affine when it is a TRS layout and an instance's axes are not
+    // perpendicular. TRS has no room for shear, a 3x4 matrix keeps it exactly
+    InstanceLayout GetPackableLayout(InstanceLayout layout, const InstanceData *instances,
+                                     size_t count);
+
+    // converts full instances into the given layout, dst must hold count * stride
+    // bytes. Sheared instances lose their shear in the TRS layouts
+    void Pack(InstanceLayout layout, const InstanceData *src, size_t count, void *dst);
+}
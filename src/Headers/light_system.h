@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include "string_id.h"
 
 namespace LightSystem {
     enum class LightType { Directional, Point };
@@ -27,6 +28,8 @@ namespace LightSystem {
 
     Light *GetLight(const std::string &name);
 
+    Light *GetLight(StringId name);
+
     const std::vector<Light *> &GetAllLights();
 
     void CleanUp();
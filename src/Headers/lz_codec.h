@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// byte-oriented LZ77 in the LZ4 block layout: a token with literal and match
+// lengths, the literals, then a 16-bit back reference. Fast to decode, meant for
+// asset packs where decompression sits on the load path
+namespace Lz {
+    // compressed form of data, which can be larger than size for incompressible
+    // input. Inputs of 4GB or more are not supported and return nothing
+    std::vector<uint8_t> Compress(const uint8_t *data, size_t size);
+
+    // output must be exactly outputSize bytes once decoded, false on corrupt input
+    bool Decompress(const uint8_t *input, size_t inputSize, uint8_t *output,
+                    size_t outputSize);
+}
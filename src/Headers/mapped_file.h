@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "common.h"
+
+// read-only view of a whole file, mmap where available, otherwise a heap copy
+class MappedFile {
+   public:
+    explicit MappedFile(const std::filesystem::path &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *Data() const {
+        return m_data;
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+   private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> m_fallback;
+#endif
+};
+
+// bytes of one file, either a range of a mapping or a decoded copy. Valid while
+// any copy of the view lives
+class FileView {
+   public:
+    FileView() = default;
+
+    FileView(std::shared_ptr<const void> owner, const uint8_t *data, const size_t size)
+        : m_owner(std::move(owner)), m_data(data), m_size(size) {}
+
+    const uint8_t *Data() const {
+        return m_data;
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+    explicit operator bool() const {
+        return m_data != nullptr;
+    }
+
+   private:
+    std::shared_ptr<const void> m_owner;
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -4,6 +4,7 @@
 
 #include "common.h"
 #include "shader_system.h"
+#include "string_id.h"
 
 namespace MaterialSystem {
     struct Property {
@@ -22,38 +23,72 @@ namespace MaterialSystem {
     };
 
     struct Material {
-        std::string name;
-        ShaderSystem::Shader *shader;
-        std::unordered_map<std::string, Property> properties;
+        ShaderSystem::ShaderHandle shader;
+        std::unordered_map<StringId, Property> properties;
+        // bumped by every persistent Set, so an alias made from older values lapses
+        uint32_t revision = 0;
     };
 
+    using MaterialHandle = Handle<Material>;
+
     void Init();
 
-    Material *CreateMaterial(const std::string &name, const std::string &shaderName);
+    MaterialHandle CreateMaterial(const std::string &name, const std::string &shaderName);
+
+    // null for stale handles, valid until the next material is created or destroyed
+    Material *Get(MaterialHandle handle);
+
+    MaterialHandle Find(const std::string &name);
+
+    std::string GetName(MaterialHandle handle);
+
+    // drops the material's reference on its shader
+    void Destroy(MaterialHandle handle);
+
+    // counted references from entities. A material nothing references stays
+    // loaded until UnloadUnused
+    void AddRef(MaterialHandle handle);
+
+    void RemoveRef(MaterialHandle handle);
+
+    uint32_t GetRefCount(MaterialHandle handle);
+
+    // destroys every unreferenced material straight away, they own no GL objects.
+    // Returns the number destroyed
+    size_t UnloadUnused();
+
+    // live materials, placeholders and defaults included
+    size_t GetCount();
+
+    // aliases every material whose shader and persistent properties match an
+    // earlier one to it, so batches split only by a material's name draw together.
+    // Names and handles are untouched. Returns the number of materials aliased
+    size_t Canonicalise();
+
+    // the material the handle is aliased to, or the handle itself. An alias lapses
+    // once either material is changed or destroyed
+    MaterialHandle GetCanonical(MaterialHandle handle);
 
-    Material *GetMaterial(const std::string &name);
+    // properties are named by id, StringTable::GetString gives the name back
 
-    void SetFloat(Material *material, const std::string &name, float value,
-                  bool persistent = true);
+    void SetFloat(Material *material, StringId name, float value, bool persistent = true);
 
-    float GetFloat(const Material *material, const std::string &name,
-                   float defaultValue = 0.0f);
+    float GetFloat(const Material *material, StringId name, float defaultValue = 0.0f);
 
-    void SetInt(Material *material, const std::string &name, int value,
-                bool persistent = true);
+    void SetInt(Material *material, StringId name, int value, bool persistent = true);
 
-    int GetInt(const Material *material, const std::string &name, int defaultValue = 0);
+    int GetInt(const Material *material, StringId name, int defaultValue = 0);
 
-    void SetVec2(Material *material, const std::string &name, const glm::vec2 &value,
+    void SetVec2(Material *material, StringId name, const glm::vec2 &value,
                  bool persistent = true);
 
-    void SetVec3(Material *material, const std::string &name, const glm::vec3 &value,
+    void SetVec3(Material *material, StringId name, const glm::vec3 &value,
                  bool persistent = true);
 
-    void SetVec4(Material *material, const std::string &name, const glm::vec4 &value,
+    void SetVec4(Material *material, StringId name, const glm::vec4 &value,
                  bool persistent = true);
 
-    void SetMat4(Material *material, const std::string &name, const glm::mat4 &value,
+    void SetMat4(Material *material, StringId name, const glm::mat4 &value,
                  bool persistent = true);
 
     void Bind(const Material *material);
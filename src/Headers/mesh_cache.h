@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "common.h"
+#include "mesh_optimiser.h"
+#include "mesh_system.h"
+
+namespace MeshCache {
+    constexpr uint32_t Version = 1;
+
+    // on-disk layout: Header, Submesh table, then the vertex and index blobs, each
+    // starting on a BlobAlignment boundary so they can be handed to GL from a mapping
+    constexpr uint64_t BlobAlignment = 64;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t vertexFormat;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexType;
+        glm::vec3 minBounds;
+        glm::vec3 maxBounds;
+        uint32_t submeshCount;
+        uint32_t reserved;
+        uint64_t submeshOffset;
+        uint64_t vertexOffset;
+        uint64_t vertexSize;
+        uint64_t indexOffset;
+        uint64_t indexSize;
+    };
+
+    // hashes the source contents, import flags and optimiser options, returns
+    // nothing when the source can't be read. sourcePath may be virtual
+    std::optional<uint64_t> ComputeKey(const std::string &sourcePath,
+                                       uint32_t importFlags,
+                                       const MeshOptimiser::Options &options);
+
+    // maps a mesh from the derived asset cache and uploads it directly, a null
+    // handle on a miss
+    MeshSystem::MeshHandle Load(const std::string &name, uint64_t key);
+
+    // copies a cached mesh into data without touching GL, false on a miss
+    bool Read(uint64_t key, MeshSystem::MeshData &data);
+
+    bool Store(uint64_t key, const MeshSystem::MeshData &data);
+}
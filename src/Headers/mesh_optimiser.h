@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+
+namespace MeshOptimiser {
+    struct Options {
+        bool deduplicate = true;
+        bool optimiseVertexCache = true;
+        bool optimiseOverdraw = true;
+        bool optimiseVertexFetch = true;
+        bool quantise = false;
+        uint32_t cacheSize = 16;
+        // overdraw ordering is rejected if it raises ACMR above this factor
+        float overdrawThreshold = 1.05f;
+    };
+
+    struct CacheStats {
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    // simulates a FIFO post-transform cache over an indexed triangle list
+    CacheStats AnalyseVertexCache(const std::vector<uint32_t> &indices,
+                                  uint32_t vertexCount, uint32_t cacheSize);
+
+    void DeduplicateVertices(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices);
+
+    // Tipsify (Sander et al. 2007)
+    void OptimiseVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount,
+                             uint32_t cacheSize);
+
+    void OptimiseOverdraw(std::vector<uint32_t> &indices,
+                          const std::vector<Vertex> &vertices, uint32_t cacheSize,
+                          float threshold);
+
+    void OptimiseVertexFetch(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices);
+
+    // runs the enabled stages in order, returns cache stats before and after
+    std::pair<CacheStats, CacheStats> Optimise(std::vector<Vertex> &vertices,
+                                               std::vector<uint32_t> &indices,
+                                               const Options &options);
+
+    std::vector<PackedVertex> Quantise(const std::vector<Vertex> &vertices);
+
+    // the inverse of Quantise, normals and uvs keep its rounding
+    std::vector<Vertex> Dequantise(const std::vector<PackedVertex> &vertices);
+}
@@ -3,8 +3,16 @@
 #include <vector>
 
 #include "common.h"
+#include "slot_map.h"
 
 namespace MeshSystem {
+    struct Submesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t baseVertex;
+        uint32_t vertexCount;
+    };
+
     struct Mesh {
         GLuint vao;
         GLuint vbo;
@@ -12,28 +20,136 @@ namespace MeshSystem {
         uint32_t vertexCount;
         uint32_t indexCount;
         bool hasIndices;
-        std::string name;
+        GLenum indexType = GL_UNSIGNED_INT;
+        VertexFormat vertexFormat = VertexFormat::Standard;
         GLuint instanceVBO = 0;
+        // bytes allocated for instanceVBO, kept across layout changes that fit
+        size_t instanceBufferSize = 0;
         uint32_t maxInstances = 0;
         uint32_t instanceCount = 0;
+        InstanceLayout instanceLayout = InstanceLayout::Full;
         bool isInstanced;
         glm::vec3 minBounds;
         glm::vec3 maxBounds;
+        std::vector<Submesh> submeshes;
         std::string path;
+        // a view owns only its VAO and instance buffer, the rest is borrowed
+        bool isView = false;
+        // of the format, vertices and indices the buffers were made from, a view
+        // has its source's
+        uint64_t contentHash = 0;
+    };
+
+    using MeshHandle = Handle<Mesh>;
+
+    // CPU-side mesh produced off the main thread, vertices are raw bytes in format
+    struct MeshData {
+        VertexFormat format = VertexFormat::Standard;
+        std::vector<uint8_t> vertices;
+        uint32_t vertexCount = 0;
+        std::vector<uint32_t> indices;
+        std::vector<Submesh> submeshes;
     };
 
     void Init();
 
-    Mesh *CreateMesh(const std::string &name, const std::vector<Vertex> &vertices,
-                     const std::vector<uint32_t> &indices = std::vector<uint32_t>());
+    // an empty name leaves the mesh out of the name index
+
+    MeshHandle CreateMesh(const std::string &name, const std::vector<Vertex> &vertices,
+                          const std::vector<uint32_t> &indices = std::vector<uint32_t>());
+
+    MeshHandle CreateMesh(const std::string &name,
+                          const std::vector<PackedVertex> &vertices,
+                          const std::vector<uint32_t> &indices = std::vector<uint32_t>());
+
+    // indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, indexData may be null.
+    // bounds holds min and max, they are computed from the positions when null
+    MeshHandle CreateMesh(const std::string &name, VertexFormat format,
+                          const void *vertexData, uint32_t vertexCount,
+                          const void *indexData, uint32_t indexCount, GLenum indexType,
+                          const glm::vec3 *bounds = nullptr);
+
+    MeshHandle CreateMesh(const std::string &name, const MeshData &data);
+
+    // a mesh drawing source's buffers through its own VAO, so it can be instanced
+    // independently
+    MeshHandle CreateView(const std::string &name, MeshHandle source);
+
+    // moves source into target's slot, freeing what target held. Handles to target
+    // now reach source's buffers and source's handle goes stale
+    bool Replace(MeshHandle target, MeshHandle source);
+
+    void Destroy(MeshHandle handle);
+
+    // null for stale handles, valid until the next mesh is created or destroyed
+    Mesh *Get(MeshHandle handle);
+
+    // Find and GetName may be called from any thread, the rest of the system
+    // belongs to the thread owning the GL context
+    MeshHandle Find(const std::string &name);
+
+    std::string GetName(MeshHandle handle);
+
+    // counted references from entities. A mesh nothing references stays loaded
+    // until UnloadUnused
+    void AddRef(MeshHandle handle);
+
+    void RemoveRef(MeshHandle handle);
+
+    uint32_t GetRefCount(MeshHandle handle);
+
+    // queues every unreferenced mesh for deferred destruction, one that gains a
+    // reference before its turn comes is kept. Returns the number queued
+    size_t UnloadUnused();
+
+    // live meshes, placeholders and defaults included
+    size_t GetCount();
+
+    // aliases every mesh whose vertices and indices match an earlier one's to it,
+    // so the same geometry imported under several names draws as one batch. The
+    // duplicates' buffers go unused and are left for GpuMemory to evict. Returns
+    // the number of meshes aliased
+    size_t Canonicalise();
+
+    // the mesh the handle is aliased to, or the handle itself. An alias lapses
+    // once either mesh is replaced or destroyed
+    MeshHandle GetCanonical(MeshHandle handle);
+
+    // frees the vertex and index storage but keeps the buffer names, so copies and
+    // views of the mesh stay valid and RestoreBuffers can refill them
+    void EvictBuffers(const Mesh *mesh);
+
+    // data must be the mesh's own, re-read from its source. The caller tracks the
+    // buffers again once the GPU has the data
+    bool RestoreBuffers(const Mesh *mesh, const MeshData &data);
+
+    // the vertex and index storage the mesh owns while resident
+    size_t GetBufferBytes(const Mesh *mesh);
+
+    // copies the mesh's vertices and indices back from its buffers, reloading them
+    // first if they were evicted. Packed vertices come back unpacked and a mesh
+    // without indices gets one per vertex. Stalls until the GPU has the data, for
+    // load time work such as baking
+    bool ReadBack(const Mesh *mesh, std::vector<Vertex> &vertices,
+                  std::vector<uint32_t> &indices);
+
+    size_t GetVertexStride(VertexFormat format);
+
+    void SetupInstancedMesh(Mesh *mesh, uint32_t maxInstances,
+                            InstanceLayout layout = InstanceLayout::Full);
 
-    Mesh *GetMesh(const std::string &name);
+    // packs into the mesh's instance layout, returns the number of bytes uploaded
+    size_t UpdateInstanceData(Mesh *mesh, const InstanceData *instances, uint32_t count);
 
-    void SetupInstancedMesh(Mesh *mesh, uint32_t maxInstances);
+    // marks the mesh used this frame. While its buffers are evicted it queues
+    // their reload and returns the placeholder, null if there is none
+    Mesh *GetResident(Mesh *mesh);
 
-    void UpdateInstanceData(Mesh *mesh, const std::vector<InstanceData> &instances);
+    // stands in for evicted meshes, usually the default cube
+    void SetPlaceholder(MeshHandle mesh);
 
-    void Bind(const Mesh *mesh);
+    // returns false when the mesh's buffers are evicted
+    bool Bind(const Mesh *mesh);
 
     void Unbind();
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional>
+
+#include "common.h"
+
+namespace ReleaseQueue {
+    // frames a released GL object outlives its last user, so commands already
+    // queued for earlier frames never reference a deleted name
+    constexpr uint32_t FrameDelay = 3;
+
+    void Init();
+
+    // release runs on the main thread FrameDelay frames from now
+    void Enqueue(std::function<void()> release);
+
+    // runs releases that are due, call once per frame
+    void Update();
+
+    // runs every pending release now, for shutdown
+    void Flush();
+
+    size_t GetPending();
+
+    void CleanUp();
+}
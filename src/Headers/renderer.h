@@ -1,27 +1,63 @@
 #pragma once
 
+#include "bvh.h"
 #include "material_system.h"
 #include "mesh_system.h"
 #include "texture_system.h"
 
 namespace Renderer {
     struct BatchGroup {
-        MeshSystem::Mesh *mesh;
-        MaterialSystem::Material *material;
-        TextureSystem::Texture *texture;
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
         std::vector<InstanceData> instances;
     };
 
+    struct Stats {
+        uint32_t instanceCount = 0;
+        size_t instanceBytes = 0;
+        float instanceUploadMs = 0.0f;
+        uint32_t staticDrawn = 0;
+        uint32_t staticCulled = 0;
+        // batches drawn, and those merged into another because their mesh and
+        // material are aliased to the same canonical ones
+        uint32_t batches = 0;
+        uint32_t collapsedBatches = 0;
+    };
+
     void Init();
 
     void SetClearColor(const glm::vec4 &color);
 
     glm::vec4 GetClearColor();
 
-    void SubmitInstanced(MeshSystem::Mesh *mesh, MaterialSystem::Material *material,
-                         TextureSystem::Texture *texture, const glm::mat4 &modelMatrix,
+    void SetInstanceLayout(InstanceLayout layout);
+
+    InstanceLayout GetInstanceLayout();
+
+    const Stats &GetStats();
+
+    void SubmitInstanced(MeshSystem::MeshHandle mesh,
+                         MaterialSystem::MaterialHandle material,
+                         TextureSystem::TextureHandle texture,
+                         const glm::mat4 &modelMatrix,
                          const glm::vec4 &color = glm::vec4(1.0f));
 
+    // makes room for count more instances in the batch, so a bulk spawn doesn't
+    // grow it one reallocation at a time. Batches keep their storage between
+    // frames while they are drawn
+    void ReserveInstances(MeshSystem::MeshHandle mesh,
+                          MaterialSystem::MaterialHandle material,
+                          TextureSystem::TextureHandle texture, size_t count);
+
+    // draws a mesh already in world space once this frame, unless bounds is
+    // outside the view. Meant for baked static geometry, each mesh keeps a single
+    // instance of the colour and needs its own handle
+    void SubmitStatic(MeshSystem::MeshHandle mesh,
+                      MaterialSystem::MaterialHandle material,
+                      TextureSystem::TextureHandle texture, const glm::vec4 &color,
+                      const Aabb &bounds);
+
     void Render(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
                 const glm::vec3 &cameraPosition);
 
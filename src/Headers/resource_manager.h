@@ -7,6 +7,7 @@
 
 #include "common.h"
 #include "material_system.h"
+#include "mesh_optimiser.h"
 #include "mesh_system.h"
 #include "shader_system.h"
 #include "texture_system.h"
@@ -14,52 +15,93 @@
 namespace ResourceManager {
     void Init();
 
-    MeshSystem::Mesh *LoadMesh(const std::string &name, const std::string &filePath);
+    // finishes background loads, call once per frame on the main thread
+    void Update();
 
-    MeshSystem::Mesh *GetMesh(const std::string &name);
+    bool IsLoading();
 
-    TextureSystem::Texture *LoadTexture(const std::string &name,
-                                        const std::string &filePath,
-                                        bool generateMips = true);
+    // frees meshes, textures, shaders and materials nothing references any more,
+    // run after a scene transition. GL objects go a few frames later through the
+    // release queue. Returns the number of resources released
+    size_t UnloadUnused();
 
-    TextureSystem::Texture *GetTexture(const std::string &name);
+    // aliases materials with the same shader and properties, and meshes with the
+    // same vertices and indices, to one of each so the renderer batches them
+    // together. Handles and names stay as they were, a saved scene keeps its
+    // names. Meshes still loading are aliased as they arrive. Run after a scene
+    // load, returns the number of resources aliased
+    size_t Canonicalise();
 
-    ShaderSystem::Shader *LoadShader(const std::string &name, const std::string &vertPath,
-                                     const std::string &fragPath);
+    // after Init meshes and textures load asynchronously. The handle returned
+    // shows a placeholder (the default cube or texture) until the resource is
+    // resident, then the same handle reaches the real one
 
-    ShaderSystem::Shader *GetShader(const std::string &name);
+    MeshSystem::MeshHandle LoadMesh(const std::string &name, const std::string &filePath);
 
-    MaterialSystem::Material *CreateMaterial(const std::string &name,
-                                             const std::string &shaderName,
-                                             bool useTexture = false);
+    MeshSystem::MeshHandle GetMesh(const std::string &name);
 
-    MaterialSystem::Material *GetMaterial(const std::string &name);
+    void SetMeshImportOptions(const MeshOptimiser::Options &options);
 
-    MeshSystem::Mesh *GetDefaultCubeMesh();
+    const MeshOptimiser::Options &GetMeshImportOptions();
 
-    MeshSystem::Mesh *GetDefaultPlaneMesh();
+    // a mesh's vertices and indices without touching GL, read from the mesh cache
+    // or, on a miss or when forceImport is set, imported through Assimp and stored
+    bool DecodeMeshData(const std::string &filePath, MeshSystem::MeshData &data,
+                        bool forceImport = false);
 
-    TextureSystem::Texture *GetDefaultTexture();
+    TextureSystem::TextureHandle LoadTexture(const std::string &name,
+                                             const std::string &filePath,
+                                             bool generateMips = true);
 
-    ShaderSystem::Shader *GetDefaultShader();
+    TextureSystem::TextureHandle GetTexture(const std::string &name);
 
-    MaterialSystem::Material *GetDefaultMaterial();
+    // re-imports every mesh or texture loaded from a virtual path on a loader
+    // thread. Each swaps in behind its existing handle once resident. Returns the
+    // number queued
+    size_t ReloadMesh(const std::string &virtualPath);
 
-    MeshSystem::Mesh *CreateDefaultCubeMesh();
+    size_t ReloadTexture(const std::string &virtualPath);
 
-    MeshSystem::Mesh *CreateDefaultPlaneMesh();
+    ShaderSystem::ShaderHandle LoadShader(const std::string &name,
+                                          const std::string &vertPath,
+                                          const std::string &fragPath);
 
-    TextureSystem::Texture *CreateDefaultTexture();
+    ShaderSystem::ShaderHandle GetShader(const std::string &name);
 
-    ShaderSystem::Shader *CreateDefaultShader();
+    MaterialSystem::MaterialHandle CreateMaterial(const std::string &name,
+                                                  const std::string &shaderName,
+                                                  bool useTexture = false);
 
-    MaterialSystem::Material *CreateDefaultMaterial();
+    MaterialSystem::MaterialHandle GetMaterial(const std::string &name);
+
+    // the defaults are made on first use, here or when their name ("cube",
+    // "plane" or "default") is loaded or looked up, and are never unloaded
+    MeshSystem::MeshHandle GetDefaultCubeMesh();
+
+    MeshSystem::MeshHandle GetDefaultPlaneMesh();
+
+    TextureSystem::TextureHandle GetDefaultTexture();
+
+    ShaderSystem::ShaderHandle GetDefaultShader();
+
+    MaterialSystem::MaterialHandle GetDefaultMaterial();
+
+    MeshSystem::MeshHandle CreateDefaultCubeMesh();
+
+    MeshSystem::MeshHandle CreateDefaultPlaneMesh();
+
+    TextureSystem::TextureHandle CreateDefaultTexture();
+
+    ShaderSystem::ShaderHandle CreateDefaultShader();
+
+    MaterialSystem::MaterialHandle CreateDefaultMaterial();
 
     void ProcessAssimpMesh(const aiScene *scene, const aiMesh *mesh,
                            std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
 
     bool LoadMeshDataFromFile(const std::string &filePath, std::vector<Vertex> &vertices,
-                              std::vector<uint32_t> &indices);
+                              std::vector<uint32_t> &indices,
+                              std::vector<MeshSystem::Submesh> *submeshes = nullptr);
 
     void CleanUp();
 }
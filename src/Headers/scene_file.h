@@ -0,0 +1,195 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <toml++/toml.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+
+// binary twin of the TOML scene files, read through one mapping with a bulk copy
+// per section instead of a parse. Every string is stored once and referred to by
+// index, meshes, textures, shaders and materials are tables the entities index
+// into, and each entity field is a packed array indexed by entity. TOML stays the
+// editable source, scene-convert turns either format into the other
+namespace SceneFile {
+    constexpr uint32_t Version = 1;
+
+    constexpr std::string_view Extension = ".scene";
+
+    // an absent string, resource, parent or light
+    constexpr uint32_t None = UINT32_MAX;
+
+    // on-disk layout: Header, then the sections in this order, each starting on
+    // an 8 byte boundary. The sections from EntityNames on hold one value per
+    // entity
+    enum class Section : uint32_t {
+        Strings,
+        Characters,
+        Lights,
+        Meshes,
+        Textures,
+        Shaders,
+        Materials,
+        Properties,
+        Values,
+        EntityNames,
+        Parents,
+        EntityLights,
+        Flags,
+        Colors,
+        Transforms,
+        Resources,
+        Count,
+    };
+
+    constexpr size_t SectionCount = static_cast<size_t>(Section::Count);
+
+    struct SectionRange {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Camera {
+        uint32_t name = None;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint32_t sceneName;
+        Camera camera;
+        uint32_t reserved;
+        SectionRange sections[SectionCount];
+    };
+
+    // a range of the characters section
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    enum class LightType : uint32_t { Directional, Point };
+
+    struct Light {
+        uint32_t name;
+        LightType type;
+        glm::vec3 position;
+        glm::vec3 direction;
+        glm::vec3 color;
+        float intensity;
+    };
+
+    struct Mesh {
+        uint32_t name;
+        uint32_t path;
+    };
+
+    struct Texture {
+        uint32_t name;
+        uint32_t path;
+    };
+
+    struct Shader {
+        uint32_t name;
+        uint32_t vertexPath;
+        uint32_t fragmentPath;
+    };
+
+    // the material's properties are a run of the properties section
+    struct Material {
+        uint32_t name;
+        uint32_t shader;
+        uint32_t firstProperty;
+        uint32_t propertyCount;
+    };
+
+    enum class PropertyType : uint32_t { Float, Int, Vec2, Vec3, Vec4, Mat4 };
+
+    // the value is a run of 32-bit words in the values section, floats and ints by
+    // their bits. A Mat4 is 16 floats column by column
+    struct Property {
+        uint32_t name;
+        PropertyType type;
+        uint32_t firstValue;
+    };
+
+    struct Transform {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    // indices into the mesh, texture and material tables
+    struct Resources {
+        uint32_t mesh = None;
+        uint32_t texture = None;
+        uint32_t material = None;
+    };
+
+    enum EntityFlags : uint32_t {
+        Static = 1 << 0,
+    };
+
+    // the words a property of the type takes
+    uint32_t GetValueCount(PropertyType type);
+
+    struct Scene {
+        uint32_t name = None;
+        Camera camera;
+
+        std::vector<StringRef> strings;
+        std::string characters;
+        std::vector<Light> lights;
+        std::vector<Mesh> meshes;
+        std::vector<Texture> textures;
+        std::vector<Shader> shaders;
+        std::vector<Material> materials;
+        std::vector<Property> properties;
+        std::vector<uint32_t> values;
+
+        std::vector<uint32_t> entityNames;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> entityLights;
+        std::vector<uint32_t> flags;
+        std::vector<glm::vec4> colors;
+        std::vector<Transform> transforms;
+        std::vector<Resources> resources;
+
+        // empty for None
+        std::string_view GetString(uint32_t index) const;
+
+        // the index of an equal string added before, or of a new one
+        uint32_t AddString(std::string_view text);
+
+        size_t GetEntityCount() const {
+            return entityNames.size();
+        }
+
+       private:
+        // only filled while building, a scene that was read adds strings as new
+        std::unordered_map<std::string, uint32_t> m_stringIndex;
+    };
+
+    // checks the header, section bounds and every index, then copies each section
+    // into its array. False when the data is not a valid scene of this version
+    bool Read(const uint8_t *data, size_t size, Scene &scene);
+
+    bool Read(const std::filesystem::path &path, Scene &scene);
+
+    // written next to the target and renamed, a failed write leaves no partial file
+    bool Write(const Scene &scene, const std::filesystem::path &path);
+
+    // the scene a TOML document describes, read the way Serialisation reads it:
+    // the first mesh, texture, shader or material of a name wins and later
+    // property blocks of a material are merged into it
+    Scene FromToml(const toml::table &document);
+
+    // the document Serialisation would have written for the scene
+    toml::table ToToml(const Scene &scene);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+// loads a scene over several frames instead of stalling the one it starts in.
+// The file is read and parsed into a SceneFile::Scene on a background thread,
+// then turned into a queue of work items (a shader to compile, a mesh or texture
+// to hand to the async loader, a material or an entity to make) run on the main
+// thread within a per-frame time budget. Entities appear as they are made and
+// show placeholders until their meshes and textures are resident. TOML and
+// binary scenes take the same path
+namespace SceneLoader {
+    struct Progress {
+        std::string filename;
+        // the file is still being read and parsed, there are no items yet
+        bool parsing;
+        uint32_t completed;
+        uint32_t total;
+        float elapsedMs;
+    };
+
+    // the current scene stays until the new file is parsed, a load already
+    // running is abandoned. False when the file is not in the Scenes mount
+    bool Begin(const std::string &filename);
+
+    // runs work items until the frame budget is spent, at least one per frame.
+    // Call once per frame on the main thread
+    void Update();
+
+    // the whole load in one call, for callers that need the scene straight away.
+    // False when it could not be read or has no camera
+    bool Load(const std::string &filename);
+
+    bool IsLoading();
+
+    Progress GetProgress();
+
+    void SetFrameBudget(float milliseconds);
+
+    float GetFrameBudget();
+
+    void CleanUp();
+}
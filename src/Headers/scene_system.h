@@ -1,39 +1,143 @@
 #pragma once
 
+#include <functional>
+#include <span>
+
+#include "bvh.h"
 #include "common.h"
 #include "light_system.h"
 #include "material_system.h"
 #include "mesh_system.h"
+#include "slot_map.h"
+#include "static_geometry.h"
 #include "texture_system.h"
 #include "transform_system.h"
 
+// entities are dense 32-bit ids. Each component type is a sparse set that packs
+// its values into one array, so Update walks only the entities it draws. Drawn
+// entities are also kept in a BVH over their world bounds for spatial queries.
+// Static entities are baked into shared world space chunks instead, they skip
+// the per-frame submit and bounds update until one is edited
 namespace SceneSystem {
-    struct Entity {
-        std::string name;
-        mutable MeshSystem::Mesh *mesh = nullptr;
-        mutable MaterialSystem::Material *material = nullptr;
-        mutable TextureSystem::Texture *texture = nullptr;
-        TransformSystem::Transform *transform = nullptr;
-        bool isActive = true;
+    // only an id type, the components live in the system's sets
+    struct Entity {};
+
+    using EntityId = Handle<Entity>;
+
+    // what the renderer draws for an entity. The resource handles are counted
+    // references, assign them through SetMesh, SetMaterial and SetTexture
+    struct Render {
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
         glm::vec4 color = glm::vec4(1.0f);
     };
 
+    struct RayHit {
+        EntityId entity;
+        float distance = std::numeric_limits<float>::infinity();
+    };
+
     void Init();
 
-    Entity *CreateEntity(const std::string &name, const glm::vec4 &color);
+    // an entity of the same name is destroyed first
+    EntityId CreateEntity(const std::string &name, const glm::vec4 &color);
+
+    // spawns one entity per transform, all drawn with the prototype's mesh,
+    // material and texture, each taking a reference to them. colors is empty for
+    // the prototype's colour or holds one per transform. Without a name prefix the
+    // entities are unnamed: no string is allocated, Find can't reach them and they
+    // aren't saved with the scene. Otherwise entity i is named prefix + i
+    std::vector<EntityId> SpawnEntities(const Render &prototype,
+                                        std::span<const TransformSystem::Trs> transforms,
+                                        std::span<const glm::vec4> colors = {},
+                                        const std::string &namePrefix = {});
+
+    // a small cube drawn at a point light and linked to it
+    EntityId CreateLightEntity(const LightSystem::Light *light);
+
+    EntityId Find(const std::string &name);
+
+    bool IsValid(EntityId entity);
+
+    // empty for a stale id or an unnamed entity
+    std::string GetName(EntityId entity);
+
+    TransformSystem::TransformHandle GetTransform(EntityId entity);
+
+    // null for a stale id. Valid until the next entity is created or destroyed
+    Render *GetRender(EntityId entity);
+
+    // the light the entity stands for, null when it isn't linked to one
+    LightSystem::Light *GetLight(EntityId entity);
+
+    void SetLight(EntityId entity, const std::string &light);
+
+    // inactive entities aren't drawn
+    bool IsActive(EntityId entity);
+
+    void SetActive(EntityId entity, bool active);
+
+    // a static entity is drawn from baked geometry, read when its chunk is baked.
+    // Its transform and colour are assumed not to change, call MarkChanged after
+    // editing either so the chunk is baked again
+    bool IsStatic(EntityId entity);
+
+    void SetStatic(EntityId entity, bool isStatic);
+
+    // queues a static entity's chunk to be baked again on the next Update. The
+    // setters here do it themselves
+    void MarkChanged(EntityId entity);
+
+    void SetMesh(EntityId entity, MeshSystem::MeshHandle mesh);
+
+    void SetMaterial(EntityId entity, MaterialSystem::MaterialHandle material);
+
+    void SetTexture(EntityId entity, TextureSystem::TextureHandle texture);
+
+    // an empty id makes the entity a root. False when either id is stale or the
+    // parent is the entity itself or one of its descendants
+    bool SetParent(EntityId entity, EntityId parent);
+
+    EntityId GetParent(EntityId entity);
+
+    // every live entity. Destroying one moves the last into its place
+    const std::vector<EntityId> &GetAllEntities();
+
+    // drops the entity's resource references and its transform, its children
+    // become roots
+    void DestroyEntity(EntityId entity);
+
+    // stale ids are skipped. Pass a copy of GetAllEntities, destroying reorders it
+    void DestroyEntities(std::span<const EntityId> entities);
+
+    // destroys every entity the predicate returns true for, returns how many
+    size_t DestroyEntitiesIf(const std::function<bool(EntityId)> &predicate);
+
+    // the queries cover the entities drawn by the last Update, by the world
+    // bounds of their meshes
+
+    std::vector<EntityId> QueryBox(const Aabb &box);
+
+    std::vector<EntityId> QuerySphere(const glm::vec3 &center, float radius);
 
-    Entity *CreateLightEntity(const LightSystem::Light *light);
+    std::vector<EntityId> QueryFrustum(const Frustum &frustum);
 
-    Entity *GetEntity(const std::string &name);
+    // the nearest entity whose mesh bounds, in the entity's own space, the ray
+    // enters. Distances are in units of direction's length
+    RayHit Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                   float maxDistance = std::numeric_limits<float>::infinity());
 
-    const std::vector<Entity *> &GetAllEntities();
+    Bvh::Stats GetSpatialStats();
 
-    void DestroyEntity(const std::string &name);
+    StaticGeometry::Stats GetStaticStats();
 
     void SetSceneName(const std::string &name);
 
     std::string GetSceneName();
 
+    // submits the drawn dynamic entities and refreshes their bounds in the BVH,
+    // then rebakes the static chunks that changed
     void Update();
 
     void CleanUp();
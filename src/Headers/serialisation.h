@@ -5,27 +5,49 @@
 
 #include "common.h"
 #include "scene_system.h"
+#include "virtual_file_system.h"
 
 namespace Serialisation {
     bool Serialise(const std::string &filename, const std::string &sceneName);
 
+    // the scene in the binary format of SceneFile, next to filename with its
+    // extension replaced. Made from the same document Serialise writes
+    bool SerialiseBinary(const std::string &filename, const std::string &sceneName);
+
+    // the whole scene in one call through SceneLoader::Load, which reads a
+    // filename ending in SceneFile::Extension as a binary scene
     bool Deserialise(const std::string &filename);
 
-    bool DeserialiseCamera(const toml::table &scene);
+    // re-reads the loaded scene and applies only what changed since it was loaded
+    // or saved: entities are created, destroyed or updated section by section
+    // without clearing the scene. False when filename is not the loaded scene
+    bool ApplyChanges(const std::string &filename);
+
+    // what ApplyChanges diffs against from now on, for loaders outside this file.
+    // An empty document stops edits applying until the next load or save
+    void SetLoadedScene(const std::string &filename, toml::table scene);
+
+    // the helpers below apply single sections of a scene document for
+    // ApplyChanges, scene loads go through SceneLoader
 
-    bool DeserialiseEntities(const toml::table &scene);
+    // leaves the entity's parent to DeserialiseParent, which needs the parent to
+    // exist already
+    SceneSystem::EntityId DeserialiseEntity(const toml::table &entityTable);
+
+    // an entity without a parent field becomes a root
+    void DeserialiseParent(SceneSystem::EntityId entity, const toml::table &entityTable);
 
     void DeserialiseLights(const toml::table &scene);
 
-    void DeserialiseTransform(const SceneSystem::Entity *entity,
+    void DeserialiseTransform(SceneSystem::EntityId entity,
                               const toml::table &transformTable);
 
-    void DeserialiseMesh(const SceneSystem::Entity *entity, const toml::table &meshTable);
+    void DeserialiseMesh(SceneSystem::EntityId entity, const toml::table &meshTable);
 
-    void DeserialiseTexture(const SceneSystem::Entity *entity,
+    void DeserialiseTexture(SceneSystem::EntityId entity,
                             const toml::table &textureTable);
 
-    void DeserialiseMaterial(const SceneSystem::Entity *entity,
+    void DeserialiseMaterial(SceneSystem::EntityId entity,
                              const toml::table &materialTable);
 
     void DeserialiseMaterialProperties(MaterialSystem::Material *material,
@@ -91,20 +113,8 @@ namespace Serialisation {
         return filename;
     }
 
+    // new scenes are written into the Scenes mount, the CWD when it was not found
     inline std::filesystem::path GetScenesPath() {
-        std::filesystem::path paths[] = {"Scenes", "../Scenes", "../../Scenes",
-                                         "gl-gfx/Scenes"};
-
-        for (const auto &path : paths) {
-            if (std::filesystem::exists(path)) {
-                return path;
-            }
-        }
-
-        ErrorHandler::Warn("Couldn't determine scenes directory, using CWD: " +
-                               std::filesystem::current_path().string(),
-                           __FILE__, __func__, __LINE__);
-
-        return "";
+        return VirtualFileSystem::GetMountPath("Scenes");
     }
 }
@@ -5,6 +5,8 @@
 namespace ShaderManager {
     GLuint CreateProgram(const std::string &vPath, const std::string &fPath);
 
+    void DeleteProgram(GLuint program);
+
     void CleanUp();
 
     inline GLenum ShaderTypeToGL(ShaderType type) {
@@ -1,38 +1,66 @@
 #pragma once
 
 #include "common.h"
+#include "slot_map.h"
+#include "string_id.h"
 
 namespace ShaderSystem {
     struct Shader {
         GLuint programId;
         std::string vertPath;
         std::string fragPath;
-        std::string name;
         bool isValid;
     };
 
+    using ShaderHandle = Handle<Shader>;
+
     void Init();
 
-    Shader *CreateShader(const std::string &name, const std::string &vertPath,
-                         const std::string &fragPath);
+    ShaderHandle CreateShader(const std::string &name, const std::string &vertPath,
+                              const std::string &fragPath);
+
+    // null for stale handles, valid until the next shader is created or destroyed
+    Shader *Get(ShaderHandle handle);
+
+    ShaderHandle Find(const std::string &name);
+
+    std::string GetName(ShaderHandle handle);
+
+    void Destroy(ShaderHandle handle);
 
-    Shader *GetShader(const std::string &name);
+    // counted references from materials. A shader nothing references stays
+    // loaded until UnloadUnused
+    void AddRef(ShaderHandle handle);
+
+    void RemoveRef(ShaderHandle handle);
+
+    uint32_t GetRefCount(ShaderHandle handle);
+
+    // queues every unreferenced shader for deferred destruction, one that gains a
+    // reference before its turn comes is kept. Returns the number queued
+    size_t UnloadUnused();
+
+    // live shaders, placeholders and defaults included
+    size_t GetCount();
 
     void Bind(const Shader *shader);
 
     void Unbind();
 
-    void SetFloat(const Shader *shader, const std::string &name, float value);
+    // uniforms are set by id, the names of every active uniform are interned and
+    // their locations cached when the shader is created
+
+    void SetFloat(const Shader *shader, StringId name, float value);
 
-    void SetInt(const Shader *shader, const std::string &name, int value);
+    void SetInt(const Shader *shader, StringId name, int value);
 
-    void SetVec2(const Shader *shader, const std::string &name, const glm::vec2 &value);
+    void SetVec2(const Shader *shader, StringId name, const glm::vec2 &value);
 
-    void SetVec3(const Shader *shader, const std::string &name, const glm::vec3 &value);
+    void SetVec3(const Shader *shader, StringId name, const glm::vec3 &value);
 
-    void SetVec4(const Shader *shader, const std::string &name, const glm::vec4 &value);
+    void SetVec4(const Shader *shader, StringId name, const glm::vec4 &value);
 
-    void SetMat4(const Shader *shader, const std::string &name, const glm::mat4 &value);
+    void SetMat4(const Shader *shader, StringId name, const glm::mat4 &value);
 
     void CleanUp();
 }
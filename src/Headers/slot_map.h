@@ -0,0 +1,370 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 32-bit reference into a SlotMap, the low bits index a slot and the high bits
+// hold the slot's generation when the handle was made. Removing a resource bumps
+// the generation, so stale handles stop resolving. Zero is never handed out
+template <typename T>
+struct Handle {
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+    static constexpr uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+    uint32_t value = 0;
+
+    static Handle Make(const uint32_t index, const uint32_t generation) {
+        return Handle{generation << IndexBits | index};
+    }
+
+    uint32_t GetIndex() const {
+        return value & IndexMask;
+    }
+
+    uint32_t GetGeneration() const {
+        return value >> IndexBits;
+    }
+
+    explicit operator bool() const {
+        return value != 0;
+    }
+
+    bool operator==(const Handle &other) const = default;
+};
+
+// resources packed in a dense array for iteration, with a slot table mapping
+// handles to them. Removal moves the last resource into the hole, so pointers
+// from Get are only valid until the next Insert or Remove
+template <typename T>
+class SlotMap {
+   public:
+    Handle<T> Insert(T value) {
+        uint32_t index;
+        if (!m_freeSlots.empty()) {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_slots.size());
+            if (index > Handle<T>::IndexMask) {
+                return {};
+            }
+
+            m_slots.push_back({0, 1});
+        }
+
+        Slot &slot = m_slots[index];
+        slot.denseIndex = static_cast<uint32_t>(m_dense.size());
+        m_dense.push_back(std::move(value));
+        m_denseToSlot.push_back(index);
+
+        return Handle<T>::Make(index, slot.generation);
+    }
+
+    T *Get(const Handle<T> handle) {
+        const Slot *slot = Resolve(handle);
+        return slot ? &m_dense[slot->denseIndex] : nullptr;
+    }
+
+    const T *Get(const Handle<T> handle) const {
+        const Slot *slot = Resolve(handle);
+        return slot ? &m_dense[slot->denseIndex] : nullptr;
+    }
+
+    bool Contains(const Handle<T> handle) const {
+        return Resolve(handle) != nullptr;
+    }
+
+    bool Remove(const Handle<T> handle) {
+        const Slot *resolved = Resolve(handle);
+        if (!resolved) {
+            return false;
+        }
+
+        const uint32_t denseIndex = resolved->denseIndex;
+        const uint32_t lastIndex = static_cast<uint32_t>(m_dense.size()) - 1;
+        if (denseIndex != lastIndex) {
+            m_dense[denseIndex] = std::move(m_dense[lastIndex]);
+            m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+            m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
+        }
+        m_dense.pop_back();
+        m_denseToSlot.pop_back();
+
+        // generation zero is skipped so no live handle is ever zero
+        Slot &slot = m_slots[handle.GetIndex()];
+        slot.generation = (slot.generation + 1) & Handle<T>::GenerationMask;
+        if (slot.generation == 0) {
+            slot.generation = 1;
+        }
+        m_freeSlots.push_back(handle.GetIndex());
+
+        return true;
+    }
+
+    // handle of the resource at a position in the dense array
+    Handle<T> GetHandle(const size_t denseIndex) const {
+        const uint32_t index = m_denseToSlot[denseIndex];
+        return Handle<T>::Make(index, m_slots[index].generation);
+    }
+
+    size_t Size() const {
+        return m_dense.size();
+    }
+
+    // room for count resources without reallocating
+    void Reserve(const size_t count) {
+        m_dense.reserve(count);
+        m_denseToSlot.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    T *begin() {
+        return m_dense.data();
+    }
+
+    T *end() {
+        return m_dense.data() + m_dense.size();
+    }
+
+    const T *begin() const {
+        return m_dense.data();
+    }
+
+    const T *end() const {
+        return m_dense.data() + m_dense.size();
+    }
+
+    void Clear() {
+        m_dense.clear();
+        m_denseToSlot.clear();
+        m_slots.clear();
+        m_freeSlots.clear();
+    }
+
+   private:
+    struct Slot {
+        uint32_t denseIndex;
+        uint32_t generation;
+    };
+
+    const Slot *Resolve(const Handle<T> handle) const {
+        const uint32_t index = handle.GetIndex();
+        if (!handle || index >= m_slots.size() ||
+            m_slots[index].generation != handle.GetGeneration()) {
+            return nullptr;
+        }
+
+        return &m_slots[index];
+    }
+
+    std::vector<T> m_dense;
+    std::vector<uint32_t> m_denseToSlot;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+};
+
+// names of SlotMap resources. Every method is safe from any thread: each shard
+// holds an immutable map that writers copy and edit under the shard's lock, then
+// swap in. A reader only waits out that pointer swap, never the copy, and keeps
+// the map it took alive while it searches. Writers only contend when they hash to
+// the same shard. The two directions are updated one after the other, so a reader
+// racing an Add may find the name before GetName reports it. Adding a name that
+// is taken moves it to the new handle.
+// The SlotMap itself is not thread-safe. A loader thread may look a name up, but
+// only the main thread inserts, resolves or removes the resources behind the
+// handles, so workers hand their results back to it to publish
+// (registry-stress exercises this under -fsanitize=thread)
+template <typename T>
+class NameIndex {
+   public:
+    static constexpr size_t ShardCount = 16;
+
+    void Add(const std::string &name, const Handle<T> handle) {
+        if (name.empty() || !handle) {
+            return;
+        }
+
+        Remove(handle);
+
+        // a name shard is always locked before a handle shard
+        NameShard &names = GetShard(name);
+        std::lock_guard lock(names.mutex);
+
+        const Handle<T> previous = Lookup(names, name);
+        Write(names, [&](NameMap &map) { map[name] = handle; });
+
+        if (previous) {
+            HandleShard &handles = GetShard(previous);
+            std::lock_guard handleLock(handles.mutex);
+            Write(handles, [&](HandleMap &map) { map.erase(previous.value); });
+        }
+
+        HandleShard &handles = GetShard(handle);
+        std::lock_guard handleLock(handles.mutex);
+        Write(handles, [&](HandleMap &map) { map[handle.value] = name; });
+    }
+
+    Handle<T> Find(const std::string &name) const {
+        return Lookup(GetShard(name), name);
+    }
+
+    // empty for unnamed resources and stale handles
+    std::string GetName(const Handle<T> handle) const {
+        const auto map = Load(GetShard(handle));
+        const auto it = map->find(handle.value);
+        return it != map->end() ? it->second : std::string();
+    }
+
+    void Remove(const Handle<T> handle) {
+        HandleShard &handles = GetShard(handle);
+
+        // the name is read unlocked to find its shard, then checked again once
+        // both locks are held in order
+        while (true) {
+            const std::string name = GetName(handle);
+            if (name.empty()) {
+                return;
+            }
+
+            NameShard &names = GetShard(name);
+            std::lock_guard lock(names.mutex);
+            std::lock_guard handleLock(handles.mutex);
+
+            const auto current = Load(handles);
+            const auto it = current->find(handle.value);
+            if (it == current->end()) {
+                return;
+            }
+            if (it->second != name) {
+                continue;
+            }
+
+            if (Lookup(names, name) == handle) {
+                Write(names, [&](NameMap &map) { map.erase(name); });
+            }
+            Write(handles, [&](HandleMap &map) { map.erase(handle.value); });
+
+            return;
+        }
+    }
+
+    void Clear() {
+        for (NameShard &names : m_nameShards) {
+            std::lock_guard lock(names.mutex);
+            Store(names, std::make_shared<const NameMap>());
+        }
+
+        for (HandleShard &handles : m_handleShards) {
+            std::lock_guard lock(handles.mutex);
+            Store(handles, std::make_shared<const HandleMap>());
+        }
+    }
+
+   private:
+    using NameMap = std::unordered_map<std::string, Handle<T>>;
+    using HandleMap = std::unordered_map<uint32_t, std::string>;
+
+    // mutex serialises writers, mapMutex only guards the pointer itself
+    template <typename Map>
+    struct Shard {
+        std::mutex mutex;
+        mutable std::shared_mutex mapMutex;
+        std::shared_ptr<const Map> map = std::make_shared<const Map>();
+    };
+
+    using NameShard = Shard<NameMap>;
+    using HandleShard = Shard<HandleMap>;
+
+    template <typename Map>
+    static std::shared_ptr<const Map> Load(const Shard<Map> &shard) {
+        std::shared_lock lock(shard.mapMutex);
+        return shard.map;
+    }
+
+    template <typename Map>
+    static void Store(Shard<Map> &shard, std::shared_ptr<const Map> map) {
+        std::unique_lock lock(shard.mapMutex);
+        shard.map.swap(map);
+    }
+
+    // the caller holds shard's lock, the old map is freed by its last reader
+    template <typename Map, typename Edit>
+    static void Write(Shard<Map> &shard, Edit edit) {
+        auto next = std::make_shared<Map>(*Load(shard));
+        edit(*next);
+        Store<Map>(shard, std::move(next));
+    }
+
+    static Handle<T> Lookup(const NameShard &names, const std::string &name) {
+        const auto map = Load(names);
+        const auto it = map->find(name);
+        return it != map->end() ? it->second : Handle<T>{};
+    }
+
+    NameShard &GetShard(const std::string &name) {
+        return m_nameShards[std::hash<std::string>{}(name) % ShardCount];
+    }
+
+    const NameShard &GetShard(const std::string &name) const {
+        return m_nameShards[std::hash<std::string>{}(name) % ShardCount];
+    }
+
+    HandleShard &GetShard(const Handle<T> handle) {
+        return m_handleShards[handle.GetIndex() % ShardCount];
+    }
+
+    const HandleShard &GetShard(const Handle<T> handle) const {
+        return m_handleShards[handle.GetIndex() % ShardCount];
+    }
+
+    std::array<NameShard, ShardCount> m_nameShards;
+    std::array<HandleShard, ShardCount> m_handleShards;
+};
+
+// counted references to SlotMap resources, kept beside the map so a count stays
+// with its handle through Replace. Nothing is freed here when a count reaches
+// zero, the owning system collects unreferenced resources in UnloadUnused
+template <typename T>
+class RefCounts {
+   public:
+    uint32_t Add(const Handle<T> handle) {
+        return handle ? ++m_counts[handle.value] : 0;
+    }
+
+    uint32_t Remove(const Handle<T> handle) {
+        const auto it = m_counts.find(handle.value);
+        if (it == m_counts.end()) {
+            return 0;
+        }
+
+        if (--it->second == 0) {
+            m_counts.erase(it);
+            return 0;
+        }
+
+        return it->second;
+    }
+
+    uint32_t Get(const Handle<T> handle) const {
+        const auto it = m_counts.find(handle.value);
+        return it != m_counts.end() ? it->second : 0;
+    }
+
+    void Erase(const Handle<T> handle) {
+        m_counts.erase(handle.value);
+    }
+
+    void Clear() {
+        m_counts.clear();
+    }
+
+   private:
+    std::unordered_map<uint32_t, uint32_t> m_counts;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "slot_map.h"
+
+// components of one type packed in a dense array, with a sparse table from a
+// handle's index to the component's position. Insert and Remove are O(1), removal
+// moves the last component into the hole, so pointers from Get are only valid
+// until the next Insert or Remove
+template <typename Id, typename T>
+class SparseSet {
+   public:
+    // replaces the component the id already has
+    T &Insert(const Id id, T value) {
+        const uint32_t index = id.GetIndex();
+        if (index >= m_sparse.size()) {
+            m_sparse.resize(index + 1, Absent);
+        }
+
+        if (m_sparse[index] != Absent) {
+            m_ids[m_sparse[index]] = id;
+            return m_dense[m_sparse[index]] = std::move(value);
+        }
+
+        m_sparse[index] = static_cast<uint32_t>(m_dense.size());
+        m_ids.push_back(id);
+        return m_dense.emplace_back(std::move(value));
+    }
+
+    bool Remove(const Id id) {
+        if (!Contains(id)) {
+            return false;
+        }
+
+        const uint32_t position = m_sparse[id.GetIndex()];
+        const uint32_t last = static_cast<uint32_t>(m_dense.size()) - 1;
+        if (position != last) {
+            m_dense[position] = std::move(m_dense[last]);
+            m_ids[position] = m_ids[last];
+            m_sparse[m_ids[position].GetIndex()] = position;
+        }
+
+        m_dense.pop_back();
+        m_ids.pop_back();
+        m_sparse[id.GetIndex()] = Absent;
+
+        return true;
+    }
+
+    T *Get(const Id id) {
+        return Contains(id) ? &m_dense[m_sparse[id.GetIndex()]] : nullptr;
+    }
+
+    const T *Get(const Id id) const {
+        return Contains(id) ? &m_dense[m_sparse[id.GetIndex()]] : nullptr;
+    }
+
+    // the id must match the stored one, a reused index with an old generation
+    // doesn't resolve
+    bool Contains(const Id id) const {
+        const uint32_t index = id.GetIndex();
+        return id && index < m_sparse.size() && m_sparse[index] != Absent &&
+               m_ids[m_sparse[index]] == id;
+    }
+
+    // id of the component at a position in the dense array
+    Id GetId(const size_t position) const {
+        return m_ids[position];
+    }
+
+    const std::vector<Id> &GetIds() const {
+        return m_ids;
+    }
+
+    size_t Size() const {
+        return m_dense.size();
+    }
+
+    T *begin() {
+        return m_dense.data();
+    }
+
+    T *end() {
+        return m_dense.data() + m_dense.size();
+    }
+
+    const T *begin() const {
+        return m_dense.data();
+    }
+
+    const T *end() const {
+        return m_dense.data() + m_dense.size();
+    }
+
+    void Reserve(const size_t count) {
+        m_dense.reserve(count);
+        m_ids.reserve(count);
+    }
+
+    void Clear() {
+        m_sparse.clear();
+        m_ids.clear();
+        m_dense.clear();
+    }
+
+   private:
+    static constexpr uint32_t Absent = UINT32_MAX;
+
+    std::vector<uint32_t> m_sparse;
+    std::vector<Id> m_ids;
+    std::vector<T> m_dense;
+};
+
+// calls fn(id, first, rest...) for every id in first that all of rest also have,
+// walking first's dense array in order. Pass the smallest set first. fn must not
+// insert into or remove from any of the sets
+template <typename Fn, typename Id, typename First, typename... Rest>
+void Query(Fn &&fn, SparseSet<Id, First> &first, SparseSet<Id, Rest> &...rest) {
+    First *components = first.begin();
+    for (size_t i = 0; i < first.Size(); i++) {
+        const Id id = first.GetId(i);
+        const std::tuple<Rest *...> others{rest.Get(id)...};
+
+        std::apply(
+            [&](Rest *...other) {
+                if ((other && ...)) {
+                    fn(id, components[i], *other...);
+                }
+            },
+            others);
+    }
+}
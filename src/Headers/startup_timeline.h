@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+
+#include "common.h"
+
+// wall-clock record of startup, from Begin to the first frame drawn with every
+// scene resource resident. Safe to add spans from any thread
+namespace StartupTimeline {
+    using Clock = std::chrono::steady_clock;
+
+    struct Span {
+        std::string name;
+        float startMs;
+        float durationMs;
+        bool mainThread;
+    };
+
+    struct Timeline {
+        // negative for milestones not reached yet
+        float milestones[static_cast<size_t>(StartupMilestone::Count)];
+        std::vector<Span> spans;
+    };
+
+    // starts the clock on the calling thread, which counts as the main thread
+    void Begin();
+
+    void AddSpan(const std::string &name, Clock::time_point start,
+                 Clock::time_point end);
+
+    template <typename Function>
+    void Measure(const std::string &name, Function &&function) {
+        const Clock::time_point start = Clock::now();
+        function();
+        AddSpan(name, start, Clock::now());
+    }
+
+    // only the first time a milestone is reached counts
+    void Mark(StartupMilestone milestone);
+
+    bool IsReached(StartupMilestone milestone);
+
+    Timeline GetTimeline();
+
+    // logs the milestones and every span in start order
+    void Report();
+
+    const char *GetName(StartupMilestone milestone);
+}
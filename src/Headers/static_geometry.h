@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "bvh.h"
+#include "common.h"
+#include "material_system.h"
+#include "mesh_system.h"
+#include "texture_system.h"
+
+// geometry that never moves, baked into world space. Pieces with the same
+// material, texture and colour whose bounds centres share a grid cell are merged
+// into one chunk with its own vertex and index buffer, drawn in one call and
+// culled by its box. A chunk is baked again only when one of its pieces is
+// inserted, replaced or removed, or when a source mesh's buffers are swapped by
+// a finished load or a reload. Items are small integers such as slot indices
+namespace StaticGeometry {
+    // what an item draws, the handles stay owned by the caller
+    struct Piece {
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
+        glm::vec4 color = glm::vec4(1.0f);
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+    };
+
+    struct Stats {
+        uint32_t pieces;
+        uint32_t chunks;
+        uint32_t bakes;
+        size_t bakedBytes;
+        float lastBakeMs;
+    };
+
+    void Init();
+
+    // replaces the item's piece when it already has one
+    void Insert(uint32_t item, const Piece &piece);
+
+    void Remove(uint32_t item);
+
+    bool Contains(uint32_t item);
+
+    // bakes the chunks that changed, then submits every chunk to the renderer and
+    // asks texture streaming for their textures. Appends the items whose source
+    // mesh was swapped since their chunk was baked to reloaded, their bounds may
+    // have changed with it. Call once per frame
+    void Update(std::vector<uint32_t> &reloaded);
+
+    Stats GetStats();
+
+    void CleanUp();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "hash.h"
+
+// a name reduced to a stable 32-bit id, for keys looked up every frame such as
+// uniform and material property names. "viewPos"_id is hashed at compile time
+struct StringId {
+    uint32_t value = 0;
+
+    explicit operator bool() const {
+        return value != 0;
+    }
+
+    bool operator==(const StringId &other) const = default;
+};
+
+template <>
+struct std::hash<StringId> {
+    size_t operator()(const StringId id) const noexcept {
+        return id.value;
+    }
+};
+
+// the strings behind the ids, so names can be shown, saved or handed to GL.
+// Entries are never removed and every function may be called from any thread.
+// With debug features two strings hashing to one id are reported when the
+// second is interned
+namespace StringTable {
+    StringId Intern(std::string_view text);
+
+    // empty for ids never interned, the reference stays valid
+    const std::string &GetString(StringId id);
+
+    size_t Size();
+
+    template <size_t N>
+    struct Literal {
+        char text[N];
+
+        consteval Literal(const char (&literal)[N]) {
+            std::copy_n(literal, N, text);
+        }
+
+        constexpr std::string_view View() const {
+            return {text, N - 1};
+        }
+    };
+
+    // one per literal used with _id, interns it during static initialisation
+    template <Literal literal>
+    struct Registration {
+        static inline const StringId id = Intern(literal.View());
+    };
+}
+
+template <StringTable::Literal literal>
+consteval StringId operator""_id() {
+    // naming the registration makes it run at startup, so GetString knows the
+    // literal without this costing anything where it is used
+    static_cast<void>(&StringTable::Registration<literal>::id);
+    return StringId{Hash::Fnv1a32(literal.View())};
+}
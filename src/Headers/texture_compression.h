@@ -0,0 +1,83 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "common.h"
+
+namespace TextureCompression {
+    constexpr uint32_t Version = 1;
+
+    struct Options {
+        bool enabled = true;
+        // use BC7 for RGB and RGBA sources where supported, slower to encode
+        bool preferBc7 = false;
+        // two channel sources hold normal map XY and go to BC5 as they are. Off,
+        // they are grey and alpha like stb_image decodes them, and go to BC3
+        bool twoChannelNormals = false;
+    };
+
+    struct MipLevel {
+        size_t offset;
+        size_t size;
+        int width;
+        int height;
+    };
+
+    // block-compressed mip chain, finest level first
+    struct CompressedImage {
+        TextureFormat format = TextureFormat::Uncompressed;
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> data;
+        std::vector<MipLevel> levels;
+        // DDS file the levels can be read back from, empty when only in memory
+        std::filesystem::path source;
+        size_t dataOffset = 0;
+    };
+
+    // queries driver support, needs a current GL context
+    void Init();
+
+    bool IsSupported(TextureFormat format);
+
+    GLenum GetInternalFormat(TextureFormat format);
+
+    size_t GetBlockSize(TextureFormat format);
+
+    const char *GetName(TextureFormat format);
+
+    // BC1 for RGB and BC3 for RGBA (BC7 if preferred), two channels go to BC3 or to
+    // BC5 for normal maps. Uncompressed when nothing suitable is supported
+    TextureFormat ChooseFormat(int channels, const Options &options);
+
+    // encodes one level of RGBA8 pixels, block rows are split across threads
+    std::vector<uint8_t> Encode(TextureFormat format, const uint8_t *rgba, int width,
+                                int height);
+
+    // expands to RGBA8, builds a box-filtered mip chain and encodes every level. Two
+    // channels are kept as RG for BC5 and expand from grey and alpha otherwise
+    CompressedImage Compress(TextureFormat format, const uint8_t *pixels, int width,
+                             int height, int channels);
+
+    // DDS with a DX10 header, legacy DXT1/DXT5/ATI2 files are also read. The
+    // image has no source, the caller sets one when the bytes are a loose file
+    bool ReadDds(const uint8_t *data, size_t size, CompressedImage &image);
+
+    // a file on disk, recorded as the image's source for streaming
+    bool ReadDds(const std::filesystem::path &path, CompressedImage &image);
+
+    bool WriteDds(std::ostream &file, const CompressedImage &image);
+
+    // hashes the source contents and target format. sourcePath may be virtual
+    std::optional<uint64_t> ComputeKey(const std::string &sourcePath,
+                                       TextureFormat format);
+
+    // reads a transcode back from the derived asset cache, false on a miss
+    bool LoadCached(uint64_t key, CompressedImage &image);
+
+    // records the cached DDS as the image's source on success
+    bool StoreCached(uint64_t key, CompressedImage &image);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+#include "texture_compression.h"
+#include "texture_system.h"
+
+namespace TextureStreaming {
+    struct Stats {
+        uint32_t textures;
+        size_t residentBytes;
+        size_t requestedBytes;
+        uint32_t pendingReads;
+        uint32_t levelsLoaded;
+        uint32_t levelsEvicted;
+    };
+
+    void Init();
+
+    void SetEnabled(bool enabled);
+
+    bool IsEnabled();
+
+    // mips at or below this size are uploaded up front and never evicted
+    uint32_t GetFirstResidentLevel(const TextureCompression::CompressedImage &image);
+
+    // hands a texture whose levels from firstLevel down are resident to the
+    // streamer, finer levels are read back from image.source on demand. The
+    // source must be a file on disk, packed images are never registered
+    void Register(GLuint textureId, const TextureCompression::CompressedImage &image,
+                  uint32_t firstLevel);
+
+    void Unregister(GLuint textureId);
+
+    // viewer used to turn bounds into a required mip, set once per frame
+    void SetViewer(const glm::vec3 &position, float fovY, float viewportHeight);
+
+    // asks for enough detail to cover a sphere at its projected size this frame
+    void RequestLevel(const TextureSystem::Texture *texture, const glm::vec3 &center,
+                      float radius);
+
+    // fits the requested levels in the budget, evicts unneeded fine mips, queues
+    // reads and uploads the levels that arrived. Call once per frame
+    void Update();
+
+    void SetBudget(size_t bytes);
+
+    size_t GetBudget();
+
+    Stats GetStats();
+
+    void CleanUp();
+}
@@ -1,11 +1,12 @@
 #pragma once
 
 #include "common.h"
+#include "slot_map.h"
+#include "texture_compression.h"
 
 namespace TextureSystem {
     struct Texture {
         GLuint id;
-        std::string name;
         int width;
         int height;
         int channels;
@@ -13,20 +14,93 @@ namespace TextureSystem {
         GLenum dataType;
         bool isValid;
         std::string path;
+        TextureFormat compression = TextureFormat::Uncompressed;
+        uint32_t mipLevels = 1;
+        size_t memoryBytes = 0;
+        // a view shares another texture's GL object and never deletes it
+        bool isView = false;
+    };
+
+    using TextureHandle = Handle<Texture>;
+
+    // decoded pixels owned by stb_image until FreeImage, or a compressed mip chain
+    struct Image {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        unsigned char *pixels = nullptr;
+        TextureCompression::CompressedImage compressed;
     };
 
     void Init();
 
-    Texture *CreateTexture(const std::string &name, const std::string &path,
-                           bool generateMips = true);
+    // applies to textures decoded afterwards, set it before loading starts
+    void SetCompressionOptions(const TextureCompression::Options &options);
+
+    const TextureCompression::Options &GetCompressionOptions();
+
+    // safe to call from any thread, it does not touch GL. DDS files are read as is,
+    // other sources are transcoded through the texture cache when compression is on
+    bool DecodeImage(const std::string &path, Image &image);
+
+    void FreeImage(Image &image);
+
+    const void *GetImageData(const Image &image);
+
+    size_t GetImageSize(const Image &image);
+
+    // an empty name leaves the texture out of the name index
+
+    TextureHandle CreateTexture(const std::string &name, const std::string &path,
+                                bool generateMips = true);
+
+    // uploads image, reading the data from pixelBuffer at offset 0 when it is set
+    TextureHandle CreateTexture(const std::string &name, const std::string &path,
+                                const Image &image, bool generateMips = true,
+                                GLuint pixelBuffer = 0);
 
-    Texture *CreateEmpty(const std::string &name, int width, int height,
-                         GLenum format = GL_RGBA8, GLenum dataType = GL_UNSIGNED_BYTE);
+    TextureHandle CreateEmpty(const std::string &name, int width, int height,
+                              GLenum format = GL_RGBA8,
+                              GLenum dataType = GL_UNSIGNED_BYTE);
 
-    Texture *GetTexture(const std::string &name);
+    TextureHandle CreateView(const std::string &name, TextureHandle source);
 
+    // moves source into target's slot, freeing what target held. Handles to target
+    // now reach source's texture and source's handle goes stale
+    bool Replace(TextureHandle target, TextureHandle source);
+
+    void Destroy(TextureHandle handle);
+
+    // null for stale handles, valid until the next texture is created or destroyed
+    Texture *Get(TextureHandle handle);
+
+    // safe from loader threads, a name appears once its texture is resident or a
+    // placeholder stands in for it. Only the main thread may Get the handle
+    TextureHandle Find(const std::string &name);
+
+    std::string GetName(TextureHandle handle);
+
+    // counted references from entities and in-flight uploads. A texture nothing
+    // references stays loaded until UnloadUnused
+    void AddRef(TextureHandle handle);
+
+    void RemoveRef(TextureHandle handle);
+
+    uint32_t GetRefCount(TextureHandle handle);
+
+    // queues every unreferenced texture for deferred destruction, one that gains a
+    // reference before its turn comes is kept. Returns the number queued
+    size_t UnloadUnused();
+
+    // live textures, placeholders and defaults included
+    size_t GetCount();
+
+    // an evicted texture binds the placeholder until its reload is resident
     void Bind(const Texture *texture, uint32_t slot = 0);
 
+    // stands in for evicted textures, usually the default texture
+    void SetPlaceholder(TextureHandle texture);
+
     void Unbind(uint32_t slot = 0);
 
     void CleanUp();
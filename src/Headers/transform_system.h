@@ -1,35 +1,83 @@
 #pragma once
 
+#include <span>
+
 #include "common.h"
+#include "slot_map.h"
 
+// transforms are stored as structure-of-arrays, one float array per component,
+// so UpdateMatrices can compose a whole SIMD batch of them at a time. Each is
+// relative to its parent, world matrices are kept parents first so one pass over
+// them resolves the hierarchy
 namespace TransformSystem {
-    struct Transform {
-        glm::vec3 position{0.0f};
-        glm::vec3 rotation{0.0f};
-        glm::vec3 scale{1.0f};
-        bool isDirty{true};
-        glm::mat4 modelMatrix{1.0f};
+    // only a handle type, the components live in the system's arrays
+    struct Transform {};
+
+    using TransformHandle = Handle<Transform>;
+
+    // local position, Euler rotation in degrees and scale
+    struct Trs {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    struct Stats {
+        uint32_t transforms;
+        uint32_t composed;
+        uint32_t propagated;
     };
 
     void Init();
 
-    Transform *CreateTransform(const std::string &name);
+    TransformHandle CreateTransform();
+
+    // creates a root per value with the arrays grown once for the whole batch.
+    // Fewer handles come back when the slot map runs out
+    std::vector<TransformHandle> CreateTransforms(std::span<const Trs> values);
+
+    // the transform's children are detached and become roots
+    void DestroyTransform(TransformHandle handle);
+
+    bool IsValid(TransformHandle handle);
+
+    // the transform keeps its local values, so it moves with the new parent. An
+    // empty parent makes it a root. False when either handle is stale or the
+    // parent is the transform or one of its descendants
+    bool SetParent(TransformHandle handle, TransformHandle parent);
+
+    TransformHandle GetParent(TransformHandle handle);
+
+    // relative to the parent. Rotation is Euler angles in degrees, applied x, then
+    // y, then z
+    void SetPosition(TransformHandle handle, const glm::vec3 &position);
+
+    glm::vec3 GetPosition(TransformHandle handle);
 
-    Transform *GetTransform(const std::string &name);
+    void SetRotation(TransformHandle handle, const glm::vec3 &rotation);
 
-    void SetPosition(Transform *transform, const glm::vec3 &position);
+    glm::vec3 GetRotation(TransformHandle handle);
 
-    glm::vec3 GetPosition(const Transform *transform);
+    void SetScale(TransformHandle handle, const glm::vec3 &scale);
 
-    void SetRotation(Transform *transform, const glm::vec3 &rotation);
+    glm::vec3 GetScale(TransformHandle handle);
 
-    glm::vec3 GetRotation(const Transform *transform);
+    // recomposes every transform changed since the last call in SIMD batches, then
+    // the world matrices of the subtrees under them, independent roots in
+    // parallel when there are enough of them. Call once per frame before the
+    // matrices are read
+    void UpdateMatrices();
 
-    void SetScale(Transform *transform, const glm::vec3 &scale);
+    // the world matrix, pending changes are applied first. Valid until the next
+    // transform is created, destroyed or reparented
+    const glm::mat4 &GetModelMatrix(TransformHandle handle);
 
-    glm::vec3 GetScale(const Transform *transform);
+    // transforms composed and world matrices revisited by the last UpdateMatrices
+    Stats GetStats();
 
-    const glm::mat4 &GetModelMatrix(Transform *transform);
+    // lanes UpdateMatrices composes at once, 8 with AVX, 4 with SSE or NEON and 1
+    // otherwise
+    size_t GetBatchWidth();
 
     void CleanUp();
 }
@@ -8,7 +8,42 @@ struct Vertex {
     glm::vec2 texCoords;
 };
 
+// octahedral snorm16 normal and half-float uvs (20 bytes)
+struct PackedVertex {
+    glm::vec3 position;
+    int16_t normal[2];
+    uint16_t texCoords[2];
+};
+
 struct InstanceData {
     glm::mat4 modelMatrix;
     glm::vec4 color;
 };
+
+// 3x4 affine matrix stored as rows, colour packed to RGBA8 (52 bytes)
+struct InstanceDataAffine {
+    glm::vec4 rows[3];
+    uint32_t color;
+};
+
+// position, quaternion (xyzw) and scale rebuilt in the vertex shader (44 bytes)
+struct InstanceDataTrs {
+    glm::vec3 position;
+    glm::vec4 rotation;
+    glm::vec3 scale;
+    uint32_t color;
+};
+
+// as above with half-precision rotation and scale, scale[3] is padding (32 bytes)
+struct InstanceDataTrsHalf {
+    glm::vec3 position;
+    uint16_t rotation[4];
+    uint16_t scale[4];
+    uint32_t color;
+};
+
+static_assert(sizeof(PackedVertex) == 20);
+static_assert(sizeof(InstanceData) == 80);
+static_assert(sizeof(InstanceDataAffine) == 52);
+static_assert(sizeof(InstanceDataTrs) == 44);
+static_assert(sizeof(InstanceDataTrsHalf) == 32);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "common.h"
+#include "mapped_file.h"
+
+// asset lookup through mount points indexed once at startup. Virtual paths are
+// "<mount>/<relative path>", e.g. "Models/cube.obj". Any path that is not in the
+// index is used as a real path, so absolute and cache paths keep working
+namespace VirtualFileSystem {
+    // mounts the engine's asset directories: Models, Textures, Shaders and Scenes,
+    // then Assets.pack over them when one was built
+    void Init();
+
+    // indexes every file below directory as "<prefix>/<relative path>". A later
+    // mount shadows files of the same virtual path. Returns false if directory
+    // does not exist
+    bool Mount(const std::string &prefix, const std::filesystem::path &directory);
+
+    // indexes every entry of an asset pack under the virtual path it was packed
+    // with, shadowing earlier mounts. Returns false if the pack is missing or invalid
+    bool MountPack(const std::filesystem::path &packPath);
+
+    void Unmount(const std::string &prefix);
+
+    // real directory of a mount, where new files under it are written. Empty when
+    // prefix is not mounted
+    std::filesystem::path GetMountPath(const std::string &prefix);
+
+    // the virtual path of an asset, found by its file name in the prefix mount so
+    // "../Assets/Models/cube.obj" and "cube.obj" both give "Models/cube.obj".
+    // Returns path unchanged when no such file is indexed
+    std::string FindAsset(const std::string &prefix, const std::string &path);
+
+    // virtual path of a file below a mounted directory, empty when no mount holds
+    // it. The latest mount wins, as it does for lookups
+    std::string GetVirtualPath(const std::filesystem::path &realPath);
+
+    // real path behind a virtual path, path itself when it is not indexed or is
+    // served from a pack, so only Read and Map see packed files
+    std::filesystem::path GetRealPath(const std::string &path);
+
+    bool Exists(const std::string &path);
+
+    // true when the file is served from a pack and has no real path to open
+    bool IsPacked(const std::string &path);
+
+    // replaces buffer with the file's contents
+    bool Read(const std::string &path, std::vector<uint8_t> &buffer);
+
+    // zero-copy view of the file, empty on failure
+    FileView Map(const std::string &path);
+
+    // indexes or drops one file under a mount after it was written or deleted
+    void Refresh(const std::string &virtualPath);
+
+    void CleanUp();
+}
@@ -4,29 +4,58 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-// Instance data
-layout (location = 3) in vec4 aModel1;
-layout (location = 4) in vec4 aModel2;
-layout (location = 5) in vec4 aModel3;
-layout (location = 6) in vec4 aModel4;
+// Instance data, interpreted according to instanceLayout:
+// 0 = mat4 columns, 1 = 3x4 affine rows, 2/3 = position, quaternion, scale
+layout (location = 3) in vec4 aInstance0;
+layout (location = 4) in vec4 aInstance1;
+layout (location = 5) in vec4 aInstance2;
+layout (location = 6) in vec4 aInstance3;
 layout (location = 7) in vec4 aColor;
 
 uniform mat4 view;
 uniform mat4 projection;
 uniform int useInstanceColor;
+uniform int instanceLayout;
+uniform int packedNormals;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 out vec4 Color;
 
+vec3 DecodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return normalize(n);
+}
+
+vec3 RotateByQuaternion(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main() {
-    mat4 instanceModel = mat4(aModel1, aModel2, aModel3, aModel4);
+    vec4 worldPos;
+    vec3 normal = packedNormals > 0 ? DecodeOctahedral(aNormal.xy) : aNormal;
 
-    vec4 worldPos = instanceModel * vec4(aPos, 1.0);
-    FragPos = worldPos.xyz;
+    if (instanceLayout >= 2) {
+        vec4 rotation = normalize(aInstance1);
+        vec3 scale = aInstance2.xyz;
+
+        worldPos = vec4(RotateByQuaternion(rotation, aPos * scale) + aInstance0.xyz, 1.0);
+        Normal = RotateByQuaternion(rotation, normal / scale);
+    } else {
+        mat4 instanceModel = instanceLayout == 1
+            ? transpose(mat4(aInstance0, aInstance1, aInstance2, vec4(0.0, 0.0, 0.0, 1.0)))
+            : mat4(aInstance0, aInstance1, aInstance2, aInstance3);
 
-    Normal = mat3(transpose(inverse(instanceModel))) * aNormal;
+        worldPos = instanceModel * vec4(aPos, 1.0);
+        Normal = mat3(transpose(inverse(instanceModel))) * normal;
+    }
+
+    FragPos = worldPos.xyz;
 
     TexCoords = aTexCoords;
     Color = useInstanceColor > 0 ? aColor : vec4(1.0);
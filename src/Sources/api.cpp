@@ -1,21 +1,48 @@
 #include "api.h"
 
+#include <future>
+
 #include "backend.h"
+#include "gpu_memory.h"
+#include "hot_reload.h"
 #include "light_system.h"
 #include "render_system.h"
 #include "resource_manager.h"
+#include "scene_loader.h"
 #include "scene_system.h"
 #include "serialisation.h"
+#include "virtual_file_system.h"
 
 namespace Api {
     static bool m_isRunning;
 
     void Init() {
-        Backend::Init();
-        ResourceManager::Init();
-        RenderSystem::Init();
-        SceneSystem::Init();
-        LightSystem::Init();
+        StartupTimeline::Begin();
+
+        // the file index and the cache scan only touch the disk, so they run
+        // beside window and context creation, which must stay on this thread
+        auto fileSystem = std::async(std::launch::async, [] {
+            StartupTimeline::Measure("VirtualFileSystem", VirtualFileSystem::Init);
+        });
+        auto derivedCache = std::async(std::launch::async, [] {
+            StartupTimeline::Measure("DerivedCache", [] { DerivedCache::Init(); });
+        });
+
+        StartupTimeline::Measure("Backend", Backend::Init);
+        StartupTimeline::Mark(StartupMilestone::Window);
+
+        fileSystem.get();
+        derivedCache.get();
+
+        StartupTimeline::Measure("ResourceManager", ResourceManager::Init);
+        StartupTimeline::Measure("RenderSystem", RenderSystem::Init);
+        StartupTimeline::Measure("SceneSystem", SceneSystem::Init);
+        StartupTimeline::Measure("LightSystem", LightSystem::Init);
+
+        // edits to assets apply while running, a development aid like the UI
+        if (g_EnableDebugFeatures) {
+            StartupTimeline::Measure("HotReload", HotReload::Init);
+        }
     }
 
     void Run() {
@@ -35,6 +62,13 @@ namespace Api {
             Backend::BeginFrame();
 
             Backend::Update();
+            ResourceManager::Update();
+            SceneLoader::Update();
+
+            if (g_EnableDebugFeatures) {
+                HotReload::Update();
+            }
+
             SceneSystem::Update();
 
             if (g_EnableDebugFeatures) {
@@ -48,12 +82,26 @@ namespace Api {
             }
 
             Backend::EndFrame();
+
+            // the scene is ready once nothing it asked for is still loading
+            if (!StartupTimeline::IsReached(StartupMilestone::SceneReady)) {
+                StartupTimeline::Mark(StartupMilestone::FirstFrame);
+                if (!ResourceManager::IsLoading() && !SceneLoader::IsLoading()) {
+                    StartupTimeline::Mark(StartupMilestone::SceneReady);
+                    StartupTimeline::Report();
+                }
+            }
         }
 
+        HotReload::CleanUp();
+        SceneLoader::CleanUp();
         SceneSystem::CleanUp();
+        TransformSystem::CleanUp();
         RenderSystem::CleanUp();
         ResourceManager::CleanUp();
         LightSystem::CleanUp();
+        DerivedCache::CleanUp();
+        VirtualFileSystem::CleanUp();
         Backend::CleanUp();
     }
 
@@ -62,13 +110,75 @@ namespace Api {
     }
 
     bool LoadScene(const std::string& path) {
-        return Serialisation::Deserialise(path);
+        if (StartupTimeline::IsReached(StartupMilestone::SceneReady)) {
+            return Serialisation::Deserialise(path);
+        }
+
+        bool loaded = false;
+        StartupTimeline::Measure("LoadScene " + path,
+                                 [&] { loaded = Serialisation::Deserialise(path); });
+
+        return loaded;
     }
 
-    SceneSystem::Entity* CreateEntity(const std::string& name, const glm::vec4& color) {
+    bool StreamScene(const std::string& path) {
+        return SceneLoader::Begin(path);
+    }
+
+    SceneSystem::EntityId CreateEntity(const std::string& name, const glm::vec4& color) {
         return SceneSystem::CreateEntity(name, color);
     }
 
+    std::vector<SceneSystem::EntityId> SpawnEntities(
+        const SceneSystem::Render& prototype,
+        const std::span<const TransformSystem::Trs> transforms,
+        const std::span<const glm::vec4> colors, const std::string& namePrefix) {
+        return SceneSystem::SpawnEntities(prototype, transforms, colors, namePrefix);
+    }
+
+    void DestroyEntities(const std::span<const SceneSystem::EntityId> entities) {
+        SceneSystem::DestroyEntities(entities);
+    }
+
+    size_t DestroyEntitiesIf(
+        const std::function<bool(SceneSystem::EntityId)>& predicate) {
+        return SceneSystem::DestroyEntitiesIf(predicate);
+    }
+
+    std::vector<SceneSystem::EntityId> QueryBox(const Aabb& box) {
+        return SceneSystem::QueryBox(box);
+    }
+
+    std::vector<SceneSystem::EntityId> QuerySphere(const glm::vec3& center,
+                                                   const float radius) {
+        return SceneSystem::QuerySphere(center, radius);
+    }
+
+    std::vector<SceneSystem::EntityId> QueryFrustum(const Frustum& frustum) {
+        return SceneSystem::QueryFrustum(frustum);
+    }
+
+    SceneSystem::RayHit Raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                const float maxDistance) {
+        return SceneSystem::Raycast(origin, direction, maxDistance);
+    }
+
+    GpuMemory::Stats GetGpuMemoryStats() {
+        return GpuMemory::GetStats();
+    }
+
+    DerivedCache::Stats GetDerivedCacheStats() {
+        return DerivedCache::GetStats();
+    }
+
+    StartupTimeline::Timeline GetStartupTimeline() {
+        return StartupTimeline::GetTimeline();
+    }
+
+    void SetGpuMemoryBudget(const size_t bytes) {
+        GpuMemory::SetBudget(bytes);
+    }
+
     float GetDeltaTime() {
         static float lastTime = Backend::GetWindowTime();
         float currentTime = Backend::GetWindowTime();
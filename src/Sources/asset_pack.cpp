@@ -0,0 +1,224 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "hash.h"
+#include "lz_codec.h"
+
+namespace AssetPack {
+    static constexpr char m_magic[4] = {'G', 'P', 'A', 'K'};
+
+    static uint64_t AlignUp(const uint64_t value) {
+        return (value + EntryAlignment - 1) & ~(EntryAlignment - 1);
+    }
+
+    uint64_t HashPath(const std::string_view path) {
+        return Hash::Fnv1a(path);
+    }
+
+    std::shared_ptr<Pack> Pack::Open(const std::filesystem::path &path) {
+        auto file = std::make_shared<const MappedFile>(path);
+        if (!file->Data() || file->Size() < sizeof(Header)) {
+            return nullptr;
+        }
+
+        Header header{};
+        std::memcpy(&header, file->Data(), sizeof(Header));
+
+        const uint64_t size = file->Size();
+        if (std::memcmp(header.magic, m_magic, sizeof(m_magic)) != 0 ||
+            header.version != Version || header.tableOffset % alignof(Entry) != 0 ||
+            header.tableOffset + uint64_t{header.entryCount} * sizeof(Entry) > size ||
+            header.namesOffset + header.namesSize > size) {
+            ErrorHandler::Warn("Ignoring invalid asset pack: " + path.string(), __FILE__,
+                               __func__, __LINE__);
+            return nullptr;
+        }
+
+        // checked once here so lookups and reads never have to
+        const auto *entries =
+            reinterpret_cast<const Entry *>(file->Data() + header.tableOffset);
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            const Entry &entry = entries[i];
+            if (entry.offset + entry.storedSize > size ||
+                uint64_t{entry.nameOffset} + entry.nameLength > header.namesSize ||
+                (entry.compression == Compression::None &&
+                 entry.storedSize != entry.size) ||
+                (i > 0 && entries[i - 1].pathHash > entry.pathHash)) {
+                ErrorHandler::Warn("Ignoring asset pack with a corrupt entry table: " +
+                                       path.string(),
+                                   __FILE__, __func__, __LINE__);
+                return nullptr;
+            }
+        }
+
+        auto pack = std::make_shared<Pack>();
+        pack->m_entries = {entries, header.entryCount};
+        pack->m_names = reinterpret_cast<const char *>(file->Data() + header.namesOffset);
+        pack->m_file = std::move(file);
+
+        return pack;
+    }
+
+    const Entry *Pack::Find(const std::string_view path) const {
+        const uint64_t hash = HashPath(path);
+        auto it = std::ranges::lower_bound(m_entries, hash, {}, &Entry::pathHash);
+
+        // colliding hashes sit next to each other, the name settles it
+        for (; it != m_entries.end() && it->pathHash == hash; ++it) {
+            if (GetPath(*it) == path) {
+                return &*it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::string_view Pack::GetPath(const Entry &entry) const {
+        return {m_names + entry.nameOffset, entry.nameLength};
+    }
+
+    FileView Pack::Read(const Entry &entry) const {
+        const uint8_t *data = m_file->Data() + entry.offset;
+        if (entry.compression == Compression::None) {
+            return {m_file, data, entry.size};
+        }
+
+        auto buffer = std::make_shared<std::vector<uint8_t>>(entry.size);
+        if (!Lz::Decompress(data, entry.storedSize, buffer->data(), buffer->size())) {
+            ErrorHandler::Warn("Failed to decompress packed " +
+                                   std::string(GetPath(entry)),
+                               __FILE__, __func__, __LINE__);
+            return {};
+        }
+
+        const uint8_t *decoded = buffer->data();
+        return {std::move(buffer), decoded, entry.size};
+    }
+
+    bool Build(const std::vector<Source> &sources, const std::filesystem::path &output,
+               const bool compress, BuildStats *stats) {
+        std::vector<const Source *> sorted;
+        sorted.reserve(sources.size());
+        for (const Source &source : sources) {
+            sorted.push_back(&source);
+        }
+
+        std::ranges::sort(sorted, [](const Source *a, const Source *b) {
+            const uint64_t hashA = HashPath(a->path);
+            const uint64_t hashB = HashPath(b->path);
+            return hashA != hashB ? hashA < hashB : a->path < b->path;
+        });
+
+        Header header{};
+        std::memcpy(header.magic, m_magic, sizeof(m_magic));
+        header.version = Version;
+        header.entryCount = static_cast<uint32_t>(sorted.size());
+        header.tableOffset = sizeof(Header);
+        header.namesOffset = header.tableOffset + sorted.size() * sizeof(Entry);
+
+        std::vector<Entry> entries(sorted.size());
+        std::string names;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            entries[i].pathHash = HashPath(sorted[i]->path);
+            entries[i].nameOffset = static_cast<uint32_t>(names.size());
+            entries[i].nameLength = static_cast<uint32_t>(sorted[i]->path.size());
+            names += sorted[i]->path;
+        }
+        header.namesSize = names.size();
+
+        // written next to the target and renamed, a failed build never leaves a
+        // truncated pack behind
+        std::filesystem::path temporary = output;
+        temporary += ".tmp";
+
+        BuildStats buildStats{};
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                ErrorHandler::Warn("Failed to open " + temporary.string(), __FILE__,
+                                   __func__, __LINE__);
+                return false;
+            }
+
+            // the table is rewritten once the entry offsets are known
+            file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+            file.write(reinterpret_cast<const char *>(entries.data()),
+                       static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+            file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+            static constexpr char padding[EntryAlignment] = {};
+            for (size_t i = 0; i < sorted.size(); i++) {
+                Entry &entry = entries[i];
+
+                std::error_code error;
+                const uint64_t size = std::filesystem::file_size(sorted[i]->file, error);
+                if (error) {
+                    ErrorHandler::Warn("Failed to read " + sorted[i]->file.string(),
+                                       __FILE__, __func__, __LINE__);
+                    return false;
+                }
+
+                const MappedFile source(sorted[i]->file);
+                if (size > 0 && source.Size() != size) {
+                    ErrorHandler::Warn("Failed to map " + sorted[i]->file.string(),
+                                       __FILE__, __func__, __LINE__);
+                    return false;
+                }
+
+                std::vector<uint8_t> compressed;
+                if (compress && size > 0) {
+                    compressed = Lz::Compress(source.Data(), size);
+                }
+
+                const bool useCompressed =
+                    !compressed.empty() && compressed.size() < size - size / 10;
+                const uint8_t *data = useCompressed ? compressed.data() : source.Data();
+
+                const auto position = static_cast<uint64_t>(file.tellp());
+                entry.offset = AlignUp(position);
+                entry.size = size;
+                entry.storedSize = useCompressed ? compressed.size() : size;
+                entry.compression = useCompressed ? Compression::Lz : Compression::None;
+
+                file.write(padding,
+                           static_cast<std::streamsize>(entry.offset - position));
+                file.write(reinterpret_cast<const char *>(data),
+                           static_cast<std::streamsize>(entry.storedSize));
+
+                buildStats.entries++;
+                buildStats.compressed += useCompressed ? 1 : 0;
+                buildStats.inputBytes += size;
+            }
+
+            buildStats.packBytes = static_cast<uint64_t>(file.tellp());
+
+            file.seekp(static_cast<std::streamoff>(header.tableOffset));
+            file.write(reinterpret_cast<const char *>(entries.data()),
+                       static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+
+            if (!file.good()) {
+                ErrorHandler::Warn("Failed to write " + temporary.string(), __FILE__,
+                                   __func__, __LINE__);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, output, error);
+        if (error) {
+            ErrorHandler::Warn("Failed to replace " + output.string() + ": " +
+                                   error.message(),
+                               __FILE__, __func__, __LINE__);
+            return false;
+        }
+
+        if (stats) {
+            *stats = buildStats;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,439 @@
+#include "async_loader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "gpu_memory.h"
+
+namespace AsyncLoader {
+    enum class RequestType { Texture, Mesh };
+
+    struct Request {
+        RequestType type;
+        std::string name;
+        std::string path;
+        bool generateMips;
+        MeshDecoder decodeMesh;
+        TextureCallback onTextureLoaded;
+        MeshCallback onMeshLoaded;
+        TextureFiller fillTexture;
+        MeshFiller fillMesh;
+        RefillCallback onRefilled;
+    };
+
+    struct Result {
+        Request request;
+        bool success;
+        TextureSystem::Image image;
+        MeshSystem::MeshData mesh;
+    };
+
+    struct PixelBuffer {
+        GLuint id;
+        size_t capacity;
+        bool inUse;
+    };
+
+    // the publish point: a resource's callback only runs once the fence behind its
+    // upload commands signals, so nothing draws from storage the GPU is still
+    // filling. Meshes and refills hold no pixel buffer
+    struct Upload {
+        std::optional<size_t> pixelBuffer;
+        GLsync fence;
+        TextureSystem::TextureHandle texture;
+        TextureCallback onTextureLoaded;
+        MeshSystem::MeshHandle mesh;
+        MeshCallback onMeshLoaded;
+        RefillCallback onRefilled;
+    };
+
+    static constexpr size_t m_maxPixelBuffers = 4;
+
+    static std::vector<std::thread> m_workers;
+    static std::mutex m_mutex;
+    static std::condition_variable m_condition;
+    static std::deque<Request> m_requests;
+    static std::deque<Result> m_results;
+    static uint32_t m_decoding = 0;
+    static bool m_stopping = false;
+
+    // main thread only
+    static std::vector<PixelBuffer> m_pixelBuffers;
+    static std::vector<Upload> m_uploads;
+    static size_t m_uploadBudget = 8 * 1024 * 1024;
+    static Stats m_stats{};
+
+    static void WorkerLoop() {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock lock(m_mutex);
+                m_condition.wait(lock, [] { return m_stopping || !m_requests.empty(); });
+                if (m_stopping) {
+                    return;
+                }
+
+                request = std::move(m_requests.front());
+                m_requests.pop_front();
+                m_decoding++;
+            }
+
+            Result result{};
+            if (request.type == RequestType::Texture) {
+                result.success = TextureSystem::DecodeImage(request.path, result.image);
+            } else {
+                result.success = request.decodeMesh(result.mesh);
+            }
+            result.request = std::move(request);
+
+            std::lock_guard lock(m_mutex);
+            m_decoding--;
+            m_results.push_back(std::move(result));
+        }
+    }
+
+    static size_t GetUploadSize(const Result &result) {
+        if (result.request.type == RequestType::Texture) {
+            return TextureSystem::GetImageSize(result.image);
+        }
+
+        return result.mesh.vertices.size() +
+               result.mesh.indices.size() * sizeof(uint32_t);
+    }
+
+    static std::optional<size_t> AcquirePixelBuffer(const size_t size) {
+        std::optional<size_t> candidate;
+        for (size_t i = 0; i < m_pixelBuffers.size(); i++) {
+            if (m_pixelBuffers[i].inUse) {
+                continue;
+            }
+
+            // prefer a buffer that is already large enough
+            if (m_pixelBuffers[i].capacity >= size) {
+                return i;
+            }
+
+            candidate = i;
+        }
+
+        if (!candidate && m_pixelBuffers.size() < m_maxPixelBuffers) {
+            PixelBuffer buffer{};
+            glGenBuffers(1, &buffer.id);
+            m_pixelBuffers.push_back(buffer);
+            candidate = m_pixelBuffers.size() - 1;
+        }
+
+        return candidate;
+    }
+
+    static void UploadTexture(Result &result, const size_t pixelBufferIndex) {
+        PixelBuffer &buffer = m_pixelBuffers[pixelBufferIndex];
+        const size_t size = TextureSystem::GetImageSize(result.image);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        if (buffer.capacity < size) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+                         GL_STREAM_DRAW);
+            buffer.capacity = size;
+            GpuMemory::Track(GpuMemoryCategory::Staging, buffer.id, size);
+        }
+
+        // the buffer is only handed out again after its fence, so no sync is needed
+        void *mapped = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        bool mappedOk = mapped != nullptr;
+        if (mapped) {
+            std::memcpy(mapped, TextureSystem::GetImageData(result.image), size);
+            mappedOk = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        const Request &request = result.request;
+        const TextureSystem::TextureHandle texture =
+            TextureSystem::CreateTexture("", request.path, result.image,
+                                         request.generateMips, mappedOk ? buffer.id : 0);
+        TextureSystem::FreeImage(result.image);
+
+        if (!texture) {
+            m_stats.failed++;
+            return;
+        }
+
+        // keeps an unload pass from freeing the texture before its callback runs
+        TextureSystem::AddRef(texture);
+
+        buffer.inUse = true;
+
+        Upload upload{};
+        upload.pixelBuffer = pixelBufferIndex;
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        upload.texture = texture;
+        upload.onTextureLoaded = request.onTextureLoaded;
+        m_uploads.push_back(std::move(upload));
+    }
+
+    static void UploadMesh(Result &result) {
+        const MeshSystem::MeshHandle mesh = MeshSystem::CreateMesh("", result.mesh);
+        if (!mesh) {
+            m_stats.failed++;
+            return;
+        }
+
+        // glBufferData returns once the data is copied, but the driver may still be
+        // moving it to the GPU. Waiting on a fence keeps the swap into the
+        // placeholder from stalling the first draw that uses it
+        MeshSystem::AddRef(mesh);
+
+        Upload upload{};
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        upload.mesh = mesh;
+        upload.onMeshLoaded = std::move(result.request.onMeshLoaded);
+        m_uploads.push_back(std::move(upload));
+    }
+
+    static void Refill(Result &result) {
+        const Request &request = result.request;
+        const bool filled = request.type == RequestType::Texture
+                                ? request.fillTexture(result.image)
+                                : request.fillMesh(result.mesh);
+        TextureSystem::FreeImage(result.image);
+
+        if (!filled) {
+            m_stats.failed++;
+            request.onRefilled(false);
+            return;
+        }
+
+        Upload upload{};
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        upload.onRefilled = request.onRefilled;
+        m_uploads.push_back(std::move(upload));
+    }
+
+    static void PushRequest(Request request) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_requests.push_back(std::move(request));
+        }
+        m_condition.notify_one();
+    }
+
+    static void RetireUploads() {
+        for (auto it = m_uploads.begin(); it != m_uploads.end();) {
+            const GLenum status = glClientWaitSync(it->fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                ++it;
+                continue;
+            }
+
+            glDeleteSync(it->fence);
+            if (it->pixelBuffer) {
+                m_pixelBuffers[*it->pixelBuffer].inUse = false;
+            }
+
+            m_stats.completed++;
+            if (it->onRefilled) {
+                it->onRefilled(true);
+            } else if (it->texture) {
+                TextureSystem::RemoveRef(it->texture);
+                if (it->onTextureLoaded) {
+                    it->onTextureLoaded(it->texture);
+                }
+            } else {
+                MeshSystem::RemoveRef(it->mesh);
+                if (it->onMeshLoaded) {
+                    it->onMeshLoaded(it->mesh);
+                }
+            }
+
+            it = m_uploads.erase(it);
+        }
+    }
+
+    void Init(uint32_t workerCount) {
+        CleanUp();
+
+        if (workerCount == 0) {
+            // leave a core for the main thread
+            const uint32_t cores = std::thread::hardware_concurrency();
+            workerCount = std::clamp(cores > 1 ? cores - 1 : 1u, 1u, 4u);
+        }
+
+        m_stopping = false;
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(WorkerLoop);
+        }
+    }
+
+    void LoadTexture(const std::string &name, const std::string &path,
+                     const bool generateMips, TextureCallback onLoaded) {
+        Request request{};
+        request.type = RequestType::Texture;
+        request.name = name;
+        request.path = path;
+        request.generateMips = generateMips;
+        request.onTextureLoaded = std::move(onLoaded);
+
+        PushRequest(std::move(request));
+    }
+
+    void LoadMesh(const std::string &name, MeshDecoder decoder, MeshCallback onLoaded) {
+        Request request{};
+        request.type = RequestType::Mesh;
+        request.name = name;
+        request.decodeMesh = std::move(decoder);
+        request.onMeshLoaded = std::move(onLoaded);
+
+        PushRequest(std::move(request));
+    }
+
+    void RefillTexture(const std::string &name, const std::string &path,
+                       TextureFiller fill, RefillCallback onRefilled) {
+        Request request{};
+        request.type = RequestType::Texture;
+        request.name = name;
+        request.path = path;
+        request.fillTexture = std::move(fill);
+        request.onRefilled = std::move(onRefilled);
+
+        PushRequest(std::move(request));
+    }
+
+    void RefillMesh(const std::string &name, MeshDecoder decoder, MeshFiller fill,
+                    RefillCallback onRefilled) {
+        Request request{};
+        request.type = RequestType::Mesh;
+        request.name = name;
+        request.decodeMesh = std::move(decoder);
+        request.fillMesh = std::move(fill);
+        request.onRefilled = std::move(onRefilled);
+
+        PushRequest(std::move(request));
+    }
+
+    void Update() {
+        m_stats.uploadedBytes = 0;
+
+        RetireUploads();
+
+        while (true) {
+            Result result;
+            std::optional<size_t> pixelBuffer;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_results.empty()) {
+                    break;
+                }
+
+                Result &next = m_results.front();
+                if (next.success) {
+                    const size_t size = GetUploadSize(next);
+                    if (m_stats.uploadedBytes > 0 &&
+                        m_stats.uploadedBytes + size > m_uploadBudget) {
+                        break;
+                    }
+
+                    // refills upload straight into the existing texture
+                    if (next.request.type == RequestType::Texture &&
+                        !next.request.onRefilled) {
+                        pixelBuffer = AcquirePixelBuffer(size);
+                        if (!pixelBuffer) {
+                            break;
+                        }
+                    }
+
+                    m_stats.uploadedBytes += size;
+                }
+
+                result = std::move(next);
+                m_results.pop_front();
+            }
+
+            if (!result.success) {
+                ErrorHandler::Warn("Failed to load " + result.request.name +
+                                       " asynchronously. Keeping placeholder.",
+                                   __FILE__, __func__, __LINE__);
+                TextureSystem::FreeImage(result.image);
+                m_stats.failed++;
+                if (result.request.onRefilled) {
+                    result.request.onRefilled(false);
+                }
+                continue;
+            }
+
+            if (result.request.onRefilled) {
+                Refill(result);
+            } else if (result.request.type == RequestType::Texture) {
+                UploadTexture(result, *pixelBuffer);
+            } else {
+                UploadMesh(result);
+            }
+        }
+    }
+
+    void SetUploadBudget(const size_t bytesPerFrame) {
+        m_uploadBudget = bytesPerFrame;
+    }
+
+    size_t GetUploadBudget() {
+        return m_uploadBudget;
+    }
+
+    bool IsIdle() {
+        std::lock_guard lock(m_mutex);
+        return m_requests.empty() && m_results.empty() && m_decoding == 0 &&
+               m_uploads.empty();
+    }
+
+    Stats GetStats() {
+        Stats stats = m_stats;
+        stats.uploading = static_cast<uint32_t>(m_uploads.size());
+
+        std::lock_guard lock(m_mutex);
+        stats.decoding = static_cast<uint32_t>(m_requests.size()) + m_decoding;
+        stats.waitingForUpload = static_cast<uint32_t>(m_results.size());
+
+        return stats;
+    }
+
+    void CleanUp() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+
+        for (auto &worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+
+        for (auto &result : m_results) {
+            TextureSystem::FreeImage(result.image);
+        }
+        m_requests.clear();
+        m_results.clear();
+        m_decoding = 0;
+
+        for (const auto &upload : m_uploads) {
+            glDeleteSync(upload.fence);
+            TextureSystem::RemoveRef(upload.texture);
+            MeshSystem::RemoveRef(upload.mesh);
+        }
+        m_uploads.clear();
+
+        for (const auto &buffer : m_pixelBuffers) {
+            GpuMemory::Release(GpuMemoryCategory::Staging, buffer.id);
+            glDeleteBuffers(1, &buffer.id);
+        }
+        m_pixelBuffers.clear();
+
+        m_stats = {};
+    }
+}
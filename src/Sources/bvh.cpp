@@ -0,0 +1,744 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+
+// leaves are widened by this share of their largest extent on every side
+static constexpr float m_margin = 0.1f;
+
+// Update rebuilds once the additions since the last build pass this share of the
+// leaves, incremental inserts lose quality a build would recover
+static constexpr uint32_t m_rebuildDivisor = 4;
+
+// past this share of the leaves moving at once, refitting the whole tree is
+// cheaper than reinserting each
+static constexpr uint32_t m_refitDivisor = 32;
+
+static constexpr uint32_t m_maxBins = 16;
+
+Frustum MakeFrustum(const glm::mat4 &viewProjection) {
+    const glm::mat4 m = glm::transpose(viewProjection);
+
+    return Frustum{{m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2],
+                    m[3] - m[2]}};
+}
+
+Aabb TransformBounds(const Aabb &bounds, const glm::mat4 &matrix) {
+    const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    const glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+    const glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    const glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x +
+                                  glm::abs(glm::vec3(matrix[1])) * extent.y +
+                                  glm::abs(glm::vec3(matrix[2])) * extent.z;
+
+    return {worldCenter - worldExtent, worldCenter + worldExtent};
+}
+
+static Aabb Union(const Aabb &a, const Aabb &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+static bool Encloses(const Aabb &outer, const Aabb &inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+           outer.min.z <= inner.min.z && outer.max.x >= inner.max.x &&
+           outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static bool Overlaps(const Aabb &a, const Aabb &b) {
+    return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z &&
+           b.min.x <= a.max.x && b.min.y <= a.max.y && b.min.z <= a.max.z;
+}
+
+// half the surface area, the SAH only compares them
+static float Area(const Aabb &bounds) {
+    const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static Aabb Widen(const Aabb &bounds) {
+    const glm::vec3 extent = bounds.max - bounds.min;
+    const float margin = m_margin * std::max({extent.x, extent.y, extent.z});
+
+    return {bounds.min - margin, bounds.max + margin};
+}
+
+// entry distance along the ray, infinity for a miss or one past limit
+static float Slab(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &origin,
+                  const glm::vec3 &inverseDirection, const float limit) {
+    const glm::vec3 t0 = (min - origin) * inverseDirection;
+    const glm::vec3 t1 = (max - origin) * inverseDirection;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+
+    const float entry = std::max({near.x, near.y, near.z, 0.0f});
+    const float exit = std::min({far.x, far.y, far.z, limit});
+
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+float RayEntry(const Aabb &bounds, const glm::vec3 &origin, const glm::vec3 &direction) {
+    return Slab(bounds.min, bounds.max, origin, 1.0f / direction,
+                std::numeric_limits<float>::infinity());
+}
+
+// traversal stack, on the call stack unless the tree is unusually deep
+template <typename T>
+class NodeStack {
+   public:
+    void Push(const T value) {
+        if (m_size < Capacity) {
+            m_fixed[m_size] = value;
+        } else {
+            m_spill.push_back(value);
+        }
+        m_size++;
+    }
+
+    T Pop() {
+        m_size--;
+        if (m_size < Capacity) {
+            return m_fixed[m_size];
+        }
+
+        const T value = m_spill.back();
+        m_spill.pop_back();
+        return value;
+    }
+
+    bool Empty() const {
+        return m_size == 0;
+    }
+
+   private:
+    static constexpr uint32_t Capacity = 64;
+
+    T m_fixed[Capacity];
+    std::vector<T> m_spill;
+    uint32_t m_size = 0;
+};
+
+void Bvh::Insert(const uint32_t item, const Aabb &bounds) {
+    if (item >= m_items.size()) {
+        m_items.resize(item + 1);
+    }
+
+    Item &entry = m_items[item];
+    if (entry.state != State::Absent) {
+        Move(item, bounds);
+        return;
+    }
+
+    entry.bounds = bounds;
+    entry.node = static_cast<uint32_t>(m_pending.size());
+    entry.state = State::Pending;
+    m_pending.push_back(item);
+}
+
+void Bvh::Move(const uint32_t item, const Aabb &bounds) {
+    if (!Contains(item)) {
+        return;
+    }
+
+    Item &entry = m_items[item];
+    entry.bounds = bounds;
+
+    if (entry.state != State::InTree || entry.moved) {
+        return;
+    }
+
+    if (Encloses(entry.widened, bounds)) {
+        m_nodes[entry.node].min = bounds.min;
+        m_nodes[entry.node].max = bounds.max;
+    } else {
+        entry.moved = true;
+        m_moved.push_back(item);
+    }
+}
+
+void Bvh::Remove(const uint32_t item) {
+    if (!Contains(item)) {
+        return;
+    }
+
+    Item &entry = m_items[item];
+    if (entry.state == State::Pending) {
+        RemovePending(item);
+    } else {
+        RemoveLeaf(entry.node);
+        FreeNode(entry.node);
+        m_leafCount--;
+    }
+
+    entry = {};
+}
+
+bool Bvh::Contains(const uint32_t item) const {
+    return item < m_items.size() && m_items[item].state != State::Absent;
+}
+
+void Bvh::Update() {
+    if (m_pending.empty() && m_moved.empty()) {
+        return;
+    }
+
+    if (m_inserted + m_pending.size() > m_leafCount / m_rebuildDivisor) {
+        Build();
+        return;
+    }
+
+    if (m_moved.size() > m_leafCount / m_refitDivisor) {
+        RefitAll();
+    }
+
+    for (const uint32_t item : m_moved) {
+        Item &entry = m_items[item];
+        if (entry.state != State::InTree || !entry.moved) {
+            continue;
+        }
+
+        entry.moved = false;
+        RemoveLeaf(entry.node);
+
+        entry.widened = Widen(entry.bounds);
+        m_nodes[entry.node].min = entry.bounds.min;
+        m_nodes[entry.node].max = entry.bounds.max;
+        InsertLeaf(entry.node);
+    }
+
+    for (const uint32_t item : m_pending) {
+        Item &entry = m_items[item];
+        const uint32_t leaf = AllocateNode();
+        m_nodes[leaf] = {entry.bounds.min, item, entry.bounds.max, None};
+
+        entry.widened = Widen(entry.bounds);
+        entry.node = leaf;
+        entry.state = State::InTree;
+        InsertLeaf(leaf);
+        m_leafCount++;
+        m_inserted++;
+    }
+
+    m_moved.clear();
+    m_pending.clear();
+}
+
+void Bvh::Build() {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // partitioned in place, so each level reads its range front to back
+    struct Primitive {
+        Aabb bounds;
+        glm::vec3 centroid;
+        uint32_t item;
+    };
+
+    std::vector<Primitive> primitives;
+    primitives.reserve(m_leafCount + m_pending.size());
+    for (uint32_t i = 0; i < m_items.size(); i++) {
+        if (m_items[i].state != State::Absent) {
+            const Aabb &bounds = m_items[i].bounds;
+            primitives.push_back({Widen(bounds), (bounds.min + bounds.max) * 0.5f, i});
+        }
+    }
+
+    m_nodes.clear();
+    m_parents.clear();
+    m_freeNodes.clear();
+    m_pending.clear();
+    m_moved.clear();
+    m_root = None;
+    m_leafCount = static_cast<uint32_t>(primitives.size());
+    m_inserted = 0;
+    m_builds++;
+
+    if (primitives.empty()) {
+        m_buildMs = 0.0f;
+        return;
+    }
+
+    m_nodes.reserve(primitives.size() * 2 - 1);
+    m_parents.reserve(primitives.size() * 2 - 1);
+
+    // a node's left child is built straight after it, so the tree comes out in
+    // depth-first order. The right child is linked to its parent when popped.
+    // A range's bounds come from its parent's bins, only the root and the halves
+    // of a split that fell back to the middle are measured
+    struct Range {
+        uint32_t begin;
+        uint32_t count;
+        uint32_t parent;
+        bool isRight;
+        bool isMeasured;
+        Aabb bounds;
+        Aabb centroidBounds;
+    };
+
+    NodeStack<Range> ranges;
+    ranges.Push({0, m_leafCount, None, false, false, {}, {}});
+
+    while (!ranges.Empty()) {
+        Range range = ranges.Pop();
+        const uint32_t node = AllocateNode();
+        m_parents[node] = range.parent;
+
+        if (range.parent == None) {
+            m_root = node;
+        } else if (range.isRight) {
+            m_nodes[range.parent].right = node;
+        } else {
+            m_nodes[range.parent].left = node;
+        }
+
+        Primitive *first = primitives.data() + range.begin;
+        if (range.count == 1) {
+            Item &entry = m_items[first->item];
+            m_nodes[node] = {entry.bounds.min, first->item, entry.bounds.max, None};
+            entry.widened = first->bounds;
+            entry.node = node;
+            entry.state = State::InTree;
+            entry.moved = false;
+            continue;
+        }
+
+        if (!range.isMeasured) {
+            for (uint32_t i = 0; i < range.count; i++) {
+                range.bounds = Union(range.bounds, first[i].bounds);
+                range.centroidBounds = Union(range.centroidBounds,
+                                             {first[i].centroid, first[i].centroid});
+            }
+        }
+
+        const Aabb &centroidBounds = range.centroidBounds;
+        m_nodes[node] = {range.bounds.min, None, range.bounds.max, None};
+
+        Range left{range.begin, range.count / 2, node, false, false, {}, {}};
+        Range right{range.begin + left.count, range.count - left.count, node, true,
+                    false, {}, {}};
+
+        // binned SAH along the longest axis of the centroids
+        const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                             : (extent.y > extent.z ? 1 : 2);
+
+        if (extent[axis] > 0.0f) {
+            // most ranges are small, they get a bin per primitive at most
+            const uint32_t binCount = std::min(range.count, m_maxBins);
+            const float lowest = centroidBounds.min[axis];
+            const float scale = static_cast<float>(binCount) / extent[axis];
+            const auto binOf = [&](const Primitive &primitive) {
+                const auto bin =
+                    static_cast<uint32_t>((primitive.centroid[axis] - lowest) * scale);
+                return std::min(bin, binCount - 1);
+            };
+
+            Aabb binBounds[m_maxBins];
+            Aabb binCentroids[m_maxBins];
+            uint32_t binCounts[m_maxBins] = {};
+            for (uint32_t i = 0; i < range.count; i++) {
+                const uint32_t bin = binOf(first[i]);
+                binBounds[bin] = Union(binBounds[bin], first[i].bounds);
+                binCentroids[bin] =
+                    Union(binCentroids[bin], {first[i].centroid, first[i].centroid});
+                binCounts[bin]++;
+            }
+
+            // costs of splitting after each bin, the right side swept first
+            float rightCosts[m_maxBins];
+            Aabb side;
+            uint32_t sideCount = 0;
+            for (uint32_t bin = binCount - 1; bin > 0; bin--) {
+                side = Union(side, binBounds[bin]);
+                sideCount += binCounts[bin];
+                rightCosts[bin - 1] = Area(side) * static_cast<float>(sideCount);
+            }
+
+            side = {};
+            sideCount = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            uint32_t bestBin = 0;
+            for (uint32_t bin = 0; bin < binCount - 1; bin++) {
+                side = Union(side, binBounds[bin]);
+                sideCount += binCounts[bin];
+
+                const float cost = Area(side) * static_cast<float>(sideCount) +
+                                   rightCosts[bin];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestBin = bin;
+                }
+            }
+
+            const Primitive *middle = std::partition(
+                first, first + range.count,
+                [&](const Primitive &primitive) { return binOf(primitive) <= bestBin; });
+            const auto split = static_cast<uint32_t>(middle - first);
+
+            if (split > 0 && split < range.count) {
+                left.count = split;
+                right.begin = range.begin + split;
+                right.count = range.count - split;
+                left.isMeasured = right.isMeasured = true;
+
+                for (uint32_t bin = 0; bin < binCount; bin++) {
+                    Range &side = bin <= bestBin ? left : right;
+                    side.bounds = Union(side.bounds, binBounds[bin]);
+                    side.centroidBounds = Union(side.centroidBounds, binCentroids[bin]);
+                }
+            }
+        }
+
+        ranges.Push(right);
+        ranges.Push(left);
+    }
+
+    m_buildMs = std::chrono::duration<float, std::milli>(
+                    std::chrono::high_resolution_clock::now() - start)
+                    .count();
+}
+
+void Bvh::QueryBox(const Aabb &box, std::vector<uint32_t> &results) const {
+    if (m_root == None) {
+        return;
+    }
+
+    NodeStack<uint32_t> stack;
+    stack.Push(m_root);
+
+    while (!stack.Empty()) {
+        const Node &node = m_nodes[stack.Pop()];
+        if (!Overlaps({node.min, node.max}, box)) {
+            continue;
+        }
+
+        if (node.right == None) {
+            results.push_back(node.left);
+        } else {
+            stack.Push(node.right);
+            stack.Push(node.left);
+        }
+    }
+}
+
+void Bvh::QuerySphere(const glm::vec3 &center, const float radius,
+                      std::vector<uint32_t> &results) const {
+    if (m_root == None) {
+        return;
+    }
+
+    const float radiusSquared = radius * radius;
+    const auto touches = [&](const glm::vec3 &min, const glm::vec3 &max) {
+        const glm::vec3 offset = center - glm::min(glm::max(center, min), max);
+        return glm::dot(offset, offset) <= radiusSquared;
+    };
+
+    NodeStack<uint32_t> stack;
+    stack.Push(m_root);
+
+    while (!stack.Empty()) {
+        const Node &node = m_nodes[stack.Pop()];
+        if (!touches(node.min, node.max)) {
+            continue;
+        }
+
+        if (node.right == None) {
+            results.push_back(node.left);
+        } else {
+            stack.Push(node.right);
+            stack.Push(node.left);
+        }
+    }
+}
+
+void Bvh::QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const {
+    if (m_root == None) {
+        return;
+    }
+
+    // clears the bits of the planes the box is wholly inside, so the subtree
+    // below skips them. False when it is wholly outside one
+    const auto classify = [&](const glm::vec3 &min, const glm::vec3 &max,
+                              uint32_t &planes) {
+        for (uint32_t i = 0; i < 6; i++) {
+            if (!(planes & (1u << i))) {
+                continue;
+            }
+
+            const glm::vec4 &plane = frustum.planes[i];
+            const glm::vec3 normal(plane);
+            const glm::vec3 farthest(normal.x > 0.0f ? max.x : min.x,
+                                     normal.y > 0.0f ? max.y : min.y,
+                                     normal.z > 0.0f ? max.z : min.z);
+            if (glm::dot(normal, farthest) + plane.w < 0.0f) {
+                return false;
+            }
+
+            const glm::vec3 nearest = min + max - farthest;
+            if (glm::dot(normal, nearest) + plane.w >= 0.0f) {
+                planes &= ~(1u << i);
+            }
+        }
+
+        return true;
+    };
+
+    struct Entry {
+        uint32_t node;
+        uint32_t planes;
+    };
+
+    NodeStack<Entry> stack;
+    stack.Push({m_root, 0x3f});
+
+    while (!stack.Empty()) {
+        Entry entry = stack.Pop();
+        const Node &node = m_nodes[entry.node];
+        if (entry.planes && !classify(node.min, node.max, entry.planes)) {
+            continue;
+        }
+
+        if (node.right == None) {
+            results.push_back(node.left);
+        } else {
+            stack.Push({node.right, entry.planes});
+            stack.Push({node.left, entry.planes});
+        }
+    }
+}
+
+Bvh::RayHit Bvh::Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                         const float maxDistance,
+                         const std::function<float(uint32_t)> &hitTest) const {
+    RayHit hit;
+    hit.distance = maxDistance;
+    if (m_root == None) {
+        return hit;
+    }
+
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    const auto entry = [&](const Node &node) {
+        return Slab(node.min, node.max, origin, inverseDirection, hit.distance);
+    };
+
+    struct Entry {
+        uint32_t node;
+        float distance;
+    };
+
+    NodeStack<Entry> stack;
+    stack.Push({m_root, entry(m_nodes[m_root])});
+
+    while (!stack.Empty()) {
+        const Entry current = stack.Pop();
+        if (current.distance >= hit.distance) {
+            continue;
+        }
+
+        const Node &node = m_nodes[current.node];
+        if (node.right == None) {
+            const float distance = hitTest ? hitTest(node.left) : current.distance;
+
+            if (distance < hit.distance) {
+                hit = {node.left, distance};
+            }
+            continue;
+        }
+
+        // the nearer child is popped first, it is likelier to shorten the ray
+        Entry left{node.left, entry(m_nodes[node.left])};
+        Entry right{node.right, entry(m_nodes[node.right])};
+        if (left.distance < right.distance) {
+            std::swap(left, right);
+        }
+
+        if (left.distance < hit.distance) {
+            stack.Push(left);
+        }
+        if (right.distance < hit.distance) {
+            stack.Push(right);
+        }
+    }
+
+    if (hit.item == None) {
+        hit.distance = std::numeric_limits<float>::infinity();
+    }
+
+    return hit;
+}
+
+Bvh::Stats Bvh::GetStats() const {
+    return {m_leafCount + static_cast<uint32_t>(m_pending.size()),
+            static_cast<uint32_t>(m_nodes.size() - m_freeNodes.size()),
+            m_builds,
+            m_refits,
+            m_inserted,
+            m_buildMs};
+}
+
+void Bvh::Clear() {
+    *this = {};
+}
+
+uint32_t Bvh::AllocateNode() {
+    if (!m_freeNodes.empty()) {
+        const uint32_t node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        return node;
+    }
+
+    m_nodes.emplace_back();
+    m_parents.push_back(None);
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void Bvh::FreeNode(const uint32_t node) {
+    m_freeNodes.push_back(node);
+}
+
+// descends to the sibling whose pairing adds the least surface area over the
+// path (Box2D's b2DynamicTree), then links the leaf beside it under a new node
+void Bvh::InsertLeaf(const uint32_t leaf) {
+    if (m_root == None) {
+        m_root = leaf;
+        m_parents[leaf] = None;
+        return;
+    }
+
+    const Aabb bounds = GetOuterBounds(leaf);
+    const auto descendCost = [&](const uint32_t child, const float inherited) {
+        const Aabb outer = GetOuterBounds(child);
+        const float area = Area(Union(bounds, outer));
+        return m_nodes[child].right == None ? area + inherited
+                                            : area - Area(outer) + inherited;
+    };
+
+    uint32_t sibling = m_root;
+    while (m_nodes[sibling].right != None) {
+        const Node &node = m_nodes[sibling];
+        const float area = Area({node.min, node.max});
+        const float combined = Area(Union(bounds, {node.min, node.max}));
+
+        const float cost = 2.0f * combined;
+        const float inherited = 2.0f * (combined - area);
+        const float leftCost = descendCost(node.left, inherited);
+        const float rightCost = descendCost(node.right, inherited);
+
+        if (cost < leftCost && cost < rightCost) {
+            break;
+        }
+
+        sibling = leftCost < rightCost ? node.left : node.right;
+    }
+
+    const uint32_t oldParent = m_parents[sibling];
+    const uint32_t parent = AllocateNode();
+    const Aabb combined = Union(bounds, GetOuterBounds(sibling));
+    m_nodes[parent] = {combined.min, sibling, combined.max, leaf};
+    m_parents[parent] = oldParent;
+    m_parents[sibling] = parent;
+    m_parents[leaf] = parent;
+
+    if (oldParent == None) {
+        m_root = parent;
+    } else {
+        Node &grandparent = m_nodes[oldParent];
+        (grandparent.left == sibling ? grandparent.left : grandparent.right) = parent;
+        RefitFrom(oldParent);
+    }
+}
+
+void Bvh::RemoveLeaf(const uint32_t leaf) {
+    if (leaf == m_root) {
+        m_root = None;
+        return;
+    }
+
+    const uint32_t parent = m_parents[leaf];
+    const uint32_t grandparent = m_parents[parent];
+    const uint32_t sibling =
+        m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+    m_parents[sibling] = grandparent;
+    if (grandparent == None) {
+        m_root = sibling;
+    } else {
+        Node &node = m_nodes[grandparent];
+        (node.left == parent ? node.left : node.right) = sibling;
+        RefitFrom(grandparent);
+    }
+
+    FreeNode(parent);
+}
+
+// the moved leaves stay where they are and every interior node is recomputed,
+// children before parents
+void Bvh::RefitAll() {
+    for (const uint32_t item : m_moved) {
+        Item &entry = m_items[item];
+        if (entry.state == State::InTree && entry.moved) {
+            entry.moved = false;
+            entry.widened = Widen(entry.bounds);
+            m_nodes[entry.node].min = entry.bounds.min;
+            m_nodes[entry.node].max = entry.bounds.max;
+        }
+    }
+    m_moved.clear();
+
+    // the last leaf may have gone since it moved
+    if (m_root == None) {
+        return;
+    }
+    m_refits++;
+
+    std::vector<uint32_t> interior;
+    interior.reserve(m_leafCount);
+
+    NodeStack<uint32_t> stack;
+    stack.Push(m_root);
+    while (!stack.Empty()) {
+        const uint32_t node = stack.Pop();
+        if (m_nodes[node].right != None) {
+            interior.push_back(node);
+            stack.Push(m_nodes[node].right);
+            stack.Push(m_nodes[node].left);
+        }
+    }
+
+    for (size_t i = interior.size(); i-- > 0;) {
+        Node &node = m_nodes[interior[i]];
+        const Aabb bounds = Union(GetOuterBounds(node.left), GetOuterBounds(node.right));
+        node.min = bounds.min;
+        node.max = bounds.max;
+    }
+}
+
+// stops at the first node whose bounds come out the same
+void Bvh::RefitFrom(uint32_t node) {
+    while (node != None) {
+        Node &current = m_nodes[node];
+        const Aabb bounds =
+            Union(GetOuterBounds(current.left), GetOuterBounds(current.right));
+
+        if (bounds.min == current.min && bounds.max == current.max) {
+            return;
+        }
+
+        current.min = bounds.min;
+        current.max = bounds.max;
+        node = m_parents[node];
+    }
+}
+
+Aabb Bvh::GetOuterBounds(const uint32_t node) const {
+    const Node &current = m_nodes[node];
+    return current.right == None ? m_items[current.left].widened
+                                 : Aabb{current.min, current.max};
+}
+
+void Bvh::RemovePending(const uint32_t item) {
+    const uint32_t position = m_items[item].node;
+    const uint32_t last = m_pending.back();
+    m_pending[position] = last;
+    m_items[last].node = position;
+    m_pending.pop_back();
+}
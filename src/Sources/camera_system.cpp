@@ -16,7 +16,13 @@ namespace CameraSystem {
     Camera *CreateCamera(const std::string &name) {
         Camera camera{};
         camera.name = name;
-        camera.transform = TransformSystem::CreateTransform(name + "_transform");
+        camera.transform = TransformSystem::CreateTransform();
+
+        // every scene load recreates its camera, the one it replaces must not
+        // leave its transform behind
+        if (const Camera *existing = GetCamera(name)) {
+            TransformSystem::DestroyTransform(existing->transform);
+        }
 
         m_cameras[name] = camera;
 
@@ -145,8 +151,8 @@ namespace CameraSystem {
         return camera->projMatrix;
     }
 
-    TransformSystem::Transform *GetTransform(const Camera *camera) {
-        return camera ? camera->transform : nullptr;
+    TransformSystem::TransformHandle GetTransform(const Camera *camera) {
+        return camera ? camera->transform : TransformSystem::TransformHandle{};
     }
 
     const glm::vec3 &GetPosition(const Camera *camera) {
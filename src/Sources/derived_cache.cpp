@@ -0,0 +1,295 @@
+#include "derived_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace DerivedCache {
+    struct KindInfo {
+        const char *name;
+        const char *directory;
+        const char *extension;
+    };
+
+    static constexpr KindInfo m_kinds[] = {
+        {"Meshes", "Meshes", ".gmesh"},
+        {"Textures", "Textures", ".dds"},
+    };
+    static_assert(std::size(m_kinds) == static_cast<size_t>(DerivedAssetKind::Count));
+
+    // temporaries older than this belong to a writer that died mid-store
+    static constexpr auto m_staleTemporaryAge = std::chrono::hours(1);
+
+    // set once in Init, before loader threads run
+    static std::filesystem::path m_directory = Options{}.directory;
+
+    static std::atomic<uint64_t> m_maxBytes = Options{}.maxBytes;
+    static std::atomic<uint64_t> m_bytes = 0;
+    static std::atomic<uint32_t> m_hits = 0;
+    static std::atomic<uint32_t> m_misses = 0;
+    static std::atomic<uint32_t> m_stores = 0;
+    static std::atomic<uint32_t> m_evictions = 0;
+
+    static std::mutex m_trimMutex;
+
+    // blobs streamed from after loading, by path, with how often each is pinned
+    static std::unordered_map<std::string, uint32_t> m_pinned;
+    static std::mutex m_pinMutex;
+
+    static std::string GetPinKey(const std::filesystem::path &path) {
+        return path.lexically_normal().string();
+    }
+
+    static bool IsPinned(const std::filesystem::path &path) {
+        std::lock_guard lock(m_pinMutex);
+        return m_pinned.contains(GetPinKey(path));
+    }
+
+    static const KindInfo &GetInfo(const DerivedAssetKind kind) {
+        return m_kinds[static_cast<size_t>(kind)];
+    }
+
+    // unique per thread and, being random, per process sharing the directory
+    static std::string GetTemporarySuffix() {
+        thread_local const uint64_t token = [] {
+            std::random_device device;
+            return static_cast<uint64_t>(device()) << 32 | device();
+        }();
+
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp",
+                      static_cast<unsigned long long>(token));
+        return suffix;
+    }
+
+    void Init(const Options &options) {
+        CleanUp();
+
+        m_directory = options.directory;
+        m_maxBytes = options.maxBytes;
+
+        Trim();
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(1) << "Derived asset cache holds "
+               << static_cast<float>(m_bytes) / (1024.0f * 1024.0f) << " MB in "
+               << m_directory.string();
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+    }
+
+    Hash::Hasher BeginKey(const DerivedAssetKind kind, const uint32_t version) {
+        Hash::Hasher hasher;
+        hasher.Add(kind);
+        hasher.Add(version);
+        return hasher;
+    }
+
+    std::filesystem::path GetPath(const DerivedAssetKind kind, const uint64_t key) {
+        const KindInfo &info = GetInfo(kind);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx%s",
+                      static_cast<unsigned long long>(key), info.extension);
+        return m_directory / info.directory / name;
+    }
+
+    std::filesystem::path Find(const DerivedAssetKind kind, const uint64_t key) {
+        std::filesystem::path path = GetPath(kind, key);
+
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(path, error)) {
+            m_misses++;
+            return {};
+        }
+
+        // the modification time is the LRU clock every process sharing the cache sees
+        std::filesystem::last_write_time(
+            path, std::filesystem::file_time_type::clock::now(), error);
+
+        m_hits++;
+        return path;
+    }
+
+    FileView Load(const DerivedAssetKind kind, const uint64_t key) {
+        const std::filesystem::path path = Find(kind, key);
+        if (path.empty()) {
+            return {};
+        }
+
+        auto file = std::make_shared<const MappedFile>(path);
+        if (!file->Data()) {
+            return {};
+        }
+
+        const uint8_t *data = file->Data();
+        const size_t size = file->Size();
+
+        return {std::move(file), data, size};
+    }
+
+    bool Store(const DerivedAssetKind kind, const uint64_t key,
+               const std::function<bool(std::ostream &)> &write) {
+        const std::filesystem::path path = GetPath(kind, key);
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        // readers only ever see a complete blob, and two writers racing on one key
+        // write identical contents, so whichever rename lands last is fine
+        std::filesystem::path temporary = path;
+        temporary += GetTemporarySuffix();
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                ErrorHandler::Warn("Failed to write derived asset: " + temporary.string(),
+                                   __FILE__, __func__, __LINE__);
+                return false;
+            }
+
+            if (!write(file) || !file.good()) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        m_stores++;
+        const uint64_t size = std::filesystem::file_size(path, error);
+        if (!error && (m_bytes += size) > m_maxBytes) {
+            Trim();
+        }
+
+        return true;
+    }
+
+    void Trim() {
+        // one trim at a time is enough, a store that finds one running moves on
+        std::unique_lock lock(m_trimMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+
+        struct Blob {
+            std::filesystem::path path;
+            uint64_t size;
+            std::filesystem::file_time_type lastUsed;
+        };
+
+        const auto now = std::filesystem::file_time_type::clock::now();
+
+        std::vector<Blob> blobs;
+        uint64_t total = 0;
+
+        std::error_code error;
+        for (const auto &file :
+             std::filesystem::recursive_directory_iterator(m_directory, error)) {
+            if (!file.is_regular_file(error)) {
+                continue;
+            }
+
+            const auto lastUsed = file.last_write_time(error);
+            if (error) {
+                continue;
+            }
+
+            if (file.path().extension() == ".tmp") {
+                if (now - lastUsed > m_staleTemporaryAge) {
+                    std::filesystem::remove(file.path(), error);
+                }
+
+                continue;
+            }
+
+            const uint64_t size = file.file_size(error);
+            if (error) {
+                continue;
+            }
+
+            blobs.push_back({file.path(), size, lastUsed});
+            total += size;
+        }
+
+        // trim to nine tenths of the limit so the next few stores don't trim again
+        const uint64_t limit = m_maxBytes;
+        if (total > limit) {
+            std::ranges::sort(blobs, {}, &Blob::lastUsed);
+
+            const uint64_t target = limit - limit / 10;
+            for (const Blob &blob : blobs) {
+                if (total <= target) {
+                    break;
+                }
+
+                if (IsPinned(blob.path)) {
+                    continue;
+                }
+
+                // a blob another process still has open may refuse, skip it
+                if (std::filesystem::remove(blob.path, error)) {
+                    total -= blob.size;
+                    m_evictions++;
+                }
+            }
+        }
+
+        m_bytes = total;
+    }
+
+    void Pin(const std::filesystem::path &path) {
+        std::lock_guard lock(m_pinMutex);
+        m_pinned[GetPinKey(path)]++;
+    }
+
+    void Unpin(const std::filesystem::path &path) {
+        std::lock_guard lock(m_pinMutex);
+        const auto it = m_pinned.find(GetPinKey(path));
+        if (it != m_pinned.end() && --it->second == 0) {
+            m_pinned.erase(it);
+        }
+    }
+
+    void SetMaxBytes(const uint64_t bytes) {
+        m_maxBytes = bytes;
+        if (m_bytes > bytes) {
+            Trim();
+        }
+    }
+
+    Stats GetStats() {
+        return {m_hits, m_misses, m_stores, m_evictions, m_bytes};
+    }
+
+    const char *GetName(const DerivedAssetKind kind) {
+        return GetInfo(kind).name;
+    }
+
+    void CleanUp() {
+        if (m_hits + m_misses + m_stores > 0) {
+            ErrorHandler::Info("Derived asset cache: " + std::to_string(m_hits) +
+                                   " hits, " + std::to_string(m_misses) + " misses, " +
+                                   std::to_string(m_stores) + " stores, " +
+                                   std::to_string(m_evictions) + " evictions",
+                               __FILE__, __func__, __LINE__);
+        }
+
+        m_hits = 0;
+        m_misses = 0;
+        m_stores = 0;
+        m_evictions = 0;
+        m_bytes = 0;
+    }
+}
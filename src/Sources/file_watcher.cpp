@@ -0,0 +1,155 @@
+#include "file_watcher.h"
+
+#include <chrono>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace FileWatcher {
+    using Clock = std::chrono::steady_clock;
+
+    // editors write a file in several steps, wait for them to finish
+    static constexpr auto m_settleTime = std::chrono::milliseconds(50);
+
+    static std::unordered_map<std::string, Clock::time_point> m_pending;
+
+#ifdef __linux__
+    static int m_fd = -1;
+    static std::unordered_map<int, std::filesystem::path> m_directories;
+
+    static bool AddWatch(const std::filesystem::path &directory) {
+        const int descriptor =
+            inotify_add_watch(m_fd, directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF);
+        if (descriptor < 0) {
+            ErrorHandler::Warn("Failed to watch " + directory.string(), __FILE__,
+                               __func__, __LINE__);
+            return false;
+        }
+
+        m_directories[descriptor] = directory;
+        return true;
+    }
+
+    static void ReadEvents() {
+        alignas(inotify_event) char buffer[16 * 1024];
+
+        ssize_t length;
+        while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+            const auto now = Clock::now();
+
+            for (const char *position = buffer; position < buffer + length;) {
+                const auto *event = reinterpret_cast<const inotify_event *>(position);
+                position += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_IGNORED) {
+                    m_directories.erase(event->wd);
+                    continue;
+                }
+
+                const auto it = m_directories.find(event->wd);
+                if (it == m_directories.end() || event->len == 0) {
+                    continue;
+                }
+
+                const std::filesystem::path path = it->second / event->name;
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        Watch(path);
+                    }
+
+                    continue;
+                }
+
+                // a create is always followed by the close of its first write
+                if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                    m_pending[path.string()] = now;
+                }
+            }
+        }
+    }
+#endif
+
+    void Init() {
+        CleanUp();
+
+#ifdef __linux__
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0) {
+            ErrorHandler::Warn("inotify is unavailable, assets won't hot reload",
+                               __FILE__, __func__, __LINE__);
+        }
+#else
+        ErrorHandler::Info("File watching is not supported on this platform", __FILE__,
+                           __func__, __LINE__);
+#endif
+    }
+
+    bool Watch(const std::filesystem::path &directory) {
+#ifdef __linux__
+        std::error_code error;
+        if (m_fd < 0 || !std::filesystem::is_directory(directory, error) ||
+            !AddWatch(directory)) {
+            return false;
+        }
+
+        for (const auto &entry :
+             std::filesystem::recursive_directory_iterator(directory, error)) {
+            if (entry.is_directory(error)) {
+                AddWatch(entry.path());
+            }
+        }
+
+        return true;
+#else
+        (void)directory;
+        return false;
+#endif
+    }
+
+    std::vector<std::filesystem::path> Poll() {
+#ifdef __linux__
+        if (m_fd >= 0) {
+            ReadEvents();
+        }
+#endif
+
+        std::vector<std::filesystem::path> changed;
+        if (m_pending.empty()) {
+            return changed;
+        }
+
+        const auto now = Clock::now();
+        std::erase_if(m_pending, [&changed, now](const auto &pending) {
+            if (now - pending.second < m_settleTime) {
+                return false;
+            }
+
+            // editors often write a temporary and rename it over the real file
+            std::error_code error;
+            if (std::filesystem::is_regular_file(pending.first, error)) {
+                changed.emplace_back(pending.first);
+            }
+
+            return true;
+        });
+
+        return changed;
+    }
+
+    void CleanUp() {
+#ifdef __linux__
+        if (m_fd >= 0) {
+            close(m_fd);
+            m_fd = -1;
+        }
+
+        m_directories.clear();
+#endif
+
+        m_pending.clear();
+    }
+}
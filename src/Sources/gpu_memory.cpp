@@ -0,0 +1,241 @@
+#include "gpu_memory.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace GpuMemory {
+    struct Allocation {
+        GpuMemoryCategory category;
+        size_t bytes;
+        uint64_t lastUsedFrame;
+        bool evicted;
+        bool reloading;
+        uint32_t failures;
+        uint64_t retryFrame;
+        Evictor evictor;
+    };
+
+    // objects idle for fewer frames than this are likely drawn again soon, e.g.
+    // just off screen while the camera pans, evicting them would thrash
+    static constexpr uint64_t m_minIdleFrames = 30;
+
+    // failed reloads wait twice as long each time, up to this many frames
+    static constexpr uint64_t m_maxRetryFrames = 256;
+
+    static constexpr auto m_categoryCount =
+        static_cast<size_t>(GpuMemoryCategory::Count);
+
+    static std::unordered_map<uint64_t, Allocation> m_allocations;
+    static Usage m_usage[m_categoryCount];
+    static size_t m_total = 0;
+    static size_t m_budget = 512 * 1024 * 1024;
+    static uint64_t m_frame = 0;
+    static Stats m_stats{};
+
+    static uint64_t GetKey(const GpuMemoryCategory category, const GLuint id) {
+        return static_cast<uint64_t>(category) << 32 | id;
+    }
+
+    static void SetBytes(Allocation &allocation, const size_t bytes) {
+        Usage &usage = m_usage[static_cast<size_t>(allocation.category)];
+        usage.bytes = usage.bytes - allocation.bytes + bytes;
+        m_total = m_total - allocation.bytes + bytes;
+        allocation.bytes = bytes;
+    }
+
+    void Init() {
+        CleanUp();
+    }
+
+    void Track(const GpuMemoryCategory category, const GLuint id, const size_t bytes) {
+        if (id == 0) {
+            return;
+        }
+
+        auto [it, inserted] = m_allocations.try_emplace(
+            GetKey(category, id),
+            Allocation{category, 0, m_frame, false, false, 0, 0, {}});
+        if (inserted) {
+            m_usage[static_cast<size_t>(category)].allocations++;
+        }
+
+        Allocation &allocation = it->second;
+        if (allocation.evicted) {
+            m_stats.reloads++;
+        }
+
+        SetBytes(allocation, bytes);
+        allocation.evicted = false;
+        allocation.reloading = false;
+        allocation.failures = 0;
+    }
+
+    void Release(const GpuMemoryCategory category, const GLuint id) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        if (it == m_allocations.end()) {
+            return;
+        }
+
+        SetBytes(it->second, 0);
+        m_usage[static_cast<size_t>(category)].allocations--;
+        m_allocations.erase(it);
+    }
+
+    void SetEvictable(const GpuMemoryCategory category, const GLuint id,
+                      Evictor evictor) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        if (it != m_allocations.end()) {
+            it->second.evictor = std::move(evictor);
+        }
+    }
+
+    bool Touch(const GpuMemoryCategory category, const GLuint id) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        if (it == m_allocations.end()) {
+            return true;
+        }
+
+        Allocation &allocation = it->second;
+        allocation.lastUsedFrame = m_frame;
+
+        if (!allocation.evicted) {
+            return true;
+        }
+
+        if (!allocation.reloading && m_frame >= allocation.retryFrame &&
+            allocation.evictor.reload) {
+            allocation.reloading = true;
+            allocation.evictor.reload();
+        }
+
+        return false;
+    }
+
+    bool Restore(const GpuMemoryCategory category, const GLuint id) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        if (it == m_allocations.end() || !it->second.evicted) {
+            return true;
+        }
+
+        Allocation &allocation = it->second;
+        allocation.lastUsedFrame = m_frame;
+
+        // restore tracks the object, which marks it resident
+        return allocation.evictor.restore && allocation.evictor.restore();
+    }
+
+    void ReloadFailed(const GpuMemoryCategory category, const GLuint id) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        if (it == m_allocations.end() || !it->second.evicted) {
+            return;
+        }
+
+        Allocation &allocation = it->second;
+        allocation.reloading = false;
+        allocation.failures = std::min(allocation.failures + 1, 31u);
+
+        const uint64_t wait =
+            std::min(uint64_t{1} << allocation.failures, m_maxRetryFrames);
+        allocation.retryFrame = m_frame + wait;
+
+        ErrorHandler::Warn(std::string("Failed to reload evicted ") + GetName(category) +
+                               " object " + std::to_string(id) + ", retrying in " +
+                               std::to_string(wait) + " frames",
+                           __FILE__, __func__, __LINE__);
+    }
+
+    bool IsEvicted(const GpuMemoryCategory category, const GLuint id) {
+        const auto it = m_allocations.find(GetKey(category, id));
+        return it != m_allocations.end() && it->second.evicted;
+    }
+
+    void Update() {
+        m_frame++;
+
+        m_stats.overBudget = false;
+        if (m_total <= m_budget) {
+            return;
+        }
+
+        std::vector<Allocation *> candidates;
+        for (auto &[key, allocation] : m_allocations) {
+            if (allocation.evictor.evict && !allocation.evicted && allocation.bytes > 0 &&
+                allocation.lastUsedFrame + m_minIdleFrames < m_frame) {
+                candidates.push_back(&allocation);
+            }
+        }
+
+        std::ranges::sort(candidates, [](const Allocation *a, const Allocation *b) {
+            return a->lastUsedFrame < b->lastUsedFrame;
+        });
+
+        for (Allocation *allocation : candidates) {
+            if (m_total <= m_budget) {
+                break;
+            }
+
+            m_stats.evictedBytes += allocation->bytes;
+            m_stats.evictions++;
+
+            allocation->evictor.evict();
+            SetBytes(*allocation, 0);
+            allocation->evicted = true;
+        }
+
+        if (m_total > m_budget) {
+            // the working set alone is over budget, streamed textures shrink to fit
+            m_stats.overBudget = true;
+        }
+    }
+
+    void SetBudget(const size_t bytes) {
+        m_budget = bytes;
+    }
+
+    size_t GetBudget() {
+        return m_budget;
+    }
+
+    size_t GetTotal() {
+        return m_total;
+    }
+
+    Usage GetUsage(const GpuMemoryCategory category) {
+        return m_usage[static_cast<size_t>(category)];
+    }
+
+    Stats GetStats() {
+        Stats stats = m_stats;
+        std::copy_n(m_usage, m_categoryCount, stats.categories);
+        stats.total = m_total;
+        stats.budget = m_budget;
+
+        return stats;
+    }
+
+    const char *GetName(const GpuMemoryCategory category) {
+        switch (category) {
+            case GpuMemoryCategory::Meshes:
+                return "Meshes";
+            case GpuMemoryCategory::Instances:
+                return "Instances";
+            case GpuMemoryCategory::Textures:
+                return "Textures";
+            case GpuMemoryCategory::RenderTargets:
+                return "Render Targets";
+            case GpuMemoryCategory::Staging:
+                return "Staging";
+            default:
+                return "Unknown";
+        }
+    }
+
+    void CleanUp() {
+        m_allocations.clear();
+        std::fill_n(m_usage, m_categoryCount, Usage{});
+        m_total = 0;
+        m_frame = 0;
+        m_stats = {};
+    }
+}
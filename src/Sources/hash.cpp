@@ -0,0 +1,134 @@
+#include "hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Hash {
+    static constexpr uint64_t m_prime1 = 11400714785074694791ull;
+    static constexpr uint64_t m_prime2 = 14029467366897019727ull;
+    static constexpr uint64_t m_prime3 = 1609587929392839161ull;
+    static constexpr uint64_t m_prime4 = 9650029242287828579ull;
+    static constexpr uint64_t m_prime5 = 2870177450012600261ull;
+
+    static uint64_t RotateLeft(const uint64_t value, const int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // the reference implementation reads little-endian, as do all our targets
+    static uint64_t Read64(const uint8_t *bytes) {
+        uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    static uint32_t Read32(const uint8_t *bytes) {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    static uint64_t Round(uint64_t lane, const uint64_t input) {
+        lane += input * m_prime2;
+        lane = RotateLeft(lane, 31);
+        return lane * m_prime1;
+    }
+
+    static uint64_t MergeRound(const uint64_t hash, const uint64_t lane) {
+        return (hash ^ Round(0, lane)) * m_prime1 + m_prime4;
+    }
+
+    uint64_t Fnv1a(const void *data, const size_t size, uint64_t hash) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    uint64_t XxHash64(const void *data, const size_t size, const uint64_t seed) {
+        Hasher hasher(seed);
+        hasher.Update(data, size);
+        return hasher.Digest();
+    }
+
+    Hasher::Hasher(const uint64_t seed)
+        : m_seed(seed),
+          m_lanes{seed + m_prime1 + m_prime2, seed + m_prime2, seed, seed - m_prime1},
+          m_buffer{} {}
+
+    void Hasher::Update(const void *data, const size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        const uint8_t *end = bytes + size;
+        m_length += size;
+
+        // top up a partial stripe first
+        if (m_buffered > 0) {
+            const size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, bytes, take);
+            m_buffered += take;
+            bytes += take;
+
+            if (m_buffered < sizeof(m_buffer)) {
+                return;
+            }
+
+            for (int i = 0; i < 4; i++) {
+                m_lanes[i] = Round(m_lanes[i], Read64(m_buffer + i * 8));
+            }
+            m_buffered = 0;
+        }
+
+        while (end - bytes >= 32) {
+            for (int i = 0; i < 4; i++) {
+                m_lanes[i] = Round(m_lanes[i], Read64(bytes + i * 8));
+            }
+            bytes += 32;
+        }
+
+        m_buffered = static_cast<size_t>(end - bytes);
+        std::memcpy(m_buffer, bytes, m_buffered);
+    }
+
+    uint64_t Hasher::Digest() const {
+        uint64_t hash;
+        if (m_length >= 32) {
+            hash = RotateLeft(m_lanes[0], 1) + RotateLeft(m_lanes[1], 7) +
+                   RotateLeft(m_lanes[2], 12) + RotateLeft(m_lanes[3], 18);
+            for (const uint64_t lane : m_lanes) {
+                hash = MergeRound(hash, lane);
+            }
+        } else {
+            hash = m_seed + m_prime5;
+        }
+
+        hash += m_length;
+
+        const uint8_t *bytes = m_buffer;
+        const uint8_t *end = m_buffer + m_buffered;
+        for (; end - bytes >= 8; bytes += 8) {
+            hash ^= Round(0, Read64(bytes));
+            hash = RotateLeft(hash, 27) * m_prime1 + m_prime4;
+        }
+
+        if (end - bytes >= 4) {
+            hash ^= Read32(bytes) * m_prime1;
+            hash = RotateLeft(hash, 23) * m_prime2 + m_prime3;
+            bytes += 4;
+        }
+
+        for (; bytes < end; bytes++) {
+            hash ^= *bytes * m_prime5;
+            hash = RotateLeft(hash, 11) * m_prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= m_prime2;
+        hash ^= hash >> 29;
+        hash *= m_prime3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+}
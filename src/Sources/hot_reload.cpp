@@ -0,0 +1,61 @@
+#include "hot_reload.h"
+
+#include "file_watcher.h"
+#include "resource_manager.h"
+#include "serialisation.h"
+#include "virtual_file_system.h"
+
+namespace HotReload {
+    static constexpr const char *m_watchedMounts[] = {"Models", "Textures", "Scenes"};
+
+    void Init() {
+        FileWatcher::Init();
+
+        for (const char *prefix : m_watchedMounts) {
+            const std::filesystem::path directory =
+                VirtualFileSystem::GetMountPath(prefix);
+            if (!directory.empty()) {
+                FileWatcher::Watch(directory);
+            }
+        }
+    }
+
+    static void Reload(const std::string &virtualPath) {
+        const size_t separator = virtualPath.find('/');
+        const std::string prefix = virtualPath.substr(0, separator);
+        const std::string file = virtualPath.substr(separator + 1);
+
+        size_t reloaded = 0;
+        if (prefix == "Models") {
+            reloaded = ResourceManager::ReloadMesh(virtualPath);
+        } else if (prefix == "Textures") {
+            reloaded = ResourceManager::ReloadTexture(virtualPath);
+        } else if (prefix == "Scenes") {
+            Serialisation::ApplyChanges(file);
+            return;
+        }
+
+        if (reloaded > 0) {
+            ErrorHandler::Info("Reloading " + virtualPath + " for " +
+                                   std::to_string(reloaded) + " resources",
+                               __FILE__, __func__, __LINE__);
+        }
+    }
+
+    void Update() {
+        for (const auto &path : FileWatcher::Poll()) {
+            const std::string virtualPath = VirtualFileSystem::GetVirtualPath(path);
+            if (virtualPath.empty()) {
+                continue;
+            }
+
+            // a new file has to be indexed, an edited one now shadows any packed copy
+            VirtualFileSystem::Refresh(virtualPath);
+            Reload(virtualPath);
+        }
+    }
+
+    void CleanUp() {
+        FileWatcher::CleanUp();
+    }
+}
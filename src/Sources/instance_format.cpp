@@ -0,0 +1,200 @@
+#include "instance_format.h"
+
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace InstanceFormat {
+    static uint32_t PackColor(const glm::vec4 &color) {
+        return glm::packUnorm4x8(glm::clamp(color, 0.0f, 1.0f));
+    }
+
+    // axes shorter than this are treated as scaled to nothing
+    static constexpr float m_minScale = 1e-6f;
+
+    // how far the normalised axes may be from perpendicular, as a cosine
+    static constexpr float m_maxShear = 1e-3f;
+
+    static void Decompose(const glm::mat4 &model, glm::vec3 &position,
+                          glm::vec4 &rotation, glm::vec3 &scale) {
+        position = glm::vec3(model[3]);
+
+        glm::mat3 basis(1.0f);
+        for (int i = 0; i < 3; i++) {
+            const glm::vec3 axis(model[i]);
+            scale[i] = glm::length(axis);
+            if (scale[i] > m_minScale) {
+                basis[i] = axis / scale[i];
+            }
+        }
+
+        // a flattened axis keeps no direction, rebuild it from the other two so the
+        // basis stays a rotation. With two or more gone the identity stands in
+        for (int i = 0; i < 3; i++) {
+            const int j = (i + 1) % 3;
+            const int k = (i + 2) % 3;
+            if (scale[i] <= m_minScale && scale[j] > m_minScale &&
+                scale[k] > m_minScale) {
+                basis[i] = glm::normalize(glm::cross(basis[j], basis[k]));
+            }
+        }
+
+        // keep the basis a proper rotation, a mirror is folded into the scale
+        if (glm::determinant(basis) < 0.0f) {
+            scale.x = -scale.x;
+            basis[0] = -basis[0];
+        }
+
+        const glm::quat q = glm::quat_cast(basis);
+        rotation = glm::vec4(q.x, q.y, q.z, q.w);
+    }
+
+    // the scale and rotation of a TRS layout only describe a basis whose axes are
+    // perpendicular, which a non-uniform scale under a rotated parent breaks
+    static bool IsSheared(const glm::mat4 &model) {
+        // a flattened axis has no direction to be sheared against
+        glm::vec3 axes[3];
+        for (int i = 0; i < 3; i++) {
+            axes[i] = glm::vec3(model[i]);
+            const float length = glm::length(axes[i]);
+            axes[i] = length > m_minScale ? axes[i] / length : glm::vec3(0.0f);
+        }
+
+        return std::abs(glm::dot(axes[0], axes[1])) > m_maxShear ||
+               std::abs(glm::dot(axes[1], axes[2])) > m_maxShear ||
+               std::abs(glm::dot(axes[2], axes[0])) > m_maxShear;
+    }
+
+    InstanceLayout GetPackableLayout(const InstanceLayout layout,
+                                     const InstanceData *instances, const size_t count) {
+        if (layout != InstanceLayout::Trs && layout != InstanceLayout::TrsHalf) {
+            return layout;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (IsSheared(instances[i].modelMatrix)) {
+                return InstanceLayout::Affine;
+            }
+        }
+
+        return layout;
+    }
+
+    size_t GetStride(const InstanceLayout layout) {
+        switch (layout) {
+            case InstanceLayout::Affine:
+                return sizeof(InstanceDataAffine);
+            case InstanceLayout::Trs:
+                return sizeof(InstanceDataTrs);
+            case InstanceLayout::TrsHalf:
+                return sizeof(InstanceDataTrsHalf);
+            case InstanceLayout::Full:
+            default:
+                return sizeof(InstanceData);
+        }
+    }
+
+    const char *GetName(const InstanceLayout layout) {
+        switch (layout) {
+            case InstanceLayout::Affine:
+                return "Affine 3x4";
+            case InstanceLayout::Trs:
+                return "Position/Quaternion/Scale";
+            case InstanceLayout::TrsHalf:
+                return "Position/Quaternion/Scale (half)";
+            case InstanceLayout::Full:
+            default:
+                return "Full mat4";
+        }
+    }
+
+    void GetAttributes(const InstanceLayout layout, Attribute (&attributes)[5]) {
+        for (auto &attribute : attributes) {
+            attribute = Attribute{0, GL_FLOAT, GL_FALSE, 0};
+        }
+
+        switch (layout) {
+            case InstanceLayout::Full:
+                for (int i = 0; i < 4; i++) {
+                    attributes[i] = {4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i};
+                }
+                attributes[4] = {4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, color)};
+                break;
+            case InstanceLayout::Affine:
+                for (int i = 0; i < 3; i++) {
+                    attributes[i] = {4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i};
+                }
+                attributes[4] = {4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                 offsetof(InstanceDataAffine, color)};
+                break;
+            case InstanceLayout::Trs:
+                attributes[0] = {3, GL_FLOAT, GL_FALSE,
+                                 offsetof(InstanceDataTrs, position)};
+                attributes[1] = {4, GL_FLOAT, GL_FALSE,
+                                 offsetof(InstanceDataTrs, rotation)};
+                attributes[2] = {3, GL_FLOAT, GL_FALSE, offsetof(InstanceDataTrs, scale)};
+                attributes[4] = {4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                 offsetof(InstanceDataTrs, color)};
+                break;
+            case InstanceLayout::TrsHalf:
+                attributes[0] = {3, GL_FLOAT, GL_FALSE,
+                                 offsetof(InstanceDataTrsHalf, position)};
+                attributes[1] = {4, GL_HALF_FLOAT, GL_FALSE,
+                                 offsetof(InstanceDataTrsHalf, rotation)};
+                attributes[2] = {3, GL_HALF_FLOAT, GL_FALSE,
+                                 offsetof(InstanceDataTrsHalf, scale)};
+                attributes[4] = {4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                 offsetof(InstanceDataTrsHalf, color)};
+                break;
+        }
+    }
+
+    void Pack(const InstanceLayout layout, const InstanceData *src, const size_t count,
+              void *dst) {
+        switch (layout) {
+            case InstanceLayout::Full:
+                std::memcpy(dst, src, count * sizeof(InstanceData));
+                break;
+            case InstanceLayout::Affine: {
+                auto *out = static_cast<InstanceDataAffine *>(dst);
+                for (size_t i = 0; i < count; i++) {
+                    const glm::mat4 &m = src[i].modelMatrix;
+                    for (int row = 0; row < 3; row++) {
+                        out[i].rows[row] =
+                            glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+                    }
+                    out[i].color = PackColor(src[i].color);
+                }
+                break;
+            }
+            case InstanceLayout::Trs: {
+                auto *out = static_cast<InstanceDataTrs *>(dst);
+                for (size_t i = 0; i < count; i++) {
+                    Decompose(src[i].modelMatrix, out[i].position, out[i].rotation,
+                              out[i].scale);
+                    out[i].color = PackColor(src[i].color);
+                }
+                break;
+            }
+            case InstanceLayout::TrsHalf: {
+                auto *out = static_cast<InstanceDataTrsHalf *>(dst);
+                for (size_t i = 0; i < count; i++) {
+                    glm::vec4 rotation;
+                    glm::vec3 scale;
+                    Decompose(src[i].modelMatrix, out[i].position, rotation, scale);
+
+                    for (int c = 0; c < 4; c++) {
+                        out[i].rotation[c] = glm::packHalf1x16(rotation[c]);
+                    }
+                    for (int c = 0; c < 3; c++) {
+                        out[i].scale[c] = glm::packHalf1x16(scale[c]);
+                    }
+                    out[i].scale[3] = glm::packHalf1x16(1.0f);
+                    out[i].color = PackColor(src[i].color);
+                }
+                break;
+            }
+        }
+    }
+}
@@ -4,7 +4,7 @@
 #include <vector>
 
 namespace LightSystem {
-    static std::unordered_map<std::string, Light> m_lights;
+    static std::unordered_map<StringId, Light> m_lights;
     static std::vector<Light *> m_lightPtrs;
 
     void Init() {
@@ -22,10 +22,11 @@ namespace LightSystem {
         light.intensity = intensity;
         light.isActive = true;
 
-        m_lights[name] = light;
-        m_lightPtrs.push_back(&m_lights[name]);
+        Light &stored = m_lights[StringTable::Intern(name)];
+        stored = light;
+        m_lightPtrs.push_back(&stored);
 
-        return &m_lights[name];
+        return &stored;
     }
 
     Light *CreatePointLight(const std::string &name, const glm::vec3 &position,
@@ -38,13 +39,18 @@ namespace LightSystem {
         light.intensity = intensity;
         light.isActive = true;
 
-        m_lights[name] = light;
-        m_lightPtrs.push_back(&m_lights[name]);
+        Light &stored = m_lights[StringTable::Intern(name)];
+        stored = light;
+        m_lightPtrs.push_back(&stored);
 
-        return &m_lights[name];
+        return &stored;
     }
 
     Light *GetLight(const std::string &name) {
+        return GetLight(StringTable::Intern(name));
+    }
+
+    Light *GetLight(const StringId name) {
         const auto it = m_lights.find(name);
         return (it != m_lights.end()) ? &it->second : nullptr;
     }
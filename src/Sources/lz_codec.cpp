@@ -0,0 +1,156 @@
+#include "lz_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace Lz {
+    static constexpr size_t m_minMatch = 4;
+    static constexpr size_t m_maxOffset = 65535;
+    // the tail is always literals, so the matcher never reads past the end
+    static constexpr size_t m_lastLiterals = 5;
+    static constexpr uint32_t m_hashBits = 14;
+    static constexpr uint32_t m_emptySlot = std::numeric_limits<uint32_t>::max();
+
+    static uint32_t HashSequence(const uint8_t *data) {
+        uint32_t sequence;
+        std::memcpy(&sequence, data, sizeof(sequence));
+        return (sequence * 2654435761u) >> (32 - m_hashBits);
+    }
+
+    static void WriteLength(std::vector<uint8_t> &output, size_t length) {
+        while (length >= 255) {
+            output.push_back(255);
+            length -= 255;
+        }
+        output.push_back(static_cast<uint8_t>(length));
+    }
+
+    static bool ReadLength(const uint8_t *input, const size_t inputSize, size_t &position,
+                           size_t &length) {
+        uint8_t byte;
+        do {
+            if (position >= inputSize) {
+                return false;
+            }
+
+            byte = input[position++];
+            length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+    static void WriteLiterals(std::vector<uint8_t> &output, const uint8_t *literals,
+                              const size_t count, const uint8_t matchToken) {
+        output.push_back(static_cast<uint8_t>(std::min<size_t>(count, 15) << 4) |
+                         matchToken);
+        if (count >= 15) {
+            WriteLength(output, count - 15);
+        }
+        output.insert(output.end(), literals, literals + count);
+    }
+
+    std::vector<uint8_t> Compress(const uint8_t *data, const size_t size) {
+        if (size >= m_emptySlot) {
+            return {};
+        }
+
+        std::vector<uint8_t> output;
+        output.reserve(size + size / 255 + 16);
+
+        std::vector<uint32_t> table(1u << m_hashBits, m_emptySlot);
+
+        const size_t matchLimit = size > m_lastLiterals ? size - m_lastLiterals : 0;
+        size_t anchor = 0;
+        size_t position = 0;
+        while (position + m_minMatch <= matchLimit) {
+            const uint32_t hash = HashSequence(data + position);
+            const uint32_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(position);
+
+            if (candidate == m_emptySlot || position - candidate > m_maxOffset ||
+                std::memcmp(data + candidate, data + position, m_minMatch) != 0) {
+                position++;
+                continue;
+            }
+
+            size_t length = m_minMatch;
+            while (position + length < matchLimit &&
+                   data[candidate + length] == data[position + length]) {
+                length++;
+            }
+
+            const size_t extra = length - m_minMatch;
+            WriteLiterals(output, data + anchor, position - anchor,
+                          static_cast<uint8_t>(std::min<size_t>(extra, 15)));
+
+            const size_t offset = position - candidate;
+            output.push_back(static_cast<uint8_t>(offset & 0xff));
+            output.push_back(static_cast<uint8_t>(offset >> 8));
+            if (extra >= 15) {
+                WriteLength(output, extra - 15);
+            }
+
+            position += length;
+            anchor = position;
+        }
+
+        // the last sequence carries only literals
+        WriteLiterals(output, data + anchor, size - anchor, 0);
+
+        return output;
+    }
+
+    bool Decompress(const uint8_t *input, const size_t inputSize, uint8_t *output,
+                    const size_t outputSize) {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < inputSize) {
+            const uint8_t token = input[in++];
+
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !ReadLength(input, inputSize, in, literalCount)) {
+                return false;
+            }
+
+            if (literalCount > inputSize - in || literalCount > outputSize - out) {
+                return false;
+            }
+
+            std::memcpy(output + out, input + in, literalCount);
+            in += literalCount;
+            out += literalCount;
+
+            if (in == inputSize) {
+                break;
+            }
+
+            if (inputSize - in < 2) {
+                return false;
+            }
+
+            const size_t offset = input[in] | static_cast<size_t>(input[in + 1]) << 8;
+            in += 2;
+
+            size_t length = token & 15;
+            if (length == 15 && !ReadLength(input, inputSize, in, length)) {
+                return false;
+            }
+            length += m_minMatch;
+
+            if (offset == 0 || offset > out || length > outputSize - out) {
+                return false;
+            }
+
+            // byte by byte, a match may overlap the bytes it is producing
+            const uint8_t *match = output + out - offset;
+            for (size_t i = 0; i < length; i++) {
+                output[out + i] = match[i];
+            }
+            out += length;
+        }
+
+        return out == outputSize;
+    }
+}
@@ -2,7 +2,7 @@
 
 int main() {
     Api::Init();
-    Api::LoadScene("demo");
+    Api::StreamScene("demo");
     Api::Run();
 
     return 0;
@@ -0,0 +1,51 @@
+#include "mapped_file.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifndef _WIN32
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                             MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            m_data = static_cast<const uint8_t *>(mapping);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+    }
+
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return;
+    }
+
+    m_fallback.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(m_fallback.data()),
+              static_cast<std::streamsize>(m_fallback.size()));
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (m_data) {
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+#endif
+}
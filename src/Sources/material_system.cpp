@@ -1,46 +1,207 @@
 #include "material_system.h"
 
+#include <algorithm>
+
 namespace MaterialSystem {
-    static std::unordered_map<std::string, Material> m_materials;
+    // the revisions both sides had when the alias was made
+    struct Alias {
+        MaterialHandle canonical;
+        uint32_t revision;
+        uint32_t canonicalRevision;
+    };
+
+    static SlotMap<Material> m_materials;
+    static NameIndex<Material> m_names;
+    static RefCounts<Material> m_refCounts;
+    static std::unordered_map<uint32_t, Alias> m_aliases;
 
     void Init() {
-        m_materials.clear();
+        m_materials.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        m_aliases.clear();
     }
 
-    Material *CreateMaterial(const std::string &name, const std::string &shaderName) {
-        auto *shader = ShaderSystem::GetShader(shaderName);
+    MaterialHandle CreateMaterial(const std::string &name,
+                                  const std::string &shaderName) {
+        const ShaderSystem::ShaderHandle shader = ShaderSystem::Find(shaderName);
         if (!shader) {
             ErrorHandler::Warn(
                 "Failed to create material: shader '" + shaderName + "' not found",
                 __FILE__, __func__, __LINE__);
         }
 
-        const Material material{
-            .name = name,
+        ShaderSystem::AddRef(shader);
+
+        Material material{
             .shader = shader,
             .properties = {},
         };
 
-        m_materials[name] = material;
+        const MaterialHandle handle = m_materials.Insert(std::move(material));
+        m_names.Add(name, handle);
+
+        return handle;
+    }
+
+    Material *Get(const MaterialHandle handle) {
+        return m_materials.Get(handle);
+    }
+
+    MaterialHandle Find(const std::string &name) {
+        return m_names.Find(name);
+    }
+
+    std::string GetName(const MaterialHandle handle) {
+        return m_names.GetName(handle);
+    }
+
+    void Destroy(const MaterialHandle handle) {
+        if (const Material *material = m_materials.Get(handle)) {
+            ShaderSystem::RemoveRef(material->shader);
+            m_names.Remove(handle);
+            m_refCounts.Erase(handle);
+            m_materials.Remove(handle);
+        }
+    }
+
+    void AddRef(const MaterialHandle handle) {
+        if (m_materials.Contains(handle)) {
+            m_refCounts.Add(handle);
+        }
+    }
+
+    void RemoveRef(const MaterialHandle handle) {
+        m_refCounts.Remove(handle);
+    }
+
+    uint32_t GetRefCount(const MaterialHandle handle) {
+        return m_refCounts.Get(handle);
+    }
+
+    size_t GetCount() {
+        return m_materials.Size();
+    }
+
+    size_t UnloadUnused() {
+        std::vector<MaterialHandle> unused;
+        for (size_t i = 0; i < m_materials.Size(); i++) {
+            if (const MaterialHandle handle = m_materials.GetHandle(i);
+                m_refCounts.Get(handle) == 0) {
+                unused.push_back(handle);
+            }
+        }
+
+        // collected first, removal reorders the dense array
+        for (const MaterialHandle handle : unused) {
+            Destroy(handle);
+        }
+
+        return unused.size();
+    }
+
+    template <typename T>
+    static void AppendBytes(std::string &key, const std::any &value) {
+        const T typed = std::any_cast<T>(value);
+        key.append(reinterpret_cast<const char *>(&typed), sizeof(T));
+    }
+
+    // the shader and the persistent properties sorted by id, as bytes. Empty
+    // when a value doesn't hold its declared type, such a material is left alone
+    static std::string GetContentKey(const Material &material) {
+        std::vector<const std::pair<const StringId, Property> *> properties;
+        for (const auto &entry : material.properties) {
+            if (entry.second.persistent) {
+                properties.push_back(&entry);
+            }
+        }
+        std::ranges::sort(properties, {},
+                          [](const auto *entry) { return entry->first.value; });
 
-        return &m_materials[name];
+        std::string key(reinterpret_cast<const char *>(&material.shader.value),
+                        sizeof(uint32_t));
+        try {
+            for (const auto *entry : properties) {
+                const Property &prop = entry->second;
+                key.append(reinterpret_cast<const char *>(&entry->first.value),
+                           sizeof(uint32_t));
+                key.push_back(static_cast<char>(prop.type));
+
+                switch (prop.type) {
+                    case Property::Type::Float:
+                        AppendBytes<float>(key, prop.value);
+                        break;
+                    case Property::Type::Int:
+                        AppendBytes<int>(key, prop.value);
+                        break;
+                    case Property::Type::Vec2:
+                        AppendBytes<glm::vec2>(key, prop.value);
+                        break;
+                    case Property::Type::Vec3:
+                        AppendBytes<glm::vec3>(key, prop.value);
+                        break;
+                    case Property::Type::Vec4:
+                        AppendBytes<glm::vec4>(key, prop.value);
+                        break;
+                    case Property::Type::Mat4:
+                        AppendBytes<glm::mat4>(key, prop.value);
+                        break;
+                }
+            }
+        } catch (const std::bad_any_cast &) {
+            return {};
+        }
+
+        return key;
+    }
+
+    size_t Canonicalise() {
+        m_aliases.clear();
+
+        // the first material in dense order with a key becomes its canonical one
+        std::unordered_map<std::string, MaterialHandle> canonical;
+        for (size_t i = 0; i < m_materials.Size(); i++) {
+            const MaterialHandle handle = m_materials.GetHandle(i);
+            const Material *material = m_materials.Get(handle);
+            std::string key = GetContentKey(*material);
+            if (key.empty()) {
+                continue;
+            }
+
+            const auto [it, added] = canonical.try_emplace(std::move(key), handle);
+            if (!added) {
+                m_aliases[handle.value] = {it->second, material->revision,
+                                           m_materials.Get(it->second)->revision};
+            }
+        }
+
+        return m_aliases.size();
     }
 
-    Material *GetMaterial(const std::string &name) {
-        if (const auto it = m_materials.find(name); it != m_materials.end()) {
-            return &it->second;
+    MaterialHandle GetCanonical(const MaterialHandle handle) {
+        const auto it = m_aliases.find(handle.value);
+        if (it == m_aliases.end()) {
+            return handle;
+        }
+
+        const Alias &alias = it->second;
+        const Material *material = m_materials.Get(handle);
+        const Material *canonical = m_materials.Get(alias.canonical);
+        if (!material || !canonical || material->revision != alias.revision ||
+            canonical->revision != alias.canonicalRevision) {
+            return handle;
         }
 
-        return nullptr;
+        return alias.canonical;
     }
 
-    void SetFloat(Material *material, const std::string &name, float value,
+    void SetFloat(Material *material, const StringId name, float value,
                   const bool persistent) {
         material->properties[name] = Property{Property::Type::Float, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
-    float GetFloat(const Material *material, const std::string &name,
-                   float defaultValue) {
+    float GetFloat(const Material *material, const StringId name, float defaultValue) {
         if (!material || material->properties.find(name) == material->properties.end()) {
             return defaultValue;
         }
@@ -57,12 +218,13 @@ namespace MaterialSystem {
         }
     }
 
-    void SetInt(Material *material, const std::string &name, int value,
+    void SetInt(Material *material, const StringId name, int value,
                 const bool persistent) {
         material->properties[name] = Property{Property::Type::Int, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
-    int GetInt(const Material *material, const std::string &name, int defaultValue) {
+    int GetInt(const Material *material, const StringId name, int defaultValue) {
         if (!material || material->properties.find(name) == material->properties.end()) {
             return defaultValue;
         }
@@ -79,66 +241,73 @@ namespace MaterialSystem {
         }
     }
 
-    void SetVec2(Material *material, const std::string &name, const glm::vec2 &value,
+    void SetVec2(Material *material, const StringId name, const glm::vec2 &value,
                  const bool persistent) {
         material->properties[name] = Property{Property::Type::Vec2, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
-    void SetVec3(Material *material, const std::string &name, const glm::vec3 &value,
+    void SetVec3(Material *material, const StringId name, const glm::vec3 &value,
                  const bool persistent) {
         material->properties[name] = Property{Property::Type::Vec3, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
-    void SetVec4(Material *material, const std::string &name, const glm::vec4 &value,
+    void SetVec4(Material *material, const StringId name, const glm::vec4 &value,
                  const bool persistent) {
         material->properties[name] = Property{Property::Type::Vec4, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
-    void SetMat4(Material *material, const std::string &name, const glm::mat4 &value,
+    void SetMat4(Material *material, const StringId name, const glm::mat4 &value,
                  const bool persistent) {
         material->properties[name] = Property{Property::Type::Mat4, value, persistent};
+        material->revision += persistent ? 1 : 0;
     }
 
     void Bind(const Material *material) {
-        if (!material || !material->shader) {
+        const ShaderSystem::Shader *shader =
+            material ? ShaderSystem::Get(material->shader) : nullptr;
+        if (!shader) {
             ErrorHandler::Warn("Attempting to bind invalid material", __FILE__, __func__,
                                __LINE__);
             return;
         }
 
-        ShaderSystem::Bind(material->shader);
+        ShaderSystem::Bind(shader);
 
         for (const auto &[name, prop] : material->properties) {
             try {
                 switch (prop.type) {
                     case Property::Type::Float:
-                        ShaderSystem::SetFloat(material->shader, name,
+                        ShaderSystem::SetFloat(shader, name,
                                                std::any_cast<float>(prop.value));
                         break;
                     case Property::Type::Int:
-                        ShaderSystem::SetInt(material->shader, name,
+                        ShaderSystem::SetInt(shader, name,
                                              std::any_cast<int>(prop.value));
                         break;
                     case Property::Type::Vec2:
-                        ShaderSystem::SetVec2(material->shader, name,
+                        ShaderSystem::SetVec2(shader, name,
                                               std::any_cast<glm::vec2>(prop.value));
                         break;
                     case Property::Type::Vec3:
-                        ShaderSystem::SetVec3(material->shader, name,
+                        ShaderSystem::SetVec3(shader, name,
                                               std::any_cast<glm::vec3>(prop.value));
                         break;
                     case Property::Type::Vec4:
-                        ShaderSystem::SetVec4(material->shader, name,
+                        ShaderSystem::SetVec4(shader, name,
                                               std::any_cast<glm::vec4>(prop.value));
                         break;
                     case Property::Type::Mat4:
-                        ShaderSystem::SetMat4(material->shader, name,
+                        ShaderSystem::SetMat4(shader, name,
                                               std::any_cast<glm::mat4>(prop.value));
                         break;
                 }
             } catch (const std::bad_any_cast &e) {
-                ErrorHandler::Warn("Failed to set material property: " + name, __FILE__,
-                                   __func__, __LINE__);
+                ErrorHandler::Warn(
+                    "Failed to set material property: " + StringTable::GetString(name),
+                    __FILE__, __func__, __LINE__);
             }
         }
     }
@@ -148,6 +317,9 @@ namespace MaterialSystem {
     }
 
     void CleanUp() {
-        m_materials.clear();
+        m_materials.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        m_aliases.clear();
     }
 }
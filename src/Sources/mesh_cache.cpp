@@ -0,0 +1,227 @@
+#include "mesh_cache.h"
+
+#include <cstring>
+
+#include "derived_cache.h"
+#include "virtual_file_system.h"
+
+namespace MeshCache {
+    static constexpr char m_magic[4] = {'G', 'M', 'S', 'H'};
+
+    static uint64_t AlignUp(const uint64_t value) {
+        return (value + BlobAlignment - 1) & ~(BlobAlignment - 1);
+    }
+
+    std::optional<uint64_t> ComputeKey(const std::string &sourcePath,
+                                       const uint32_t importFlags,
+                                       const MeshOptimiser::Options &options) {
+        const FileView file = VirtualFileSystem::Map(sourcePath);
+        if (!file) {
+            return std::nullopt;
+        }
+
+        Hash::Hasher hasher = DerivedCache::BeginKey(DerivedAssetKind::Mesh, Version);
+        hasher.Add(importFlags);
+        hasher.Add(options.deduplicate);
+        hasher.Add(options.optimiseVertexCache);
+        hasher.Add(options.optimiseOverdraw);
+        hasher.Add(options.optimiseVertexFetch);
+        hasher.Add(options.quantise);
+        hasher.Add(options.cacheSize);
+        hasher.Add(options.overdrawThreshold);
+        hasher.Update(file.Data(), file.Size());
+
+        return hasher.Digest();
+    }
+
+    // written as a bound check so a corrupt offset can't wrap around
+    static bool Fits(const uint64_t offset, const uint64_t size,
+                     const uint64_t fileSize) {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    // the counts must match their blobs, which must lie inside the file
+    static bool IsValid(const Header &header, const uint64_t key,
+                        const uint64_t fileSize) {
+        if (std::memcmp(header.magic, m_magic, sizeof(m_magic)) != 0 ||
+            header.version != Version || header.key != key) {
+            return false;
+        }
+
+        if (header.vertexFormat != static_cast<uint32_t>(VertexFormat::Standard) &&
+            header.vertexFormat != static_cast<uint32_t>(VertexFormat::Packed)) {
+            return false;
+        }
+
+        if (header.indexType != GL_UNSIGNED_SHORT &&
+            header.indexType != GL_UNSIGNED_INT) {
+            return false;
+        }
+
+        const uint64_t stride =
+            MeshSystem::GetVertexStride(static_cast<VertexFormat>(header.vertexFormat));
+        const uint64_t indexStride =
+            header.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        return header.vertexSize == header.vertexCount * stride &&
+               header.indexSize == header.indexCount * indexStride &&
+               Fits(header.vertexOffset, header.vertexSize, fileSize) &&
+               Fits(header.indexOffset, header.indexSize, fileSize) &&
+               Fits(header.submeshOffset,
+                    uint64_t{header.submeshCount} * sizeof(MeshSystem::Submesh),
+                    fileSize);
+    }
+
+    // reads and validates the header, nullopt when the entry is missing or stale
+    static std::optional<Header> ReadHeader(const FileView &file, const uint64_t key) {
+        if (file.Size() < sizeof(Header)) {
+            return std::nullopt;
+        }
+
+        Header header{};
+        std::memcpy(&header, file.Data(), sizeof(Header));
+
+        if (!IsValid(header, key, file.Size())) {
+            ErrorHandler::Warn("Ignoring invalid mesh cache entry: " +
+                                   DerivedCache::GetPath(DerivedAssetKind::Mesh, key)
+                                       .string(),
+                               __FILE__, __func__, __LINE__);
+            return std::nullopt;
+        }
+
+        return header;
+    }
+
+    static void ReadSubmeshes(const FileView &file, const Header &header,
+                              std::vector<MeshSystem::Submesh> &submeshes) {
+        submeshes.resize(header.submeshCount);
+        std::memcpy(submeshes.data(), file.Data() + header.submeshOffset,
+                    header.submeshCount * sizeof(MeshSystem::Submesh));
+    }
+
+    MeshSystem::MeshHandle Load(const std::string &name, const uint64_t key) {
+        const FileView file = DerivedCache::Load(DerivedAssetKind::Mesh, key);
+        if (!file) {
+            return {};
+        }
+
+        const std::optional<Header> header = ReadHeader(file, key);
+        if (!header) {
+            return {};
+        }
+
+        const glm::vec3 bounds[2] = {header->minBounds, header->maxBounds};
+
+        const MeshSystem::MeshHandle handle = MeshSystem::CreateMesh(
+            name, static_cast<VertexFormat>(header->vertexFormat),
+            file.Data() + header->vertexOffset, header->vertexCount,
+            header->indexCount ? file.Data() + header->indexOffset : nullptr,
+            header->indexCount, header->indexType, bounds);
+
+        if (MeshSystem::Mesh *mesh = MeshSystem::Get(handle)) {
+            ReadSubmeshes(file, *header, mesh->submeshes);
+        }
+
+        return handle;
+    }
+
+    bool Read(const uint64_t key, MeshSystem::MeshData &data) {
+        const FileView file = DerivedCache::Load(DerivedAssetKind::Mesh, key);
+        if (!file) {
+            return false;
+        }
+
+        const std::optional<Header> header = ReadHeader(file, key);
+        if (!header) {
+            return false;
+        }
+
+        data.format = static_cast<VertexFormat>(header->vertexFormat);
+        data.vertexCount = header->vertexCount;
+        data.vertices.assign(file.Data() + header->vertexOffset,
+                             file.Data() + header->vertexOffset + header->vertexSize);
+
+        data.indices.resize(header->indexCount);
+        if (header->indexType == GL_UNSIGNED_SHORT) {
+            const uint8_t *indices = file.Data() + header->indexOffset;
+            for (uint32_t i = 0; i < header->indexCount; i++) {
+                uint16_t index;
+                std::memcpy(&index, indices + i * sizeof(uint16_t), sizeof(uint16_t));
+                data.indices[i] = index;
+            }
+        } else {
+            std::memcpy(data.indices.data(), file.Data() + header->indexOffset,
+                        header->indexCount * sizeof(uint32_t));
+        }
+
+        ReadSubmeshes(file, *header, data.submeshes);
+
+        return true;
+    }
+
+    bool Store(const uint64_t key, const MeshSystem::MeshData &data) {
+        const VertexFormat format = data.format;
+        const void *vertexData = data.vertices.data();
+        const uint32_t vertexCount = data.vertexCount;
+        const std::vector<uint32_t> &indices = data.indices;
+        const std::vector<MeshSystem::Submesh> &submeshes = data.submeshes;
+
+        const size_t stride = MeshSystem::GetVertexStride(format);
+        const bool shortIndices =
+            vertexCount <= std::numeric_limits<uint16_t>::max() + 1u;
+
+        Header header{};
+        std::memcpy(header.magic, m_magic, sizeof(m_magic));
+        header.version = Version;
+        header.key = key;
+        header.vertexFormat = static_cast<uint32_t>(format);
+        header.vertexCount = vertexCount;
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        header.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        header.submeshCount = static_cast<uint32_t>(submeshes.size());
+
+        header.minBounds = glm::vec3(std::numeric_limits<float>::max());
+        header.maxBounds = glm::vec3(std::numeric_limits<float>::lowest());
+        const auto *bytes = static_cast<const uint8_t *>(vertexData);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            glm::vec3 position;
+            std::memcpy(&position, bytes + i * stride, sizeof(glm::vec3));
+            header.minBounds = glm::min(header.minBounds, position);
+            header.maxBounds = glm::max(header.maxBounds, position);
+        }
+
+        std::vector<uint16_t> packedIndices;
+        const void *indexData = indices.data();
+        if (shortIndices) {
+            packedIndices.assign(indices.begin(), indices.end());
+            indexData = packedIndices.data();
+        }
+
+        header.submeshOffset = sizeof(Header);
+        header.vertexOffset = AlignUp(header.submeshOffset +
+                                      submeshes.size() * sizeof(MeshSystem::Submesh));
+        header.vertexSize = vertexCount * stride;
+        header.indexOffset = AlignUp(header.vertexOffset + header.vertexSize);
+        header.indexSize =
+            indices.size() * (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t));
+
+        return DerivedCache::Store(DerivedAssetKind::Mesh, key, [&](std::ostream &file) {
+            const auto writeAt = [&file](const uint64_t offset, const void *data,
+                                         const uint64_t size) {
+                static constexpr char padding[BlobAlignment] = {};
+                const auto position = static_cast<uint64_t>(file.tellp());
+                file.write(padding, static_cast<std::streamsize>(offset - position));
+                file.write(static_cast<const char *>(data),
+                           static_cast<std::streamsize>(size));
+            };
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+            writeAt(header.submeshOffset, submeshes.data(),
+                    submeshes.size() * sizeof(MeshSystem::Submesh));
+            writeAt(header.vertexOffset, vertexData, header.vertexSize);
+            writeAt(header.indexOffset, indexData, header.indexSize);
+
+            return file.good();
+        });
+    }
+}
@@ -0,0 +1,413 @@
+#include "mesh_optimiser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/gtc/packing.hpp>
+
+#include "hash.h"
+
+namespace MeshOptimiser {
+    struct VertexHasher {
+        size_t operator()(const Vertex &vertex) const {
+            // the raw vertex bytes, Vertex is tightly packed floats
+            return Hash::Fnv1a(&vertex, sizeof(Vertex));
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const Vertex &a, const Vertex &b) const {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    CacheStats AnalyseVertexCache(const std::vector<uint32_t> &indices,
+                                  const uint32_t vertexCount, const uint32_t cacheSize) {
+        CacheStats stats{};
+        if (indices.size() < 3 || vertexCount == 0) {
+            return stats;
+        }
+
+        // a vertex is in the cache while fewer than cacheSize misses happened since
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        uint32_t misses = 0;
+
+        for (const uint32_t index : indices) {
+            if (time - timestamps[index] > cacheSize) {
+                timestamps[index] = time++;
+                misses++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+
+        return stats;
+    }
+
+    void DeduplicateVertices(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices) {
+        std::unordered_map<Vertex, uint32_t, VertexHasher, VertexEqual> unique;
+        unique.reserve(vertices.size());
+
+        std::vector<Vertex> result;
+        result.reserve(vertices.size());
+
+        std::vector<uint32_t> remap(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const auto [it, inserted] =
+                unique.try_emplace(vertices[i], static_cast<uint32_t>(result.size()));
+            if (inserted) {
+                result.push_back(vertices[i]);
+            }
+
+            remap[i] = it->second;
+        }
+
+        if (indices.empty()) {
+            indices.resize(vertices.size());
+            std::iota(indices.begin(), indices.end(), 0u);
+        }
+
+        for (auto &index : indices) {
+            index = remap[index];
+        }
+
+        vertices = std::move(result);
+    }
+
+    static int32_t SkipDeadEnd(const std::vector<uint32_t> &liveTriangles,
+                               std::vector<uint32_t> &deadEnds, uint32_t &cursor,
+                               const uint32_t vertexCount) {
+        while (!deadEnds.empty()) {
+            const uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+
+            if (liveTriangles[vertex] > 0) {
+                return static_cast<int32_t>(vertex);
+            }
+        }
+
+        while (cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                return static_cast<int32_t>(cursor);
+            }
+
+            cursor++;
+        }
+
+        return -1;
+    }
+
+    void OptimiseVertexCache(std::vector<uint32_t> &indices, const uint32_t vertexCount,
+                             const uint32_t cacheSize) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || vertexCount == 0) {
+            return;
+        }
+
+        // vertex -> triangle adjacency in compressed rows
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (const uint32_t index : indices) {
+            liveTriangles[index]++;
+        }
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] = offsets[v] + liveTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        uint32_t time = cacheSize + 1;
+        uint32_t cursor = 0;
+        int32_t fanning = 0;
+
+        while (fanning >= 0) {
+            candidates.clear();
+
+            for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+                const uint32_t triangle = adjacency[a];
+                if (emitted[triangle]) {
+                    continue;
+                }
+
+                for (int c = 0; c < 3; c++) {
+                    const uint32_t vertex = indices[triangle * 3 + c];
+                    result.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+
+                    if (time - timestamps[vertex] > cacheSize) {
+                        timestamps[vertex] = time++;
+                    }
+                }
+
+                emitted[triangle] = true;
+            }
+
+            // pick the candidate that will still be in cache after its fan is emitted
+            int32_t next = -1;
+            int32_t bestPriority = -1;
+            for (const uint32_t vertex : candidates) {
+                if (liveTriangles[vertex] == 0) {
+                    continue;
+                }
+
+                int32_t priority = 0;
+                if (time - timestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                    priority = static_cast<int32_t>(time - timestamps[vertex]);
+                }
+
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = static_cast<int32_t>(vertex);
+                }
+            }
+
+            if (next == -1) {
+                next = SkipDeadEnd(liveTriangles, deadEnds, cursor, vertexCount);
+            }
+
+            fanning = next;
+        }
+
+        indices = std::move(result);
+    }
+
+    void OptimiseOverdraw(std::vector<uint32_t> &indices,
+                          const std::vector<Vertex> &vertices, const uint32_t cacheSize,
+                          const float threshold) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        const auto vertexCount = static_cast<uint32_t>(vertices.size());
+        const float baseAcmr = AnalyseVertexCache(indices, vertexCount, cacheSize).acmr;
+
+        // clusters start where a triangle misses the cache on all three vertices,
+        // reordering at those points cannot break the cache locality within a fan
+        std::vector<size_t> clusterStarts;
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+
+        for (size_t t = 0; t < triangleCount; t++) {
+            int misses = 0;
+            for (int c = 0; c < 3; c++) {
+                const uint32_t vertex = indices[t * 3 + c];
+                if (time - timestamps[vertex] > cacheSize) {
+                    timestamps[vertex] = time++;
+                    misses++;
+                }
+            }
+
+            if (t == 0 || misses == 3) {
+                clusterStarts.push_back(t);
+            }
+        }
+
+        if (clusterStarts.size() < 2) {
+            return;
+        }
+
+        glm::vec3 meshCentroid(0.0f);
+        for (const auto &vertex : vertices) {
+            meshCentroid += vertex.position;
+        }
+        meshCentroid /= static_cast<float>(vertices.size());
+
+        struct Cluster {
+            size_t start;
+            size_t end;
+            float sortKey;
+        };
+
+        std::vector<Cluster> clusters;
+        clusters.reserve(clusterStarts.size());
+
+        for (size_t c = 0; c < clusterStarts.size(); c++) {
+            const size_t start = clusterStarts[c];
+            const size_t end =
+                (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+
+            glm::vec3 centroid(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+
+            for (size_t t = start; t < end; t++) {
+                const glm::vec3 &p0 = vertices[indices[t * 3 + 0]].position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+
+                const glm::vec3 weighted = glm::cross(p1 - p0, p2 - p0);
+                const float triangleArea = glm::length(weighted);
+
+                centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                normal += weighted;
+                area += triangleArea;
+            }
+
+            if (area > 0.0f) {
+                centroid /= area;
+            }
+
+            const float normalLength = glm::length(normal);
+            if (normalLength > 0.0f) {
+                normal /= normalLength;
+            }
+
+            // clusters facing away from the centre occlude the rest, draw them first
+            clusters.push_back({start, end, glm::dot(centroid - meshCentroid, normal)});
+        }
+
+        std::stable_sort(clusters.begin(), clusters.end(),
+                         [](const Cluster &a, const Cluster &b) {
+                             return a.sortKey > b.sortKey;
+                         });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (const auto &cluster : clusters) {
+            result.insert(result.end(), indices.begin() + cluster.start * 3,
+                          indices.begin() + cluster.end * 3);
+        }
+
+        if (AnalyseVertexCache(result, vertexCount, cacheSize).acmr <=
+            baseAcmr * threshold) {
+            indices = std::move(result);
+        }
+    }
+
+    void OptimiseVertexFetch(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices) {
+        constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(vertices.size(), unused);
+
+        std::vector<Vertex> result;
+        result.reserve(vertices.size());
+
+        for (auto &index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = static_cast<uint32_t>(result.size());
+                result.push_back(vertices[index]);
+            }
+
+            index = remap[index];
+        }
+
+        vertices = std::move(result);
+    }
+
+    std::pair<CacheStats, CacheStats> Optimise(std::vector<Vertex> &vertices,
+                                               std::vector<uint32_t> &indices,
+                                               const Options &options) {
+        if (indices.empty()) {
+            indices.resize(vertices.size());
+            std::iota(indices.begin(), indices.end(), 0u);
+        }
+
+        const CacheStats before = AnalyseVertexCache(
+            indices, static_cast<uint32_t>(vertices.size()), options.cacheSize);
+
+        if (options.deduplicate) {
+            DeduplicateVertices(vertices, indices);
+        }
+
+        if (options.optimiseVertexCache) {
+            OptimiseVertexCache(indices, static_cast<uint32_t>(vertices.size()),
+                                options.cacheSize);
+        }
+
+        if (options.optimiseOverdraw) {
+            OptimiseOverdraw(indices, vertices, options.cacheSize,
+                             options.overdrawThreshold);
+        }
+
+        if (options.optimiseVertexFetch) {
+            OptimiseVertexFetch(vertices, indices);
+        }
+
+        const CacheStats after = AnalyseVertexCache(
+            indices, static_cast<uint32_t>(vertices.size()), options.cacheSize);
+
+        return {before, after};
+    }
+
+    static int16_t PackSnorm16(const float value) {
+        return static_cast<int16_t>(
+            std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    std::vector<PackedVertex> Quantise(const std::vector<Vertex> &vertices) {
+        std::vector<PackedVertex> result(vertices.size());
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex &vertex = vertices[i];
+            PackedVertex &packed = result[i];
+
+            packed.position = vertex.position;
+
+            // octahedral mapping of the unit normal onto [-1, 1]^2
+            glm::vec3 n = vertex.normal;
+            const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            n = (l1 > 0.0f) ? n / l1 : glm::vec3(0.0f, 0.0f, 1.0f);
+
+            glm::vec2 octahedral(n.x, n.y);
+            if (n.z < 0.0f) {
+                octahedral =
+                    glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                              (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+            }
+
+            packed.normal[0] = PackSnorm16(octahedral.x);
+            packed.normal[1] = PackSnorm16(octahedral.y);
+            packed.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+            packed.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+        }
+
+        return result;
+    }
+
+    std::vector<Vertex> Dequantise(const std::vector<PackedVertex> &vertices) {
+        std::vector<Vertex> result(vertices.size());
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const PackedVertex &packed = vertices[i];
+            Vertex &vertex = result[i];
+
+            vertex.position = packed.position;
+
+            // the same unfolding as the vertex shader's DecodeOctahedral
+            const float x = std::max(packed.normal[0] / 32767.0f, -1.0f);
+            const float y = std::max(packed.normal[1] / 32767.0f, -1.0f);
+            glm::vec3 n(x, y, 1.0f - std::abs(x) - std::abs(y));
+            if (n.z < 0.0f) {
+                n.x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                n.y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            }
+
+            vertex.normal = glm::normalize(n);
+            vertex.texCoords = glm::vec2(glm::unpackHalf1x16(packed.texCoords[0]),
+                                         glm::unpackHalf1x16(packed.texCoords[1]));
+        }
+
+        return result;
+    }
+}
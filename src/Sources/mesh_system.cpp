@@ -1,42 +1,54 @@
 #include "mesh_system.h"
 
-#include <unordered_map>
+#include <cstring>
+#include <numeric>
+
+#include "gpu_memory.h"
+#include "hash.h"
+#include "instance_format.h"
+#include "mesh_optimiser.h"
+#include "release_queue.h"
 
 namespace MeshSystem {
-    static std::unordered_map<std::string, Mesh> m_meshes;
+    // the content hashes both sides had when the alias was made
+    struct Alias {
+        MeshHandle canonical;
+        uint64_t contentHash;
+    };
+
+    static SlotMap<Mesh> m_meshes;
+    static NameIndex<Mesh> m_names;
+    static RefCounts<Mesh> m_refCounts;
+    static std::unordered_map<uint32_t, Alias> m_aliases;
+    static std::vector<uint8_t> m_packedInstances;
+    static MeshHandle m_placeholder;
 
     void Init() {
-        m_meshes.clear();
+        m_meshes.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        m_aliases.clear();
     }
 
-    Mesh *CreateMesh(const std::string &name, const std::vector<Vertex> &vertices,
-                     const std::vector<uint32_t> &indices) {
-        Mesh mesh{};
-        mesh.name = name;
-        mesh.hasIndices = !indices.empty();
-        mesh.indexCount = indices.size();
-        mesh.vertexCount = vertices.size();
-
-        mesh.minBounds = glm::vec3(std::numeric_limits<float>::max());
-        mesh.maxBounds = glm::vec3(std::numeric_limits<float>::lowest());
-        for (const auto &vertex : vertices) {
-            mesh.minBounds = glm::min(mesh.minBounds, vertex.position);
-            mesh.maxBounds = glm::max(mesh.maxBounds, vertex.position);
-        }
+    static void SetupVertexAttributes(const VertexFormat format) {
+        if (format == VertexFormat::Packed) {
+            const auto stride = static_cast<GLsizei>(sizeof(PackedVertex));
 
-        glGenVertexArrays(1, &mesh.vao);
-        glBindVertexArray(mesh.vao);
+            // position attribute
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+                                  (void *)offsetof(PackedVertex, position));
 
-        glGenBuffers(1, &mesh.vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(),
-                     GL_STATIC_DRAW);
+            // octahedral normal attribute, decoded in the vertex shader
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                                  (void *)offsetof(PackedVertex, normal));
 
-        if (mesh.hasIndices) {
-            glGenBuffers(1, &mesh.ebo);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
-                         indices.data(), GL_STATIC_DRAW);
+            // half-float texture coordinate attribute
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                                  (void *)offsetof(PackedVertex, texCoords));
+            return;
         }
 
         // position attribute
@@ -53,72 +65,496 @@ namespace MeshSystem {
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                               (void *)offsetof(Vertex, texCoords));
+    }
+
+    static MeshHandle CreateMeshWithIndices(const std::string &name,
+                                            const VertexFormat format,
+                                            const void *vertexData,
+                                            const uint32_t vertexCount,
+                                            const std::vector<uint32_t> &indices) {
+        if (!indices.empty() &&
+            vertexCount <= std::numeric_limits<uint16_t>::max() + 1u) {
+            const std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            return CreateMesh(name, format, vertexData, vertexCount, shortIndices.data(),
+                              static_cast<uint32_t>(shortIndices.size()),
+                              GL_UNSIGNED_SHORT);
+        }
+
+        return CreateMesh(name, format, vertexData, vertexCount, indices.data(),
+                          static_cast<uint32_t>(indices.size()), GL_UNSIGNED_INT);
+    }
+
+    MeshHandle CreateMesh(const std::string &name, const std::vector<Vertex> &vertices,
+                          const std::vector<uint32_t> &indices) {
+        return CreateMeshWithIndices(name, VertexFormat::Standard, vertices.data(),
+                                     static_cast<uint32_t>(vertices.size()), indices);
+    }
+
+    MeshHandle CreateMesh(const std::string &name,
+                          const std::vector<PackedVertex> &vertices,
+                          const std::vector<uint32_t> &indices) {
+        return CreateMeshWithIndices(name, VertexFormat::Packed, vertices.data(),
+                                     static_cast<uint32_t>(vertices.size()), indices);
+    }
+
+    MeshHandle CreateMesh(const std::string &name, const VertexFormat format,
+                          const void *vertexData, const uint32_t vertexCount,
+                          const void *indexData, const uint32_t indexCount,
+                          const GLenum indexType, const glm::vec3 *bounds) {
+        const size_t stride = GetVertexStride(format);
+        const size_t indexSize =
+            (indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        Mesh mesh{};
+        mesh.hasIndices = indexData && indexCount > 0;
+        mesh.indexCount = indexCount;
+        mesh.indexType = indexType;
+        mesh.vertexCount = vertexCount;
+        mesh.vertexFormat = format;
+
+        if (bounds) {
+            mesh.minBounds = bounds[0];
+            mesh.maxBounds = bounds[1];
+        } else {
+            // position is the leading vec3 of every vertex format
+            mesh.minBounds = glm::vec3(std::numeric_limits<float>::max());
+            mesh.maxBounds = glm::vec3(std::numeric_limits<float>::lowest());
+            const auto *bytes = static_cast<const uint8_t *>(vertexData);
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                glm::vec3 position;
+                std::memcpy(&position, bytes + i * stride, sizeof(glm::vec3));
+                mesh.minBounds = glm::min(mesh.minBounds, position);
+                mesh.maxBounds = glm::max(mesh.maxBounds, position);
+            }
+        }
+
+        Hash::Hasher hasher;
+        hasher.Add(format);
+        hasher.Add(vertexCount);
+        hasher.Update(vertexData, vertexCount * stride);
+        if (mesh.hasIndices) {
+            hasher.Add(indexType);
+            hasher.Add(indexCount);
+            hasher.Update(indexData, indexCount * indexSize);
+        }
+        mesh.contentHash = hasher.Digest();
+
+        glGenVertexArrays(1, &mesh.vao);
+        glBindVertexArray(mesh.vao);
+
+        glGenBuffers(1, &mesh.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * stride, vertexData, GL_STATIC_DRAW);
+
+        if (mesh.hasIndices) {
+            glGenBuffers(1, &mesh.ebo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indexData,
+                         GL_STATIC_DRAW);
+        }
+
+        SetupVertexAttributes(format);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
 
-        m_meshes[name] = mesh;
+        // both buffers are accounted under the vertex buffer so they evict together
+        const size_t indexBytes = mesh.hasIndices ? indexCount * indexSize : 0;
+        GpuMemory::Track(GpuMemoryCategory::Meshes, mesh.vbo,
+                         vertexCount * stride + indexBytes);
+
+        const MeshHandle handle = m_meshes.Insert(std::move(mesh));
+        m_names.Add(name, handle);
+
+        return handle;
+    }
+
+    MeshHandle CreateMesh(const std::string &name, const MeshData &data) {
+        const MeshHandle handle = CreateMeshWithIndices(
+            name, data.format, data.vertices.data(), data.vertexCount, data.indices);
+        if (Mesh *mesh = m_meshes.Get(handle)) {
+            mesh->submeshes = data.submeshes;
+        }
+
+        return handle;
+    }
+
+    MeshHandle CreateView(const std::string &name, const MeshHandle source) {
+        const Mesh *sourceMesh = m_meshes.Get(source);
+        if (!sourceMesh) {
+            return {};
+        }
+
+        Mesh view = *sourceMesh;
+        view.instanceVBO = 0;
+        view.instanceBufferSize = 0;
+        view.maxInstances = 0;
+        view.instanceCount = 0;
+        view.isInstanced = false;
+        view.isView = true;
+
+        glGenVertexArrays(1, &view.vao);
+        glBindVertexArray(view.vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, view.vbo);
+        if (view.hasIndices) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, view.ebo);
+        }
+
+        SetupVertexAttributes(view.vertexFormat);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        const MeshHandle handle = m_meshes.Insert(std::move(view));
+        m_names.Add(name, handle);
+
+        return handle;
+    }
+
+    static void Release(Mesh &mesh) {
+        glDeleteVertexArrays(1, &mesh.vao);
+
+        if (mesh.instanceVBO) {
+            GpuMemory::Release(GpuMemoryCategory::Instances, mesh.instanceVBO);
+            glDeleteBuffers(1, &mesh.instanceVBO);
+        }
+
+        if (mesh.isView) {
+            return;
+        }
+
+        GpuMemory::Release(GpuMemoryCategory::Meshes, mesh.vbo);
+        glDeleteBuffers(1, &mesh.vbo);
+
+        if (mesh.hasIndices) {
+            glDeleteBuffers(1, &mesh.ebo);
+        }
+    }
+
+    bool Replace(const MeshHandle target, const MeshHandle source) {
+        Mesh *targetMesh = m_meshes.Get(target);
+        Mesh *sourceMesh = m_meshes.Get(source);
+        if (!targetMesh || !sourceMesh || target == source) {
+            return false;
+        }
+
+        Release(*targetMesh);
+        *targetMesh = std::move(*sourceMesh);
+
+        m_names.Remove(source);
+        m_refCounts.Erase(source);
+        m_meshes.Remove(source);
+
+        return true;
+    }
+
+    void Destroy(const MeshHandle handle) {
+        if (Mesh *mesh = m_meshes.Get(handle)) {
+            Release(*mesh);
+            m_names.Remove(handle);
+            m_refCounts.Erase(handle);
+            m_meshes.Remove(handle);
+        }
+    }
+
+    Mesh *Get(const MeshHandle handle) {
+        return m_meshes.Get(handle);
+    }
+
+    MeshHandle Find(const std::string &name) {
+        return m_names.Find(name);
+    }
+
+    std::string GetName(const MeshHandle handle) {
+        return m_names.GetName(handle);
+    }
+
+    void AddRef(const MeshHandle handle) {
+        if (m_meshes.Contains(handle)) {
+            m_refCounts.Add(handle);
+        }
+    }
+
+    void RemoveRef(const MeshHandle handle) {
+        m_refCounts.Remove(handle);
+    }
+
+    uint32_t GetRefCount(const MeshHandle handle) {
+        return m_refCounts.Get(handle);
+    }
 
-        return &m_meshes[name];
+    size_t GetCount() {
+        return m_meshes.Size();
     }
 
-    Mesh *GetMesh(const std::string &name) {
-        const auto it = m_meshes.find(name);
-        return (it != m_meshes.end()) ? &it->second : nullptr;
+    size_t UnloadUnused() {
+        size_t queued = 0;
+        for (size_t i = 0; i < m_meshes.Size(); i++) {
+            const MeshHandle handle = m_meshes.GetHandle(i);
+            if (m_refCounts.Get(handle) > 0) {
+                continue;
+            }
+
+            ReleaseQueue::Enqueue([handle] {
+                if (m_refCounts.Get(handle) == 0) {
+                    Destroy(handle);
+                }
+            });
+            queued++;
+        }
+
+        return queued;
     }
 
-    void SetupInstancedMesh(Mesh *mesh, uint32_t maxInstances) {
+    size_t Canonicalise() {
+        m_aliases.clear();
+
+        // the first mesh in dense order with some content becomes its canonical one
+        std::unordered_map<uint64_t, MeshHandle> canonical;
+        for (size_t i = 0; i < m_meshes.Size(); i++) {
+            const MeshHandle handle = m_meshes.GetHandle(i);
+            const uint64_t hash = m_meshes.Get(handle)->contentHash;
+            if (hash == 0) {
+                continue;
+            }
+
+            const auto [it, added] = canonical.try_emplace(hash, handle);
+            if (!added) {
+                m_aliases[handle.value] = {it->second, hash};
+            }
+        }
+
+        return m_aliases.size();
+    }
+
+    MeshHandle GetCanonical(const MeshHandle handle) {
+        const auto it = m_aliases.find(handle.value);
+        if (it == m_aliases.end()) {
+            return handle;
+        }
+
+        const Alias &alias = it->second;
+        const Mesh *mesh = m_meshes.Get(handle);
+        const Mesh *canonical = m_meshes.Get(alias.canonical);
+        if (!mesh || !canonical || mesh->contentHash != alias.contentHash ||
+            canonical->contentHash != alias.contentHash) {
+            return handle;
+        }
+
+        return alias.canonical;
+    }
+
+    void EvictBuffers(const Mesh *mesh) {
         if (!mesh) {
             return;
         }
 
+        // respecifying with no data frees the storage, the VAO keeps pointing at it
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+        if (mesh->hasIndices) {
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->ebo);
+            glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        GpuMemory::Track(GpuMemoryCategory::Meshes, mesh->vbo, 0);
+    }
+
+    bool RestoreBuffers(const Mesh *mesh, const MeshData &data) {
+        if (!mesh || data.format != mesh->vertexFormat ||
+            data.vertexCount != mesh->vertexCount ||
+            data.indices.size() != (mesh->hasIndices ? mesh->indexCount : 0)) {
+            return false;
+        }
+
+        // the element buffer is filled through GL_ARRAY_BUFFER so no VAO is touched
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.vertices.size()),
+                     data.vertices.data(), GL_STATIC_DRAW);
+
+        size_t indexBytes = 0;
+        if (mesh->hasIndices) {
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->ebo);
+            if (mesh->indexType == GL_UNSIGNED_SHORT) {
+                const std::vector<uint16_t> shortIndices(data.indices.begin(),
+                                                         data.indices.end());
+                indexBytes = shortIndices.size() * sizeof(uint16_t);
+                glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexBytes),
+                             shortIndices.data(), GL_STATIC_DRAW);
+            } else {
+                indexBytes = data.indices.size() * sizeof(uint32_t);
+                glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(indexBytes),
+                             data.indices.data(), GL_STATIC_DRAW);
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        return true;
+    }
+
+    size_t GetBufferBytes(const Mesh *mesh) {
+        if (!mesh) {
+            return 0;
+        }
+
+        const size_t indexSize =
+            mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        const size_t indexBytes = mesh->hasIndices ? mesh->indexCount * indexSize : 0;
+
+        return mesh->vertexCount * GetVertexStride(mesh->vertexFormat) + indexBytes;
+    }
+
+    bool ReadBack(const Mesh *mesh, std::vector<Vertex> &vertices,
+                  std::vector<uint32_t> &indices) {
+        if (!mesh || !GpuMemory::Restore(GpuMemoryCategory::Meshes, mesh->vbo)) {
+            return false;
+        }
+
+        // both buffers are read through GL_ARRAY_BUFFER so no VAO is touched
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        if (mesh->vertexFormat == VertexFormat::Packed) {
+            std::vector<PackedVertex> packed(mesh->vertexCount);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, packed.size() * sizeof(PackedVertex),
+                               packed.data());
+            vertices = MeshOptimiser::Dequantise(packed);
+        } else {
+            vertices.resize(mesh->vertexCount);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex),
+                               vertices.data());
+        }
+
+        if (!mesh->hasIndices) {
+            indices.resize(mesh->vertexCount);
+            std::iota(indices.begin(), indices.end(), 0u);
+        } else if (mesh->indexType == GL_UNSIGNED_SHORT) {
+            std::vector<uint16_t> shortIndices(mesh->indexCount);
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->ebo);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, shortIndices.size() * sizeof(uint16_t),
+                               shortIndices.data());
+            indices.assign(shortIndices.begin(), shortIndices.end());
+        } else {
+            indices.resize(mesh->indexCount);
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->ebo);
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, indices.size() * sizeof(uint32_t),
+                               indices.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        return true;
+    }
+
+    size_t GetVertexStride(const VertexFormat format) {
+        return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    void SetupInstancedMesh(Mesh *mesh, uint32_t maxInstances,
+                            const InstanceLayout layout) {
+        if (!mesh) {
+            return;
+        }
+
+        const size_t stride = InstanceFormat::GetStride(layout);
+        const size_t size = maxInstances * stride;
+
+        // a layout change that still fits the buffer only re-points the attributes
+        if (mesh->instanceVBO && mesh->instanceBufferSize < size) {
+            GpuMemory::Release(GpuMemoryCategory::Instances, mesh->instanceVBO);
+            glDeleteBuffers(1, &mesh->instanceVBO);
+            mesh->instanceVBO = 0;
+        }
+
         mesh->maxInstances = maxInstances;
         mesh->instanceCount = 0;
+        mesh->instanceLayout = layout;
         mesh->isInstanced = true;
 
-        glGenBuffers(1, &mesh->instanceVBO);
         glBindVertexArray(mesh->vao);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->instanceVBO);
 
-        glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(InstanceData), nullptr,
-                     GL_DYNAMIC_DRAW);
+        if (mesh->instanceVBO) {
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->instanceVBO);
+        } else {
+            glGenBuffers(1, &mesh->instanceVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->instanceVBO);
+
+            glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            GpuMemory::Track(GpuMemoryCategory::Instances, mesh->instanceVBO, size);
+            mesh->instanceBufferSize = size;
+        }
+
+        InstanceFormat::Attribute attributes[5];
+        InstanceFormat::GetAttributes(layout, attributes);
+
+        for (int i = 0; i < 5; i++) {
+            const auto &attribute = attributes[i];
+            if (attribute.components == 0) {
+                glDisableVertexAttribArray(3 + i);
+                continue;
+            }
 
-        for (int i = 0; i < 4; i++) {
             glEnableVertexAttribArray(3 + i);
-            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
-                                  (void *)(sizeof(float) * i * 4));
+            glVertexAttribPointer(3 + i, attribute.components, attribute.type,
+                                  attribute.normalised, (GLsizei)stride,
+                                  (void *)attribute.offset);
             glVertexAttribDivisor(3 + i, 1);
         }
 
-        glEnableVertexAttribArray(7);
-        glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
-                              (void *)(sizeof(glm::mat4)));
-        glVertexAttribDivisor(7, 1);
-
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
 
-    void UpdateInstanceData(Mesh *mesh, const std::vector<InstanceData> &instances) {
+    size_t UpdateInstanceData(Mesh *mesh, const InstanceData *instances,
+                              const uint32_t count) {
         if (!mesh || !mesh->isInstanced) {
-            return;
+            return 0;
         }
 
-        mesh->instanceCount = std::min((uint32_t)instances.size(), mesh->maxInstances);
+        mesh->instanceCount = std::min(count, mesh->maxInstances);
         if (mesh->instanceCount == 0) {
-            return;
+            return 0;
         }
 
+        const size_t size =
+            mesh->instanceCount * InstanceFormat::GetStride(mesh->instanceLayout);
+
         glBindBuffer(GL_ARRAY_BUFFER, mesh->instanceVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, mesh->instanceCount * sizeof(InstanceData),
-                        instances.data());
+
+        if (mesh->instanceLayout == InstanceLayout::Full) {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances);
+        } else {
+            m_packedInstances.resize(size);
+            InstanceFormat::Pack(mesh->instanceLayout, instances, mesh->instanceCount,
+                                 m_packedInstances.data());
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_packedInstances.data());
+        }
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        return size;
     }
 
-    void Bind(const Mesh *mesh) {
-        if (mesh) {
-            glBindVertexArray(mesh->vao);
+    Mesh *GetResident(Mesh *mesh) {
+        if (!mesh || GpuMemory::Touch(GpuMemoryCategory::Meshes, mesh->vbo)) {
+            return mesh;
         }
+
+        return m_meshes.Get(m_placeholder);
+    }
+
+    void SetPlaceholder(const MeshHandle mesh) {
+        m_placeholder = mesh;
+    }
+
+    bool Bind(const Mesh *mesh) {
+        // evicted buffers must not be drawn, GetResident swaps in the placeholder
+        if (!mesh || !GpuMemory::Touch(GpuMemoryCategory::Meshes, mesh->vbo)) {
+            return false;
+        }
+
+        glBindVertexArray(mesh->vao);
+
+        return true;
     }
 
     void Unbind() {
@@ -131,7 +567,7 @@ namespace MeshSystem {
         }
 
         if (mesh->hasIndices) {
-            glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT,
+            glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, mesh->indexType,
                                     nullptr, mesh->instanceCount);
         } else {
             glDrawArraysInstanced(GL_TRIANGLES, 0, mesh->vertexCount,
@@ -140,15 +576,15 @@ namespace MeshSystem {
     }
 
     void CleanUp() {
-        for (auto &[name, mesh] : m_meshes) {
-            glDeleteVertexArrays(1, &mesh.vao);
-            glDeleteBuffers(1, &mesh.vbo);
-
-            if (mesh.hasIndices) {
-                glDeleteBuffers(1, &mesh.ebo);
-            }
+        for (Mesh &mesh : m_meshes) {
+            Release(mesh);
         }
 
-        m_meshes.clear();
+        m_meshes.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        m_aliases.clear();
+        m_packedInstances.clear();
+        m_placeholder = {};
     }
 }
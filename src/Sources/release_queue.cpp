@@ -0,0 +1,50 @@
+#include "release_queue.h"
+
+#include <deque>
+
+namespace ReleaseQueue {
+    struct PendingRelease {
+        uint64_t frame;
+        std::function<void()> release;
+    };
+
+    static std::deque<PendingRelease> m_pending;
+    static uint64_t m_frame = 0;
+
+    void Init() {
+        m_pending.clear();
+        m_frame = 0;
+    }
+
+    void Enqueue(std::function<void()> release) {
+        m_pending.push_back({m_frame + FrameDelay, std::move(release)});
+    }
+
+    void Update() {
+        m_frame++;
+
+        // entries are queued in frame order, so the due ones are at the front
+        while (!m_pending.empty() && m_pending.front().frame <= m_frame) {
+            const std::function<void()> release = std::move(m_pending.front().release);
+            m_pending.pop_front();
+            release();
+        }
+    }
+
+    void Flush() {
+        while (!m_pending.empty()) {
+            const std::function<void()> release = std::move(m_pending.front().release);
+            m_pending.pop_front();
+            release();
+        }
+    }
+
+    size_t GetPending() {
+        return m_pending.size();
+    }
+
+    void CleanUp() {
+        Flush();
+        m_frame = 0;
+    }
+}
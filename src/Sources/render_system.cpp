@@ -2,6 +2,7 @@
 
 #include "backend.h"
 #include "renderer.h"
+#include "texture_streaming.h"
 
 namespace RenderSystem {
     void Init() {
@@ -49,6 +50,7 @@ namespace RenderSystem {
             const glm::mat4 &projMatrix = CameraSystem::GetProjectionMatrix(mainCamera);
             const glm::vec3 &cameraPosition = CameraSystem::GetPosition(mainCamera);
 
+            TextureStreaming::SetViewer(cameraPosition, mainCamera->fov, currentHeight);
             Renderer::Render(viewMatrix, projMatrix, cameraPosition);
         }
     }
@@ -1,24 +1,85 @@
 #include "renderer.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <tuple>
 #include <vector>
 
+#include "instance_format.h"
 #include "light_system.h"
 
 namespace Renderer {
+    // a baked mesh drawn as one identity instance
+    struct StaticDraw {
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
+        glm::vec4 color;
+        Aabb bounds;
+    };
+
+    // batches keep the handles they were submitted with, the canonical ones are
+    // only looked up when drawing so aliases that lapse split them again
+    struct CanonicalBatch {
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        BatchGroup *batch;
+
+        std::tuple<uint32_t, uint32_t, uint32_t> Key() const {
+            return {mesh.value, material.value, batch->texture.value};
+        }
+    };
+
+    // the uniforms of one entry in the shader's light array
+    struct LightUniforms {
+        StringId type;
+        StringId position;
+        StringId direction;
+        StringId color;
+        StringId intensity;
+    };
+
+    static constexpr int m_maxLights = 8;
+
     static std::unordered_map<size_t, BatchGroup> m_batchGroups;
+    static std::vector<StaticDraw> m_staticDraws;
+    static std::vector<CanonicalBatch> m_canonicalBatches;
+    static std::vector<InstanceData> m_mergedInstances;
+    static std::array<LightUniforms, m_maxLights> m_lightUniforms;
     static auto m_clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    static auto m_instanceLayout = InstanceLayout::Full;
+    static Stats m_stats;
 
-    static size_t ComputeBatchHash(MeshSystem::Mesh *mesh,
-                                   MaterialSystem::Material *material,
-                                   TextureSystem::Texture *texture) {
+    using Clock = std::chrono::high_resolution_clock;
+
+    static float ElapsedMs(const Clock::time_point &start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    static size_t ComputeBatchHash(const MeshSystem::MeshHandle mesh,
+                                   const MaterialSystem::MaterialHandle material,
+                                   const TextureSystem::TextureHandle texture) {
         size_t hash = 0;
-        hash = std::hash<void *>{}(mesh);
-        hash ^= std::hash<void *>{}(material) << 1;
-        hash ^= std::hash<void *>{}(texture) << 2;
+        hash = std::hash<uint32_t>{}(mesh.value);
+        hash ^= std::hash<uint32_t>{}(material.value) << 1;
+        hash ^= std::hash<uint32_t>{}(texture.value) << 2;
         return hash;
     }
 
-    void Init() {}
+    // the light uniform names are built once here rather than for every draw
+    void Init() {
+        for (int i = 0; i < m_maxLights; i++) {
+            const std::string prefix = "lights[" + std::to_string(i) + "].";
+            m_lightUniforms[i] = {
+                .type = StringTable::Intern(prefix + "type"),
+                .position = StringTable::Intern(prefix + "position"),
+                .direction = StringTable::Intern(prefix + "direction"),
+                .color = StringTable::Intern(prefix + "color"),
+                .intensity = StringTable::Intern(prefix + "intensity"),
+            };
+        }
+    }
 
     void SetClearColor(const glm::vec4 &color) {
         m_clearColor = color;
@@ -28,9 +89,22 @@ namespace Renderer {
         return m_clearColor;
     }
 
-    void SubmitInstanced(MeshSystem::Mesh *mesh, MaterialSystem::Material *material,
-                         TextureSystem::Texture *texture, const glm::mat4 &modelMatrix,
-                         const glm::vec4 &color) {
+    void SetInstanceLayout(const InstanceLayout layout) {
+        m_instanceLayout = layout;
+    }
+
+    InstanceLayout GetInstanceLayout() {
+        return m_instanceLayout;
+    }
+
+    const Stats &GetStats() {
+        return m_stats;
+    }
+
+    void SubmitInstanced(const MeshSystem::MeshHandle mesh,
+                         const MaterialSystem::MaterialHandle material,
+                         const TextureSystem::TextureHandle texture,
+                         const glm::mat4 &modelMatrix, const glm::vec4 &color) {
         if (!mesh || !material || !texture) {
             ErrorHandler::Warn(
                 "Error submitting instanced command to renderer. Mesh, transform or "
@@ -43,11 +117,142 @@ namespace Renderer {
         instance.modelMatrix = modelMatrix;
         instance.color = color;
 
-        const size_t batchHash = ComputeBatchHash(mesh, material, texture);
-        m_batchGroups[batchHash].mesh = mesh;
-        m_batchGroups[batchHash].material = material;
-        m_batchGroups[batchHash].texture = texture;
-        m_batchGroups[batchHash].instances.push_back(instance);
+        BatchGroup &batch = m_batchGroups[ComputeBatchHash(mesh, material, texture)];
+        batch.mesh = mesh;
+        batch.material = material;
+        batch.texture = texture;
+        batch.instances.push_back(instance);
+    }
+
+    void ReserveInstances(const MeshSystem::MeshHandle mesh,
+                          const MaterialSystem::MaterialHandle material,
+                          const TextureSystem::TextureHandle texture,
+                          const size_t count) {
+        if (!mesh || !material || !texture) {
+            return;
+        }
+
+        BatchGroup &batch = m_batchGroups[ComputeBatchHash(mesh, material, texture)];
+        batch.mesh = mesh;
+        batch.material = material;
+        batch.texture = texture;
+        batch.instances.reserve(batch.instances.capacity() + count);
+    }
+
+    void SubmitStatic(const MeshSystem::MeshHandle mesh,
+                      const MaterialSystem::MaterialHandle material,
+                      const TextureSystem::TextureHandle texture, const glm::vec4 &color,
+                      const Aabb &bounds) {
+        if (!mesh || !material || !texture) {
+            ErrorHandler::Warn(
+                "Error submitting static command to renderer. Mesh or material not set",
+                __FILE__, __func__, __LINE__);
+            return;
+        }
+
+        m_staticDraws.push_back({mesh, material, texture, color, bounds});
+    }
+
+    // the uniforms every draw sets, then the texture, mesh and draw call
+    static void Draw(MaterialSystem::Material *material, const MeshSystem::Mesh *mesh,
+                     const TextureSystem::Texture *texture, const glm::mat4 &viewMatrix,
+                     const glm::mat4 &projectionMatrix, const glm::vec3 &cameraPosition) {
+        const auto &lights = LightSystem::GetAllLights();
+
+        MaterialSystem::Bind(material);
+        MaterialSystem::SetMat4(material, "view"_id, viewMatrix, false);
+        MaterialSystem::SetMat4(material, "projection"_id, projectionMatrix, false);
+        MaterialSystem::SetInt(material, "useInstanceColor"_id, 1, false);
+        MaterialSystem::SetInt(material, "instanceLayout"_id,
+                               static_cast<int>(mesh->instanceLayout), false);
+        MaterialSystem::SetInt(material, "packedNormals"_id,
+                               mesh->vertexFormat == VertexFormat::Packed ? 1 : 0, false);
+        MaterialSystem::SetVec3(material, "viewPos"_id, cameraPosition, false);
+
+        const int numLights = std::min(static_cast<int>(lights.size()), m_maxLights);
+        MaterialSystem::SetInt(material, "numLights"_id, numLights, false);
+
+        for (int i = 0; i < numLights; i++) {
+            const auto &light = lights[i];
+            if (!light->isActive) {
+                continue;
+            }
+
+            const LightUniforms &uniforms = m_lightUniforms[i];
+            MaterialSystem::SetInt(
+                material, uniforms.type,
+                light->type == LightSystem::LightType::Directional ? 0 : 1, false);
+            MaterialSystem::SetVec3(material, uniforms.position, light->position, false);
+            MaterialSystem::SetVec3(material, uniforms.direction, light->direction,
+                                    false);
+            MaterialSystem::SetVec3(material, uniforms.color, light->color, false);
+            MaterialSystem::SetFloat(material, uniforms.intensity, light->intensity,
+                                     false);
+        }
+
+        if (texture) {
+            TextureSystem::Bind(texture, 0);
+        }
+
+        if (MeshSystem::Bind(mesh)) {
+            MeshSystem::DrawInstanced(mesh);
+            MeshSystem::Unbind();
+        }
+
+        if (texture) {
+            TextureSystem::Unbind();
+        }
+
+        MaterialSystem::Unbind();
+    }
+
+    // a box is dropped only when it is wholly behind one plane
+    static bool IsVisible(const Frustum &frustum, const Aabb &bounds) {
+        for (const glm::vec4 &plane : frustum.planes) {
+            const glm::vec3 farthest(plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+                                     plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+                                     plane.z > 0.0f ? bounds.max.z : bounds.min.z);
+            if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void RenderStatic(const glm::mat4 &viewMatrix,
+                             const glm::mat4 &projectionMatrix,
+                             const glm::vec3 &cameraPosition) {
+        const Frustum frustum = MakeFrustum(projectionMatrix * viewMatrix);
+
+        for (const StaticDraw &draw : m_staticDraws) {
+            MeshSystem::Mesh *mesh = MeshSystem::Get(draw.mesh);
+            MaterialSystem::Material *material = MaterialSystem::Get(draw.material);
+            if (!mesh || !material) {
+                continue;
+            }
+
+            if (!IsVisible(frustum, draw.bounds)) {
+                m_stats.staticCulled++;
+                continue;
+            }
+
+            // the instance only changes with the layout, the vertices are in world
+            // space already
+            if (!mesh->isInstanced || mesh->instanceLayout != m_instanceLayout) {
+                MeshSystem::SetupInstancedMesh(mesh, 1, m_instanceLayout);
+
+                const InstanceData instance{glm::mat4(1.0f), draw.color};
+                m_stats.instanceBytes +=
+                    MeshSystem::UpdateInstanceData(mesh, &instance, 1);
+            }
+
+            Draw(material, mesh, TextureSystem::Get(draw.texture), viewMatrix,
+                 projectionMatrix, cameraPosition);
+            m_stats.staticDrawn++;
+        }
+
+        m_staticDraws.clear();
     }
 
     void Render(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
@@ -57,81 +262,95 @@ namespace Renderer {
 
         static const uint32_t maxInstances = 2048;
 
-        const auto &lights = LightSystem::GetAllLights();
+        m_stats = {};
+
+        RenderStatic(viewMatrix, projectionMatrix, cameraPosition);
 
+        m_canonicalBatches.clear();
         for (auto &[_, batch] : m_batchGroups) {
-            if (batch.instances.empty()) {
-                continue;
+            if (!batch.instances.empty()) {
+                m_canonicalBatches.push_back(
+                    {MeshSystem::GetCanonical(batch.mesh),
+                     MaterialSystem::GetCanonical(batch.material), &batch});
             }
+        }
+        std::ranges::sort(m_canonicalBatches, {}, &CanonicalBatch::Key);
 
-            size_t instancesProcessed = 0;
-            while (instancesProcessed < batch.instances.size()) {
-                const size_t currentBatchSize = std::min(
-                    (size_t)maxInstances, batch.instances.size() - instancesProcessed);
-
-                std::vector<InstanceData> currentBatchInstances(
-                    batch.instances.begin() + instancesProcessed,
-                    batch.instances.begin() + instancesProcessed + currentBatchSize);
+        for (size_t first = 0; first < m_canonicalBatches.size();) {
+            size_t last = first + 1;
+            while (last < m_canonicalBatches.size() &&
+                   m_canonicalBatches[last].Key() == m_canonicalBatches[first].Key()) {
+                last++;
+            }
 
-                if (!batch.mesh->isInstanced) {
-                    MeshSystem::SetupInstancedMesh(batch.mesh, maxInstances);
+            // a batch alone draws from its own storage, merged ones are gathered
+            const CanonicalBatch &group = m_canonicalBatches[first];
+            const std::vector<InstanceData> *instances = &group.batch->instances;
+            if (last - first > 1) {
+                m_mergedInstances.clear();
+                for (size_t i = first; i < last; i++) {
+                    const auto &merged = m_canonicalBatches[i].batch->instances;
+                    m_mergedInstances.insert(m_mergedInstances.end(), merged.begin(),
+                                             merged.end());
                 }
+                instances = &m_mergedInstances;
+                m_stats.collapsedBatches += static_cast<uint32_t>(last - first - 1);
+            }
 
-                MeshSystem::UpdateInstanceData(batch.mesh, currentBatchInstances);
-
-                MaterialSystem::Bind(batch.material);
-                MaterialSystem::SetMat4(batch.material, "view", viewMatrix, false);
-                MaterialSystem::SetMat4(batch.material, "projection", projectionMatrix,
-                                        false);
-                MaterialSystem::SetInt(batch.material, "useInstanceColor", 1, false);
-                MaterialSystem::SetVec3(batch.material, "viewPos", cameraPosition, false);
-
-                const int numLights = std::min(static_cast<int>(lights.size()), 8);
-                MaterialSystem::SetInt(batch.material, "numLights", numLights, false);
-
-                for (int i = 0; i < numLights; i++) {
-                    const auto &light = lights[i];
-                    if (!light->isActive) {
-                        continue;
-                    }
-
-                    std::string prefix = "lights[" + std::to_string(i) + "].";
-                    MaterialSystem::SetInt(
-                        batch.material, prefix + "type",
-                        light->type == LightSystem::LightType::Directional ? 0 : 1,
-                        false);
-                    MaterialSystem::SetVec3(batch.material, prefix + "position",
-                                            light->position, false);
-                    MaterialSystem::SetVec3(batch.material, prefix + "direction",
-                                            light->direction, false);
-                    MaterialSystem::SetVec3(batch.material, prefix + "color",
-                                            light->color, false);
-                    MaterialSystem::SetFloat(batch.material, prefix + "intensity",
-                                             light->intensity, false);
-                }
+            // an evicted mesh draws as the placeholder until its reload is resident
+            MeshSystem::Mesh *mesh = MeshSystem::GetResident(MeshSystem::Get(group.mesh));
+            MaterialSystem::Material *material = MaterialSystem::Get(group.material);
+            const TextureSystem::Texture *texture =
+                TextureSystem::Get(group.batch->texture);
+            first = last;
+            if (!mesh || !material) {
+                continue;
+            }
 
-                if (batch.texture) {
-                    TextureSystem::Bind(batch.texture, 0);
-                }
+            m_stats.batches++;
 
-                MeshSystem::Bind(batch.mesh);
-                MeshSystem::DrawInstanced(batch.mesh);
-                MeshSystem::Unbind();
+            // one layout for the whole batch, sheared instances anywhere in it can't
+            // be packed as TRS and take it to affine
+            const InstanceLayout layout = InstanceFormat::GetPackableLayout(
+                m_instanceLayout, instances->data(), instances->size());
+            if (!mesh->isInstanced || mesh->instanceLayout != layout) {
+                MeshSystem::SetupInstancedMesh(mesh, maxInstances, layout);
+            }
 
-                if (batch.texture) {
-                    TextureSystem::Unbind();
-                }
+            size_t instancesProcessed = 0;
+            while (instancesProcessed < instances->size()) {
+                const size_t currentBatchSize = std::min(
+                    (size_t)maxInstances, instances->size() - instancesProcessed);
+
+                const InstanceData *chunk = instances->data() + instancesProcessed;
+                const auto chunkStart = Clock::now();
+                m_stats.instanceBytes += MeshSystem::UpdateInstanceData(
+                    mesh, chunk, static_cast<uint32_t>(currentBatchSize));
+                m_stats.instanceCount += static_cast<uint32_t>(currentBatchSize);
+                m_stats.instanceUploadMs += ElapsedMs(chunkStart);
 
-                MaterialSystem::Unbind();
+                Draw(material, mesh, texture, viewMatrix, projectionMatrix,
+                     cameraPosition);
 
                 instancesProcessed += currentBatchSize;
             }
         }
 
-        m_batchGroups.clear();
+        // a group keeps its storage for the next frame unless nothing was drawn from it
+        for (auto it = m_batchGroups.begin(); it != m_batchGroups.end();) {
+            if (it->second.instances.empty()) {
+                it = m_batchGroups.erase(it);
+            } else {
+                it->second.instances.clear();
+                ++it;
+            }
+        }
     }
 
     void CleanUp() {
         m_batchGroups.clear();
+        m_staticDraws.clear();
+        m_canonicalBatches.clear();
+        m_mergedInstances.clear();
     }
 }
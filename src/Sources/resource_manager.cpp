@@ -1,224 +1,841 @@
 #include "resource_manager.h"
 
-#include <filesystem>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <unordered_map>
+
+#include "async_loader.h"
+#include "gpu_memory.h"
+#include "mesh_cache.h"
+#include "release_queue.h"
+#include "texture_streaming.h"
+#include "virtual_file_system.h"
 
 namespace ResourceManager {
-    std::unordered_map<std::string, MeshSystem::Mesh> m_meshes;
-    std::unordered_map<std::string, TextureSystem::Texture> m_textures;
-    std::unordered_map<std::string, ShaderSystem::Shader> m_shaders;
-    std::unordered_map<std::string, MaterialSystem::Material> m_materials;
+    // built in and made on first use, through their getter or by name. They back
+    // placeholders and fallbacks, so they are never unloaded
+    MeshSystem::MeshHandle m_defaultCubeMesh;
+    MeshSystem::MeshHandle m_defaultPlaneMesh;
+    TextureSystem::TextureHandle m_defaultTexture;
+    ShaderSystem::ShaderHandle m_defaultShader;
+    MaterialSystem::MaterialHandle m_defaultMaterial;
 
-    MeshSystem::Mesh *m_defaultCubeMesh = nullptr;
-    MeshSystem::Mesh *m_defaultPlaneMesh = nullptr;
-    TextureSystem::Texture *m_defaultTexture = nullptr;
-    ShaderSystem::Shader *m_defaultShader = nullptr;
-    MaterialSystem::Material *m_defaultMaterial = nullptr;
+    constexpr const char *m_cubeMeshName = "cube";
+    constexpr const char *m_planeMeshName = "plane";
+    constexpr const char *m_defaultName = "default";
+
+    MeshOptimiser::Options m_meshImportOptions;
+
+    constexpr uint32_t m_meshImportFlags =
+        aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_FlipUVs;
+
+    // meshes and textures load in the background once the placeholders exist
+    bool m_asyncLoading = false;
+
+    // set when a mesh finishes loading, its content may match one already aliased
+    static bool m_canonicaliseMeshes = false;
+
+    struct TextureSource {
+        TextureSystem::TextureHandle handle;
+        bool generateMips;
+    };
+
+    // handles loaded from each virtual path, so a changed file reaches every
+    // resource made from it. Destroyed handles are pruned when the file changes
+    static std::unordered_map<std::string, std::vector<MeshSystem::MeshHandle>>
+        m_meshSources;
+    static std::unordered_map<std::string, std::vector<TextureSource>> m_textureSources;
 
     void Init() {
+        GpuMemory::Init();
+        ReleaseQueue::Init();
         MeshSystem::Init();
         TextureSystem::Init();
         ShaderSystem::Init();
         MaterialSystem::Init();
 
-        m_defaultCubeMesh = CreateDefaultCubeMesh();
-        m_defaultPlaneMesh = CreateDefaultPlaneMesh();
-        m_defaultTexture = CreateDefaultTexture();
-        m_defaultShader = CreateDefaultShader();
-        m_defaultMaterial = CreateDefaultMaterial();
+        AsyncLoader::Init();
+        m_asyncLoading = true;
+    }
+
+    void Update() {
+        GpuMemory::Update();
+        AsyncLoader::Update();
+        TextureStreaming::Update();
+        ReleaseQueue::Update();
+
+        if (m_canonicaliseMeshes) {
+            MeshSystem::Canonicalise();
+            m_canonicaliseMeshes = false;
+        }
+    }
+
+    bool IsLoading() {
+        return !AsyncLoader::IsIdle();
+    }
+
+    size_t UnloadUnused() {
+        // materials go first so the shaders they held can be released in this pass
+        const size_t released = MaterialSystem::UnloadUnused() +
+                                ShaderSystem::UnloadUnused() +
+                                MeshSystem::UnloadUnused() +
+                                TextureSystem::UnloadUnused();
+
+        ErrorHandler::Info("Unloading " + std::to_string(released) +
+                               " unused resources",
+                           __FILE__, __func__, __LINE__);
+
+        return released;
+    }
+
+    size_t Canonicalise() {
+        const size_t materials = MaterialSystem::Canonicalise();
+        const size_t meshes = MeshSystem::Canonicalise();
+        m_canonicaliseMeshes = false;
+
+        if (materials + meshes > 0) {
+            ErrorHandler::Info("Aliased " + std::to_string(materials) +
+                                   " duplicate materials and " + std::to_string(meshes) +
+                                   " duplicate meshes",
+                               __FILE__, __func__, __LINE__);
+        }
+
+        return materials + meshes;
+    }
+
+    // Assimp stream over a VFS view, so meshes read from packs like loose files
+    class VfsStream final : public Assimp::IOStream {
+       public:
+        explicit VfsStream(FileView file) : m_file(std::move(file)) {}
+
+        size_t Read(void *buffer, const size_t size, const size_t count) override {
+            if (size == 0) {
+                return 0;
+            }
+
+            const size_t items = std::min(count, (m_file.Size() - m_position) / size);
+            std::memcpy(buffer, m_file.Data() + m_position, items * size);
+            m_position += items * size;
+
+            return items;
+        }
+
+        size_t Write(const void *, size_t, size_t) override {
+            return 0;
+        }
+
+        aiReturn Seek(const size_t offset, const aiOrigin origin) override {
+            size_t base = 0;
+            if (origin == aiOrigin_CUR) {
+                base = m_position;
+            } else if (origin == aiOrigin_END) {
+                if (offset > m_file.Size()) {
+                    return aiReturn_FAILURE;
+                }
+
+                m_position = m_file.Size() - offset;
+                return aiReturn_SUCCESS;
+            }
+
+            if (base + offset > m_file.Size()) {
+                return aiReturn_FAILURE;
+            }
+
+            m_position = base + offset;
+            return aiReturn_SUCCESS;
+        }
+
+        size_t Tell() const override {
+            return m_position;
+        }
+
+        size_t FileSize() const override {
+            return m_file.Size();
+        }
+
+        void Flush() override {}
+
+       private:
+        FileView m_file;
+        size_t m_position = 0;
+    };
+
+    // resolves the OBJ's MTL and any other file Assimp asks for through the VFS,
+    // next to the model's own virtual path
+    class VfsIOSystem final : public Assimp::IOSystem {
+       public:
+        bool Exists(const char *path) const override {
+            return VirtualFileSystem::Exists(path);
+        }
+
+        char getOsSeparator() const override {
+            return '/';
+        }
+
+        Assimp::IOStream *Open(const char *path, const char *mode) override {
+            if (std::strchr(mode, 'w') || std::strchr(mode, 'a')) {
+                return nullptr;
+            }
+
+            FileView file = VirtualFileSystem::Map(path);
+            return file ? new VfsStream(std::move(file)) : nullptr;
+        }
+
+        void Close(Assimp::IOStream *stream) override {
+            delete stream;
+        }
+    };
+
+    static std::string GetMeshPath(const std::string &filePath) {
+        return VirtualFileSystem::FindAsset("Models", filePath);
     }
 
-    MeshSystem::Mesh *LoadMesh(const std::string &name, const std::string &filePath) {
-        if (const auto it = m_meshes.find(name); it != m_meshes.end()) {
-            return &it->second;
+    static void OptimiseSubmeshes(std::vector<Vertex> &vertices,
+                                  std::vector<uint32_t> &indices,
+                                  std::vector<MeshSystem::Submesh> &submeshes,
+                                  const MeshOptimiser::Options &options) {
+        std::vector<Vertex> optimisedVertices;
+        std::vector<uint32_t> optimisedIndices;
+        optimisedVertices.reserve(vertices.size());
+        optimisedIndices.reserve(indices.size());
+
+        // each submesh is optimised on its own so the submesh table stays valid
+        for (auto &submesh : submeshes) {
+            std::vector<Vertex> localVertices(
+                vertices.begin() + submesh.baseVertex,
+                vertices.begin() + submesh.baseVertex + submesh.vertexCount);
+            std::vector<uint32_t> localIndices(
+                indices.begin() + submesh.firstIndex,
+                indices.begin() + submesh.firstIndex + submesh.indexCount);
+            for (auto &index : localIndices) {
+                index -= submesh.baseVertex;
+            }
+
+            MeshOptimiser::Optimise(localVertices, localIndices, options);
+
+            submesh.baseVertex = static_cast<uint32_t>(optimisedVertices.size());
+            submesh.vertexCount = static_cast<uint32_t>(localVertices.size());
+            submesh.firstIndex = static_cast<uint32_t>(optimisedIndices.size());
+            submesh.indexCount = static_cast<uint32_t>(localIndices.size());
+
+            for (const auto index : localIndices) {
+                optimisedIndices.push_back(submesh.baseVertex + index);
+            }
+            optimisedVertices.insert(optimisedVertices.end(), localVertices.begin(),
+                                     localVertices.end());
         }
 
+        vertices = std::move(optimisedVertices);
+        indices = std::move(optimisedIndices);
+    }
+
+    // Assimp import and optimisation, stores the result in the mesh cache. Touches
+    // no GL or shared state so it can run on a loader thread
+    static bool ImportMeshData(const std::string &name, const std::string &sourcePath,
+                               const std::optional<uint64_t> &cacheKey,
+                               const MeshOptimiser::Options &options,
+                               MeshSystem::MeshData &data) {
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
-        if (!LoadMeshDataFromFile(filePath, vertices, indices)) {
-            ErrorHandler::Warn(
-                "Failed to load mesh: " + filePath + ". Using default cube.", __FILE__,
-                __func__, __LINE__);
+        std::vector<MeshSystem::Submesh> submeshes;
+        if (!LoadMeshDataFromFile(sourcePath, vertices, indices, &submeshes)) {
+            return false;
+        }
+
+        const MeshOptimiser::CacheStats before = MeshOptimiser::AnalyseVertexCache(
+            indices, static_cast<uint32_t>(vertices.size()), options.cacheSize);
+
+        OptimiseSubmeshes(vertices, indices, submeshes, options);
+
+        const MeshOptimiser::CacheStats after = MeshOptimiser::AnalyseVertexCache(
+            indices, static_cast<uint32_t>(vertices.size()), options.cacheSize);
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(3) << "Optimised mesh " << name << ": "
+               << vertices.size() << " vertices, " << indices.size() / 3
+               << " triangles, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR "
+               << before.atvr << " -> " << after.atvr;
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+
+        data.vertexCount = static_cast<uint32_t>(vertices.size());
+        if (options.quantise) {
+            const std::vector<PackedVertex> packed = MeshOptimiser::Quantise(vertices);
+            const auto *bytes = reinterpret_cast<const uint8_t *>(packed.data());
+            data.format = VertexFormat::Packed;
+            data.vertices.assign(bytes, bytes + packed.size() * sizeof(PackedVertex));
+        } else {
+            const auto *bytes = reinterpret_cast<const uint8_t *>(vertices.data());
+            data.format = VertexFormat::Standard;
+            data.vertices.assign(bytes, bytes + vertices.size() * sizeof(Vertex));
+        }
+        data.indices = std::move(indices);
+        data.submeshes = std::move(submeshes);
+
+        if (cacheKey) {
+            MeshCache::Store(*cacheKey, data);
+        }
+
+        return true;
+    }
+
+    static void ReportMeshLoad(
+        const std::string &name, const bool fromCache,
+        const std::chrono::high_resolution_clock::time_point start) {
+        const float elapsedMs = std::chrono::duration<float, std::milli>(
+                                    std::chrono::high_resolution_clock::now() - start)
+                                    .count();
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(3) << "Loaded mesh " << name
+               << (fromCache ? " from cache" : " with Assimp") << " in " << elapsedMs
+               << " ms";
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+    }
+
+    // runs on a loader thread, the cache entry is copied out instead of mapped for GL
+    static bool DecodeMesh(const std::string &name, const std::string &filePath,
+                           const MeshOptimiser::Options &options,
+                           MeshSystem::MeshData &data) {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        const std::string sourcePath = GetMeshPath(filePath);
+        const std::optional<uint64_t> cacheKey =
+            MeshCache::ComputeKey(sourcePath, m_meshImportFlags, options);
+
+        const bool fromCache = cacheKey && MeshCache::Read(*cacheKey, data);
+        if (!fromCache && !ImportMeshData(name, sourcePath, cacheKey, options, data)) {
+            return false;
+        }
 
-            return m_defaultCubeMesh;
+        ReportMeshLoad(name, fromCache, start);
+
+        return true;
+    }
+
+    static MeshSystem::MeshHandle LoadMeshNow(const std::string &name,
+                                              const std::string &filePath) {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        const std::string sourcePath = GetMeshPath(filePath);
+        const std::optional<uint64_t> cacheKey =
+            MeshCache::ComputeKey(sourcePath, m_meshImportFlags, m_meshImportOptions);
+
+        // a cache hit never touches Assimp
+        MeshSystem::MeshHandle mesh;
+        if (cacheKey) {
+            mesh = MeshCache::Load(name, *cacheKey);
         }
 
-        MeshSystem::Mesh *mesh = MeshSystem::CreateMesh(name, vertices, indices);
+        const bool fromCache = static_cast<bool>(mesh);
         if (!mesh) {
-            ErrorHandler::Warn("Failed to create mesh: " + name + ". Using default cube.",
-                               __FILE__, __func__, __LINE__);
+            MeshSystem::MeshData data;
+            if (ImportMeshData(name, sourcePath, cacheKey, m_meshImportOptions, data)) {
+                mesh = MeshSystem::CreateMesh(name, data);
+            }
+        }
+
+        if (mesh) {
+            ReportMeshLoad(name, fromCache, start);
+        }
+
+        return mesh;
+    }
+
+    // what an evicted mesh is read back from, fixed when the mesh is loaded so a
+    // later change to the import options cannot produce a mismatched layout
+    struct MeshSource {
+        std::string name;
+        std::string filePath;
+        MeshOptimiser::Options options;
+    };
+
+    static void OnMeshRefilled(const MeshSystem::Mesh &mesh, const bool success) {
+        if (success) {
+            GpuMemory::Track(GpuMemoryCategory::Meshes, mesh.vbo,
+                             MeshSystem::GetBufferBytes(&mesh));
+        } else {
+            GpuMemory::ReloadFailed(GpuMemoryCategory::Meshes, mesh.vbo);
+        }
+    }
+
+    // the mesh may have been released while its reload was queued
+    static bool FillMesh(const MeshSystem::Mesh &mesh, const MeshSystem::MeshData &data) {
+        return GpuMemory::IsEvicted(GpuMemoryCategory::Meshes, mesh.vbo) &&
+               MeshSystem::RestoreBuffers(&mesh, data);
+    }
+
+    static void QueueMeshReload(const MeshSystem::Mesh &mesh, const MeshSource &source) {
+        AsyncLoader::RefillMesh(
+            source.name,
+            [source](MeshSystem::MeshData &data) {
+                return DecodeMesh(source.name, source.filePath, source.options, data);
+            },
+            [mesh](const MeshSystem::MeshData &data) { return FillMesh(mesh, data); },
+            [mesh](const bool success) { OnMeshRefilled(mesh, success); });
+    }
+
+    static bool RestoreMesh(const MeshSystem::Mesh &mesh, const MeshSource &source) {
+        MeshSystem::MeshData data;
+        if (!DecodeMesh(source.name, source.filePath, source.options, data) ||
+            !FillMesh(mesh, data)) {
+            return false;
+        }
+
+        OnMeshRefilled(mesh, true);
+
+        return true;
+    }
 
-            return m_defaultCubeMesh;
+    // meshes from files can be dropped under memory pressure and read back
+    // through the mesh cache once drawn again. The evictor keeps its own copy of
+    // the buffer description, which does not change once the mesh is loaded
+    static void MakeMeshEvictable(const MeshSystem::MeshHandle handle,
+                                  const std::string &filePath,
+                                  const MeshOptimiser::Options &options) {
+        const MeshSystem::Mesh *mesh = MeshSystem::Get(handle);
+        if (!mesh) {
+            return;
         }
 
-        mesh->path = filePath;
+        const MeshSource source{MeshSystem::GetName(handle), filePath, options};
+        GpuMemory::SetEvictable(
+            GpuMemoryCategory::Meshes, mesh->vbo,
+            {[mesh = *mesh] { MeshSystem::EvictBuffers(&mesh); },
+             [mesh = *mesh, source] { QueueMeshReload(mesh, source); },
+             [mesh = *mesh, source] { return RestoreMesh(mesh, source); }});
+    }
 
-        m_meshes[name] = *mesh;
+    // decodes on a loader thread, the result takes over target's slot
+    static void QueueMeshLoad(const MeshSystem::MeshHandle target,
+                              const std::string &filePath) {
+        const std::string name = MeshSystem::GetName(target);
+
+        AsyncLoader::LoadMesh(
+            name,
+            [name, filePath, options = m_meshImportOptions](MeshSystem::MeshData &data) {
+                return DecodeMesh(name, filePath, options, data);
+            },
+            [target, filePath, options = m_meshImportOptions](
+                const MeshSystem::MeshHandle mesh) {
+                if (!MeshSystem::Replace(target, mesh)) {
+                    MeshSystem::Destroy(mesh);
+                    return;
+                }
+
+                MeshSystem::Get(target)->path = filePath;
+                MakeMeshEvictable(target, filePath, options);
+                m_canonicaliseMeshes = true;
+            });
+    }
 
-        return &m_meshes[name];
+    // built-in names resolve even before the resource is first made
+    static MeshSystem::MeshHandle FindMesh(const std::string &name) {
+        if (name == m_cubeMeshName) {
+            return GetDefaultCubeMesh();
+        }
+        if (name == m_planeMeshName) {
+            return GetDefaultPlaneMesh();
+        }
+
+        return MeshSystem::Find(name);
     }
 
-    MeshSystem::Mesh *GetMesh(const std::string &name) {
-        if (const auto it = m_meshes.find(name); it != m_meshes.end()) {
-            return &it->second;
+    MeshSystem::MeshHandle LoadMesh(const std::string &name,
+                                    const std::string &filePath) {
+        if (const MeshSystem::MeshHandle existing = FindMesh(name)) {
+            return existing;
+        }
+
+        if (m_asyncLoading) {
+            // draw the default cube until the real mesh is resident, it then takes
+            // over the placeholder's slot so the handle stays valid
+            const MeshSystem::MeshHandle placeholder =
+                MeshSystem::CreateView(name, GetDefaultCubeMesh());
+            if (MeshSystem::Mesh *mesh = MeshSystem::Get(placeholder)) {
+                mesh->path = filePath;
+            }
+
+            QueueMeshLoad(placeholder, filePath);
+            m_meshSources[GetMeshPath(filePath)].push_back(placeholder);
+
+            return placeholder;
+        }
+
+        const MeshSystem::MeshHandle mesh = LoadMeshNow(name, filePath);
+        if (!mesh) {
+            ErrorHandler::Warn(
+                "Failed to load mesh: " + filePath + ". Using default cube.", __FILE__,
+                __func__, __LINE__);
+
+            return GetDefaultCubeMesh();
+        }
+
+        MeshSystem::Get(mesh)->path = filePath;
+        MakeMeshEvictable(mesh, filePath, m_meshImportOptions);
+        m_meshSources[GetMeshPath(filePath)].push_back(mesh);
+
+        return mesh;
+    }
+
+    MeshSystem::MeshHandle GetMesh(const std::string &name) {
+        if (const MeshSystem::MeshHandle mesh = FindMesh(name)) {
+            return mesh;
         }
 
         ErrorHandler::Warn("Mesh not found: " + name + ". Using default cube.", __FILE__,
                            __func__, __LINE__);
 
-        return m_defaultCubeMesh;
+        return GetDefaultCubeMesh();
+    }
+
+    bool DecodeMeshData(const std::string &filePath, MeshSystem::MeshData &data,
+                        const bool forceImport) {
+        const std::string sourcePath = GetMeshPath(filePath);
+        const std::optional<uint64_t> cacheKey =
+            MeshCache::ComputeKey(sourcePath, m_meshImportFlags, m_meshImportOptions);
+
+        if (!forceImport && cacheKey && MeshCache::Read(*cacheKey, data)) {
+            return true;
+        }
+
+        return ImportMeshData(filePath, sourcePath, cacheKey, m_meshImportOptions, data);
+    }
+
+    void SetMeshImportOptions(const MeshOptimiser::Options &options) {
+        m_meshImportOptions = options;
+    }
+
+    const MeshOptimiser::Options &GetMeshImportOptions() {
+        return m_meshImportOptions;
+    }
+
+    static std::string GetTexturePath(const std::string &filePath) {
+        return VirtualFileSystem::FindAsset("Textures", filePath);
+    }
+
+    static void QueueTextureLoad(const TextureSystem::TextureHandle target,
+                                 const std::string &filePath, const bool generateMips) {
+        AsyncLoader::LoadTexture(
+            TextureSystem::GetName(target), filePath, generateMips,
+            [target](const TextureSystem::TextureHandle texture) {
+                if (!TextureSystem::Replace(target, texture)) {
+                    TextureSystem::Destroy(texture);
+                }
+            });
     }
 
-    TextureSystem::Texture *LoadTexture(const std::string &name,
-                                        const std::string &filePath, bool generateMips) {
-        if (const auto it = m_textures.find(name); it != m_textures.end()) {
-            return &it->second;
+    static TextureSystem::TextureHandle FindTexture(const std::string &name) {
+        return name == m_defaultName ? GetDefaultTexture() : TextureSystem::Find(name);
+    }
+
+    TextureSystem::TextureHandle LoadTexture(const std::string &name,
+                                             const std::string &filePath,
+                                             bool generateMips) {
+        if (const TextureSystem::TextureHandle existing = FindTexture(name)) {
+            return existing;
         }
 
-        const TextureSystem::Texture *texture =
+        if (m_asyncLoading) {
+            const TextureSystem::TextureHandle placeholder =
+                TextureSystem::CreateView(name, GetDefaultTexture());
+            if (TextureSystem::Texture *texture = TextureSystem::Get(placeholder)) {
+                texture->path = filePath;
+            }
+
+            QueueTextureLoad(placeholder, filePath, generateMips);
+            m_textureSources[GetTexturePath(filePath)].push_back(
+                {placeholder, generateMips});
+
+            return placeholder;
+        }
+
+        const TextureSystem::TextureHandle texture =
             TextureSystem::CreateTexture(name, filePath, generateMips);
         if (!texture) {
             ErrorHandler::Warn(
                 "Failed to load texture: " + filePath + ". Using default texture.",
                 __FILE__, __func__, __LINE__);
 
-            return m_defaultTexture;
+            return GetDefaultTexture();
         }
 
-        m_textures[name] = *texture;
+        m_textureSources[GetTexturePath(filePath)].push_back({texture, generateMips});
 
-        return &m_textures[name];
+        return texture;
     }
 
-    TextureSystem::Texture *GetTexture(const std::string &name) {
-        if (const auto it = m_textures.find(name); it != m_textures.end()) {
-            return &it->second;
+    TextureSystem::TextureHandle GetTexture(const std::string &name) {
+        if (const TextureSystem::TextureHandle texture = FindTexture(name)) {
+            return texture;
         }
 
         ErrorHandler::Warn("Texture not found: " + name + ". Using default texture.",
                            __FILE__, __func__, __LINE__);
 
-        return m_defaultTexture;
+        return GetDefaultTexture();
+    }
+
+    size_t ReloadMesh(const std::string &virtualPath) {
+        const auto it = m_meshSources.find(virtualPath);
+        if (it == m_meshSources.end()) {
+            return 0;
+        }
+
+        std::erase_if(it->second, [](const MeshSystem::MeshHandle mesh) {
+            return !MeshSystem::Get(mesh);
+        });
+
+        // the file's new contents hash to a new cache key, so this re-imports
+        for (const MeshSystem::MeshHandle mesh : it->second) {
+            QueueMeshLoad(mesh, MeshSystem::Get(mesh)->path);
+        }
+
+        return it->second.size();
+    }
+
+    size_t ReloadTexture(const std::string &virtualPath) {
+        const auto it = m_textureSources.find(virtualPath);
+        if (it == m_textureSources.end()) {
+            return 0;
+        }
+
+        std::erase_if(it->second, [](const TextureSource &source) {
+            return !TextureSystem::Get(source.handle);
+        });
+
+        for (const auto &[texture, generateMips] : it->second) {
+            QueueTextureLoad(texture, TextureSystem::Get(texture)->path, generateMips);
+        }
+
+        return it->second.size();
+    }
+
+    static ShaderSystem::ShaderHandle FindShader(const std::string &name) {
+        return name == m_defaultName ? GetDefaultShader() : ShaderSystem::Find(name);
     }
 
-    ShaderSystem::Shader *LoadShader(const std::string &name, const std::string &vertPath,
-                                     const std::string &fragPath) {
-        if (const auto it = m_shaders.find(name); it != m_shaders.end()) {
-            return &it->second;
+    ShaderSystem::ShaderHandle LoadShader(const std::string &name,
+                                          const std::string &vertPath,
+                                          const std::string &fragPath) {
+        if (const ShaderSystem::ShaderHandle existing = FindShader(name)) {
+            return existing;
         }
 
-        ShaderSystem::Shader *shader =
+        const ShaderSystem::ShaderHandle shader =
             ShaderSystem::CreateShader(name, vertPath, fragPath);
         if (!shader) {
             ErrorHandler::Warn(
                 "Failed to load shader: " + name + ". Using default shader.", __FILE__,
                 __func__, __LINE__);
 
-            return m_defaultShader;
+            return GetDefaultShader();
         }
 
-        m_shaders[name] = *shader;
-
         return shader;
     }
 
-    ShaderSystem::Shader *GetShader(const std::string &name) {
-        if (const auto it = m_shaders.find(name); it != m_shaders.end()) {
-            return &it->second;
+    ShaderSystem::ShaderHandle GetShader(const std::string &name) {
+        if (const ShaderSystem::ShaderHandle shader = FindShader(name)) {
+            return shader;
         }
 
         ErrorHandler::Warn("Shader not found: " + name + ". Using default shader.",
                            __FILE__, __func__, __LINE__);
 
-        return m_defaultShader;
+        return GetDefaultShader();
     }
 
-    MaterialSystem::Material *CreateMaterial(const std::string &name,
-                                             const std::string &shaderName,
-                                             bool useTexture) {
-        if (const auto it = m_materials.find(name); it != m_materials.end()) {
-            return &it->second;
-        }
+    static MaterialSystem::MaterialHandle FindMaterial(const std::string &name) {
+        return name == m_defaultName ? GetDefaultMaterial() : MaterialSystem::Find(name);
+    }
 
-        MaterialSystem::Material *material =
+    // null on failure, the default material is made through here as well
+    static MaterialSystem::MaterialHandle CreateMaterialNow(const std::string &name,
+                                                            const std::string &shaderName,
+                                                            const bool useTexture) {
+        const MaterialSystem::MaterialHandle handle =
             MaterialSystem::CreateMaterial(name, shaderName);
+        MaterialSystem::Material *material = MaterialSystem::Get(handle);
         if (!material) {
+            return {};
+        }
+
+        SetVec3(material, "color"_id, glm::vec3(1.0f));
+        SetInt(material, "mainTexture"_id, 0);
+        SetInt(material, "useTexture"_id, useTexture);
+        SetInt(material, "isEmissive"_id, 0);
+        SetVec3(material, "ambientColor"_id, glm::vec3(0.1f));
+        SetFloat(material, "ambientStrength"_id, 0.1f);
+        SetFloat(material, "diffuseStrength"_id, 0.7f);
+        SetFloat(material, "specularStrength"_id, 0.5f);
+        SetFloat(material, "shininess"_id, 32.0f);
+
+        return handle;
+    }
+
+    MaterialSystem::MaterialHandle CreateMaterial(const std::string &name,
+                                                  const std::string &shaderName,
+                                                  bool useTexture) {
+        if (const MaterialSystem::MaterialHandle existing = FindMaterial(name)) {
+            return existing;
+        }
+
+        // materials find their shader by name, which may be the unmade default
+        FindShader(shaderName);
+
+        const MaterialSystem::MaterialHandle handle =
+            CreateMaterialNow(name, shaderName, useTexture);
+        if (!handle) {
             ErrorHandler::Warn(
                 "Could not create material: " + name + ". Using default material.",
                 __FILE__, __func__, __LINE__);
 
-            return m_defaultMaterial;
+            return GetDefaultMaterial();
         }
 
-        SetVec3(material, "color", glm::vec3(1.0f));
-        SetInt(material, "mainTexture", 0);
-        SetInt(material, "useTexture", useTexture);
-        SetInt(material, "isEmissive", 0);
-        SetVec3(material, "ambientColor", glm::vec3(0.1f));
-        SetFloat(material, "ambientStrength", 0.1f);
-        SetFloat(material, "diffuseStrength", 0.7f);
-        SetFloat(material, "specularStrength", 0.5f);
-        SetFloat(material, "shininess", 32.0f);
-
-        m_materials[name] = *material;
-
-        return &m_materials[name];
+        return handle;
     }
 
-    MaterialSystem::Material *GetMaterial(const std::string &name) {
-        if (const auto it = m_materials.find(name); it != m_materials.end()) {
-            return &it->second;
+    MaterialSystem::MaterialHandle GetMaterial(const std::string &name) {
+        if (const MaterialSystem::MaterialHandle material = FindMaterial(name)) {
+            return material;
         }
 
         ErrorHandler::Warn("Material not found: " + name + ".  Using default material.",
                            __FILE__, __func__, __LINE__);
 
-        return m_defaultMaterial;
+        return GetDefaultMaterial();
     }
 
-    MeshSystem::Mesh *GetDefaultCubeMesh() {
+    MeshSystem::MeshHandle GetDefaultCubeMesh() {
+        if (!m_defaultCubeMesh) {
+            m_defaultCubeMesh = CreateDefaultCubeMesh();
+            MeshSystem::AddRef(m_defaultCubeMesh);
+            MeshSystem::SetPlaceholder(m_defaultCubeMesh);
+        }
+
         return m_defaultCubeMesh;
     }
 
-    MeshSystem::Mesh *GetDefaultPlaneMesh() {
+    MeshSystem::MeshHandle GetDefaultPlaneMesh() {
+        if (!m_defaultPlaneMesh) {
+            m_defaultPlaneMesh = CreateDefaultPlaneMesh();
+            MeshSystem::AddRef(m_defaultPlaneMesh);
+        }
+
         return m_defaultPlaneMesh;
     }
 
-    TextureSystem::Texture *GetDefaultTexture() {
+    TextureSystem::TextureHandle GetDefaultTexture() {
+        if (!m_defaultTexture) {
+            m_defaultTexture = CreateDefaultTexture();
+            TextureSystem::AddRef(m_defaultTexture);
+            TextureSystem::SetPlaceholder(m_defaultTexture);
+        }
+
         return m_defaultTexture;
     }
 
-    ShaderSystem::Shader *GetDefaultShader() {
+    ShaderSystem::ShaderHandle GetDefaultShader() {
+        if (!m_defaultShader) {
+            m_defaultShader = CreateDefaultShader();
+            ShaderSystem::AddRef(m_defaultShader);
+        }
+
         return m_defaultShader;
     }
 
-    MaterialSystem::Material *GetDefaultMaterial() {
+    MaterialSystem::MaterialHandle GetDefaultMaterial() {
+        if (!m_defaultMaterial) {
+            m_defaultMaterial = CreateDefaultMaterial();
+            MaterialSystem::AddRef(m_defaultMaterial);
+        }
+
         return m_defaultMaterial;
     }
 
-    MeshSystem::Mesh *CreateDefaultCubeMesh() {
-        return LoadMesh("cube", "../Assets/Models/cube.obj");
+    // one face of a built-in shape, corners in the order and winding the matching
+    // .obj in Assets/Models lists them
+    static void AddQuad(const std::array<glm::vec3, 4> &corners, const glm::vec3 &normal,
+                        std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+        // flipped the way aiProcess_FlipUVs flips the imported files
+        static const glm::vec2 texCoords[4] = {
+            {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, {0.0f, 0.0f}};
+
+        const auto base = static_cast<uint32_t>(vertices.size());
+        for (size_t i = 0; i < corners.size(); i++) {
+            vertices.push_back({corners[i], normal, texCoords[i]});
+        }
+
+        indices.insert(indices.end(),
+                       {base, base + 1, base + 2, base, base + 2, base + 3});
     }
 
-    MeshSystem::Mesh *CreateDefaultPlaneMesh() {
-        return LoadMesh("plane", "../Assets/Models/plane.obj");
+    // the same geometry cube.obj imports to, without waking Assimp or the disk
+    MeshSystem::MeshHandle CreateDefaultCubeMesh() {
+        const glm::vec3 p[8] = {
+            {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f},
+            {-0.5f, 0.5f, 0.5f}, {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f},
+            {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        };
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        AddQuad({p[0], p[1], p[2], p[3]}, {0.0f, 0.0f, 1.0f}, vertices, indices);
+        AddQuad({p[4], p[5], p[6], p[7]}, {0.0f, 0.0f, -1.0f}, vertices, indices);
+        AddQuad({p[3], p[2], p[6], p[7]}, {0.0f, 1.0f, 0.0f}, vertices, indices);
+        AddQuad({p[0], p[1], p[5], p[4]}, {0.0f, -1.0f, 0.0f}, vertices, indices);
+        AddQuad({p[4], p[0], p[3], p[7]}, {-1.0f, 0.0f, 0.0f}, vertices, indices);
+        AddQuad({p[5], p[1], p[2], p[6]}, {1.0f, 0.0f, 0.0f}, vertices, indices);
+
+        return MeshSystem::CreateMesh(m_cubeMeshName, vertices, indices);
     }
 
-    TextureSystem::Texture *CreateDefaultTexture() {
-        return LoadTexture("default", "../Assets/Textures/default.png");
+    MeshSystem::MeshHandle CreateDefaultPlaneMesh() {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        AddQuad({glm::vec3(-0.5f, 0.0f, 0.5f), glm::vec3(0.5f, 0.0f, 0.5f),
+                 glm::vec3(0.5f, 0.0f, -0.5f), glm::vec3(-0.5f, 0.0f, -0.5f)},
+                {0.0f, 1.0f, 0.0f}, vertices, indices);
+
+        return MeshSystem::CreateMesh(m_planeMeshName, vertices, indices);
     }
 
-    ShaderSystem::Shader *CreateDefaultShader() {
-        return LoadShader("default", "../src/Shaders/default.vert",
-                          "../src/Shaders/default.frag");
+    // plain white, so an untextured material shows its colour unchanged
+    TextureSystem::TextureHandle CreateDefaultTexture() {
+        unsigned char white[4] = {255, 255, 255, 255};
+
+        TextureSystem::Image image{};
+        image.width = 1;
+        image.height = 1;
+        image.channels = 4;
+        image.pixels = white;
+
+        return TextureSystem::CreateTexture(m_defaultName, "", image, false);
     }
 
-    MaterialSystem::Material *CreateDefaultMaterial() {
-        return CreateMaterial("default", "default", 0);
+    // compiled directly, LoadShader falls back to this and can't be used to make it
+    ShaderSystem::ShaderHandle CreateDefaultShader() {
+        return ShaderSystem::CreateShader(m_defaultName, "../src/Shaders/default.vert",
+                                          "../src/Shaders/default.frag");
+    }
+
+    MaterialSystem::MaterialHandle CreateDefaultMaterial() {
+        GetDefaultShader();
+        return CreateMaterialNow(m_defaultName, m_defaultName, false);
     }
 
     void ProcessAssimpMesh(const aiScene * /*scene*/, const aiMesh *mesh,
                            std::vector<Vertex> &vertices,
                            std::vector<uint32_t> &indices) {
+        // meshes are appended into one buffer, so rebase their indices
+        const auto baseVertex = static_cast<uint32_t>(vertices.size());
+
         for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
             Vertex vertex{};
             vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y,
@@ -242,29 +859,19 @@ namespace ResourceManager {
         for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
             const aiFace face = mesh->mFaces[i];
             for (unsigned int j = 0; j < face.mNumIndices; j++) {
-                indices.push_back(face.mIndices[j]);
+                indices.push_back(baseVertex + face.mIndices[j]);
             }
         }
     }
 
     bool LoadMeshDataFromFile(const std::string &filePath, std::vector<Vertex> &vertices,
-                              std::vector<uint32_t> &indices) {
-        const std::filesystem::path meshFile = std::filesystem::path(filePath).filename();
-        std::filesystem::path paths[] = {"Assets/Models", "../Assets/Models",
-                                         "../../Assets/Models", "gl-gfx/Assets/Models"};
-
-        std::string trueFilePath;
-        for (const auto &basePath : paths) {
-            if (std::filesystem::path fullPath = basePath / meshFile; exists(fullPath)) {
-                trueFilePath = fullPath.string();
-                break;
-            }
-        }
-
+                              std::vector<uint32_t> &indices,
+                              std::vector<MeshSystem::Submesh> *submeshes) {
+        // the importer owns and deletes its IO handler
         Assimp::Importer importer;
+        importer.SetIOHandler(new VfsIOSystem());
         const aiScene *scene =
-            importer.ReadFile(trueFilePath, aiProcess_Triangulate | aiProcess_GenNormals |
-                                                aiProcess_FlipUVs);
+            importer.ReadFile(GetMeshPath(filePath), m_meshImportFlags);
 
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
             ErrorHandler::Warn(
@@ -276,26 +883,46 @@ namespace ResourceManager {
 
         for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
             const aiMesh *mesh = scene->mMeshes[i];
+
+            const MeshSystem::Submesh submesh{
+                .firstIndex = static_cast<uint32_t>(indices.size()),
+                .indexCount = 0,
+                .baseVertex = static_cast<uint32_t>(vertices.size()),
+                .vertexCount = mesh->mNumVertices,
+            };
+
             ProcessAssimpMesh(scene, mesh, vertices, indices);
+
+            if (submeshes) {
+                submeshes->push_back(submesh);
+                submeshes->back().indexCount =
+                    static_cast<uint32_t>(indices.size()) - submesh.firstIndex;
+            }
         }
 
         return true;
     }
 
     void CleanUp() {
+        AsyncLoader::CleanUp();
+        m_asyncLoading = false;
+
+        ReleaseQueue::CleanUp();
+
         MeshSystem::CleanUp();
         TextureSystem::CleanUp();
         ShaderSystem::CleanUp();
         MaterialSystem::CleanUp();
 
-        m_meshes.clear();
-        m_textures.clear();
-        m_shaders.clear();
+        m_defaultCubeMesh = {};
+        m_defaultPlaneMesh = {};
+        m_defaultTexture = {};
+        m_defaultShader = {};
+        m_defaultMaterial = {};
+
+        m_meshSources.clear();
+        m_textureSources.clear();
 
-        m_defaultCubeMesh = nullptr;
-        m_defaultPlaneMesh = nullptr;
-        m_defaultTexture = nullptr;
-        m_defaultShader = nullptr;
-        m_defaultMaterial = nullptr;
+        GpuMemory::CleanUp();
     }
 }
@@ -0,0 +1,682 @@
+#include "scene_file.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "mapped_file.h"
+
+namespace SceneFile {
+    static constexpr char m_magic[4] = {'G', 'S', 'C', 'N'};
+
+    static constexpr uint64_t m_sectionAlignment = 8;
+
+    static uint64_t AlignUp(const uint64_t value) {
+        return (value + m_sectionAlignment - 1) & ~(m_sectionAlignment - 1);
+    }
+
+    uint32_t GetValueCount(const PropertyType type) {
+        switch (type) {
+            case PropertyType::Float:
+            case PropertyType::Int:
+                return 1;
+            case PropertyType::Vec2:
+                return 2;
+            case PropertyType::Vec3:
+                return 3;
+            case PropertyType::Vec4:
+                return 4;
+            case PropertyType::Mat4:
+                return 16;
+        }
+
+        return 0;
+    }
+
+    std::string_view Scene::GetString(const uint32_t index) const {
+        if (index >= strings.size()) {
+            return {};
+        }
+
+        return std::string_view(characters).substr(strings[index].offset,
+                                                    strings[index].length);
+    }
+
+    uint32_t Scene::AddString(const std::string_view text) {
+        const auto [it, added] = m_stringIndex.try_emplace(
+            std::string(text), static_cast<uint32_t>(strings.size()));
+        if (added) {
+            strings.push_back({static_cast<uint32_t>(characters.size()),
+                               static_cast<uint32_t>(text.size())});
+            characters += text;
+        }
+
+        return it->second;
+    }
+
+    // the section's bytes copied into values, false when they don't fit the file
+    // or are not a whole number of values
+    template <typename T>
+    static bool CopySection(const uint8_t *data, const size_t size,
+                            const SectionRange &range, std::vector<T> &values) {
+        if (range.offset > size || range.size > size - range.offset ||
+            range.size % sizeof(T) != 0) {
+            return false;
+        }
+
+        values.resize(range.size / sizeof(T));
+        std::memcpy(values.data(), data + range.offset, range.size);
+
+        return true;
+    }
+
+    static bool CopySection(const uint8_t *data, const size_t size,
+                            const SectionRange &range, std::string &characters) {
+        if (range.offset > size || range.size > size - range.offset) {
+            return false;
+        }
+
+        characters.assign(reinterpret_cast<const char *>(data + range.offset),
+                          range.size);
+
+        return true;
+    }
+
+    // every index is checked once here, so loading never has to
+    static bool Validate(const Scene &scene) {
+        const auto isString = [&scene](const uint32_t index) {
+            return index == None || index < scene.strings.size();
+        };
+        const auto isIndex = [](const uint32_t index, const size_t count) {
+            return index == None || index < count;
+        };
+
+        for (const StringRef &string : scene.strings) {
+            if (uint64_t{string.offset} + string.length > scene.characters.size()) {
+                return false;
+            }
+        }
+
+        if (!isString(scene.name) || !isString(scene.camera.name)) {
+            return false;
+        }
+
+        for (const Light &light : scene.lights) {
+            if (!isString(light.name) || light.type > LightType::Point) {
+                return false;
+            }
+        }
+
+        for (const Mesh &mesh : scene.meshes) {
+            if (!isString(mesh.name) || !isString(mesh.path)) {
+                return false;
+            }
+        }
+
+        for (const Texture &texture : scene.textures) {
+            if (!isString(texture.name) || !isString(texture.path)) {
+                return false;
+            }
+        }
+
+        for (const Shader &shader : scene.shaders) {
+            if (!isString(shader.name) || !isString(shader.vertexPath) ||
+                !isString(shader.fragmentPath)) {
+                return false;
+            }
+        }
+
+        for (const Material &material : scene.materials) {
+            if (!isString(material.name) ||
+                !isIndex(material.shader, scene.shaders.size()) ||
+                uint64_t{material.firstProperty} + material.propertyCount >
+                    scene.properties.size()) {
+                return false;
+            }
+        }
+
+        for (const Property &property : scene.properties) {
+            if (!isString(property.name) || property.type > PropertyType::Mat4 ||
+                uint64_t{property.firstValue} + GetValueCount(property.type) >
+                    scene.values.size()) {
+                return false;
+            }
+        }
+
+        const size_t count = scene.GetEntityCount();
+        if (scene.parents.size() != count || scene.entityLights.size() != count ||
+            scene.flags.size() != count || scene.colors.size() != count ||
+            scene.transforms.size() != count || scene.resources.size() != count) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const Resources &resources = scene.resources[i];
+            if (!isString(scene.entityNames[i]) || !isIndex(scene.parents[i], count) ||
+                !isString(scene.entityLights[i]) ||
+                !isIndex(resources.mesh, scene.meshes.size()) ||
+                !isIndex(resources.texture, scene.textures.size()) ||
+                !isIndex(resources.material, scene.materials.size())) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Read(const uint8_t *data, const size_t size, Scene &scene) {
+        if (!data || size < sizeof(Header)) {
+            return false;
+        }
+
+        Header header{};
+        std::memcpy(&header, data, sizeof(Header));
+        if (std::memcmp(header.magic, m_magic, sizeof(m_magic)) != 0 ||
+            header.version != Version || header.sectionCount != SectionCount) {
+            return false;
+        }
+
+        scene = {};
+        scene.name = header.sceneName;
+        scene.camera = header.camera;
+
+        const auto copy = [&](const Section section, auto &values) {
+            return CopySection(data, size, header.sections[static_cast<size_t>(section)],
+                               values);
+        };
+
+        return copy(Section::Strings, scene.strings) &&
+               copy(Section::Characters, scene.characters) &&
+               copy(Section::Lights, scene.lights) &&
+               copy(Section::Meshes, scene.meshes) &&
+               copy(Section::Textures, scene.textures) &&
+               copy(Section::Shaders, scene.shaders) &&
+               copy(Section::Materials, scene.materials) &&
+               copy(Section::Properties, scene.properties) &&
+               copy(Section::Values, scene.values) &&
+               copy(Section::EntityNames, scene.entityNames) &&
+               copy(Section::Parents, scene.parents) &&
+               copy(Section::EntityLights, scene.entityLights) &&
+               copy(Section::Flags, scene.flags) && copy(Section::Colors, scene.colors) &&
+               copy(Section::Transforms, scene.transforms) &&
+               copy(Section::Resources, scene.resources) && Validate(scene);
+    }
+
+    bool Read(const std::filesystem::path &path, Scene &scene) {
+        const MappedFile file(path);
+        return Read(file.Data(), file.Size(), scene);
+    }
+
+    struct Bytes {
+        const void *data;
+        uint64_t size;
+    };
+
+    template <typename T>
+    static Bytes GetBytes(const std::vector<T> &values) {
+        return {values.data(), values.size() * sizeof(T)};
+    }
+
+    bool Write(const Scene &scene, const std::filesystem::path &path) {
+        // in Section order
+        const std::array<Bytes, SectionCount> sections = {
+            GetBytes(scene.strings),
+            Bytes{scene.characters.data(), scene.characters.size()},
+            GetBytes(scene.lights),
+            GetBytes(scene.meshes),
+            GetBytes(scene.textures),
+            GetBytes(scene.shaders),
+            GetBytes(scene.materials),
+            GetBytes(scene.properties),
+            GetBytes(scene.values),
+            GetBytes(scene.entityNames),
+            GetBytes(scene.parents),
+            GetBytes(scene.entityLights),
+            GetBytes(scene.flags),
+            GetBytes(scene.colors),
+            GetBytes(scene.transforms),
+            GetBytes(scene.resources),
+        };
+
+        Header header{};
+        std::memcpy(header.magic, m_magic, sizeof(m_magic));
+        header.version = Version;
+        header.sectionCount = SectionCount;
+        header.sceneName = scene.name;
+        header.camera = scene.camera;
+
+        uint64_t offset = AlignUp(sizeof(Header));
+        for (size_t i = 0; i < SectionCount; i++) {
+            header.sections[i] = {offset, sections[i].size};
+            offset = AlignUp(offset + sections[i].size);
+        }
+
+        std::filesystem::path temporary = path;
+        temporary += ".tmp";
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                ErrorHandler::Warn("Failed to open " + temporary.string(), __FILE__,
+                                   __func__, __LINE__);
+                return false;
+            }
+
+            static constexpr char padding[m_sectionAlignment] = {};
+            file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+            uint64_t position = sizeof(Header);
+            for (size_t i = 0; i < SectionCount; i++) {
+                file.write(padding, static_cast<std::streamsize>(
+                                        header.sections[i].offset - position));
+                file.write(static_cast<const char *>(sections[i].data),
+                           static_cast<std::streamsize>(sections[i].size));
+                position = header.sections[i].offset + sections[i].size;
+            }
+
+            if (!file) {
+                ErrorHandler::Warn("Failed to write " + temporary.string(), __FILE__,
+                                   __func__, __LINE__);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            ErrorHandler::Warn("Failed to replace " + path.string() + ": " +
+                                   error.message(),
+                               __FILE__, __func__, __LINE__);
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    // the reading rules of Serialisation: an array too short gives fallback for
+    // every value, a missing value in a long enough array gives fallback for it
+    static void ReadFloats(const toml::array *array, float *values, const size_t count,
+                           const float fallback) {
+        const bool complete = array && array->size() >= count;
+        for (size_t i = 0; i < count; i++) {
+            values[i] = complete ? (*array)[i].value_or(fallback) : fallback;
+        }
+    }
+
+    static glm::vec3 ReadVec3(const toml::array *array) {
+        glm::vec3 value;
+        ReadFloats(array, &value.x, 3, 0.0f);
+        return value;
+    }
+
+    static toml::array ToArray(const float *values, const size_t count) {
+        toml::array array;
+        for (size_t i = 0; i < count; i++) {
+            array.push_back(values[i]);
+        }
+
+        return array;
+    }
+
+    static uint32_t AddShader(Scene &scene,
+                              std::unordered_map<std::string, uint32_t> &index,
+                              const toml::table &shader) {
+        const std::string name = shader["name"].value_or(std::string());
+        const auto [it, added] =
+            index.try_emplace(name, static_cast<uint32_t>(scene.shaders.size()));
+        if (added) {
+            scene.shaders.push_back(
+                {scene.AddString(name),
+                 scene.AddString(shader["vertex_path"].value_or(std::string())),
+                 scene.AddString(shader["fragment_path"].value_or(std::string()))});
+        }
+
+        return it->second;
+    }
+
+    // a property as Serialisation::DeserialiseMaterialProperties reads it, false
+    // for values it would skip
+    static bool ReadProperty(const toml::node &node, PropertyType &type,
+                             std::vector<uint32_t> &words) {
+        if (node.is_floating_point()) {
+            type = PropertyType::Float;
+            words = {std::bit_cast<uint32_t>(
+                static_cast<float>(node.as_floating_point()->get()))};
+            return true;
+        }
+
+        if (node.is_integer()) {
+            type = PropertyType::Int;
+            words = {std::bit_cast<uint32_t>(static_cast<int>(node.as_integer()->get()))};
+            return true;
+        }
+
+        const toml::array *array = node.as_array();
+        if (!array) {
+            return false;
+        }
+
+        float values[16];
+        switch (array->size()) {
+            case 2:
+                type = PropertyType::Vec2;
+                ReadFloats(array, values, 2, 0.0f);
+                break;
+            case 3:
+                type = PropertyType::Vec3;
+                ReadFloats(array, values, 3, 0.0f);
+                break;
+            case 4:
+                type = PropertyType::Vec4;
+                ReadFloats(array, values, 4, 1.0f);
+                break;
+            case 16:
+                type = PropertyType::Mat4;
+                ReadFloats(array, values, 16, 0.0f);
+                break;
+            default:
+                return false;
+        }
+
+        words.resize(GetValueCount(type));
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] = std::bit_cast<uint32_t>(values[i]);
+        }
+
+        return true;
+    }
+
+    Scene FromToml(const toml::table &document) {
+        Scene scene;
+        if (const auto name = document["scene_name"].value<std::string>()) {
+            scene.name = scene.AddString(*name);
+        }
+
+        if (const toml::table *camera = document["camera"].as_table()) {
+            scene.camera.name =
+                scene.AddString((*camera)["name"].value_or(std::string()));
+            scene.camera.position = ReadVec3((*camera)["position"].as_array());
+            scene.camera.up = ReadVec3((*camera)["up"].as_array());
+        }
+
+        std::unordered_map<std::string, uint32_t> lightNames;
+        if (const toml::array *lights = document["light"].as_array()) {
+            for (const toml::node &node : *lights) {
+                const toml::table &light = *node.as_table();
+                const std::string name = light["name"].value_or(std::string());
+                const bool directional =
+                    light["type"].value_or(std::string()) == "directional";
+
+                // scenes saved by older builds name the direction "directional"
+                const toml::array *direction = light.contains("direction")
+                                                   ? light["direction"].as_array()
+                                                   : light["directional"].as_array();
+
+                lightNames.try_emplace(name, scene.AddString(name));
+                scene.lights.push_back({
+                    .name = scene.AddString(name),
+                    .type = directional ? LightType::Directional : LightType::Point,
+                    .position = ReadVec3(light["position"].as_array()),
+                    .direction = ReadVec3(direction),
+                    .color = ReadVec3(light["color"].as_array()),
+                    .intensity = light["intensity"].value_or(0.0f),
+                });
+            }
+        }
+
+        const toml::array *entities = document["entity"].as_array();
+        if (!entities) {
+            return scene;
+        }
+
+        std::unordered_map<std::string, uint32_t> meshIndex;
+        std::unordered_map<std::string, uint32_t> textureIndex;
+        std::unordered_map<std::string, uint32_t> shaderIndex;
+        std::unordered_map<std::string, uint32_t> materialIndex;
+
+        // merged across every entity naming the material, later values win
+        std::vector<std::map<std::string, std::pair<PropertyType, std::vector<uint32_t>>>>
+            materialProperties;
+
+        std::unordered_map<std::string, uint32_t> entityIndex;
+        std::vector<std::string> parentNames;
+
+        for (const toml::node &node : *entities) {
+            const toml::table &entity = *node.as_table();
+            const std::string name = entity["name"].value_or(std::string());
+            const auto index = static_cast<uint32_t>(scene.GetEntityCount());
+
+            // a later entity of the same name replaces the earlier one on load, as
+            // a parent the later one is found
+            entityIndex[name] = index;
+            parentNames.push_back(entity["parent"].value_or(std::string()));
+
+            uint32_t light = None;
+            if (const auto linked = entity["light"].value<std::string>()) {
+                light = scene.AddString(*linked);
+            } else if (name.ends_with("_visual")) {
+                const auto it = lightNames.find(name.substr(0, name.size() - 7));
+                light = it != lightNames.end() ? it->second : None;
+            }
+
+            glm::vec4 color;
+            ReadFloats(entity["color"].as_array(), &color.x, 4, 1.0f);
+
+            Transform transform;
+            if (const toml::table *table = entity["transform"].as_table()) {
+                transform.position = ReadVec3((*table)["position"].as_array());
+                transform.rotation = ReadVec3((*table)["rotation"].as_array());
+                transform.scale = ReadVec3((*table)["scale"].as_array());
+            }
+
+            Resources resources;
+            if (const toml::table *mesh = entity["mesh"].as_table()) {
+                const std::string meshName = (*mesh)["name"].value_or(std::string());
+                const auto [it, added] = meshIndex.try_emplace(
+                    meshName, static_cast<uint32_t>(scene.meshes.size()));
+                if (added) {
+                    scene.meshes.push_back(
+                        {scene.AddString(meshName),
+                         scene.AddString((*mesh)["path"].value_or(std::string()))});
+                }
+                resources.mesh = it->second;
+            }
+
+            if (const toml::table *texture = entity["texture"].as_table()) {
+                const std::string textureName =
+                    (*texture)["name"].value_or(std::string());
+                const auto [it, added] = textureIndex.try_emplace(
+                    textureName, static_cast<uint32_t>(scene.textures.size()));
+                if (added) {
+                    scene.textures.push_back(
+                        {scene.AddString(textureName),
+                         scene.AddString((*texture)["path"].value_or(std::string()))});
+                }
+                resources.texture = it->second;
+            }
+
+            if (const toml::table *material = entity["material"].as_table()) {
+                const std::string materialName =
+                    (*material)["name"].value_or(std::string());
+                const toml::table *shader = (*material)["shader"].as_table();
+                const uint32_t materialShader =
+                    shader ? AddShader(scene, shaderIndex, *shader) : None;
+
+                const auto [it, added] = materialIndex.try_emplace(
+                    materialName, static_cast<uint32_t>(scene.materials.size()));
+                if (added) {
+                    scene.materials.push_back(
+                        {scene.AddString(materialName), materialShader, 0, 0});
+                    materialProperties.emplace_back();
+                }
+                resources.material = it->second;
+
+                if (const toml::table *properties =
+                        (*material)["properties"].as_table()) {
+                    for (const auto &[key, value] : *properties) {
+                        PropertyType type;
+                        std::vector<uint32_t> words;
+                        if (ReadProperty(value, type, words)) {
+                            materialProperties[it->second][std::string(key.str())] = {
+                                type, std::move(words)};
+                        }
+                    }
+                }
+            }
+
+            scene.entityNames.push_back(scene.AddString(name));
+            scene.entityLights.push_back(light);
+            scene.flags.push_back(entity["static"].value_or(false) ? Static : 0u);
+            scene.colors.push_back(color);
+            scene.transforms.push_back(transform);
+            scene.resources.push_back(resources);
+        }
+
+        // parents can come later in the file than their children
+        for (const std::string &parent : parentNames) {
+            const auto it = entityIndex.find(parent);
+            const bool found = !parent.empty() && it != entityIndex.end();
+            scene.parents.push_back(found ? it->second : None);
+        }
+
+        for (size_t i = 0; i < scene.materials.size(); i++) {
+            Material &material = scene.materials[i];
+            material.firstProperty = static_cast<uint32_t>(scene.properties.size());
+            material.propertyCount = static_cast<uint32_t>(materialProperties[i].size());
+
+            for (const auto &[name, property] : materialProperties[i]) {
+                scene.properties.push_back({scene.AddString(name), property.first,
+                                            static_cast<uint32_t>(scene.values.size())});
+                scene.values.insert(scene.values.end(), property.second.begin(),
+                                    property.second.end());
+            }
+        }
+
+        return scene;
+    }
+
+    static toml::table ToToml(const Scene &scene, const Material &material) {
+        toml::table table;
+        table.insert("name", scene.GetString(material.name));
+
+        if (material.shader != None) {
+            const Shader &shader = scene.shaders[material.shader];
+            toml::table shaderTable;
+            shaderTable.insert("name", scene.GetString(shader.name));
+            shaderTable.insert("fragment_path", scene.GetString(shader.fragmentPath));
+            shaderTable.insert("vertex_path", scene.GetString(shader.vertexPath));
+            table.insert("shader", shaderTable);
+        }
+
+        toml::table properties;
+        for (uint32_t i = 0; i < material.propertyCount; i++) {
+            const Property &property = scene.properties[material.firstProperty + i];
+            const uint32_t *words = scene.values.data() + property.firstValue;
+            const std::string_view name = scene.GetString(property.name);
+
+            if (property.type == PropertyType::Int) {
+                properties.insert(name, std::bit_cast<int>(words[0]));
+                continue;
+            }
+
+            float values[16];
+            const uint32_t count = GetValueCount(property.type);
+            for (uint32_t j = 0; j < count; j++) {
+                values[j] = std::bit_cast<float>(words[j]);
+            }
+
+            if (property.type == PropertyType::Float) {
+                properties.insert(name, values[0]);
+            } else {
+                properties.insert(name, ToArray(values, count));
+            }
+        }
+        table.insert("properties", properties);
+
+        return table;
+    }
+
+    toml::table ToToml(const Scene &scene) {
+        toml::table document;
+        if (scene.name != None) {
+            document.insert("scene_name", scene.GetString(scene.name));
+        }
+
+        toml::table camera;
+        if (scene.camera.name != None) {
+            camera.insert("name", scene.GetString(scene.camera.name));
+            camera.insert("position", ToArray(&scene.camera.position.x, 3));
+            camera.insert("up", ToArray(&scene.camera.up.x, 3));
+        }
+        document.insert("camera", camera);
+
+        toml::array entities;
+        for (size_t i = 0; i < scene.GetEntityCount(); i++) {
+            toml::table entity;
+            entity.insert("name", scene.GetString(scene.entityNames[i]));
+            if (scene.parents[i] != None) {
+                entity.insert("parent",
+                              scene.GetString(scene.entityNames[scene.parents[i]]));
+            }
+            if (scene.entityLights[i] != None) {
+                entity.insert("light", scene.GetString(scene.entityLights[i]));
+            }
+            if (scene.flags[i] & Static) {
+                entity.insert("static", true);
+            }
+            entity.insert("color", ToArray(&scene.colors[i].x, 4));
+
+            const Transform &transform = scene.transforms[i];
+            toml::table transformTable;
+            transformTable.insert("position", ToArray(&transform.position.x, 3));
+            transformTable.insert("scale", ToArray(&transform.scale.x, 3));
+            transformTable.insert("rotation", ToArray(&transform.rotation.x, 3));
+            entity.insert("transform", transformTable);
+
+            const Resources &resources = scene.resources[i];
+            if (resources.mesh != None) {
+                const Mesh &mesh = scene.meshes[resources.mesh];
+                toml::table meshTable;
+                meshTable.insert("name", scene.GetString(mesh.name));
+                meshTable.insert("path", scene.GetString(mesh.path));
+                entity.insert("mesh", meshTable);
+            }
+
+            if (resources.texture != None) {
+                const Texture &texture = scene.textures[resources.texture];
+                toml::table textureTable;
+                textureTable.insert("name", scene.GetString(texture.name));
+                textureTable.insert("path", scene.GetString(texture.path));
+                entity.insert("texture", textureTable);
+            }
+
+            if (resources.material != None) {
+                entity.insert("material",
+                              ToToml(scene, scene.materials[resources.material]));
+            }
+
+            entities.push_back(entity);
+        }
+        document.insert("entity", entities);
+
+        toml::array lights;
+        for (const Light &light : scene.lights) {
+            toml::table table;
+            table.insert("name", scene.GetString(light.name));
+            table.insert("type",
+                         light.type == LightType::Directional ? "directional" : "point");
+            table.insert("position", ToArray(&light.position.x, 3));
+            if (light.type == LightType::Directional) {
+                table.insert("direction", ToArray(&light.direction.x, 3));
+            }
+            table.insert("color", ToArray(&light.color.x, 3));
+            table.insert("intensity", light.intensity);
+            lights.push_back(table);
+        }
+        document.insert("light", lights);
+
+        return document;
+    }
+}
@@ -0,0 +1,458 @@
+#include "scene_loader.h"
+
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iomanip>
+
+#include "camera_system.h"
+#include "light_system.h"
+#include "render_system.h"
+#include "resource_manager.h"
+#include "scene_file.h"
+#include "scene_system.h"
+#include "serialisation.h"
+#include "startup_timeline.h"
+#include "transform_system.h"
+
+namespace SceneLoader {
+    using Clock = std::chrono::steady_clock;
+
+    enum class ItemType : uint8_t { Shader, Mesh, Texture, Material, Entity, Finish };
+
+    // an index into the scene's table of the item's type
+    struct Item {
+        ItemType type;
+        uint32_t index;
+    };
+
+    struct Parsed {
+        bool valid = false;
+        SceneFile::Scene scene;
+        // empty for binary scenes, what ApplyChanges diffs against for TOML ones
+        toml::table document;
+    };
+
+    static float m_frameBudgetMs = 2.0f;
+
+    static std::string m_filename;
+    static Clock::time_point m_start;
+    static std::future<Parsed> m_parse;
+
+    static SceneFile::Scene m_scene;
+    static toml::table m_document;
+    static bool m_hasCamera = false;
+    static std::vector<Item> m_items;
+    static size_t m_next = 0;
+
+    // filled by the items that make them, indexed like the scene's tables
+    static std::vector<MeshSystem::MeshHandle> m_meshes;
+    static std::vector<TextureSystem::TextureHandle> m_textures;
+    static std::vector<MaterialSystem::MaterialHandle> m_materials;
+    static std::vector<SceneSystem::EntityId> m_entities;
+
+    static bool IsBinary(const std::string &filename) {
+        return std::filesystem::path(filename).extension() == SceneFile::Extension;
+    }
+
+    static std::string GetFilename(const std::string &filename) {
+        return IsBinary(filename) ? filename
+                                  : Serialisation::EnsureTomlExtension(filename);
+    }
+
+    // runs on a background thread, touches nothing but the file
+    static Parsed Parse(const std::string &filename) {
+        Parsed parsed;
+        const std::string scenePath = "Scenes/" + filename;
+
+        const FileView file = VirtualFileSystem::Map(scenePath);
+        if (!file) {
+            ErrorHandler::Warn("Scene file does not exist: " + filename, __FILE__,
+                               __func__, __LINE__);
+            return parsed;
+        }
+
+        if (IsBinary(filename)) {
+            parsed.valid = SceneFile::Read(file.Data(), file.Size(), parsed.scene);
+            if (!parsed.valid) {
+                ErrorHandler::Warn("Ignoring invalid binary scene: " + filename,
+                                   __FILE__, __func__, __LINE__);
+            }
+
+            return parsed;
+        }
+
+        try {
+            const std::string_view document(reinterpret_cast<const char *>(file.Data()),
+                                            file.Size());
+            parsed.document = toml::parse(document, scenePath);
+            parsed.scene = SceneFile::FromToml(parsed.document);
+            parsed.valid = true;
+        } catch (const toml::parse_error &err) {
+            ErrorHandler::Warn("Error parsing TOML: " + std::string(err.what()), __FILE__,
+                               __func__, __LINE__);
+        }
+
+        return parsed;
+    }
+
+    static std::string GetString(const uint32_t index) {
+        return std::string(m_scene.GetString(index));
+    }
+
+    // swaps the old scene out for the parsed one's lights and camera and queues
+    // everything else. False, keeping the old scene, when the parse failed
+    static bool Start(Parsed parsed) {
+        if (!parsed.valid) {
+            ErrorHandler::Warn("Failed to load scene: " + m_filename, __FILE__, __func__,
+                               __LINE__);
+            m_filename.clear();
+            return false;
+        }
+
+        m_scene = std::move(parsed.scene);
+        m_document = std::move(parsed.document);
+
+        // the old scene's resources stay referenced by nothing but are only
+        // unloaded once the new scene has taken what it shares with them
+        SceneSystem::CleanUp();
+        LightSystem::CleanUp();
+
+        // half a scene must not be diffed against either file
+        Serialisation::SetLoadedScene(m_filename, {});
+
+        if (m_scene.name != SceneFile::None) {
+            SceneSystem::SetSceneName(GetString(m_scene.name));
+        }
+
+        for (const SceneFile::Light &light : m_scene.lights) {
+            if (light.type == SceneFile::LightType::Directional) {
+                LightSystem::CreateDirectionalLight(GetString(light.name),
+                                                    light.direction, light.color,
+                                                    light.intensity);
+            } else {
+                LightSystem::CreatePointLight(GetString(light.name), light.position,
+                                              light.color, light.intensity);
+            }
+        }
+
+        m_hasCamera = m_scene.camera.name != SceneFile::None;
+        if (m_hasCamera) {
+            auto *camera = CameraSystem::CreateCamera(GetString(m_scene.camera.name));
+            CameraSystem::SetMainCamera(camera);
+            RenderSystem::UpdateProjection();
+            camera->position = m_scene.camera.position;
+            camera->up = m_scene.camera.up;
+        }
+
+        // meshes and textures go to the loader threads before any entity is made,
+        // so they decode while the entities are
+        const auto queue = [](const ItemType type, const size_t count) {
+            for (uint32_t i = 0; i < count; i++) {
+                m_items.push_back({type, i});
+            }
+        };
+        m_items.clear();
+        queue(ItemType::Shader, m_scene.shaders.size());
+        queue(ItemType::Mesh, m_scene.meshes.size());
+        queue(ItemType::Texture, m_scene.textures.size());
+        queue(ItemType::Material, m_scene.materials.size());
+        queue(ItemType::Entity, m_scene.GetEntityCount());
+        m_items.push_back({ItemType::Finish, 0});
+        m_next = 0;
+
+        m_meshes.assign(m_scene.meshes.size(), {});
+        m_textures.assign(m_scene.textures.size(), {});
+        m_materials.assign(m_scene.materials.size(), {});
+        m_entities.assign(m_scene.GetEntityCount(), {});
+
+        return true;
+    }
+
+    static void LoadShader(const SceneFile::Shader &shader) {
+        const std::string name = GetString(shader.name);
+        if (!ShaderSystem::Find(name)) {
+            ResourceManager::LoadShader(name, GetString(shader.vertexPath),
+                                        GetString(shader.fragmentPath));
+        }
+    }
+
+    static MeshSystem::MeshHandle LoadMesh(const SceneFile::Mesh &mesh) {
+        const std::string name = GetString(mesh.name);
+        if (const MeshSystem::MeshHandle existing = MeshSystem::Find(name)) {
+            return existing;
+        }
+
+        return ResourceManager::LoadMesh(name, GetString(mesh.path));
+    }
+
+    static TextureSystem::TextureHandle LoadTexture(const SceneFile::Texture &texture) {
+        const std::string name = GetString(texture.name);
+        if (const TextureSystem::TextureHandle existing = TextureSystem::Find(name)) {
+            return existing;
+        }
+
+        return ResourceManager::LoadTexture(name, GetString(texture.path));
+    }
+
+    // a property's value from its run of words
+    template <typename T>
+    static T FromWords(const uint32_t *words) {
+        T value;
+        std::memcpy(static_cast<void *>(&value), words, sizeof(T));
+        return value;
+    }
+
+    static MaterialSystem::MaterialHandle LoadMaterial(const SceneFile::Material &entry) {
+        const std::string name = GetString(entry.name);
+        MaterialSystem::MaterialHandle handle = MaterialSystem::Find(name);
+        if (!handle) {
+            const std::string shader = entry.shader != SceneFile::None
+                                           ? GetString(m_scene.shaders[entry.shader].name)
+                                           : std::string();
+            handle = MaterialSystem::CreateMaterial(name, shader);
+        }
+
+        MaterialSystem::Material *material = MaterialSystem::Get(handle);
+        if (!material) {
+            return handle;
+        }
+
+        for (uint32_t i = 0; i < entry.propertyCount; i++) {
+            const SceneFile::Property &property =
+                m_scene.properties[entry.firstProperty + i];
+            const StringId id = StringTable::Intern(m_scene.GetString(property.name));
+            const uint32_t *words = m_scene.values.data() + property.firstValue;
+
+            switch (property.type) {
+                case SceneFile::PropertyType::Float:
+                    MaterialSystem::SetFloat(material, id, FromWords<float>(words));
+                    break;
+                case SceneFile::PropertyType::Int:
+                    MaterialSystem::SetInt(material, id, FromWords<int>(words));
+                    break;
+                case SceneFile::PropertyType::Vec2:
+                    MaterialSystem::SetVec2(material, id, FromWords<glm::vec2>(words));
+                    break;
+                case SceneFile::PropertyType::Vec3:
+                    MaterialSystem::SetVec3(material, id, FromWords<glm::vec3>(words));
+                    break;
+                case SceneFile::PropertyType::Vec4:
+                    MaterialSystem::SetVec4(material, id, FromWords<glm::vec4>(words));
+                    break;
+                case SceneFile::PropertyType::Mat4:
+                    MaterialSystem::SetMat4(material, id, FromWords<glm::mat4>(words));
+                    break;
+            }
+        }
+
+        return handle;
+    }
+
+    static void SetParent(const uint32_t index) {
+        const uint32_t parent = m_scene.parents[index];
+        if (parent == SceneFile::None || !m_entities[index]) {
+            return;
+        }
+
+        if (!SceneSystem::SetParent(m_entities[index], m_entities[parent])) {
+            ErrorHandler::Warn("Failed to parent " +
+                                   GetString(m_scene.entityNames[index]) + " to " +
+                                   GetString(m_scene.entityNames[parent]),
+                               __FILE__, __func__, __LINE__);
+        }
+    }
+
+    static void LoadEntity(const uint32_t index) {
+        const SceneSystem::EntityId entity = SceneSystem::CreateEntity(
+            GetString(m_scene.entityNames[index]), m_scene.colors[index]);
+        m_entities[index] = entity;
+        if (!entity) {
+            return;
+        }
+
+        SceneSystem::SetLight(entity, GetString(m_scene.entityLights[index]));
+        SceneSystem::SetStatic(entity, m_scene.flags[index] & SceneFile::Static);
+
+        const SceneFile::Transform &transform = m_scene.transforms[index];
+        const TransformSystem::TransformHandle handle = SceneSystem::GetTransform(entity);
+        TransformSystem::SetPosition(handle, transform.position);
+        TransformSystem::SetScale(handle, transform.scale);
+        TransformSystem::SetRotation(handle, transform.rotation);
+        SceneSystem::MarkChanged(entity);
+
+        const SceneFile::Resources &resources = m_scene.resources[index];
+        if (resources.mesh != SceneFile::None) {
+            SceneSystem::SetMesh(entity, m_meshes[resources.mesh]);
+        }
+        if (resources.texture != SceneFile::None) {
+            SceneSystem::SetTexture(entity, m_textures[resources.texture]);
+        }
+        if (resources.material != SceneFile::None) {
+            SceneSystem::SetMaterial(entity, m_materials[resources.material]);
+        }
+
+        // a parent later in the file adopts it in Finish
+        if (m_scene.parents[index] < index) {
+            SetParent(index);
+        }
+    }
+
+    static void Finish() {
+        for (uint32_t i = 0; i < m_entities.size(); i++) {
+            const uint32_t parent = m_scene.parents[i];
+            if (parent != SceneFile::None && parent > i) {
+                SetParent(i);
+            }
+        }
+
+        ResourceManager::UnloadUnused();
+        ResourceManager::Canonicalise();
+
+        Serialisation::SetLoadedScene(m_filename, std::move(m_document));
+
+        const Clock::time_point end = Clock::now();
+        if (!StartupTimeline::IsReached(StartupMilestone::SceneReady)) {
+            StartupTimeline::AddSpan("LoadScene " + m_filename, m_start, end);
+        }
+
+        std::ostringstream message;
+        message << "Loaded " << m_filename << " (" << m_entities.size()
+                << " entities) in " << std::fixed << std::setprecision(2)
+                << std::chrono::duration<float, std::milli>(end - m_start).count()
+                << " ms";
+        ErrorHandler::Info(message.str(), __FILE__, __func__, __LINE__);
+
+        m_scene = {};
+        m_document = {};
+        m_meshes.clear();
+        m_textures.clear();
+        m_materials.clear();
+        m_entities.clear();
+    }
+
+    static void Run(const Item &item) {
+        switch (item.type) {
+            case ItemType::Shader:
+                LoadShader(m_scene.shaders[item.index]);
+                break;
+            case ItemType::Mesh:
+                m_meshes[item.index] = LoadMesh(m_scene.meshes[item.index]);
+                break;
+            case ItemType::Texture:
+                m_textures[item.index] = LoadTexture(m_scene.textures[item.index]);
+                break;
+            case ItemType::Material:
+                m_materials[item.index] = LoadMaterial(m_scene.materials[item.index]);
+                break;
+            case ItemType::Entity:
+                LoadEntity(item.index);
+                break;
+            case ItemType::Finish:
+                Finish();
+                break;
+        }
+    }
+
+    bool Begin(const std::string &filename) {
+        const std::string finalFilename = GetFilename(filename);
+        if (!VirtualFileSystem::Exists("Scenes/" + finalFilename)) {
+            ErrorHandler::Warn("Scene file does not exist: " + finalFilename, __FILE__,
+                               __func__, __LINE__);
+            return false;
+        }
+
+        CleanUp();
+
+        m_filename = finalFilename;
+        m_start = Clock::now();
+        m_parse = std::async(std::launch::async, Parse, finalFilename);
+
+        return true;
+    }
+
+    void Update() {
+        if (m_parse.valid()) {
+            if (m_parse.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return;
+            }
+
+            if (!Start(m_parse.get())) {
+                return;
+            }
+        }
+
+        const Clock::time_point start = Clock::now();
+        while (m_next < m_items.size()) {
+            Run(m_items[m_next++]);
+
+            if (std::chrono::duration<float, std::milli>(Clock::now() - start).count() >=
+                m_frameBudgetMs) {
+                break;
+            }
+        }
+    }
+
+    bool Load(const std::string &filename) {
+        CleanUp();
+
+        m_filename = GetFilename(filename);
+        m_start = Clock::now();
+        if (!Start(Parse(m_filename))) {
+            return false;
+        }
+
+        while (m_next < m_items.size()) {
+            Run(m_items[m_next++]);
+        }
+
+        return m_hasCamera;
+    }
+
+    bool IsLoading() {
+        return m_parse.valid() || m_next < m_items.size();
+    }
+
+    Progress GetProgress() {
+        Progress progress{};
+        if (!IsLoading()) {
+            return progress;
+        }
+
+        progress.filename = m_filename;
+        progress.parsing = m_parse.valid();
+        progress.completed = static_cast<uint32_t>(m_next);
+        progress.total = static_cast<uint32_t>(m_items.size());
+        progress.elapsedMs =
+            std::chrono::duration<float, std::milli>(Clock::now() - m_start).count();
+
+        return progress;
+    }
+
+    void SetFrameBudget(const float milliseconds) {
+        m_frameBudgetMs = milliseconds;
+    }
+
+    float GetFrameBudget() {
+        return m_frameBudgetMs;
+    }
+
+    // a parse still running is waited for, a half-made scene stays as it is
+    void CleanUp() {
+        if (m_parse.valid()) {
+            m_parse.wait();
+            m_parse = {};
+        }
+
+        m_filename.clear();
+        m_scene = {};
+        m_document = {};
+        m_hasCamera = false;
+        m_items.clear();
+        m_next = 0;
+        m_meshes.clear();
+        m_textures.clear();
+        m_materials.clear();
+        m_entities.clear();
+    }
+}
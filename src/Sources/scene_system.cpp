@@ -2,76 +2,462 @@
 
 #include "renderer.h"
 #include "resource_manager.h"
+#include "sparse_set.h"
+#include "texture_streaming.h"
 
 namespace SceneSystem {
+    // an entity is drawn while it has this
+    struct Active {};
+
+    // drawn from baked geometry rather than submitted every frame
+    struct Static {};
+
+    // a static entity to place in its chunk again on the next Update
+    struct Changed {};
+
     static std::string m_name;
-    static std::unordered_map<std::string, Entity> m_entities;
-    static std::vector<Entity *> m_entityPtrs;
+    static SlotMap<Entity> m_entities;
+
+    // every entity has a transform, the rest are optional
+    static SparseSet<EntityId, std::string> m_names;
+    static SparseSet<EntityId, TransformSystem::TransformHandle> m_transforms;
+    static SparseSet<EntityId, Render> m_renders;
+    static SparseSet<EntityId, StringId> m_lights;
+    static SparseSet<EntityId, Active> m_active;
+    static SparseSet<EntityId, EntityId> m_parents;
+    static SparseSet<EntityId, Static> m_static;
+    static SparseSet<EntityId, Changed> m_changed;
+    static std::unordered_map<std::string, EntityId> m_byName;
+
+    // world bounds of the drawn entities as the BVH last saw them. Its items are
+    // slot indices, m_spatialIds maps them back
+    static SparseSet<EntityId, Aabb> m_worldBounds;
+    static Bvh m_spatial;
+    static std::vector<EntityId> m_spatialIds;
 
     void Init() {
-        m_entities.clear();
-        m_entityPtrs.clear();
+        CleanUp();
     }
 
-    Entity *CreateEntity(const std::string &name, const glm::vec4 &color) {
-        Entity entity;
-        entity.name = name;
-        entity.transform = TransformSystem::CreateTransform(name);
-        entity.color = color;
+    EntityId CreateEntity(const std::string &name, const glm::vec4 &color) {
+        DestroyEntity(Find(name));
 
-        m_entities[name] = entity;
-        m_entityPtrs.push_back(&m_entities[name]);
+        const EntityId entity = m_entities.Insert({});
+        if (!entity) {
+            ErrorHandler::Warn("Too many entities, failed to create " + name, __FILE__,
+                               __func__, __LINE__);
+            return {};
+        }
 
-        return &m_entities[name];
+        m_names.Insert(entity, name);
+        m_transforms.Insert(entity, TransformSystem::CreateTransform());
+        m_renders.Insert(entity, {}).color = color;
+        m_active.Insert(entity, {});
+        m_byName[name] = entity;
+
+        return entity;
     }
 
-    Entity *CreateLightEntity(const LightSystem::Light *light) {
+    std::vector<EntityId> SpawnEntities(
+        const Render &prototype, const std::span<const TransformSystem::Trs> transforms,
+        const std::span<const glm::vec4> colors, const std::string &namePrefix) {
+        if (!colors.empty() && colors.size() != transforms.size()) {
+            ErrorHandler::Warn("Spawning needs one colour per transform or none",
+                               __FILE__, __func__, __LINE__);
+            return {};
+        }
+
+        const std::vector<TransformSystem::TransformHandle> transformHandles =
+            TransformSystem::CreateTransforms(transforms);
+        const size_t spawned = transformHandles.size();
+
+        const size_t count = m_entities.Size() + spawned;
+        m_entities.Reserve(count);
+        m_transforms.Reserve(count);
+        m_renders.Reserve(count);
+        m_active.Reserve(count);
+        if (!namePrefix.empty()) {
+            m_names.Reserve(count);
+            m_byName.reserve(m_byName.size() + spawned);
+        }
+
+        Renderer::ReserveInstances(prototype.mesh, prototype.material, prototype.texture,
+                                   spawned);
+
+        std::vector<EntityId> entities;
+        entities.reserve(spawned);
+        for (size_t i = 0; i < spawned; i++) {
+            const EntityId entity = m_entities.Insert({});
+            if (!entity) {
+                for (size_t j = i; j < spawned; j++) {
+                    TransformSystem::DestroyTransform(transformHandles[j]);
+                }
+                break;
+            }
+
+            if (!namePrefix.empty()) {
+                const std::string name = namePrefix + std::to_string(i);
+                DestroyEntity(Find(name));
+                m_names.Insert(entity, name);
+                m_byName[name] = entity;
+            }
+
+            Render &render = m_renders.Insert(entity, prototype);
+            render.color = colors.empty() ? prototype.color : colors[i];
+            MeshSystem::AddRef(render.mesh);
+            MaterialSystem::AddRef(render.material);
+            TextureSystem::AddRef(render.texture);
+
+            m_transforms.Insert(entity, transformHandles[i]);
+            m_active.Insert(entity, {});
+            entities.push_back(entity);
+        }
+
+        if (entities.size() < transforms.size()) {
+            ErrorHandler::Warn("Too many entities, spawned " +
+                                   std::to_string(entities.size()) + " of " +
+                                   std::to_string(transforms.size()),
+                               __FILE__, __func__, __LINE__);
+        }
+
+        return entities;
+    }
+
+    EntityId CreateLightEntity(const LightSystem::Light *light) {
         if (light->type != LightSystem::LightType::Point) {
-            return nullptr;
+            return {};
         }
 
-        auto *lightEntity =
+        const EntityId lightEntity =
             CreateEntity(light->name + "_visual", glm::vec4(light->color, 1.0f));
-        lightEntity->mesh = ResourceManager::GetDefaultCubeMesh();
+        SetMesh(lightEntity, ResourceManager::GetDefaultCubeMesh());
+        SetLight(lightEntity, light->name);
 
-        auto *lightMaterial =
+        const MaterialSystem::MaterialHandle lightMaterialHandle =
             MaterialSystem::CreateMaterial(light->name + "_material", "default");
-        MaterialSystem::SetVec3(lightMaterial, "color", light->color);
-        MaterialSystem::SetInt(lightMaterial, "useTexture", 0);
+        auto *lightMaterial = MaterialSystem::Get(lightMaterialHandle);
+        MaterialSystem::SetVec3(lightMaterial, "color"_id, light->color);
+        MaterialSystem::SetInt(lightMaterial, "useTexture"_id, 0);
 
         const glm::vec3 emissiveColor = light->color * 2.0f;
-        MaterialSystem::SetVec3(lightMaterial, "color", emissiveColor);
+        MaterialSystem::SetVec3(lightMaterial, "color"_id, emissiveColor);
 
-        lightEntity->material = lightMaterial;
-        lightEntity->texture = ResourceManager::GetDefaultTexture();
+        SetMaterial(lightEntity, lightMaterialHandle);
+        SetTexture(lightEntity, ResourceManager::GetDefaultTexture());
 
-        TransformSystem::SetScale(lightEntity->transform, glm::vec3(0.2f));
-        TransformSystem::SetPosition(lightEntity->transform, light->position);
+        const TransformSystem::TransformHandle transform = GetTransform(lightEntity);
+        TransformSystem::SetScale(transform, glm::vec3(0.2f));
+        TransformSystem::SetPosition(transform, light->position);
 
         return lightEntity;
     }
 
-    Entity *GetEntity(const std::string &name) {
-        const auto it = m_entities.find(name);
-        return (it != m_entities.end()) ? &it->second : nullptr;
+    EntityId Find(const std::string &name) {
+        const auto it = m_byName.find(name);
+        return it != m_byName.end() ? it->second : EntityId{};
+    }
+
+    bool IsValid(const EntityId entity) {
+        return m_entities.Contains(entity);
+    }
+
+    std::string GetName(const EntityId entity) {
+        const std::string *name = m_names.Get(entity);
+        return name ? *name : std::string();
+    }
+
+    TransformSystem::TransformHandle GetTransform(const EntityId entity) {
+        const TransformSystem::TransformHandle *transform = m_transforms.Get(entity);
+        return transform ? *transform : TransformSystem::TransformHandle{};
+    }
+
+    Render *GetRender(const EntityId entity) {
+        return m_renders.Get(entity);
+    }
+
+    LightSystem::Light *GetLight(const EntityId entity) {
+        const StringId *light = m_lights.Get(entity);
+        return light ? LightSystem::GetLight(*light) : nullptr;
+    }
+
+    void SetLight(const EntityId entity, const std::string &light) {
+        if (!IsValid(entity)) {
+            return;
+        }
+
+        if (light.empty()) {
+            m_lights.Remove(entity);
+        } else {
+            m_lights.Insert(entity, StringTable::Intern(light));
+        }
+    }
+
+    bool IsActive(const EntityId entity) {
+        return m_active.Contains(entity);
+    }
+
+    static void RemoveFromSpatial(const EntityId entity) {
+        if (m_worldBounds.Remove(entity)) {
+            m_spatial.Remove(entity.GetIndex());
+        }
+    }
+
+    // the BVH only hears about bounds that changed
+    static void IndexBounds(const EntityId entity, const Aabb &bounds) {
+        if (Aabb *indexed = m_worldBounds.Get(entity)) {
+            if (indexed->min != bounds.min || indexed->max != bounds.max) {
+                *indexed = bounds;
+                m_spatial.Move(entity.GetIndex(), bounds);
+            }
+            return;
+        }
+
+        m_worldBounds.Insert(entity, bounds);
+        m_spatial.Insert(entity.GetIndex(), bounds);
+        if (entity.GetIndex() >= m_spatialIds.size()) {
+            m_spatialIds.resize(entity.GetIndex() + 1);
+        }
+        m_spatialIds[entity.GetIndex()] = entity;
+    }
+
+    void SetActive(const EntityId entity, const bool active) {
+        if (!IsValid(entity)) {
+            return;
+        }
+
+        if (active) {
+            m_active.Insert(entity, {});
+        } else {
+            m_active.Remove(entity);
+            RemoveFromSpatial(entity);
+        }
+
+        MarkChanged(entity);
+    }
+
+    bool IsStatic(const EntityId entity) {
+        return m_static.Contains(entity);
+    }
+
+    void SetStatic(const EntityId entity, const bool isStatic) {
+        if (!IsValid(entity) || isStatic == IsStatic(entity)) {
+            return;
+        }
+
+        if (isStatic) {
+            m_static.Insert(entity, {});
+            MarkChanged(entity);
+        } else {
+            m_static.Remove(entity);
+            m_changed.Remove(entity);
+            StaticGeometry::Remove(entity.GetIndex());
+        }
+    }
+
+    void MarkChanged(const EntityId entity) {
+        if (m_static.Contains(entity)) {
+            m_changed.Insert(entity, {});
+        }
+    }
+
+    void SetMesh(const EntityId entity, const MeshSystem::MeshHandle mesh) {
+        if (Render *render = m_renders.Get(entity)) {
+            MeshSystem::AddRef(mesh);
+            MeshSystem::RemoveRef(render->mesh);
+            render->mesh = mesh;
+            MarkChanged(entity);
+        }
+    }
+
+    void SetMaterial(const EntityId entity,
+                     const MaterialSystem::MaterialHandle material) {
+        if (Render *render = m_renders.Get(entity)) {
+            MaterialSystem::AddRef(material);
+            MaterialSystem::RemoveRef(render->material);
+            render->material = material;
+            MarkChanged(entity);
+        }
+    }
+
+    void SetTexture(const EntityId entity, const TextureSystem::TextureHandle texture) {
+        if (Render *render = m_renders.Get(entity)) {
+            TextureSystem::AddRef(texture);
+            TextureSystem::RemoveRef(render->texture);
+            render->texture = texture;
+            MarkChanged(entity);
+        }
+    }
+
+    bool SetParent(const EntityId entity, const EntityId parent) {
+        if (!IsValid(entity) || (parent && !IsValid(parent)) ||
+            !TransformSystem::SetParent(GetTransform(entity), GetTransform(parent))) {
+            return false;
+        }
+
+        if (parent) {
+            m_parents.Insert(entity, parent);
+        } else {
+            m_parents.Remove(entity);
+        }
+
+        MarkChanged(entity);
+
+        return true;
+    }
+
+    EntityId GetParent(const EntityId entity) {
+        const EntityId *parent = m_parents.Get(entity);
+        return parent ? *parent : EntityId{};
     }
 
-    const std::vector<Entity *> &GetAllEntities() {
-        return m_entityPtrs;
+    const std::vector<EntityId> &GetAllEntities() {
+        return m_transforms.GetIds();
     }
 
-    void DestroyEntity(const std::string &name) {
-        const auto it = m_entities.find(name);
-        if (it != m_entities.end()) {
-            if (const auto vecIt = std::ranges::find(m_entityPtrs, &it->second);
-                vecIt != m_entityPtrs.end()) {
-                m_entityPtrs.erase(vecIt);
+    // the resources stay loaded until ResourceManager::UnloadUnused
+    static void Release(Render &render) {
+        MeshSystem::RemoveRef(render.mesh);
+        MaterialSystem::RemoveRef(render.material);
+        TextureSystem::RemoveRef(render.texture);
+        render = {};
+    }
+
+    // everything but the parent links of the entity's children, see DetachOrphans
+    static bool Destroy(const EntityId entity) {
+        if (!m_entities.Remove(entity)) {
+            return false;
+        }
+
+        if (Render *render = m_renders.Get(entity)) {
+            Release(*render);
+        }
+
+        if (const std::string *name = m_names.Get(entity)) {
+            m_byName.erase(*name);
+        }
+
+        TransformSystem::DestroyTransform(GetTransform(entity));
+        RemoveFromSpatial(entity);
+        if (m_static.Remove(entity)) {
+            StaticGeometry::Remove(entity.GetIndex());
+        }
+
+        m_names.Remove(entity);
+        m_transforms.Remove(entity);
+        m_renders.Remove(entity);
+        m_lights.Remove(entity);
+        m_active.Remove(entity);
+        m_parents.Remove(entity);
+        m_changed.Remove(entity);
+
+        return true;
+    }
+
+    // the transform system has already made the children roots. Only parented
+    // entities are searched, none in a flat scene
+    static void DetachOrphans() {
+        for (size_t i = m_parents.Size(); i-- > 0;) {
+            if (!IsValid(m_parents.begin()[i])) {
+                m_parents.Remove(m_parents.GetId(i));
             }
+        }
+    }
 
-            m_entities.erase(it);
+    void DestroyEntity(const EntityId entity) {
+        if (Destroy(entity)) {
+            DetachOrphans();
         }
     }
 
+    void DestroyEntities(const std::span<const EntityId> entities) {
+        bool destroyed = false;
+        for (const EntityId entity : entities) {
+            destroyed |= Destroy(entity);
+        }
+
+        if (destroyed) {
+            DetachOrphans();
+        }
+    }
+
+    size_t DestroyEntitiesIf(const std::function<bool(EntityId)> &predicate) {
+        // collected first, destroying reorders the set being walked
+        std::vector<EntityId> entities;
+        for (const EntityId entity : m_transforms.GetIds()) {
+            if (predicate(entity)) {
+                entities.push_back(entity);
+            }
+        }
+
+        DestroyEntities(entities);
+
+        return entities.size();
+    }
+
+    static std::vector<EntityId> ToEntities(const std::vector<uint32_t> &items) {
+        std::vector<EntityId> entities;
+        entities.reserve(items.size());
+        for (const uint32_t item : items) {
+            entities.push_back(m_spatialIds[item]);
+        }
+
+        return entities;
+    }
+
+    std::vector<EntityId> QueryBox(const Aabb &box) {
+        std::vector<uint32_t> items;
+        m_spatial.QueryBox(box, items);
+        return ToEntities(items);
+    }
+
+    std::vector<EntityId> QuerySphere(const glm::vec3 &center, const float radius) {
+        std::vector<uint32_t> items;
+        m_spatial.QuerySphere(center, radius, items);
+        return ToEntities(items);
+    }
+
+    std::vector<EntityId> QueryFrustum(const Frustum &frustum) {
+        std::vector<uint32_t> items;
+        m_spatial.QueryFrustum(frustum, items);
+        return ToEntities(items);
+    }
+
+    RayHit Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                   const float maxDistance) {
+        // the world box of a rotated mesh is loose, the ray is tested again in
+        // the entity's space against the mesh's own box
+        const Bvh::RayHit hit = m_spatial.Raycast(
+            origin, direction, maxDistance, [&](const uint32_t item) {
+                const EntityId entity = m_spatialIds[item];
+                const Render *render = m_renders.Get(entity);
+                const MeshSystem::Mesh *mesh =
+                    render ? MeshSystem::Get(render->mesh) : nullptr;
+                if (!mesh) {
+                    return std::numeric_limits<float>::infinity();
+                }
+
+                const glm::mat4 toLocal = glm::inverse(
+                    TransformSystem::GetModelMatrix(GetTransform(entity)));
+                return RayEntry({mesh->minBounds, mesh->maxBounds},
+                                glm::vec3(toLocal * glm::vec4(origin, 1.0f)),
+                                glm::vec3(toLocal * glm::vec4(direction, 0.0f)));
+            });
+
+        if (hit.item == Bvh::None) {
+            return {};
+        }
+
+        return {m_spatialIds[hit.item], hit.distance};
+    }
+
+    Bvh::Stats GetSpatialStats() {
+        return m_spatial.GetStats();
+    }
+
+    StaticGeometry::Stats GetStaticStats() {
+        return StaticGeometry::GetStats();
+    }
+
     void SetSceneName(const std::string &name) {
         m_name = name;
     }
@@ -80,18 +466,139 @@ namespace SceneSystem {
         return m_name;
     }
 
-    void Update() {
-        for (const auto *entity : m_entityPtrs) {
-            if (entity->isActive) {
-                Renderer::SubmitInstanced(
-                    entity->mesh, entity->material, entity->texture,
-                    TransformSystem::GetModelMatrix(entity->transform), entity->color);
+    static Aabb GetWorldBounds(const MeshSystem::Mesh &mesh, const glm::mat4 &model) {
+        return TransformBounds({mesh.minBounds, mesh.maxBounds}, model);
+    }
+
+    // a static entity moves with its parent, so edits reach the static entities
+    // under a changed one too. Only parented entities are searched
+    static void MarkChangedDescendants() {
+        for (size_t i = 0; i < m_parents.Size(); i++) {
+            const EntityId entity = m_parents.GetId(i);
+            if (!m_static.Contains(entity) || m_changed.Contains(entity)) {
+                continue;
+            }
+
+            for (EntityId ancestor = m_parents.begin()[i]; ancestor;
+                 ancestor = GetParent(ancestor)) {
+                if (m_changed.Contains(ancestor)) {
+                    m_changed.Insert(entity, {});
+                    break;
+                }
+            }
+        }
+    }
+
+    static const MeshSystem::Mesh *GetMesh(const EntityId entity) {
+        const Render *render = m_renders.Get(entity);
+        return render ? MeshSystem::Get(render->mesh) : nullptr;
+    }
+
+    // places the static entities edited since the last Update in their chunks
+    // again, or takes out the ones that no longer draw
+    static void UpdateStatic() {
+        if (m_changed.Size() > 0) {
+            MarkChangedDescendants();
+        }
+
+        for (const EntityId entity : m_changed.GetIds()) {
+            const Render *render = m_renders.Get(entity);
+            const MeshSystem::Mesh *mesh = GetMesh(entity);
+            if (!mesh || !render->material || !render->texture ||
+                !m_active.Contains(entity)) {
+                StaticGeometry::Remove(entity.GetIndex());
+                RemoveFromSpatial(entity);
+                continue;
+            }
+
+            const glm::mat4 &model =
+                TransformSystem::GetModelMatrix(GetTransform(entity));
+            StaticGeometry::Insert(entity.GetIndex(),
+                                   {render->mesh, render->material, render->texture,
+                                    render->color, model});
+            IndexBounds(entity, GetWorldBounds(*mesh, model));
+        }
+        m_changed.Clear();
+
+        // a mesh that finished loading has new bounds as well as new vertices
+        std::vector<uint32_t> reloaded;
+        StaticGeometry::Update(reloaded);
+        for (const uint32_t item : reloaded) {
+            const EntityId entity = m_spatialIds[item];
+            const MeshSystem::Mesh *mesh = GetMesh(entity);
+            if (mesh && m_worldBounds.Contains(entity)) {
+                const glm::mat4 &model =
+                    TransformSystem::GetModelMatrix(GetTransform(entity));
+                IndexBounds(entity, GetWorldBounds(*mesh, model));
             }
         }
     }
 
+    void Update() {
+        TransformSystem::UpdateMatrices();
+
+        Query(
+            [](const EntityId entity, const Render &render, const Active &,
+               const TransformSystem::TransformHandle &transform) {
+                if (m_static.Contains(entity)) {
+                    return;
+                }
+
+                const glm::mat4 &model = TransformSystem::GetModelMatrix(transform);
+                Renderer::SubmitInstanced(render.mesh, render.material, render.texture,
+                                          model, render.color);
+
+                const MeshSystem::Mesh *mesh = MeshSystem::Get(render.mesh);
+                if (!mesh) {
+                    return;
+                }
+
+                const glm::vec3 &minBounds = mesh->minBounds;
+                const glm::vec3 &maxBounds = mesh->maxBounds;
+                const Aabb bounds = GetWorldBounds(*mesh, model);
+                IndexBounds(entity, bounds);
+
+                if (const TextureSystem::Texture *texture =
+                        TextureSystem::Get(render.texture)) {
+                    const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+                    const float scale = std::max({glm::length(glm::vec3(model[0])),
+                                                  glm::length(glm::vec3(model[1])),
+                                                  glm::length(glm::vec3(model[2]))});
+
+                    TextureStreaming::RequestLevel(
+                        texture, center,
+                        0.5f * glm::length(maxBounds - minBounds) * scale);
+                }
+            },
+            m_renders, m_active, m_transforms);
+
+        UpdateStatic();
+
+        m_spatial.Update();
+    }
+
     void CleanUp() {
-        m_entities.clear();
-        m_entityPtrs.clear();
+        for (Render &render : m_renders) {
+            Release(render);
+        }
+
+        for (const TransformSystem::TransformHandle transform : m_transforms) {
+            TransformSystem::DestroyTransform(transform);
+        }
+
+        m_entities.Clear();
+        m_names.Clear();
+        m_transforms.Clear();
+        m_renders.Clear();
+        m_lights.Clear();
+        m_active.Clear();
+        m_parents.Clear();
+        m_static.Clear();
+        m_changed.Clear();
+        m_byName.clear();
+        m_worldBounds.Clear();
+        m_spatial.Clear();
+        m_spatialIds.clear();
+        StaticGeometry::CleanUp();
     }
 }
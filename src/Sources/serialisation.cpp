@@ -1,14 +1,30 @@
 #include "serialisation.h"
 
+#include <chrono>
+#include <iomanip>
+#include <unordered_map>
+
 #include "camera_system.h"
 #include "light_system.h"
 #include "render_system.h"
 #include "resource_manager.h"
+#include "scene_file.h"
+#include "scene_loader.h"
 #include "scene_system.h"
 #include "transform_system.h"
 
 namespace Serialisation {
-    bool Serialise(const std::string &filename, const std::string &sceneName) {
+    // the scene file as last loaded or saved, what ApplyChanges diffs against
+    static std::string m_loadedFile;
+    static toml::table m_loadedScene;
+
+    void SetLoadedScene(const std::string &filename, toml::table scene) {
+        m_loadedFile = scene.empty() ? std::string() : EnsureTomlExtension(filename);
+        m_loadedScene = std::move(scene);
+    }
+
+    // the current scene as the document Serialise writes
+    static toml::table BuildScene(const std::string &sceneName) {
         toml::table scene;
         scene.insert("scene_name", sceneName);
 
@@ -21,15 +37,35 @@ namespace Serialisation {
         scene.insert("camera", camera);
 
         toml::array entities;
-        for (const auto *entity : SceneSystem::GetAllEntities()) {
+        for (const SceneSystem::EntityId entity : SceneSystem::GetAllEntities()) {
+            // unnamed entities are spawned at runtime and aren't part of the scene
+            const std::string name = SceneSystem::GetName(entity);
+            if (name.empty()) {
+                continue;
+            }
+
+            const SceneSystem::Render *render = SceneSystem::GetRender(entity);
+
             toml::table entityTable;
-            entityTable.insert("name", entity->name);
-            entityTable.insert("color", ToTomlArray(entity->color));
+            entityTable.insert("name", name);
+            if (const SceneSystem::EntityId parent = SceneSystem::GetParent(entity)) {
+                entityTable.insert("parent", SceneSystem::GetName(parent));
+            }
+            if (const LightSystem::Light *light = SceneSystem::GetLight(entity)) {
+                entityTable.insert("light", light->name);
+            }
+            if (SceneSystem::IsStatic(entity)) {
+                entityTable.insert("static", true);
+            }
+            entityTable.insert("color",
+                               ToTomlArray(render ? render->color : glm::vec4(1.0f)));
 
             toml::table transform;
-            glm::vec3 position = TransformSystem::GetPosition(entity->transform);
-            glm::vec3 scale = TransformSystem::GetScale(entity->transform);
-            glm::vec3 rotation = TransformSystem::GetRotation(entity->transform);
+            const TransformSystem::TransformHandle handle =
+                SceneSystem::GetTransform(entity);
+            glm::vec3 position = TransformSystem::GetPosition(handle);
+            glm::vec3 scale = TransformSystem::GetScale(handle);
+            glm::vec3 rotation = TransformSystem::GetRotation(handle);
 
             transform.insert("position", ToTomlArray(position));
             transform.insert("scale", ToTomlArray(scale));
@@ -37,41 +73,49 @@ namespace Serialisation {
 
             entityTable.insert("transform", transform);
 
-            if (entity->mesh) {
+            if (!render) {
+                entities.push_back(entityTable);
+                continue;
+            }
+
+            if (const auto *entityMesh = MeshSystem::Get(render->mesh)) {
                 toml::table mesh;
-                mesh.insert("name", entity->mesh->name);
-                mesh.insert("path", entity->mesh->path);
+                mesh.insert("name", MeshSystem::GetName(render->mesh));
+                mesh.insert("path", entityMesh->path);
 
                 entityTable.insert("mesh", mesh);
             }
 
-            if (entity->texture) {
+            if (const auto *entityTexture = TextureSystem::Get(render->texture)) {
                 toml::table texture;
-                texture.insert("name", entity->texture->name);
-                texture.insert("path", entity->texture->path);
+                texture.insert("name", TextureSystem::GetName(render->texture));
+                texture.insert("path", entityTexture->path);
 
                 entityTable.insert("texture", texture);
             }
 
-            if (entity->material) {
+            if (const auto *entityMaterial = MaterialSystem::Get(render->material)) {
                 toml::table material;
-                material.insert("name", entity->material->name);
+                material.insert("name", MaterialSystem::GetName(render->material));
 
-                if (entity->material->shader) {
+                if (const auto *entityShader =
+                        ShaderSystem::Get(entityMaterial->shader)) {
                     toml::table shader;
-                    shader.insert("name", entity->material->shader->name);
-                    shader.insert("fragment_path", entity->material->shader->fragPath);
-                    shader.insert("vertex_path", entity->material->shader->vertPath);
+                    shader.insert("name", ShaderSystem::GetName(entityMaterial->shader));
+                    shader.insert("fragment_path", entityShader->fragPath);
+                    shader.insert("vertex_path", entityShader->vertPath);
 
                     material.insert("shader", shader);
                 }
 
                 toml::table properties;
-                for (const auto &[name, prop] : entity->material->properties) {
+                for (const auto &[id, prop] : entityMaterial->properties) {
                     if (!prop.persistent) {
                         continue;
                     }
 
+                    const std::string &name = StringTable::GetString(id);
+
                     switch (prop.type) {
                         case MaterialSystem::Property::Type::Float:
                             properties.insert(name, std::any_cast<float>(prop.value));
@@ -123,7 +167,7 @@ namespace Serialisation {
                                           : "point");
             lightTable.insert("position", ToTomlArray(light->position));
             if (light->type == LightSystem::LightType::Directional) {
-                lightTable.insert("directional", ToTomlArray(light->direction));
+                lightTable.insert("direction", ToTomlArray(light->direction));
             }
             lightTable.insert("color", ToTomlArray(light->color));
             lightTable.insert("intensity", light->intensity);
@@ -132,83 +176,275 @@ namespace Serialisation {
         }
         scene.insert("light", lights);
 
-        return Write(scene, filename);
+        return scene;
     }
 
-    bool Deserialise(const std::string &filename) {
-        auto scene = Read(filename);
-        if (scene.empty()) {
-            ErrorHandler::Warn("Failed to load scene: " + filename, __FILE__, __func__,
-                               __LINE__);
+    bool Serialise(const std::string &filename, const std::string &sceneName) {
+        toml::table scene = BuildScene(sceneName);
+        if (!Write(scene, filename)) {
             return false;
         }
 
-        SceneSystem::CleanUp();
+        // the watcher sees this save too, there is nothing to apply from it
+        m_loadedFile = EnsureTomlExtension(filename);
+        m_loadedScene = std::move(scene);
+
+        return true;
+    }
+
+    bool SerialiseBinary(const std::string &filename, const std::string &sceneName) {
+        const std::string finalFilename = std::filesystem::path(filename)
+                                              .replace_extension(SceneFile::Extension)
+                                              .string();
 
-        if (scene.contains("scene_name") && scene["scene_name"].is_string()) {
-            const std::string sceneName =
-                scene["scene_name"].as_string()->value_or("Unnamed Scene");
-            SceneSystem::SetSceneName(sceneName);
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (!SceneFile::Write(SceneFile::FromToml(BuildScene(sceneName)),
+                              GetScenesPath() / finalFilename)) {
+            return false;
         }
 
-        DeserialiseLights(scene);
+        VirtualFileSystem::Refresh("Scenes/" + finalFilename);
 
-        return (DeserialiseCamera(scene) && DeserialiseEntities(scene));
+        const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::ostringstream message;
+        message << "Saved " << finalFilename << " in " << std::fixed
+                << std::setprecision(2)
+                << std::chrono::duration<float, std::milli>(elapsed).count() << " ms";
+        ErrorHandler::Info(message.str(), __FILE__, __func__, __LINE__);
+
+        return true;
     }
 
-    bool DeserialiseCamera(const toml::table &scene) {
-        if (!scene.contains("camera") || !scene["camera"].is_table()) {
-            return false;
+    bool Deserialise(const std::string &filename) {
+        return SceneLoader::Load(filename);
+    }
+
+    static std::unordered_map<std::string, const toml::table *> GetEntityTables(
+        const toml::table &scene) {
+        std::unordered_map<std::string, const toml::table *> tables;
+        if (!scene.contains("entity") || !scene["entity"].is_array()) {
+            return tables;
+        }
+
+        for (const auto &entities = *scene["entity"].as_array();
+             auto &entityValue : entities) {
+            if (const auto *entityTable = entityValue.as_table()) {
+                tables[(*entityTable)["name"].value_or(std::string())] = entityTable;
+            }
         }
 
-        auto &cameraTable = *scene["camera"].as_table();
-        const std::string cameraName = cameraTable["name"].as_string()->get();
+        return tables;
+    }
 
-        auto *camera = CameraSystem::CreateCamera(cameraName);
-        CameraSystem::SetMainCamera(camera);
+    // scenes saved before the link was stored name the visual after the light
+    static std::string GetLightName(const toml::table &entityTable) {
+        if (const auto light = entityTable["light"].value<std::string>()) {
+            return *light;
+        }
 
-        RenderSystem::UpdateProjection();
+        const std::string name = entityTable["name"].value_or(std::string());
+        const std::string_view suffix = "_visual";
+        if (!name.ends_with(suffix)) {
+            return {};
+        }
 
-        camera->position = ToVec3(*cameraTable["position"].as_array());
-        camera->up = ToVec3(*cameraTable["up"].as_array());
+        const std::string light = name.substr(0, name.size() - suffix.size());
+        return LightSystem::GetLight(light) ? light : std::string();
+    }
+
+    static bool Differs(const toml::table &a, const toml::table &b,
+                        const std::string_view key) {
+        const toml::node *nodeA = a.get(key);
+        const toml::node *nodeB = b.get(key);
+        if (!nodeA || !nodeB) {
+            return nodeA != nodeB;
+        }
+
+        // every section of a scene file is either a table or an array of them
+        if (nodeA->is_table() && nodeB->is_table()) {
+            return *nodeA->as_table() != *nodeB->as_table();
+        }
+
+        if (nodeA->is_array() && nodeB->is_array()) {
+            return *nodeA->as_array() != *nodeB->as_array();
+        }
 
         return true;
     }
 
-    bool DeserialiseEntities(const toml::table &scene) {
-        if (!scene.contains("entity") || !scene["entity"].is_array()) {
+    // moves the camera in place, a renamed one becomes the main camera
+    static void ApplyCamera(const toml::table &cameraTable) {
+        const std::string cameraName = cameraTable["name"].value_or(std::string());
+
+        auto *camera = CameraSystem::GetCamera(cameraName);
+        if (!camera) {
+            camera = CameraSystem::CreateCamera(cameraName);
+            CameraSystem::SetMainCamera(camera);
+            RenderSystem::UpdateProjection();
+        }
+
+        camera->position = ToVec3(*cameraTable["position"].as_array());
+        camera->up = ToVec3(*cameraTable["up"].as_array());
+    }
+
+    bool ApplyChanges(const std::string &filename) {
+        if (EnsureTomlExtension(filename) != m_loadedFile) {
             return false;
         }
 
-        for (const auto &entities = *scene["entity"].as_array();
-             auto &entityValue : entities) {
-            auto &entityTable = *entityValue.as_table();
+        const auto start = std::chrono::high_resolution_clock::now();
 
-            std::string name = entityTable["name"].as_string()->get();
-            glm::vec4 color = ToVec4(*entityTable["color"].as_array());
+        toml::table scene = Read(filename);
+        if (scene.empty()) {
+            return false;
+        }
 
-            const auto *entity = SceneSystem::CreateEntity(name, color);
+        const auto oldEntities = GetEntityTables(m_loadedScene);
+        const auto newEntities = GetEntityTables(scene);
 
-            if (entityTable.contains("transform")) {
-                DeserialiseTransform(entity, *entityTable["transform"].as_table());
+        size_t removed = 0;
+        for (const auto &[name, table] : oldEntities) {
+            if (!newEntities.contains(name)) {
+                SceneSystem::DestroyEntity(SceneSystem::Find(name));
+                removed++;
             }
+        }
 
-            if (entityTable.contains("mesh")) {
-                DeserialiseMesh(entity, *entityTable["mesh"].as_table());
+        size_t created = 0;
+        size_t changed = 0;
+        for (const auto &[name, table] : newEntities) {
+            const auto old = oldEntities.find(name);
+            const SceneSystem::EntityId entity = SceneSystem::Find(name);
+            if (old == oldEntities.end() || !entity) {
+                DeserialiseEntity(*table);
+                created++;
+                continue;
             }
 
-            if (entityTable.contains("texture")) {
-                DeserialiseTexture(entity, *entityTable["texture"].as_table());
+            if (*old->second == *table) {
+                continue;
+            }
+
+            // only the sections that changed are applied, the entity keeps the rest
+            const auto changedSection = [&](const std::string_view key) {
+                return Differs(*old->second, *table, key) ? (*table)[key].as_table()
+                                                           : nullptr;
+            };
+
+            if (Differs(*old->second, *table, "color") && table->contains("color")) {
+                if (SceneSystem::Render *render = SceneSystem::GetRender(entity)) {
+                    render->color = ToVec4(*(*table)["color"].as_array());
+                    SceneSystem::MarkChanged(entity);
+                }
+            }
+
+            SceneSystem::SetLight(entity, GetLightName(*table));
+            SceneSystem::SetStatic(entity, (*table)["static"].value_or(false));
+
+            if (const auto *transform = changedSection("transform")) {
+                DeserialiseTransform(entity, *transform);
             }
 
-            if (entityTable.contains("material")) {
-                DeserialiseMaterial(entity, *entityTable["material"].as_table());
+            if (const auto *mesh = changedSection("mesh")) {
+                DeserialiseMesh(entity, *mesh);
             }
+
+            if (const auto *texture = changedSection("texture")) {
+                DeserialiseTexture(entity, *texture);
+            }
+
+            if (const auto *material = changedSection("material")) {
+                DeserialiseMaterial(entity, *material);
+            }
+
+            changed++;
+        }
+
+        // also re-parents the children of entities that were just recreated
+        for (const auto &[name, table] : newEntities) {
+            if (const SceneSystem::EntityId entity = SceneSystem::Find(name)) {
+                DeserialiseParent(entity, *table);
+            }
+        }
+
+        if (Differs(m_loadedScene, scene, "light")) {
+            LightSystem::CleanUp();
+            DeserialiseLights(scene);
         }
 
+        if (Differs(m_loadedScene, scene, "camera") && scene["camera"].is_table()) {
+            ApplyCamera(*scene["camera"].as_table());
+        }
+
+        if (removed + changed > 0) {
+            ResourceManager::UnloadUnused();
+        }
+        if (created + changed > 0) {
+            ResourceManager::Canonicalise();
+        }
+
+        m_loadedScene = std::move(scene);
+
+        const float elapsedMs = std::chrono::duration<float, std::milli>(
+                                    std::chrono::high_resolution_clock::now() - start)
+                                    .count();
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(3) << "Applied changes to "
+               << m_loadedFile << ": " << created << " created, " << changed
+               << " changed, " << removed << " removed in " << elapsedMs << " ms";
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+
         return true;
     }
 
+    SceneSystem::EntityId DeserialiseEntity(const toml::table &entityTable) {
+        std::string name = entityTable["name"].as_string()->get();
+        glm::vec4 color = ToVec4(*entityTable["color"].as_array());
+
+        const SceneSystem::EntityId entity = SceneSystem::CreateEntity(name, color);
+        if (!entity) {
+            return {};
+        }
+
+        SceneSystem::SetLight(entity, GetLightName(entityTable));
+        SceneSystem::SetStatic(entity, entityTable["static"].value_or(false));
+
+        if (entityTable.contains("transform")) {
+            DeserialiseTransform(entity, *entityTable["transform"].as_table());
+        }
+
+        if (entityTable.contains("mesh")) {
+            DeserialiseMesh(entity, *entityTable["mesh"].as_table());
+        }
+
+        if (entityTable.contains("texture")) {
+            DeserialiseTexture(entity, *entityTable["texture"].as_table());
+        }
+
+        if (entityTable.contains("material")) {
+            DeserialiseMaterial(entity, *entityTable["material"].as_table());
+        }
+
+        return entity;
+    }
+
+    void DeserialiseParent(const SceneSystem::EntityId entity,
+                           const toml::table &entityTable) {
+        const std::string parent = entityTable["parent"].value_or(std::string());
+        if (parent.empty()) {
+            SceneSystem::SetParent(entity, {});
+            return;
+        }
+
+        if (const SceneSystem::EntityId parentEntity = SceneSystem::Find(parent);
+            !parentEntity || !SceneSystem::SetParent(entity, parentEntity)) {
+            ErrorHandler::Warn(
+                "Failed to parent " + SceneSystem::GetName(entity) + " to " + parent,
+                __FILE__, __func__, __LINE__);
+        }
+    }
+
     void DeserialiseLights(const toml::table &scene) {
         if (!scene.contains("light") || !scene["light"].is_array()) {
             return;
@@ -237,43 +473,50 @@ namespace Serialisation {
         }
     }
 
-    void DeserialiseTransform(const SceneSystem::Entity *entity,
+    void DeserialiseTransform(const SceneSystem::EntityId entity,
                               const toml::table &transformTable) {
+        const TransformSystem::TransformHandle transform =
+            SceneSystem::GetTransform(entity);
+
         const auto position = ToVec3(*transformTable["position"].as_array());
-        TransformSystem::SetPosition(entity->transform, position);
+        TransformSystem::SetPosition(transform, position);
 
         const auto scale = ToVec3(*transformTable["scale"].as_array());
-        TransformSystem::SetScale(entity->transform, scale);
+        TransformSystem::SetScale(transform, scale);
 
         const auto rotation = ToVec3(*transformTable["rotation"].as_array());
-        TransformSystem::SetRotation(entity->transform, rotation);
+        TransformSystem::SetRotation(transform, rotation);
+
+        SceneSystem::MarkChanged(entity);
     }
 
-    void DeserialiseMesh(const SceneSystem::Entity *entity,
+    void DeserialiseMesh(const SceneSystem::EntityId entity,
                          const toml::table &meshTable) {
         const std::string meshName = meshTable["name"].as_string()->get();
         const std::string meshPath = meshTable["path"].as_string()->get();
 
-        if (auto *existingMesh = MeshSystem::GetMesh(meshName)) {
-            entity->mesh = existingMesh;
+        if (const MeshSystem::MeshHandle existingMesh = MeshSystem::Find(meshName)) {
+            SceneSystem::SetMesh(entity, existingMesh);
         } else {
-            entity->mesh = ResourceManager::LoadMesh(meshName, meshPath);
+            SceneSystem::SetMesh(entity, ResourceManager::LoadMesh(meshName, meshPath));
         }
     }
 
-    void DeserialiseTexture(const SceneSystem::Entity *entity,
+    void DeserialiseTexture(const SceneSystem::EntityId entity,
                             const toml::table &textureTable) {
         const std::string textureName = textureTable["name"].as_string()->get();
         const std::string texturePath = textureTable["path"].as_string()->get();
 
-        if (auto *existingTexture = TextureSystem::GetTexture(textureName)) {
-            entity->texture = existingTexture;
+        if (const TextureSystem::TextureHandle existingTexture =
+                TextureSystem::Find(textureName)) {
+            SceneSystem::SetTexture(entity, existingTexture);
         } else {
-            entity->texture = ResourceManager::LoadTexture(textureName, texturePath);
+            SceneSystem::SetTexture(
+                entity, ResourceManager::LoadTexture(textureName, texturePath));
         }
     }
 
-    void DeserialiseMaterial(const SceneSystem::Entity *entity,
+    void DeserialiseMaterial(const SceneSystem::EntityId entity,
                              const toml::table &materialTable) {
         const std::string materialName = materialTable["name"].as_string()->get();
 
@@ -283,7 +526,7 @@ namespace Serialisation {
             auto &shaderTable = *materialTable["shader"].as_table();
             shaderName = shaderTable["name"].as_string()->get();
 
-            if (!ShaderSystem::GetShader(shaderName)) {
+            if (!ShaderSystem::Find(shaderName)) {
                 const std::string vertPath =
                     shaderTable["vertex_path"].as_string()->get();
                 const std::string fragPath =
@@ -293,16 +536,17 @@ namespace Serialisation {
             }
         }
 
-        MaterialSystem::Material *material = nullptr;
-        if (auto *existingMaterial = MaterialSystem::GetMaterial(materialName)) {
-            entity->material = existingMaterial;
-            material = existingMaterial;
+        if (const MaterialSystem::MaterialHandle existingMaterial =
+                MaterialSystem::Find(materialName)) {
+            SceneSystem::SetMaterial(entity, existingMaterial);
         } else {
-            material = MaterialSystem::CreateMaterial(materialName, shaderName);
-            entity->material = material;
+            SceneSystem::SetMaterial(
+                entity, MaterialSystem::CreateMaterial(materialName, shaderName));
         }
 
-        if (materialTable.contains("properties")) {
+        const SceneSystem::Render *render = SceneSystem::GetRender(entity);
+        if (auto *material = render ? MaterialSystem::Get(render->material) : nullptr;
+            material && materialTable.contains("properties")) {
             DeserialiseMaterialProperties(material,
                                           *materialTable["properties"].as_table());
         }
@@ -311,7 +555,7 @@ namespace Serialisation {
     void DeserialiseMaterialProperties(MaterialSystem::Material *material,
                                        const toml::table &propertiesTable) {
         for (auto &[propKey, propValue] : propertiesTable) {
-            std::string propName(propKey.str());
+            const StringId propName = StringTable::Intern(propKey.str());
 
             if (propValue.is_floating_point()) {
                 const auto value =
@@ -364,16 +608,19 @@ namespace Serialisation {
 
     toml::table Read(const std::string &filename) {
         const std::string finalFilename = EnsureTomlExtension(filename);
-        const std::filesystem::path filePath = GetScenesPath() / finalFilename;
+        const std::string scenePath = "Scenes/" + finalFilename;
 
         try {
-            if (!std::filesystem::exists(filePath)) {
+            const FileView file = VirtualFileSystem::Map(scenePath);
+            if (!file) {
                 ErrorHandler::Warn("Scene file does not exist: " + finalFilename,
                                    __FILE__, __func__, __LINE__);
                 return {};
             }
 
-            return toml::parse_file(filePath.string());
+            const std::string_view document(reinterpret_cast<const char *>(file.Data()),
+                                            file.Size());
+            return toml::parse(document, scenePath);
         } catch (const toml::parse_error &err) {
             ErrorHandler::Warn("Error parsing TOML: " + std::string(err.what()), __FILE__,
                                __func__, __LINE__);
@@ -398,6 +645,8 @@ namespace Serialisation {
         file << data;
         file.close();
 
+        VirtualFileSystem::Refresh("Scenes/" + finalFilename);
+
         return true;
     }
 }
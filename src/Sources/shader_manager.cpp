@@ -1,39 +1,25 @@
 #include "shader_manager.h"
 
-#include <filesystem>
-#include <fstream>
 #include <unordered_map>
+#include <vector>
+
+#include "virtual_file_system.h"
 
 namespace ShaderManager {
-    std::unordered_map<ShaderType, unsigned int> m_shaders;
     std::unordered_map<std::string, unsigned int> m_programs;
 
     static GLuint LoadShader(ShaderType type, const std::string &path) {
-        std::string code;
-
-        try {
-            std::ifstream file;
-
-            file.open(path);
-            if (!file.is_open()) {
-                ErrorHandler::Warn("Could not open shader file: " + path, __FILE__,
-                                   __func__, __LINE__);
-                return 0;
-            }
-
-            std::stringstream shaderStream;
-            shaderStream << file.rdbuf();
-            file.close();
-            code = shaderStream.str();
-        } catch (std::ifstream::failure & /*e*/) {
-            ErrorHandler::Warn("Shader file not successfully read: " + path, __FILE__,
-                               __func__, __LINE__);
+        std::vector<uint8_t> code;
+        if (!VirtualFileSystem::Read(path, code)) {
+            ErrorHandler::Warn("Could not open shader file: " + path, __FILE__, __func__,
+                               __LINE__);
             return 0;
         }
 
-        const char *shaderCode = code.c_str();
+        const auto *shaderCode = reinterpret_cast<const char *>(code.data());
+        const auto codeLength = static_cast<GLint>(code.size());
         GLuint shaderId = glCreateShader(ShaderTypeToGL(type));
-        glShaderSource(shaderId, 1, &shaderCode, nullptr);
+        glShaderSource(shaderId, 1, &shaderCode, &codeLength);
         glCompileShader(shaderId);
 
         int success;
@@ -47,33 +33,17 @@ namespace ShaderManager {
                                      __FILE__, __func__, __LINE__);
         }
 
-        m_shaders[type] = shaderId;
         return shaderId;
     }
 
-    static std::string GetShaderPath(const std::string &filename) {
-        std::filesystem::path paths[] = {"src/Shaders", "../src/Shaders",
-                                         "../../src/Shaders", "gl-gfx/src/Shaders"};
-
-        for (const auto &basePath : paths) {
-            if (std::filesystem::path fullPath = basePath / filename; exists(fullPath)) {
-                return fullPath.string();
-            }
-        }
-
-        return filename;
-    }
-
     GLuint CreateProgram(const std::string &vPath, const std::string &fPath) {
-        const std::filesystem::path vertexFile = std::filesystem::path(vPath).filename();
-        const std::filesystem::path fragmentFile =
-            std::filesystem::path(fPath).filename();
-
         const GLuint vertexShader =
-            LoadShader(VERTEX, GetShaderPath(vertexFile.string()));
+            LoadShader(VERTEX, VirtualFileSystem::FindAsset("Shaders", vPath));
         const GLuint fragmentShader =
-            LoadShader(FRAGMENT, GetShaderPath(fragmentFile.string()));
+            LoadShader(FRAGMENT, VirtualFileSystem::FindAsset("Shaders", fPath));
         if (!vertexShader || !fragmentShader) {
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
             return 0;
         }
 
@@ -91,8 +61,11 @@ namespace ShaderManager {
                                      __FILE__, __func__, __LINE__);
         }
 
+        // the linked program keeps its own copy, the stages are not needed again
         glDetachShader(program, vertexShader);
         glDetachShader(program, fragmentShader);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
 
         const std::string key = vPath + "_" + fPath;
         m_programs[key] = program;
@@ -100,16 +73,17 @@ namespace ShaderManager {
         return program;
     }
 
-    void CleanUp() {
-        for (const auto &[_, shader] : m_shaders) {
-            glDeleteShader(shader);
-        }
+    void DeleteProgram(const GLuint program) {
+        std::erase_if(m_programs,
+                      [program](const auto &entry) { return entry.second == program; });
+        glDeleteProgram(program);
+    }
 
+    void CleanUp() {
         for (const auto &[_, program] : m_programs) {
             glDeleteProgram(program);
         }
 
-        m_shaders.clear();
         m_programs.clear();
     }
 }
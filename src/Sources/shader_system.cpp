@@ -1,38 +1,149 @@
 #include "shader_system.h"
 
+#include <vector>
+
+#include "release_queue.h"
 #include "shader_manager.h"
 
 namespace ShaderSystem {
-    static std::unordered_map<std::string, Shader> m_shaders;
-    static std::unordered_map<std::string, GLint> m_uniformLocations;
+    static SlotMap<Shader> m_shaders;
+    static NameIndex<Shader> m_names;
+    static RefCounts<Shader> m_refCounts;
+    // keyed by program in the high bits and uniform id in the low bits
+    static std::unordered_map<uint64_t, GLint> m_uniformLocations;
 
     void Init() {
-        m_shaders.clear();
+        m_shaders.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
         m_uniformLocations.clear();
     }
 
-    Shader *CreateShader(const std::string &name, const std::string &vertPath,
-                         const std::string &fragPath) {
+    static uint64_t GetUniformKey(const GLuint program, const StringId name) {
+        return static_cast<uint64_t>(program) << 32 | name.value;
+    }
+
+    static void CacheUniformLocation(const GLuint program, const std::string &name) {
+        m_uniformLocations[GetUniformKey(program, StringTable::Intern(name))] =
+            glGetUniformLocation(program, name.c_str());
+    }
+
+    // arrays are reported once by their first element, each element and the bare
+    // name get an entry. Members of arrays of structs are reported one by one
+    static void CacheUniformLocations(const GLuint program) {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<char> buffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, static_cast<GLuint>(i),
+                               static_cast<GLsizei>(buffer.size()), &length, &size, &type,
+                               buffer.data());
+
+            std::string name(buffer.data(), length);
+            if (name.ends_with("[0]")) {
+                name.resize(name.size() - 3);
+                for (GLint element = 0; element < size; element++) {
+                    CacheUniformLocation(program,
+                                         name + "[" + std::to_string(element) + "]");
+                }
+            }
+
+            CacheUniformLocation(program, name);
+        }
+    }
+
+    ShaderHandle CreateShader(const std::string &name, const std::string &vertPath,
+                              const std::string &fragPath) {
         Shader shader{
             .programId = ShaderManager::CreateProgram(vertPath, fragPath),
             .vertPath = vertPath,
             .fragPath = fragPath,
-            .name = name,
             .isValid = false,
         };
 
         shader.isValid = (shader.programId != 0);
-        if (shader.isValid) {
-            m_shaders[name] = shader;
-            return &m_shaders[name];
+        if (!shader.isValid) {
+            return {};
+        }
+
+        CacheUniformLocations(shader.programId);
+
+        const ShaderHandle handle = m_shaders.Insert(std::move(shader));
+        m_names.Add(name, handle);
+
+        return handle;
+    }
+
+    Shader *Get(const ShaderHandle handle) {
+        return m_shaders.Get(handle);
+    }
+
+    ShaderHandle Find(const std::string &name) {
+        return m_names.Find(name);
+    }
+
+    std::string GetName(const ShaderHandle handle) {
+        return m_names.GetName(handle);
+    }
+
+    void Destroy(const ShaderHandle handle) {
+        const Shader *shader = m_shaders.Get(handle);
+        if (!shader) {
+            return;
         }
 
-        return nullptr;
+        // program names are reused by GL, so cached locations must not outlive it
+        std::erase_if(m_uniformLocations, [shader](const auto &entry) {
+            return entry.first >> 32 == shader->programId;
+        });
+        ShaderManager::DeleteProgram(shader->programId);
+
+        m_names.Remove(handle);
+        m_refCounts.Erase(handle);
+        m_shaders.Remove(handle);
+    }
+
+    void AddRef(const ShaderHandle handle) {
+        if (m_shaders.Contains(handle)) {
+            m_refCounts.Add(handle);
+        }
+    }
+
+    void RemoveRef(const ShaderHandle handle) {
+        m_refCounts.Remove(handle);
     }
 
-    Shader *GetShader(const std::string &name) {
-        const auto it = m_shaders.find(name);
-        return (it != m_shaders.end()) ? &it->second : nullptr;
+    uint32_t GetRefCount(const ShaderHandle handle) {
+        return m_refCounts.Get(handle);
+    }
+
+    size_t GetCount() {
+        return m_shaders.Size();
+    }
+
+    size_t UnloadUnused() {
+        size_t queued = 0;
+        for (size_t i = 0; i < m_shaders.Size(); i++) {
+            const ShaderHandle handle = m_shaders.GetHandle(i);
+            if (m_refCounts.Get(handle) > 0) {
+                continue;
+            }
+
+            ReleaseQueue::Enqueue([handle] {
+                if (m_refCounts.Get(handle) == 0) {
+                    Destroy(handle);
+                }
+            });
+            queued++;
+        }
+
+        return queued;
     }
 
     void Bind(const Shader *shader) {
@@ -45,62 +156,62 @@ namespace ShaderSystem {
         glUseProgram(0);
     }
 
-    static GLint GetUniformLocation(const Shader *shader, const std::string &name) {
-        const std::string key = std::to_string(shader->programId) + "_" + name;
+    // a uniform the program doesn't use is reported once, then cached as missing
+    static GLint GetUniformLocation(const Shader *shader, const StringId name) {
+        const uint64_t key = GetUniformKey(shader->programId, name);
         if (const auto it = m_uniformLocations.find(key);
             it != m_uniformLocations.end()) {
             return it->second;
         }
 
-        const GLint location = glGetUniformLocation(shader->programId, name.c_str());
-        if (location == -1) {
-            ErrorHandler::Warn("Uniform '" + name + "' not found in shader program",
-                               __FILE__, __func__, __LINE__);
-        }
-
-        m_uniformLocations[key] = location;
+        ErrorHandler::Warn("Uniform '" + StringTable::GetString(name) +
+                               "' not found in shader program",
+                           __FILE__, __func__, __LINE__);
+        m_uniformLocations[key] = -1;
 
-        return location;
+        return -1;
     }
 
-    void SetFloat(const Shader *shader, const std::string &name, const float value) {
+    void SetFloat(const Shader *shader, const StringId name, const float value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniform1f(location, value);
         }
     }
 
-    void SetInt(const Shader *shader, const std::string &name, const int value) {
+    void SetInt(const Shader *shader, const StringId name, const int value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniform1i(location, value);
         }
     }
 
-    void SetVec2(const Shader *shader, const std::string &name, const glm::vec2 &value) {
+    void SetVec2(const Shader *shader, const StringId name, const glm::vec2 &value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniform2fv(location, 1, glm::value_ptr(value));
         }
     }
 
-    void SetVec3(const Shader *shader, const std::string &name, const glm::vec3 &value) {
+    void SetVec3(const Shader *shader, const StringId name, const glm::vec3 &value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniform3fv(location, 1, glm::value_ptr(value));
         }
     }
 
-    void SetVec4(const Shader *shader, const std::string &name, const glm::vec4 &value) {
+    void SetVec4(const Shader *shader, const StringId name, const glm::vec4 &value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniform4fv(location, 1, glm::value_ptr(value));
         }
     }
 
-    void SetMat4(const Shader *shader, const std::string &name, const glm::mat4 &value) {
+    void SetMat4(const Shader *shader, const StringId name, const glm::mat4 &value) {
         if (const GLint location = GetUniformLocation(shader, name); location != -1) {
             glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
         }
     }
 
     void CleanUp() {
-        m_shaders.clear();
+        m_shaders.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
         m_uniformLocations.clear();
 
         ShaderManager::CleanUp();
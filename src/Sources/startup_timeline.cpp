@@ -0,0 +1,112 @@
+#include "startup_timeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+namespace StartupTimeline {
+    static constexpr size_t m_milestoneCount =
+        static_cast<size_t>(StartupMilestone::Count);
+
+    static std::mutex m_mutex;
+    static Clock::time_point m_begin = Clock::now();
+    static std::thread::id m_mainThread;
+    static Timeline m_timeline = [] {
+        Timeline timeline{};
+        std::fill_n(timeline.milestones, m_milestoneCount, -1.0f);
+        return timeline;
+    }();
+
+    static float ToMs(const Clock::time_point time) {
+        return std::chrono::duration<float, std::milli>(time - m_begin).count();
+    }
+
+    void Begin() {
+        std::lock_guard lock(m_mutex);
+
+        m_begin = Clock::now();
+        m_mainThread = std::this_thread::get_id();
+        m_timeline.spans.clear();
+        std::fill_n(m_timeline.milestones, m_milestoneCount, -1.0f);
+    }
+
+    void AddSpan(const std::string &name, const Clock::time_point start,
+                 const Clock::time_point end) {
+        std::lock_guard lock(m_mutex);
+
+        m_timeline.spans.push_back({name, ToMs(start), ToMs(end) - ToMs(start),
+                                    std::this_thread::get_id() == m_mainThread});
+    }
+
+    void Mark(const StartupMilestone milestone) {
+        const Clock::time_point now = Clock::now();
+
+        std::lock_guard lock(m_mutex);
+
+        float &time = m_timeline.milestones[static_cast<size_t>(milestone)];
+        if (time < 0.0f) {
+            time = ToMs(now);
+        }
+    }
+
+    bool IsReached(const StartupMilestone milestone) {
+        std::lock_guard lock(m_mutex);
+        return m_timeline.milestones[static_cast<size_t>(milestone)] >= 0.0f;
+    }
+
+    Timeline GetTimeline() {
+        std::lock_guard lock(m_mutex);
+        return m_timeline;
+    }
+
+    void Report() {
+        Timeline timeline = GetTimeline();
+        std::ranges::sort(timeline.spans, {}, &Span::startMs);
+
+        size_t nameWidth = 0;
+        for (size_t i = 0; i < m_milestoneCount; i++) {
+            const char *name = GetName(static_cast<StartupMilestone>(i));
+            nameWidth = std::max(nameWidth, std::strlen(name));
+        }
+        for (const Span &span : timeline.spans) {
+            nameWidth = std::max(nameWidth, span.name.size());
+        }
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(1) << "Startup timeline:";
+        for (size_t i = 0; i < m_milestoneCount; i++) {
+            const auto milestone = static_cast<StartupMilestone>(i);
+            report << "\n  " << std::left << std::setw(static_cast<int>(nameWidth))
+                   << GetName(milestone) << std::right;
+            if (timeline.milestones[i] < 0.0f) {
+                report << "  not reached";
+            } else {
+                report << std::setw(9) << timeline.milestones[i] << " ms";
+            }
+        }
+
+        for (const Span &span : timeline.spans) {
+            report << "\n  " << std::left << std::setw(static_cast<int>(nameWidth))
+                   << span.name << std::right << std::setw(9) << span.startMs
+                   << " ms +" << std::setw(8) << span.durationMs << " ms"
+                   << (span.mainThread ? "" : "  (worker)");
+        }
+
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+    }
+
+    const char *GetName(const StartupMilestone milestone) {
+        switch (milestone) {
+            case StartupMilestone::Window:
+                return "Window";
+            case StartupMilestone::FirstFrame:
+                return "First Frame";
+            case StartupMilestone::SceneReady:
+                return "Scene Ready";
+            default:
+                return "Unknown";
+        }
+    }
+}
@@ -0,0 +1,294 @@
+#include "static_geometry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include "hash.h"
+#include "release_queue.h"
+#include "renderer.h"
+#include "texture_streaming.h"
+
+namespace StaticGeometry {
+    // side of the grid cells chunks are split by, in world units. Smaller cells
+    // cull tighter but draw more calls
+    static constexpr float m_cellSize = 32.0f;
+
+    static constexpr uint32_t m_none = UINT32_MAX;
+
+    struct ChunkKey {
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
+        glm::vec4 color;
+        glm::ivec3 cell;
+
+        bool operator==(const ChunkKey &other) const {
+            return material == other.material && texture == other.texture &&
+                   color == other.color && cell == other.cell;
+        }
+    };
+
+    struct ChunkKeyHash {
+        size_t operator()(const ChunkKey &key) const {
+            uint64_t hash = Hash::Fnv1a(&key.material.value, sizeof(uint32_t));
+            hash = Hash::Fnv1a(&key.texture.value, sizeof(uint32_t), hash);
+            hash = Hash::Fnv1a(&key.color, sizeof(glm::vec4), hash);
+            return Hash::Fnv1a(&key.cell, sizeof(glm::ivec3), hash);
+        }
+    };
+
+    // a source mesh and the vertex buffer it had when the chunk was baked
+    struct Source {
+        MeshSystem::MeshHandle mesh;
+        GLuint vbo;
+    };
+
+    struct Chunk {
+        ChunkKey key;
+        std::vector<uint32_t> items;
+        MeshSystem::MeshHandle baked;
+        Aabb bounds;
+        std::vector<Source> sources;
+        size_t bytes = 0;
+        bool dirty = false;
+    };
+
+    struct Placement {
+        Piece piece;
+        uint32_t chunk = m_none;
+        // position in the chunk's items
+        uint32_t slot = 0;
+    };
+
+    // chunks are kept when they empty, the same key filling again reuses them
+    static std::vector<Chunk> m_chunks;
+    static std::unordered_map<ChunkKey, uint32_t, ChunkKeyHash> m_chunkIndex;
+    static std::vector<uint32_t> m_dirtyChunks;
+    static std::vector<Placement> m_placements;
+    static uint32_t m_pieceCount = 0;
+    static uint32_t m_bakes = 0;
+    static float m_lastBakeMs = 0.0f;
+
+    void Init() {
+        CleanUp();
+    }
+
+    static void MarkDirty(const uint32_t chunk) {
+        if (!m_chunks[chunk].dirty) {
+            m_chunks[chunk].dirty = true;
+            m_dirtyChunks.push_back(chunk);
+        }
+    }
+
+    // the cell holding the centre of the piece's world bounds
+    static glm::ivec3 GetCell(const Piece &piece) {
+        const MeshSystem::Mesh *mesh = MeshSystem::Get(piece.mesh);
+        const glm::vec3 local =
+            mesh ? (mesh->minBounds + mesh->maxBounds) * 0.5f : glm::vec3(0.0f);
+        const glm::vec3 center = glm::vec3(piece.modelMatrix * glm::vec4(local, 1.0f));
+
+        return glm::ivec3(glm::floor(center / m_cellSize));
+    }
+
+    void Insert(const uint32_t item, const Piece &piece) {
+        Remove(item);
+
+        if (item >= m_placements.size()) {
+            m_placements.resize(item + 1);
+        }
+
+        const ChunkKey key{piece.material, piece.texture, piece.color, GetCell(piece)};
+        const auto [it, added] =
+            m_chunkIndex.try_emplace(key, static_cast<uint32_t>(m_chunks.size()));
+        if (added) {
+            m_chunks.emplace_back().key = key;
+        }
+
+        Chunk &chunk = m_chunks[it->second];
+        m_placements[item] = {piece, it->second,
+                              static_cast<uint32_t>(chunk.items.size())};
+        chunk.items.push_back(item);
+        MarkDirty(it->second);
+        m_pieceCount++;
+    }
+
+    void Remove(const uint32_t item) {
+        if (!Contains(item)) {
+            return;
+        }
+
+        Placement &placement = m_placements[item];
+        Chunk &chunk = m_chunks[placement.chunk];
+
+        const uint32_t last = chunk.items.back();
+        chunk.items[placement.slot] = last;
+        m_placements[last].slot = placement.slot;
+        chunk.items.pop_back();
+
+        MarkDirty(placement.chunk);
+        placement = {};
+        m_pieceCount--;
+    }
+
+    bool Contains(const uint32_t item) {
+        return item < m_placements.size() && m_placements[item].chunk != m_none;
+    }
+
+    // the old buffers may still be in flight, they go through the release queue
+    static void ReleaseBaked(Chunk &chunk) {
+        if (const MeshSystem::MeshHandle baked = chunk.baked) {
+            MeshSystem::RemoveRef(baked);
+            ReleaseQueue::Enqueue([baked] { MeshSystem::Destroy(baked); });
+        }
+
+        chunk.baked = {};
+        chunk.bounds = {};
+        chunk.sources.clear();
+        chunk.bytes = 0;
+    }
+
+    struct SourceData {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // sources holds the meshes read back so far this frame, a mesh shared by
+    // many pieces is read once
+    static void Bake(Chunk &chunk, std::unordered_map<uint32_t, SourceData> &sources) {
+        ReleaseBaked(chunk);
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        for (const uint32_t item : chunk.items) {
+            const Piece &piece = m_placements[item].piece;
+            const MeshSystem::Mesh *mesh = MeshSystem::Get(piece.mesh);
+            if (!mesh) {
+                continue;
+            }
+
+            auto [it, added] = sources.try_emplace(piece.mesh.value);
+            if (added && !MeshSystem::ReadBack(mesh, it->second.vertices,
+                                               it->second.indices)) {
+                ErrorHandler::Warn("Failed to read back mesh " +
+                                       MeshSystem::GetName(piece.mesh) + " for baking",
+                                   __FILE__, __func__, __LINE__);
+            }
+
+            const auto isSource = [&piece](const Source &source) {
+                return source.mesh == piece.mesh;
+            };
+            if (std::ranges::none_of(chunk.sources, isSource)) {
+                chunk.sources.push_back({piece.mesh, mesh->vbo});
+            }
+
+            const glm::mat4 &model = piece.modelMatrix;
+            const glm::mat3 normalMatrix =
+                glm::transpose(glm::inverse(glm::mat3(model)));
+            const auto base = static_cast<uint32_t>(vertices.size());
+
+            for (const Vertex &vertex : it->second.vertices) {
+                const glm::vec3 position(model * glm::vec4(vertex.position, 1.0f));
+                const glm::vec3 normal = glm::normalize(normalMatrix * vertex.normal);
+                vertices.push_back({position, normal, vertex.texCoords});
+                chunk.bounds.min = glm::min(chunk.bounds.min, position);
+                chunk.bounds.max = glm::max(chunk.bounds.max, position);
+            }
+
+            for (const uint32_t index : it->second.indices) {
+                indices.push_back(base + index);
+            }
+        }
+
+        chunk.dirty = false;
+        if (indices.empty()) {
+            return;
+        }
+
+        // unnamed and referenced, so it never reaches the name index or UnloadUnused
+        chunk.baked = MeshSystem::CreateMesh("", vertices, indices);
+        MeshSystem::AddRef(chunk.baked);
+        chunk.bytes = vertices.size() * sizeof(Vertex) +
+                      indices.size() * (vertices.size() <= 65536 ? sizeof(uint16_t)
+                                                                 : sizeof(uint32_t));
+        m_bakes++;
+    }
+
+    // a finished load or a reload swaps new buffers in behind the same handle
+    static bool SourcesChanged(const Chunk &chunk) {
+        for (const Source &source : chunk.sources) {
+            const MeshSystem::Mesh *mesh = MeshSystem::Get(source.mesh);
+            if (!mesh || mesh->vbo != source.vbo) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Update(std::vector<uint32_t> &reloaded) {
+        for (uint32_t i = 0; i < m_chunks.size(); i++) {
+            Chunk &chunk = m_chunks[i];
+            if (!chunk.dirty && SourcesChanged(chunk)) {
+                reloaded.insert(reloaded.end(), chunk.items.begin(), chunk.items.end());
+                MarkDirty(i);
+            }
+        }
+
+        if (!m_dirtyChunks.empty()) {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            std::unordered_map<uint32_t, SourceData> sources;
+            for (const uint32_t chunk : m_dirtyChunks) {
+                Bake(m_chunks[chunk], sources);
+            }
+            m_dirtyChunks.clear();
+
+            m_lastBakeMs = std::chrono::duration<float, std::milli>(
+                               std::chrono::high_resolution_clock::now() - start)
+                               .count();
+        }
+
+        for (const Chunk &chunk : m_chunks) {
+            if (!chunk.baked) {
+                continue;
+            }
+
+            Renderer::SubmitStatic(chunk.baked, chunk.key.material, chunk.key.texture,
+                                   chunk.key.color, chunk.bounds);
+
+            if (const TextureSystem::Texture *texture =
+                    TextureSystem::Get(chunk.key.texture)) {
+                TextureStreaming::RequestLevel(
+                    texture, (chunk.bounds.min + chunk.bounds.max) * 0.5f,
+                    0.5f * glm::length(chunk.bounds.max - chunk.bounds.min));
+            }
+        }
+    }
+
+    Stats GetStats() {
+        Stats stats{};
+        stats.pieces = m_pieceCount;
+        stats.bakes = m_bakes;
+        stats.lastBakeMs = m_lastBakeMs;
+        for (const Chunk &chunk : m_chunks) {
+            stats.chunks += chunk.baked ? 1 : 0;
+            stats.bakedBytes += chunk.bytes;
+        }
+
+        return stats;
+    }
+
+    void CleanUp() {
+        for (Chunk &chunk : m_chunks) {
+            ReleaseBaked(chunk);
+        }
+
+        m_chunks.clear();
+        m_chunkIndex.clear();
+        m_dirtyChunks.clear();
+        m_placements.clear();
+        m_pieceCount = 0;
+        m_bakes = 0;
+        m_lastBakeMs = 0.0f;
+    }
+}
@@ -0,0 +1,60 @@
+#include "string_id.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "common.h"
+
+namespace StringTable {
+    struct Table {
+        std::shared_mutex mutex;
+        std::unordered_map<uint32_t, std::string> strings;
+    };
+
+    // made on first use, literals are interned before main
+    static Table &GetTable() {
+        static Table table;
+        return table;
+    }
+
+    StringId Intern(const std::string_view text) {
+        const StringId id{Hash::Fnv1a32(text)};
+        Table &table = GetTable();
+
+        {
+            std::shared_lock lock(table.mutex);
+            if (const auto it = table.strings.find(id.value); it != table.strings.end()) {
+                if (g_EnableDebugFeatures && it->second != text) {
+                    ErrorHandler::Warn("String id collision: '" + std::string(text) +
+                                           "' and '" + it->second + "'",
+                                       __FILE__, __func__, __LINE__);
+                }
+
+                return id;
+            }
+        }
+
+        std::unique_lock lock(table.mutex);
+        table.strings.try_emplace(id.value, text);
+
+        return id;
+    }
+
+    const std::string &GetString(const StringId id) {
+        static const std::string empty;
+
+        Table &table = GetTable();
+        std::shared_lock lock(table.mutex);
+        const auto it = table.strings.find(id.value);
+
+        return it != table.strings.end() ? it->second : empty;
+    }
+
+    size_t Size() {
+        Table &table = GetTable();
+        std::shared_lock lock(table.mutex);
+
+        return table.strings.size();
+    }
+}
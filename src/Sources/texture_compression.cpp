@@ -0,0 +1,786 @@
+#include "texture_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "derived_cache.h"
+#include "mapped_file.h"
+#include "virtual_file_system.h"
+
+// not guaranteed by a core profile loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+namespace TextureCompression {
+    static bool m_supportsS3tc = false;
+    static bool m_supportsBptc = false;
+
+    // DXGI formats used by the DX10 header
+    static constexpr uint32_t m_dxgiBc1 = 71;
+    static constexpr uint32_t m_dxgiBc1Srgb = 72;
+    static constexpr uint32_t m_dxgiBc3 = 77;
+    static constexpr uint32_t m_dxgiBc3Srgb = 78;
+    static constexpr uint32_t m_dxgiBc5 = 83;
+    static constexpr uint32_t m_dxgiBc7 = 98;
+    static constexpr uint32_t m_dxgiBc7Srgb = 99;
+
+    struct DdsPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        char fourCC[4];
+        uint32_t rgbBitCount;
+        uint32_t masks[4];
+    };
+
+    struct DdsHeader {
+        char magic[4];
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DdsPixelFormat pixelFormat;
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+
+    struct DdsHeaderDx10 {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    static_assert(sizeof(DdsHeader) == 128);
+    static_assert(sizeof(DdsHeaderDx10) == 20);
+
+    using Block = uint8_t[16][4];
+
+    static bool HasExtension(const char *name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for (GLint i = 0; i < count; i++) {
+            const auto *extension =
+                reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && std::strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Init() {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+        m_supportsS3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+        m_supportsBptc = major > 4 || (major == 4 && minor >= 2) ||
+                         HasExtension("GL_ARB_texture_compression_bptc");
+    }
+
+    bool IsSupported(const TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1:
+            case TextureFormat::BC3:
+                return m_supportsS3tc;
+            case TextureFormat::BC5:
+                // RGTC is core since 3.0
+                return true;
+            case TextureFormat::BC7:
+                return m_supportsBptc;
+            case TextureFormat::Uncompressed:
+            default:
+                return true;
+        }
+    }
+
+    GLenum GetInternalFormat(const TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1:
+                return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case TextureFormat::BC3:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TextureFormat::BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            case TextureFormat::BC7:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            case TextureFormat::Uncompressed:
+            default:
+                return GL_RGBA8;
+        }
+    }
+
+    size_t GetBlockSize(const TextureFormat format) {
+        return format == TextureFormat::BC1 ? 8 : 16;
+    }
+
+    const char *GetName(const TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1:
+                return "BC1";
+            case TextureFormat::BC3:
+                return "BC3";
+            case TextureFormat::BC5:
+                return "BC5";
+            case TextureFormat::BC7:
+                return "BC7";
+            case TextureFormat::Uncompressed:
+            default:
+                return "Uncompressed";
+        }
+    }
+
+    TextureFormat ChooseFormat(const int channels, const Options &options) {
+        if (!options.enabled) {
+            return TextureFormat::Uncompressed;
+        }
+
+        TextureFormat format = TextureFormat::Uncompressed;
+        switch (channels) {
+            case 2:
+                format = options.twoChannelNormals ? TextureFormat::BC5
+                                                   : TextureFormat::BC3;
+                break;
+            case 3:
+                format = TextureFormat::BC1;
+                break;
+            case 4:
+                format = TextureFormat::BC3;
+                break;
+            default:
+                // BC4 would be the fit for one channel, BC5 saves nothing over R8
+                return TextureFormat::Uncompressed;
+        }
+
+        if (options.preferBc7 && format != TextureFormat::BC5 &&
+            IsSupported(TextureFormat::BC7)) {
+            return TextureFormat::BC7;
+        }
+
+        return IsSupported(format) ? format : TextureFormat::Uncompressed;
+    }
+
+    static void FetchBlock(const uint8_t *rgba, const int width, const int height,
+                           const int blockX, const int blockY, Block &block) {
+        // edge blocks repeat the last row and column
+        for (int y = 0; y < 4; y++) {
+            const int sourceY = std::min(blockY * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++) {
+                const int sourceX = std::min(blockX * 4 + x, width - 1);
+                std::memcpy(block[y * 4 + x],
+                            rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4,
+                            4);
+            }
+        }
+    }
+
+    static glm::vec4 GetPixel(const Block &block, const int index, const int channels) {
+        return glm::vec4(block[index][0], block[index][1], block[index][2],
+                         channels == 4 ? block[index][3] : 0);
+    }
+
+    // endpoints along the principal axis of the block's colours
+    static void FindEndpoints(const Block &block, const int channels, glm::vec4 &low,
+                              glm::vec4 &high) {
+        glm::vec4 mean(0.0f);
+        for (int i = 0; i < 16; i++) {
+            mean += GetPixel(block, i, channels);
+        }
+        mean /= 16.0f;
+
+        glm::mat4 covariance(0.0f);
+        for (int i = 0; i < 16; i++) {
+            const glm::vec4 d = GetPixel(block, i, channels) - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+
+        // seeded from the channel that varies most, a fixed (1,1,1) seed is
+        // orthogonal to colours with equal channel sums such as red against green
+        int widest = 0;
+        for (int c = 1; c < 4; c++) {
+            if (covariance[c][c] > covariance[widest][widest]) {
+                widest = c;
+            }
+        }
+
+        glm::vec4 axis(0.0f);
+        if (const float length = glm::length(covariance[widest]); length > 1e-6f) {
+            axis = covariance[widest] / length;
+            for (int i = 0; i < 8; i++) {
+                const glm::vec4 next = covariance * axis;
+                const float nextLength = glm::length(next);
+                if (nextLength < 1e-6f) {
+                    break;
+                }
+                axis = next / nextLength;
+            }
+        }
+
+        float minT = 0.0f;
+        float maxT = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            const float t = glm::dot(GetPixel(block, i, channels) - mean, axis);
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        low = glm::clamp(mean + axis * minT, 0.0f, 255.0f);
+        high = glm::clamp(mean + axis * maxT, 0.0f, 255.0f);
+    }
+
+    static uint16_t To565(const glm::vec4 &color) {
+        const auto r = static_cast<uint16_t>(std::lround(color.r * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(color.g * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(color.b * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static glm::vec3 From565(const uint16_t color) {
+        const int r = (color >> 11) & 31;
+        const int g = (color >> 5) & 63;
+        const int b = color & 31;
+        return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    static float DistanceSquared(const glm::vec3 &a, const glm::vec3 &b) {
+        const glm::vec3 d = a - b;
+        return glm::dot(d, d);
+    }
+
+    // blocks are written little-endian, which every supported target is
+    static void EncodeBc1(const Block &block, uint8_t *out) {
+        glm::vec4 low;
+        glm::vec4 high;
+        FindEndpoints(block, 3, low, high);
+
+        uint16_t color0 = To565(high);
+        uint16_t color1 = To565(low);
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        // color0 > color1 selects the four colour mode
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            const glm::vec3 palette[4] = {
+                From565(color0), From565(color1),
+                (2.0f * From565(color0) + From565(color1)) / 3.0f,
+                (From565(color0) + 2.0f * From565(color1)) / 3.0f};
+
+            for (int i = 0; i < 16; i++) {
+                const glm::vec3 pixel(block[i][0], block[i][1], block[i][2]);
+
+                uint32_t best = 0;
+                float bestDistance = DistanceSquared(pixel, palette[0]);
+                for (uint32_t j = 1; j < 4; j++) {
+                    if (const float distance = DistanceSquared(pixel, palette[j]);
+                        distance < bestDistance) {
+                        best = j;
+                        bestDistance = distance;
+                    }
+                }
+
+                indices |= best << (2 * i);
+            }
+        }
+
+        std::memcpy(out, &color0, sizeof(color0));
+        std::memcpy(out + 2, &color1, sizeof(color1));
+        std::memcpy(out + 4, &indices, sizeof(indices));
+    }
+
+    // single channel block as used by BC3 alpha, BC4 and each half of BC5
+    static void EncodeBc4(const Block &block, const int channel, uint8_t *out) {
+        uint8_t minValue = 255;
+        uint8_t maxValue = 0;
+        for (int i = 0; i < 16; i++) {
+            minValue = std::min(minValue, block[i][channel]);
+            maxValue = std::max(maxValue, block[i][channel]);
+        }
+
+        // value0 > value1 selects the eight value ramp, codes 2-7 interpolate
+        uint64_t bits = 0;
+        if (maxValue != minValue) {
+            const float range = static_cast<float>(maxValue - minValue);
+            for (int i = 0; i < 16; i++) {
+                const auto t = static_cast<uint64_t>(
+                    std::lround((maxValue - block[i][channel]) * 7.0f / range));
+                const uint64_t code = t == 0 ? 0 : t == 7 ? 1 : t + 1;
+                bits |= code << (3 * i);
+            }
+        }
+
+        out[0] = maxValue;
+        out[1] = minValue;
+        for (int i = 0; i < 6; i++) {
+            out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    static void WriteBits(uint8_t *out, uint32_t &position, const uint32_t value,
+                          const uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, position++) {
+            if ((value >> i) & 1) {
+                out[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+            }
+        }
+    }
+
+    // quantises to 7 bits plus a p-bit shared across the channels of one endpoint
+    static void QuantiseBc7Endpoint(const glm::vec4 &color, uint8_t (&quantised)[4],
+                                    uint32_t &pBit) {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t p = 0; p < 2; p++) {
+            uint8_t candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                const long value = std::lround((color[c] - static_cast<float>(p)) / 2.0f);
+                candidate[c] = static_cast<uint8_t>(std::clamp(value, 0L, 127L));
+                const float decoded = static_cast<float>((candidate[c] << 1) | p);
+                error += (decoded - color[c]) * (decoded - color[c]);
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                pBit = p;
+                std::memcpy(quantised, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    // mode 6: one subset, RGBA 7.7.7.7 endpoints with p-bits and 4-bit indices
+    static void EncodeBc7(const Block &block, uint8_t *out) {
+        static constexpr int weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                            34, 38, 43, 47, 51, 55, 60, 64};
+
+        glm::vec4 low;
+        glm::vec4 high;
+        FindEndpoints(block, 4, low, high);
+
+        uint8_t endpoints[2][4];
+        uint32_t pBits[2];
+        QuantiseBc7Endpoint(low, endpoints[0], pBits[0]);
+        QuantiseBc7Endpoint(high, endpoints[1], pBits[1]);
+
+        glm::vec4 palette[16];
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                const int e0 = (endpoints[0][c] << 1) | static_cast<int>(pBits[0]);
+                const int e1 = (endpoints[1][c] << 1) | static_cast<int>(pBits[1]);
+                palette[i][c] = static_cast<float>(
+                    ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6);
+            }
+        }
+
+        uint32_t indices[16];
+        for (int i = 0; i < 16; i++) {
+            const glm::vec4 pixel = GetPixel(block, i, 4);
+
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t j = 0; j < 16; j++) {
+                const glm::vec4 d = pixel - palette[j];
+                if (const float distance = glm::dot(d, d); distance < bestDistance) {
+                    bestDistance = distance;
+                    indices[i] = j;
+                }
+            }
+        }
+
+        // the first index is stored without its top bit, so it must be below 8
+        if (indices[0] & 8) {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (auto &index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(out, 0, 16);
+        uint32_t position = 0;
+        WriteBits(out, position, 1 << 6, 7);
+        for (int c = 0; c < 4; c++) {
+            WriteBits(out, position, endpoints[0][c], 7);
+            WriteBits(out, position, endpoints[1][c], 7);
+        }
+        WriteBits(out, position, pBits[0], 1);
+        WriteBits(out, position, pBits[1], 1);
+        for (int i = 0; i < 16; i++) {
+            WriteBits(out, position, indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    static void EncodeBlock(const TextureFormat format, const Block &block,
+                            uint8_t *out) {
+        switch (format) {
+            case TextureFormat::BC1:
+                EncodeBc1(block, out);
+                break;
+            case TextureFormat::BC3:
+                EncodeBc4(block, 3, out);
+                EncodeBc1(block, out + 8);
+                break;
+            case TextureFormat::BC5:
+                EncodeBc4(block, 0, out);
+                EncodeBc4(block, 1, out + 8);
+                break;
+            case TextureFormat::BC7:
+                EncodeBc7(block, out);
+                break;
+            case TextureFormat::Uncompressed:
+            default:
+                break;
+        }
+    }
+
+    std::vector<uint8_t> Encode(const TextureFormat format, const uint8_t *rgba,
+                                const int width, const int height) {
+        const int blocksX = (width + 3) / 4;
+        const int blocksY = (height + 3) / 4;
+        const size_t blockSize = GetBlockSize(format);
+
+        std::vector<uint8_t> encoded(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+        const auto encodeRows = [&](const int firstRow, const int lastRow) {
+            Block block;
+            for (int blockY = firstRow; blockY < lastRow; blockY++) {
+                for (int blockX = 0; blockX < blocksX; blockX++) {
+                    FetchBlock(rgba, width, height, blockX, blockY, block);
+                    EncodeBlock(format, block,
+                                encoded.data() +
+                                    (static_cast<size_t>(blockY) * blocksX + blockX) *
+                                        blockSize);
+                }
+            }
+        };
+
+        // small levels aren't worth a thread
+        const int threadCount =
+            blocksX * blocksY < 1024
+                ? 1
+                : std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1,
+                             blocksY);
+        const int rowsPerThread = (blocksY + threadCount - 1) / threadCount;
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++) {
+            const int firstRow = i * rowsPerThread;
+            const int lastRow = std::min(blocksY, firstRow + rowsPerThread);
+            if (firstRow < lastRow) {
+                threads.emplace_back(encodeRows, firstRow, lastRow);
+            }
+        }
+
+        encodeRows(0, std::min(blocksY, rowsPerThread));
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        return encoded;
+    }
+
+    static std::vector<uint8_t> ExpandToRgba(const TextureFormat format,
+                                             const uint8_t *pixels, const int width,
+                                             const int height, const int channels) {
+        const size_t count = static_cast<size_t>(width) * height;
+        std::vector<uint8_t> rgba(count * 4);
+
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t *source = pixels + i * channels;
+            uint8_t *target = rgba.data() + i * 4;
+
+            switch (channels) {
+                case 1:
+                    target[0] = target[1] = target[2] = source[0];
+                    target[3] = 255;
+                    break;
+                case 2:
+                    // normal map XY for BC5, grey and alpha for anything else
+                    if (format == TextureFormat::BC5) {
+                        target[0] = source[0];
+                        target[1] = source[1];
+                        target[2] = 0;
+                        target[3] = 255;
+                    } else {
+                        target[0] = target[1] = target[2] = source[0];
+                        target[3] = source[1];
+                    }
+                    break;
+                case 3:
+                    std::memcpy(target, source, 3);
+                    target[3] = 255;
+                    break;
+                default:
+                    std::memcpy(target, source, 4);
+                    break;
+            }
+        }
+
+        return rgba;
+    }
+
+    static std::vector<uint8_t> Downsample(const std::vector<uint8_t> &rgba,
+                                           const int width, const int height,
+                                           const int nextWidth, const int nextHeight) {
+        std::vector<uint8_t> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+        for (int y = 0; y < nextHeight; y++) {
+            const int y0 = std::min(y * 2, height - 1);
+            const int y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < nextWidth; x++) {
+                const int x0 = std::min(x * 2, width - 1);
+                const int x1 = std::min(x * 2 + 1, width - 1);
+
+                for (int c = 0; c < 4; c++) {
+                    const int sum = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                                    rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                                    rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                                    rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                    next[(static_cast<size_t>(y) * nextWidth + x) * 4 + c] =
+                        static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        return next;
+    }
+
+    CompressedImage Compress(const TextureFormat format, const uint8_t *pixels,
+                             const int width, const int height, const int channels) {
+        CompressedImage image;
+        image.format = format;
+        image.width = width;
+        image.height = height;
+
+        std::vector<uint8_t> level =
+            ExpandToRgba(format, pixels, width, height, channels);
+        int levelWidth = width;
+        int levelHeight = height;
+
+        while (true) {
+            const std::vector<uint8_t> encoded =
+                Encode(format, level.data(), levelWidth, levelHeight);
+            image.levels.push_back(
+                {image.data.size(), encoded.size(), levelWidth, levelHeight});
+            image.data.insert(image.data.end(), encoded.begin(), encoded.end());
+
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+
+            const int nextWidth = std::max(1, levelWidth / 2);
+            const int nextHeight = std::max(1, levelHeight / 2);
+            level = Downsample(level, levelWidth, levelHeight, nextWidth, nextHeight);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+
+        return image;
+    }
+
+    static size_t GetLevelSize(const TextureFormat format, const int width,
+                               const int height) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) *
+               GetBlockSize(format);
+    }
+
+    static TextureFormat FromDxgi(const uint32_t dxgiFormat) {
+        switch (dxgiFormat) {
+            case m_dxgiBc1:
+            case m_dxgiBc1Srgb:
+                return TextureFormat::BC1;
+            case m_dxgiBc3:
+            case m_dxgiBc3Srgb:
+                return TextureFormat::BC3;
+            case m_dxgiBc5:
+                return TextureFormat::BC5;
+            case m_dxgiBc7:
+            case m_dxgiBc7Srgb:
+                return TextureFormat::BC7;
+            default:
+                return TextureFormat::Uncompressed;
+        }
+    }
+
+    static uint32_t ToDxgi(const TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1:
+                return m_dxgiBc1;
+            case TextureFormat::BC3:
+                return m_dxgiBc3;
+            case TextureFormat::BC5:
+                return m_dxgiBc5;
+            case TextureFormat::BC7:
+                return m_dxgiBc7;
+            case TextureFormat::Uncompressed:
+            default:
+                return 0;
+        }
+    }
+
+    static TextureFormat FromFourCC(const char (&fourCC)[4]) {
+        if (std::memcmp(fourCC, "DXT1", 4) == 0) {
+            return TextureFormat::BC1;
+        }
+        if (std::memcmp(fourCC, "DXT5", 4) == 0) {
+            return TextureFormat::BC3;
+        }
+        if (std::memcmp(fourCC, "ATI2", 4) == 0 || std::memcmp(fourCC, "BC5U", 4) == 0) {
+            return TextureFormat::BC5;
+        }
+
+        return TextureFormat::Uncompressed;
+    }
+
+    // rows are kept bottom-up to match the flipped stb_image uploads, prebuilt DDS
+    // files need to be exported flipped as well
+    bool ReadDds(const uint8_t *data, const size_t size, CompressedImage &image) {
+        DdsHeader header{};
+        if (!data || size < sizeof(DdsHeader)) {
+            return false;
+        }
+
+        std::memcpy(&header, data, sizeof(DdsHeader));
+        if (std::memcmp(header.magic, "DDS ", 4) != 0 || header.size != 124) {
+            return false;
+        }
+
+        size_t dataOffset = sizeof(DdsHeader);
+        image.format = FromFourCC(header.pixelFormat.fourCC);
+        if (std::memcmp(header.pixelFormat.fourCC, "DX10", 4) == 0) {
+            if (size < dataOffset + sizeof(DdsHeaderDx10)) {
+                return false;
+            }
+
+            DdsHeaderDx10 dx10{};
+            std::memcpy(&dx10, data + dataOffset, sizeof(DdsHeaderDx10));
+            image.format = FromDxgi(dx10.dxgiFormat);
+            dataOffset += sizeof(DdsHeaderDx10);
+        }
+
+        if (image.format == TextureFormat::Uncompressed || header.width == 0 ||
+            header.height == 0) {
+            return false;
+        }
+
+        image.width = static_cast<int>(header.width);
+        image.height = static_cast<int>(header.height);
+        image.levels.clear();
+
+        const uint32_t levelCount = std::max(1u, header.mipMapCount);
+        int levelWidth = image.width;
+        int levelHeight = image.height;
+        size_t offset = 0;
+        for (uint32_t i = 0; i < levelCount; i++) {
+            const size_t levelSize = GetLevelSize(image.format, levelWidth, levelHeight);
+            image.levels.push_back({offset, levelSize, levelWidth, levelHeight});
+            offset += levelSize;
+
+            levelWidth = std::max(1, levelWidth / 2);
+            levelHeight = std::max(1, levelHeight / 2);
+        }
+
+        if (dataOffset + offset > size) {
+            return false;
+        }
+
+        image.source.clear();
+        image.dataOffset = dataOffset;
+        image.data.assign(data + dataOffset, data + dataOffset + offset);
+
+        return true;
+    }
+
+    bool ReadDds(const std::filesystem::path &path, CompressedImage &image) {
+        const MappedFile file(path);
+        if (!ReadDds(file.Data(), file.Size(), image)) {
+            return false;
+        }
+
+        image.source = path;
+
+        return true;
+    }
+
+    bool WriteDds(std::ostream &file, const CompressedImage &image) {
+        DdsHeader header{};
+        std::memcpy(header.magic, "DDS ", 4);
+        header.size = 124;
+        // caps, height, width, pixel format, mip count and linear size
+        header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+        header.width = static_cast<uint32_t>(image.width);
+        header.height = static_cast<uint32_t>(image.height);
+        header.pitchOrLinearSize =
+            image.levels.empty() ? 0 : static_cast<uint32_t>(image.levels[0].size);
+        header.mipMapCount = static_cast<uint32_t>(image.levels.size());
+        header.pixelFormat.size = sizeof(DdsPixelFormat);
+        header.pixelFormat.flags = 0x4;
+        std::memcpy(header.pixelFormat.fourCC, "DX10", 4);
+        // texture, mipmap and complex
+        header.caps[0] = 0x1000 | 0x400000 | 0x8;
+
+        DdsHeaderDx10 dx10{};
+        dx10.dxgiFormat = ToDxgi(image.format);
+        dx10.resourceDimension = 3;
+        dx10.arraySize = 1;
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(&dx10), sizeof(dx10));
+        file.write(reinterpret_cast<const char *>(image.data.data()),
+                   static_cast<std::streamsize>(image.data.size()));
+
+        return file.good();
+    }
+
+    std::optional<uint64_t> ComputeKey(const std::string &sourcePath,
+                                       const TextureFormat format) {
+        const FileView file = VirtualFileSystem::Map(sourcePath);
+        if (!file) {
+            return std::nullopt;
+        }
+
+        Hash::Hasher hasher = DerivedCache::BeginKey(DerivedAssetKind::Texture, Version);
+        hasher.Add(format);
+        hasher.Update(file.Data(), file.Size());
+
+        return hasher.Digest();
+    }
+
+    bool LoadCached(const uint64_t key, CompressedImage &image) {
+        const std::filesystem::path path =
+            DerivedCache::Find(DerivedAssetKind::Texture, key);
+        return !path.empty() && ReadDds(path, image);
+    }
+
+    bool StoreCached(const uint64_t key, CompressedImage &image) {
+        if (!DerivedCache::Store(DerivedAssetKind::Texture, key,
+                                 [&image](std::ostream &file) {
+                                     return WriteDds(file, image);
+                                 })) {
+            return false;
+        }
+
+        image.source = DerivedCache::GetPath(DerivedAssetKind::Texture, key);
+        image.dataOffset = sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+        return true;
+    }
+}
@@ -0,0 +1,427 @@
+#include "texture_streaming.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "derived_cache.h"
+#include "gpu_memory.h"
+
+namespace TextureStreaming {
+    struct StreamedTexture {
+        GLuint id;
+        // GL reuses deleted names, this tells registrations of one name apart
+        uint64_t serial;
+        GLenum internalFormat;
+        std::filesystem::path source;
+        size_t dataOffset;
+        std::vector<TextureCompression::MipLevel> levels;
+        // levels from firstLevel down are always resident
+        uint32_t firstLevel;
+        uint32_t residentLevel;
+        uint32_t requestedLevel;
+        uint32_t targetLevel;
+        bool readPending;
+        // failed reads in a row, and the frame the next one may be queued
+        uint32_t failures;
+        uint64_t retryFrame;
+    };
+
+    struct Read {
+        GLuint id;
+        uint64_t serial;
+        uint32_t level;
+        std::filesystem::path source;
+        size_t offset;
+        size_t size;
+        std::vector<uint8_t> data;
+        bool success;
+    };
+
+    // mips up to this size load with the texture
+    static constexpr int m_residentTailSize = 64;
+
+    // a texture whose reads keep failing stops streaming at its resident level
+    static constexpr uint32_t m_maxReadFailures = 5;
+
+    static std::unordered_map<GLuint, StreamedTexture> m_textures;
+    static bool m_enabled = true;
+    static size_t m_budget = 256 * 1024 * 1024;
+    static size_t m_uploadBudget = 4 * 1024 * 1024;
+    static Stats m_stats{};
+    static uint64_t m_frame = 0;
+    static uint64_t m_nextSerial = 0;
+
+    static glm::vec3 m_viewerPosition{0.0f};
+    static float m_viewerScale = 0.0f;
+
+    static std::thread m_reader;
+    static std::mutex m_mutex;
+    static std::condition_variable m_condition;
+    static std::deque<Read> m_reads;
+    static std::deque<Read> m_completedReads;
+    static bool m_stopping = false;
+
+    static void ReaderLoop() {
+        while (true) {
+            Read read;
+            {
+                std::unique_lock lock(m_mutex);
+                m_condition.wait(lock, [] { return m_stopping || !m_reads.empty(); });
+                if (m_stopping) {
+                    return;
+                }
+
+                read = std::move(m_reads.front());
+                m_reads.pop_front();
+            }
+
+            std::ifstream file(read.source, std::ios::binary);
+            read.data.resize(read.size);
+            read.success =
+                file.is_open() &&
+                file.seekg(static_cast<std::streamoff>(read.offset)) &&
+                file.read(reinterpret_cast<char *>(read.data.data()),
+                          static_cast<std::streamsize>(read.size));
+
+            std::lock_guard lock(m_mutex);
+            m_completedReads.push_back(std::move(read));
+        }
+    }
+
+    static size_t GetResidentBytes(const StreamedTexture &texture, const uint32_t level) {
+        size_t bytes = 0;
+        for (uint32_t i = level; i < texture.levels.size(); i++) {
+            bytes += texture.levels[i].size;
+        }
+
+        return bytes;
+    }
+
+    // reads already completed are dropped by their serial instead
+    static void DropQueuedReads(const GLuint textureId) {
+        std::lock_guard lock(m_mutex);
+        std::erase_if(m_reads, [textureId](const Read &read) {
+            return read.id == textureId;
+        });
+    }
+
+    void Init() {
+        CleanUp();
+
+        m_stopping = false;
+        m_reader = std::thread(ReaderLoop);
+    }
+
+    void SetEnabled(const bool enabled) {
+        m_enabled = enabled;
+    }
+
+    bool IsEnabled() {
+        return m_enabled;
+    }
+
+    uint32_t GetFirstResidentLevel(const TextureCompression::CompressedImage &image) {
+        for (uint32_t i = 0; i < image.levels.size(); i++) {
+            const auto &level = image.levels[i];
+            if (std::max(level.width, level.height) <= m_residentTailSize) {
+                return i;
+            }
+        }
+
+        return static_cast<uint32_t>(image.levels.size()) - 1;
+    }
+
+    void Register(const GLuint textureId,
+                  const TextureCompression::CompressedImage &image,
+                  const uint32_t firstLevel) {
+        StreamedTexture texture{};
+        texture.id = textureId;
+        texture.serial = ++m_nextSerial;
+        texture.internalFormat = TextureCompression::GetInternalFormat(image.format);
+        texture.source = image.source;
+        texture.dataOffset = image.dataOffset;
+        texture.levels = image.levels;
+        texture.firstLevel = firstLevel;
+        texture.residentLevel = firstLevel;
+        texture.requestedLevel = firstLevel;
+        texture.targetLevel = firstLevel;
+
+        // the derived cache must not trim the blob the finer levels come from
+        DerivedCache::Pin(texture.source);
+
+        if (const auto it = m_textures.find(textureId); it != m_textures.end()) {
+            DerivedCache::Unpin(it->second.source);
+            DropQueuedReads(textureId);
+        }
+        m_textures[textureId] = std::move(texture);
+    }
+
+    void Unregister(const GLuint textureId) {
+        const auto it = m_textures.find(textureId);
+        if (it == m_textures.end()) {
+            return;
+        }
+
+        // a read in flight for it is dropped when it completes
+        DerivedCache::Unpin(it->second.source);
+        DropQueuedReads(textureId);
+        m_textures.erase(it);
+    }
+
+    void SetViewer(const glm::vec3 &position, const float fovY,
+                   const float viewportHeight) {
+        m_viewerPosition = position;
+        // pixels covered by one world unit at distance one
+        m_viewerScale = viewportHeight / (2.0f * std::tan(glm::radians(fovY) * 0.5f));
+    }
+
+    void RequestLevel(const TextureSystem::Texture *texture, const glm::vec3 &center,
+                      const float radius) {
+        if (!texture) {
+            return;
+        }
+
+        const auto it = m_textures.find(texture->id);
+        if (it == m_textures.end()) {
+            return;
+        }
+
+        StreamedTexture &streamed = it->second;
+
+        // assumes the texture is mapped once across the object
+        const float distance = std::max(glm::length(center - m_viewerPosition), 1e-3f);
+        const float pixels = std::max(2.0f * radius * m_viewerScale / distance, 1.0f);
+        const auto texels = static_cast<float>(
+            std::max(streamed.levels[0].width, streamed.levels[0].height));
+
+        const auto level = static_cast<uint32_t>(
+            std::clamp(std::floor(std::log2(texels / pixels)), 0.0f,
+                       static_cast<float>(streamed.firstLevel)));
+
+        streamed.requestedLevel = std::min(streamed.requestedLevel, level);
+    }
+
+    // streamed mips get whatever the GPU budget leaves after everything else
+    static size_t GetEffectiveBudget() {
+        size_t resident = 0;
+        for (const auto &[id, texture] : m_textures) {
+            resident += GetResidentBytes(texture, texture.residentLevel);
+        }
+
+        const size_t total = GpuMemory::GetTotal();
+        const size_t others = total > resident ? total - resident : 0;
+        const size_t gpuBudget = GpuMemory::GetBudget();
+
+        return std::min(m_budget, gpuBudget > others ? gpuBudget - others : 0);
+    }
+
+    // raises the finest requested levels until everything fits in the budget
+    static void FitTargets() {
+        const size_t budget = GetEffectiveBudget();
+
+        size_t total = 0;
+        for (auto &[id, texture] : m_textures) {
+            texture.targetLevel = texture.requestedLevel;
+            total += GetResidentBytes(texture, texture.targetLevel);
+        }
+        m_stats.requestedBytes = total;
+
+        while (total > budget) {
+            StreamedTexture *finest = nullptr;
+            for (auto &[id, texture] : m_textures) {
+                if (texture.targetLevel >= texture.firstLevel) {
+                    continue;
+                }
+
+                if (!finest || texture.targetLevel < finest->targetLevel ||
+                    (texture.targetLevel == finest->targetLevel &&
+                     texture.levels[texture.targetLevel].size >
+                         finest->levels[finest->targetLevel].size)) {
+                    finest = &texture;
+                }
+            }
+
+            if (!finest) {
+                break;
+            }
+
+            total -= finest->levels[finest->targetLevel].size;
+            finest->targetLevel++;
+        }
+    }
+
+    static void Evict(StreamedTexture &texture) {
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+                        static_cast<GLint>(texture.targetLevel));
+
+        // respecifying a level as empty releases its storage
+        for (uint32_t level = texture.residentLevel; level < texture.targetLevel;
+             level++) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level),
+                                   texture.internalFormat, 0, 0, 0, 0, nullptr);
+            m_stats.levelsEvicted++;
+        }
+
+        texture.residentLevel = texture.targetLevel;
+        GpuMemory::Track(GpuMemoryCategory::Textures, texture.id,
+                         GetResidentBytes(texture, texture.residentLevel));
+    }
+
+    // retries after 2, 4, 8... frames, then settles for the levels already resident
+    static void ReadFailed(StreamedTexture &texture, const Read &read) {
+        texture.failures++;
+        if (texture.failures < m_maxReadFailures) {
+            texture.retryFrame = m_frame + (1ull << texture.failures);
+            return;
+        }
+
+        ErrorHandler::Warn("Failed to stream mip " + std::to_string(read.level) +
+                               " from " + read.source.string() +
+                               ", keeping the levels already resident",
+                           __FILE__, __func__, __LINE__);
+
+        texture.firstLevel = texture.residentLevel;
+        texture.requestedLevel = texture.firstLevel;
+        texture.targetLevel = std::max(texture.targetLevel, texture.firstLevel);
+    }
+
+    static void UploadCompletedReads() {
+        size_t uploaded = 0;
+
+        while (uploaded < m_uploadBudget) {
+            Read read;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_completedReads.empty()) {
+                    break;
+                }
+
+                read = std::move(m_completedReads.front());
+                m_completedReads.pop_front();
+            }
+
+            // the name may have gone to another texture since the read was queued
+            const auto it = m_textures.find(read.id);
+            if (it == m_textures.end() || it->second.serial != read.serial) {
+                continue;
+            }
+
+            StreamedTexture &texture = it->second;
+            texture.readPending = false;
+
+            if (!read.success) {
+                ReadFailed(texture, read);
+                continue;
+            }
+            texture.failures = 0;
+
+            // the texture may have been evicted past this level while reading
+            if (read.level + 1 != texture.residentLevel ||
+                read.level < texture.targetLevel) {
+                continue;
+            }
+
+            const TextureCompression::MipLevel &level = texture.levels[read.level];
+
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(read.level),
+                                   texture.internalFormat, level.width, level.height, 0,
+                                   static_cast<GLsizei>(level.size), read.data.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+                            static_cast<GLint>(read.level));
+
+            texture.residentLevel = read.level;
+            GpuMemory::Track(GpuMemoryCategory::Textures, texture.id,
+                             GetResidentBytes(texture, texture.residentLevel));
+            uploaded += level.size;
+            m_stats.levelsLoaded++;
+        }
+    }
+
+    void Update() {
+        if (!m_enabled || m_textures.empty()) {
+            return;
+        }
+
+        m_frame++;
+        UploadCompletedReads();
+        FitTargets();
+
+        size_t resident = 0;
+        std::vector<Read> reads;
+        for (auto &[id, texture] : m_textures) {
+            if (texture.residentLevel < texture.targetLevel) {
+                Evict(texture);
+            } else if (texture.residentLevel > texture.targetLevel &&
+                       !texture.readPending && m_frame >= texture.retryFrame) {
+                // one level at a time so detail sharpens progressively
+                const uint32_t level = texture.residentLevel - 1;
+                reads.push_back({id, texture.serial, level, texture.source,
+                                 texture.dataOffset + texture.levels[level].offset,
+                                 texture.levels[level].size, {}, false});
+                texture.readPending = true;
+            }
+
+            resident += GetResidentBytes(texture, texture.residentLevel);
+
+            // requests are rebuilt every frame, unrequested textures fall back
+            texture.requestedLevel = texture.firstLevel;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_stats.textures = static_cast<uint32_t>(m_textures.size());
+        m_stats.residentBytes = resident;
+
+        if (!reads.empty()) {
+            std::lock_guard lock(m_mutex);
+            for (auto &read : reads) {
+                m_reads.push_back(std::move(read));
+            }
+        }
+        m_condition.notify_one();
+    }
+
+    void SetBudget(const size_t bytes) {
+        m_budget = bytes;
+    }
+
+    size_t GetBudget() {
+        return m_budget;
+    }
+
+    Stats GetStats() {
+        Stats stats = m_stats;
+
+        std::lock_guard lock(m_mutex);
+        stats.pendingReads =
+            static_cast<uint32_t>(m_reads.size() + m_completedReads.size());
+
+        return stats;
+    }
+
+    void CleanUp() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+
+        if (m_reader.joinable()) {
+            m_reader.join();
+        }
+
+        m_reads.clear();
+        m_completedReads.clear();
+        for (const auto &[id, texture] : m_textures) {
+            DerivedCache::Unpin(texture.source);
+        }
+        m_textures.clear();
+        m_stats = {};
+        m_frame = 0;
+    }
+}
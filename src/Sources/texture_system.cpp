@@ -1,53 +1,401 @@
 #include "texture_system.h"
 
+#include <chrono>
 #include <filesystem>
+#include <iomanip>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "async_loader.h"
+#include "gpu_memory.h"
+#include "release_queue.h"
+#include "texture_streaming.h"
+#include "virtual_file_system.h"
+
 namespace TextureSystem {
-    static std::unordered_map<std::string, Texture> m_textures;
+    static SlotMap<Texture> m_textures;
+    static NameIndex<Texture> m_names;
+    static RefCounts<Texture> m_refCounts;
+    static TextureCompression::Options m_compressionOptions;
+    static TextureHandle m_placeholder;
+
+    void Init() {
+        m_textures.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        stbi_set_flip_vertically_on_load(true);
+        TextureCompression::Init();
+        TextureStreaming::Init();
+    }
+
+    void SetCompressionOptions(const TextureCompression::Options &options) {
+        m_compressionOptions = options;
+    }
+
+    const TextureCompression::Options &GetCompressionOptions() {
+        return m_compressionOptions;
+    }
 
-    static std::string GetTexturePath(const std::string &filename) {
-        std::filesystem::path paths[] = {"Assets/Textures", "../Assets/Textures",
-                                         "../../Assets/Textures",
-                                         "gl-gfx/Assets/Textures"};
+    static int GetChannelCount(const TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1:
+                return 3;
+            case TextureFormat::BC5:
+                return 2;
+            default:
+                return 4;
+        }
+    }
 
-        for (const auto &basePath : paths) {
-            if (std::filesystem::path fullPath = basePath / filename; exists(fullPath)) {
-                return fullPath.string();
+    static void SetCompressed(Image &image,
+                              TextureCompression::CompressedImage compressed) {
+        image.width = compressed.width;
+        image.height = compressed.height;
+        image.channels = GetChannelCount(compressed.format);
+        image.compressed = std::move(compressed);
+    }
+
+    bool DecodeImage(const std::string &path, Image &image) {
+        const std::filesystem::path textureFile = std::filesystem::path(path).filename();
+        const std::string assetPath = VirtualFileSystem::FindAsset("Textures", path);
+
+        // stb decodes straight from the mapping, the file is never copied
+        const FileView file = VirtualFileSystem::Map(assetPath);
+        if (!file) {
+            return false;
+        }
+
+        if (textureFile.extension() == ".dds") {
+            TextureCompression::CompressedImage compressed;
+            if (!TextureCompression::ReadDds(file.Data(), file.Size(), compressed)) {
+                return false;
             }
+
+            // the streamer reads finer levels back from disk, so a packed file has
+            // no source and is uploaded whole
+            if (!VirtualFileSystem::IsPacked(assetPath)) {
+                compressed.source = VirtualFileSystem::GetRealPath(assetPath);
+            }
+
+            SetCompressed(image, std::move(compressed));
+            return true;
+        }
+
+        // the header is enough to pick a format and look for a cached transcode
+        TextureFormat format = TextureFormat::Uncompressed;
+        std::optional<uint64_t> cacheKey;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        if (stbi_info_from_memory(file.Data(), static_cast<int>(file.Size()), &width,
+                                  &height, &channels)) {
+            format = TextureCompression::ChooseFormat(channels, m_compressionOptions);
         }
 
-        return filename;
+        if (format != TextureFormat::Uncompressed) {
+            cacheKey = TextureCompression::ComputeKey(assetPath, format);
+
+            TextureCompression::CompressedImage compressed;
+            if (cacheKey && TextureCompression::LoadCached(*cacheKey, compressed)) {
+                SetCompressed(image, std::move(compressed));
+                return true;
+            }
+        }
+
+        image.pixels = stbi_load_from_memory(file.Data(), static_cast<int>(file.Size()),
+                                             &image.width, &image.height,
+                                             &image.channels, 0);
+        if (!image.pixels) {
+            return false;
+        }
+
+        if (format == TextureFormat::Uncompressed) {
+            return true;
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        TextureCompression::CompressedImage compressed = TextureCompression::Compress(
+            format, image.pixels, image.width, image.height, image.channels);
+        const size_t sourceSize = GetImageSize(image);
+        FreeImage(image);
+
+        const float elapsedMs = std::chrono::duration<float, std::milli>(
+                                    std::chrono::high_resolution_clock::now() - start)
+                                    .count();
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(1) << "Compressed texture "
+               << textureFile.string() << " (" << compressed.width << "x"
+               << compressed.height << ") to " << TextureCompression::GetName(format)
+               << " with " << compressed.levels.size() << " mips in " << elapsedMs
+               << " ms: " << static_cast<float>(sourceSize) / 1024.0f << " KB -> "
+               << static_cast<float>(compressed.data.size()) / 1024.0f << " KB";
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+
+        if (cacheKey) {
+            TextureCompression::StoreCached(*cacheKey, compressed);
+        }
+
+        SetCompressed(image, std::move(compressed));
+        return true;
     }
 
-    void Init() {
-        m_textures.clear();
-        stbi_set_flip_vertically_on_load(true);
+    void FreeImage(Image &image) {
+        if (image.pixels) {
+            stbi_image_free(image.pixels);
+            image.pixels = nullptr;
+        }
+
+        image.compressed = {};
+    }
+
+    const void *GetImageData(const Image &image) {
+        if (image.compressed.format != TextureFormat::Uncompressed) {
+            return image.compressed.data.data();
+        }
+
+        return image.pixels;
+    }
+
+    size_t GetImageSize(const Image &image) {
+        if (image.compressed.format != TextureFormat::Uncompressed) {
+            return image.compressed.data.size();
+        }
+
+        return static_cast<size_t>(image.width) * image.height * image.channels;
+    }
+
+    // the mip chain is prebuilt, with a pixel buffer bound offsets index into it.
+    // Returns the bytes uploaded
+    static size_t UploadCompressedLevels(const Texture &texture,
+                                         const TextureCompression::CompressedImage &image,
+                                         const uint32_t firstLevel,
+                                         const GLuint pixelBuffer) {
+        size_t bytes = 0;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        for (uint32_t i = firstLevel; i < texture.mipLevels; i++) {
+            const TextureCompression::MipLevel &level = image.levels[i];
+            const void *data =
+                pixelBuffer
+                    ? reinterpret_cast<const void *>(level.offset)
+                    : static_cast<const void *>(image.data.data() + level.offset);
+
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), texture.format,
+                                   level.width, level.height, 0,
+                                   static_cast<GLsizei>(level.size), data);
+            bytes += level.size;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        return bytes;
+    }
+
+    static void UploadPixels(const Texture &texture, const Image &image,
+                             const GLuint pixelBuffer) {
+        // stb_image rows are tightly packed. With a pixel buffer bound the data
+        // pointer is an offset into it
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glTexImage2D(GL_TEXTURE_2D, 0, texture.format, texture.width, texture.height, 0,
+                     texture.format, texture.dataType,
+                     pixelBuffer ? nullptr : image.pixels);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        if (texture.mipLevels > 1) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+
+    static void EvictTexture(const Texture &texture) {
+        // empty levels release the storage, the GL name stays valid for views
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        for (uint32_t i = 0; i < texture.mipLevels; i++) {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA8, 0, 0, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    static bool FillTexture(const Texture &texture, const Image &image) {
+        // the texture was released while its reload was queued
+        if (!GpuMemory::IsEvicted(GpuMemoryCategory::Textures, texture.id)) {
+            return false;
+        }
+
+        // the source may have changed on disk, only a matching layout can refill
+        const bool matches = image.width == texture.width &&
+                             image.height == texture.height &&
+                             image.channels == texture.channels &&
+                             image.compressed.format == texture.compression &&
+                             (texture.compression == TextureFormat::Uncompressed ||
+                              image.compressed.levels.size() >= texture.mipLevels);
+        if (!matches) {
+            return false;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        if (texture.compression != TextureFormat::Uncompressed) {
+            UploadCompressedLevels(texture, image.compressed, 0, 0);
+        } else {
+            UploadPixels(texture, image, 0);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return true;
+    }
+
+    static void OnRefilled(const Texture &texture, const bool success) {
+        if (success) {
+            GpuMemory::Track(GpuMemoryCategory::Textures, texture.id,
+                             texture.memoryBytes);
+        } else {
+            GpuMemory::ReloadFailed(GpuMemoryCategory::Textures, texture.id);
+        }
+    }
+
+    // decoding runs on a loader thread, the placeholder draws until it is back
+    static void QueueReload(const Texture &texture) {
+        AsyncLoader::RefillTexture(
+            texture.path, texture.path,
+            [texture](const Image &image) { return FillTexture(texture, image); },
+            [texture](const bool success) { OnRefilled(texture, success); });
+    }
+
+    static bool RestoreTexture(const Texture &texture) {
+        Image image;
+        if (!DecodeImage(texture.path, image)) {
+            return false;
+        }
+
+        const bool filled = FillTexture(texture, image);
+        FreeImage(image);
+
+        if (filled) {
+            OnRefilled(texture, true);
+        }
+
+        return filled;
+    }
+
+    // textures with a source can be dropped under memory pressure and reloaded
+    // once they are bound again. The evictor keeps its own copy of the
+    // description, so it does not depend on which slot the texture ends up in
+    static void TrackTexture(const Texture &texture, const bool evictable) {
+        GpuMemory::Track(GpuMemoryCategory::Textures, texture.id, texture.memoryBytes);
+
+        if (evictable && !texture.path.empty()) {
+            GpuMemory::SetEvictable(GpuMemoryCategory::Textures, texture.id,
+                                    {[texture] { EvictTexture(texture); },
+                                     [texture] { QueueReload(texture); },
+                                     [texture] { return RestoreTexture(texture); }});
+        }
+    }
+
+    static TextureHandle Insert(const std::string &name, Texture texture) {
+        const TextureHandle handle = m_textures.Insert(std::move(texture));
+        m_names.Add(name, handle);
+
+        return handle;
     }
 
-    Texture *CreateTexture(const std::string &name, const std::string &path,
-                           const bool generateMips) {
+    static TextureHandle CreateCompressedTexture(const std::string &name,
+                                                 const std::string &path,
+                                                 const Image &image,
+                                                 const bool generateMips,
+                                                 const GLuint pixelBuffer) {
+        const TextureCompression::CompressedImage &compressed = image.compressed;
+        if (!TextureCompression::IsSupported(compressed.format)) {
+            ErrorHandler::Warn(std::string("Unsupported compressed format: ") +
+                                   TextureCompression::GetName(compressed.format),
+                               __FILE__, __func__, __LINE__);
+            return {};
+        }
+
         Texture texture{};
-        texture.name = name;
+        texture.width = image.width;
+        texture.height = image.height;
+        texture.channels = image.channels;
+        texture.format = TextureCompression::GetInternalFormat(compressed.format);
+        texture.dataType = GL_UNSIGNED_BYTE;
+        texture.compression = compressed.format;
+        texture.mipLevels =
+            generateMips ? static_cast<uint32_t>(compressed.levels.size()) : 1;
         texture.isValid = false;
 
-        const std::filesystem::path textureFile = std::filesystem::path(path).filename();
+        // textures backed by a file start from the coarse tail, the streamer reads
+        // finer levels in once something is close enough to need them
+        const bool streamed = TextureStreaming::IsEnabled() && texture.mipLevels > 1 &&
+                              !compressed.source.empty();
+        const uint32_t firstLevel =
+            streamed ? TextureStreaming::GetFirstResidentLevel(compressed) : 0;
 
-        unsigned char *data =
-            stbi_load(GetTexturePath(textureFile.string()).c_str(), &texture.width,
-                      &texture.height, &texture.channels, 0);
-        if (!data) {
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+
+        texture.memoryBytes =
+            UploadCompressedLevels(texture, compressed, firstLevel, pixelBuffer);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+                        static_cast<GLint>(firstLevel));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                        static_cast<GLint>(texture.mipLevels) - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        texture.mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        texture.path = path;
+        texture.isValid = true;
+
+        // streamed textures shrink through their mips instead of being evicted
+        TrackTexture(texture, !streamed);
+        if (streamed) {
+            TextureStreaming::Register(texture.id, compressed, firstLevel);
+        }
+
+        return Insert(name, std::move(texture));
+    }
+
+    TextureHandle CreateTexture(const std::string &name, const std::string &path,
+                                const bool generateMips) {
+        Image image;
+        if (!DecodeImage(path, image)) {
             ErrorHandler::Warn("Failed to load texture: " + path, __FILE__, __func__,
                                __LINE__);
-            return nullptr;
+            return {};
         }
 
+        const TextureHandle texture = CreateTexture(name, path, image, generateMips);
+        FreeImage(image);
+
+        return texture;
+    }
+
+    TextureHandle CreateTexture(const std::string &name, const std::string &path,
+                                const Image &image, const bool generateMips,
+                                const GLuint pixelBuffer) {
+        if (image.compressed.format != TextureFormat::Uncompressed) {
+            return CreateCompressedTexture(name, path, image, generateMips, pixelBuffer);
+        }
+
+        Texture texture{};
+        texture.width = image.width;
+        texture.height = image.height;
+        texture.channels = image.channels;
+        texture.isValid = false;
+
         switch (texture.channels) {
             case 1:
                 texture.format = GL_RED;
                 break;
+            case 2:
+                texture.format = GL_RG;
+                break;
             case 3:
                 texture.format = GL_RGB;
                 break;
@@ -58,20 +406,37 @@ namespace TextureSystem {
                 ErrorHandler::Warn(
                     "Unsupported number of channels: " + std::to_string(texture.channels),
                     __FILE__, __func__, __LINE__);
-                stbi_image_free(data);
-                return nullptr;
+                return {};
         }
 
         texture.dataType = GL_UNSIGNED_BYTE;
+        texture.memoryBytes = GetImageSize(image);
+
+        if (generateMips) {
+            int levelWidth = texture.width;
+            int levelHeight = texture.height;
+            while (levelWidth > 1 || levelHeight > 1) {
+                levelWidth = std::max(1, levelWidth / 2);
+                levelHeight = std::max(1, levelHeight / 2);
+                texture.memoryBytes +=
+                    static_cast<size_t>(levelWidth) * levelHeight * texture.channels;
+                texture.mipLevels++;
+            }
+        }
 
         glGenTextures(1, &texture.id);
         glBindTexture(GL_TEXTURE_2D, texture.id);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, texture.format, texture.width, texture.height, 0,
-                     texture.format, texture.dataType, data);
+        UploadPixels(texture, image, pixelBuffer);
 
-        if (generateMips) {
-            glGenerateMipmap(GL_TEXTURE_2D);
+        // stb_image decodes one and two channels as grey and grey plus alpha, core
+        // GL has no luminance formats so the red and green channels are swizzled
+        const bool normals =
+            texture.channels == 2 && m_compressionOptions.twoChannelNormals;
+        if (texture.channels <= 2 && !normals) {
+            const GLint alpha = texture.channels == 2 ? GL_GREEN : GL_ONE;
+            const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, alpha};
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
         }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -80,19 +445,17 @@ namespace TextureSystem {
                         generateMips ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        stbi_image_free(data);
-
         texture.path = path;
         texture.isValid = true;
-        m_textures[name] = texture;
 
-        return &m_textures[name];
+        TrackTexture(texture, true);
+
+        return Insert(name, std::move(texture));
     }
 
-    Texture *CreateEmpty(const std::string &name, const int width, const int height,
-                         const GLenum format, const GLenum dataType) {
+    TextureHandle CreateEmpty(const std::string &name, const int width, const int height,
+                              const GLenum format, const GLenum dataType) {
         Texture texture{};
-        texture.name = name;
         texture.width = width;
         texture.height = height;
         texture.format = format;
@@ -110,36 +473,146 @@ namespace TextureSystem {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+        // empty textures are only ever filled by the GPU
+        GpuMemory::Track(GpuMemoryCategory::RenderTargets, texture.id,
+                         static_cast<size_t>(width) * height * 4);
+
         texture.isValid = true;
-        m_textures[name] = texture;
 
-        return &m_textures[name];
+        return Insert(name, std::move(texture));
     }
 
-    Texture *GetTexture(const std::string &name) {
-        const auto it = m_textures.find(name);
-        return (it != m_textures.end()) ? &it->second : nullptr;
+    TextureHandle CreateView(const std::string &name, const TextureHandle source) {
+        const Texture *sourceTexture = m_textures.Get(source);
+        if (!sourceTexture) {
+            return {};
+        }
+
+        Texture view = *sourceTexture;
+        view.isView = true;
+
+        return Insert(name, std::move(view));
+    }
+
+    static void Release(const Texture &texture) {
+        if (!texture.isValid || texture.isView) {
+            return;
+        }
+
+        TextureStreaming::Unregister(texture.id);
+        GpuMemory::Release(GpuMemoryCategory::Textures, texture.id);
+        GpuMemory::Release(GpuMemoryCategory::RenderTargets, texture.id);
+        glDeleteTextures(1, &texture.id);
+    }
+
+    bool Replace(const TextureHandle target, const TextureHandle source) {
+        Texture *targetTexture = m_textures.Get(target);
+        Texture *sourceTexture = m_textures.Get(source);
+        if (!targetTexture || !sourceTexture || target == source) {
+            return false;
+        }
+
+        Release(*targetTexture);
+        *targetTexture = std::move(*sourceTexture);
+
+        m_names.Remove(source);
+        m_refCounts.Erase(source);
+        m_textures.Remove(source);
+
+        return true;
+    }
+
+    void Destroy(const TextureHandle handle) {
+        if (const Texture *texture = m_textures.Get(handle)) {
+            Release(*texture);
+            m_names.Remove(handle);
+            m_refCounts.Erase(handle);
+            m_textures.Remove(handle);
+        }
+    }
+
+    Texture *Get(const TextureHandle handle) {
+        return m_textures.Get(handle);
+    }
+
+    TextureHandle Find(const std::string &name) {
+        return m_names.Find(name);
+    }
+
+    std::string GetName(const TextureHandle handle) {
+        return m_names.GetName(handle);
+    }
+
+    void AddRef(const TextureHandle handle) {
+        if (m_textures.Contains(handle)) {
+            m_refCounts.Add(handle);
+        }
+    }
+
+    void RemoveRef(const TextureHandle handle) {
+        m_refCounts.Remove(handle);
+    }
+
+    uint32_t GetRefCount(const TextureHandle handle) {
+        return m_refCounts.Get(handle);
+    }
+
+    size_t GetCount() {
+        return m_textures.Size();
+    }
+
+    size_t UnloadUnused() {
+        size_t queued = 0;
+        for (size_t i = 0; i < m_textures.Size(); i++) {
+            const TextureHandle handle = m_textures.GetHandle(i);
+            if (m_refCounts.Get(handle) > 0) {
+                continue;
+            }
+
+            ReleaseQueue::Enqueue([handle] {
+                if (m_refCounts.Get(handle) == 0) {
+                    Destroy(handle);
+                }
+            });
+            queued++;
+        }
+
+        return queued;
     }
 
     void Bind(const Texture *texture, const uint32_t slot) {
         if (texture && texture->isValid) {
             glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture(GL_TEXTURE_2D, texture->id);
+
+            if (GpuMemory::Touch(GpuMemoryCategory::Textures, texture->id)) {
+                glBindTexture(GL_TEXTURE_2D, texture->id);
+                return;
+            }
+
+            const Texture *placeholder = m_textures.Get(m_placeholder);
+            glBindTexture(GL_TEXTURE_2D, placeholder ? placeholder->id : 0);
         }
     }
 
+    void SetPlaceholder(const TextureHandle texture) {
+        m_placeholder = texture;
+    }
+
     void Unbind(const uint32_t slot) {
         glActiveTexture(GL_TEXTURE0 + slot);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void CleanUp() {
-        for (auto &[name, texture] : m_textures) {
-            if (texture.isValid) {
-                glDeleteTextures(1, &texture.id);
-            }
+        TextureStreaming::CleanUp();
+
+        for (const Texture &texture : m_textures) {
+            Release(texture);
         }
 
-        m_textures.clear();
+        m_textures.Clear();
+        m_names.Clear();
+        m_refCounts.Clear();
+        m_placeholder = {};
     }
 }
@@ -1,97 +1,895 @@
 #include "transform_system.h"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace TransformSystem {
-    static std::unordered_map<std::string, Transform> m_transforms;
+#if defined(__AVX__)
+    using Lanes = __m256;
+    static constexpr size_t m_width = 8;
+
+    static Lanes Load(const float *values) {
+        return _mm256_load_ps(values);
+    }
+
+    static Lanes Mul(const Lanes a, const Lanes b) {
+        return _mm256_mul_ps(a, b);
+    }
+
+    static Lanes Add(const Lanes a, const Lanes b) {
+        return _mm256_add_ps(a, b);
+    }
+
+    static Lanes Sub(const Lanes a, const Lanes b) {
+        return _mm256_sub_ps(a, b);
+    }
+
+    static Lanes Zero() {
+        return _mm256_setzero_ps();
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    using Lanes = __m128;
+    static constexpr size_t m_width = 4;
+
+    static Lanes Load(const float *values) {
+        return _mm_load_ps(values);
+    }
+
+    static Lanes Mul(const Lanes a, const Lanes b) {
+        return _mm_mul_ps(a, b);
+    }
+
+    static Lanes Add(const Lanes a, const Lanes b) {
+        return _mm_add_ps(a, b);
+    }
+
+    static Lanes Sub(const Lanes a, const Lanes b) {
+        return _mm_sub_ps(a, b);
+    }
+
+    static Lanes Zero() {
+        return _mm_setzero_ps();
+    }
+#elif defined(__ARM_NEON)
+    using Lanes = float32x4_t;
+    static constexpr size_t m_width = 4;
+
+    static Lanes Load(const float *values) {
+        return vld1q_f32(values);
+    }
+
+    static Lanes Mul(const Lanes a, const Lanes b) {
+        return vmulq_f32(a, b);
+    }
+
+    static Lanes Add(const Lanes a, const Lanes b) {
+        return vaddq_f32(a, b);
+    }
+
+    static Lanes Sub(const Lanes a, const Lanes b) {
+        return vsubq_f32(a, b);
+    }
+
+    static Lanes Zero() {
+        return vdupq_n_f32(0.0f);
+    }
+#else
+    using Lanes = float;
+    static constexpr size_t m_width = 1;
+
+    static Lanes Load(const float *values) {
+        return *values;
+    }
+
+    static Lanes Mul(const Lanes a, const Lanes b) {
+        return a * b;
+    }
+
+    static Lanes Add(const Lanes a, const Lanes b) {
+        return a + b;
+    }
+
+    static Lanes Sub(const Lanes a, const Lanes b) {
+        return a - b;
+    }
+
+    static Lanes Zero() {
+        return 0.0f;
+    }
+#endif
+
+    // the widest load needs 32 byte alignment, a lane batch never straddles it
+    template <typename T>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        static constexpr std::align_val_t Alignment{32};
+
+        AlignedAllocator() = default;
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U> &) {}
+
+        T *allocate(const size_t count) {
+            return static_cast<T *>(::operator new(count * sizeof(T), Alignment));
+        }
+
+        void deallocate(T *values, size_t) {
+            ::operator delete(values, Alignment);
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U> &) const {
+            return true;
+        }
+    };
+
+    template <typename T>
+    using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+    // rotation is kept as the sin and cos of each angle, set once in SetRotation,
+    // so composing needs no trigonometry
+    enum Component {
+        PositionX,
+        PositionY,
+        PositionZ,
+        SinX,
+        CosX,
+        SinY,
+        CosY,
+        SinZ,
+        CosZ,
+        ScaleX,
+        ScaleY,
+        ScaleZ,
+        ComponentCount
+    };
+
+    static constexpr float m_identity[ComponentCount] = {0.0f, 0.0f, 0.0f, 0.0f,
+                                                         1.0f, 0.0f, 1.0f, 0.0f,
+                                                         1.0f, 1.0f, 1.0f, 1.0f};
+
+    // a root and its descendants, a contiguous range of the hierarchy order
+    struct Subtree {
+        uint32_t begin;
+        uint32_t end;
+        bool dirty;
+    };
+
+    static constexpr uint32_t m_noParent = UINT32_MAX;
+
+    // below this many world matrices to revisit a thread costs more than it saves
+    static constexpr size_t m_parallelThreshold = 16384;
+
+    // every array follows the slot map's dense order. The component arrays and
+    // local matrices are padded with identity lanes to a whole batch
+    static SlotMap<Transform> m_slots;
+    static AlignedVector<float> m_components[ComponentCount];
+    static AlignedVector<glm::mat4> m_matrices;
+    static std::vector<glm::vec3> m_rotations;
+    static std::vector<uint64_t> m_dirty;
+    static std::vector<TransformHandle> m_parents;
+    static std::vector<uint32_t> m_childCounts;
+    static size_t m_capacity = 0;
+
+    // the hierarchy order: depth first from each root, so a parent always comes
+    // before its children. m_positions maps a dense index into it, the rest are
+    // indexed by it. Rebuilt when the hierarchy or the dense order changes. A
+    // root's world matrix is its local one, m_worlds only holds the children's
+    static std::vector<uint32_t> m_order;
+    static std::vector<uint32_t> m_positions;
+    static std::vector<uint32_t> m_orderParents;
+    static std::vector<uint32_t> m_subtreeOf;
+    static std::vector<uint8_t> m_worldDirty;
+    static std::vector<glm::mat4> m_worlds;
+    static std::vector<Subtree> m_subtrees;
+    static std::vector<uint32_t> m_dirtySubtrees;
+    static bool m_orderStale = false;
+
+    // anything changed since UpdateMatrices
+    static bool m_pending = false;
+    static Stats m_stats{};
+
+    // helpers for the world matrix update, started by the first update big enough
+    // to share and kept until CleanUp. Each generation hands every worker its run
+    // of m_dirtySubtrees in m_workRanges, the main thread takes what is left
+    static std::vector<std::thread> m_workers;
+    static std::vector<std::pair<size_t, size_t>> m_workRanges;
+    static std::mutex m_workMutex;
+    static std::condition_variable m_workCondition;
+    static std::condition_variable m_doneCondition;
+    static uint64_t m_generation = 0;
+    static size_t m_busyWorkers = 0;
+    static bool m_stopping = false;
+
+    static_assert(64 % m_width == 0, "a batch must not straddle a dirty word");
+
+    static constexpr uint64_t m_batchMask =
+        m_width == 64 ? ~uint64_t{0} : (uint64_t{1} << m_width) - 1;
+
+    static const Transform *Resolve(const TransformHandle handle) {
+        return m_slots.Get(handle);
+    }
+
+    static size_t IndexOf(const Transform *transform) {
+        return static_cast<size_t>(transform - m_slots.begin());
+    }
+
+    static void SetDirty(const size_t index) {
+        m_dirty[index / 64] |= uint64_t{1} << (index % 64);
+        m_pending = true;
+    }
+
+    static void ResetLane(const size_t index) {
+        for (size_t component = 0; component < ComponentCount; component++) {
+            m_components[component][index] = m_identity[component];
+        }
+        m_matrices[index] = glm::mat4(1.0f);
+        m_dirty[index / 64] &= ~(uint64_t{1} << (index % 64));
+    }
+
+    // the arrays hold a whole number of batches
+    static void Grow(const size_t count) {
+        if (count <= m_capacity) {
+            return;
+        }
+
+        m_capacity = (count + m_width - 1) / m_width * m_width;
+        for (size_t component = 0; component < ComponentCount; component++) {
+            m_components[component].resize(m_capacity, m_identity[component]);
+        }
+        m_matrices.resize(m_capacity, glm::mat4(1.0f));
+        m_dirty.resize((m_capacity + 63) / 64, 0);
+    }
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    // rows holds one matrix column for four transforms, row by row
+    static void StoreColumn(__m128 row0, __m128 row1, __m128 row2, __m128 row3,
+                            glm::mat4 *matrices, const int column) {
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+        _mm_storeu_ps(&matrices[0][column].x, row0);
+        _mm_storeu_ps(&matrices[1][column].x, row1);
+        _mm_storeu_ps(&matrices[2][column].x, row2);
+        _mm_storeu_ps(&matrices[3][column].x, row3);
+    }
+#endif
+
+    // columns[c][r] is row r of matrix column c for every lane, the bottom row is
+    // always (0, 0, 0, 1)
+    static void StoreMatrices(const Lanes (&columns)[4][3], glm::mat4 *matrices) {
+#if defined(__AVX__)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (int half = 0; half < 2; half++) {
+            for (int c = 0; c < 4; c++) {
+                __m128 rows[3];
+                for (int r = 0; r < 3; r++) {
+                    rows[r] = half == 0 ? _mm256_castps256_ps128(columns[c][r])
+                                        : _mm256_extractf128_ps(columns[c][r], 1);
+                }
+                StoreColumn(rows[0], rows[1], rows[2], c == 3 ? one : zero,
+                            matrices + half * 4, c);
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (int c = 0; c < 4; c++) {
+            StoreColumn(columns[c][0], columns[c][1], columns[c][2], c == 3 ? one : zero,
+                        matrices, c);
+        }
+#else
+        alignas(32) float values[4][3][m_width];
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 3; r++) {
+#if defined(__ARM_NEON)
+                vst1q_f32(values[c][r], columns[c][r]);
+#else
+                values[c][r][0] = columns[c][r];
+#endif
+            }
+        }
+
+        for (size_t lane = 0; lane < m_width; lane++) {
+            glm::mat4 &matrix = matrices[lane];
+            for (int c = 0; c < 4; c++) {
+                matrix[c] = glm::vec4(values[c][0][lane], values[c][1][lane],
+                                      values[c][2][lane], c == 3 ? 1.0f : 0.0f);
+            }
+        }
+#endif
+    }
+
+    // translate * rotateX * rotateY * rotateZ * scale for the batch starting at
+    // base, the same product glm::translate, rotate and scale build
+    static void ComposeBatch(const size_t base) {
+        const auto load = [base](const Component component) {
+            return Load(m_components[component].data() + base);
+        };
+
+        const Lanes sx = load(SinX);
+        const Lanes cx = load(CosX);
+        const Lanes sy = load(SinY);
+        const Lanes cy = load(CosY);
+        const Lanes sz = load(SinZ);
+        const Lanes cz = load(CosZ);
+        const Lanes scaleX = load(ScaleX);
+        const Lanes scaleY = load(ScaleY);
+        const Lanes scaleZ = load(ScaleZ);
+
+        const Lanes sxsy = Mul(sx, sy);
+        const Lanes cxsy = Mul(cx, sy);
+
+        const Lanes columns[4][3] = {
+            {
+                Mul(Mul(cy, cz), scaleX),
+                Mul(Add(Mul(cx, sz), Mul(sxsy, cz)), scaleX),
+                Mul(Sub(Mul(sx, sz), Mul(cxsy, cz)), scaleX),
+            },
+            {
+                Mul(Sub(Zero(), Mul(cy, sz)), scaleY),
+                Mul(Sub(Mul(cx, cz), Mul(sxsy, sz)), scaleY),
+                Mul(Add(Mul(sx, cz), Mul(cxsy, sz)), scaleY),
+            },
+            {
+                Mul(sy, scaleZ),
+                Mul(Sub(Zero(), Mul(sx, cy)), scaleZ),
+                Mul(Mul(cx, cy), scaleZ),
+            },
+            {load(PositionX), load(PositionY), load(PositionZ)},
+        };
+
+        StoreMatrices(columns, m_matrices.data() + base);
+    }
+
+    static void RebuildOrder() {
+        const size_t count = m_slots.Size();
+
+        // the children of dense index i are children[firstChild[i]..firstChild[i + 1]]
+        std::vector<uint32_t> firstChild(count + 1, 0);
+        std::vector<uint32_t> parentIndices(count, m_noParent);
+        for (size_t i = 0; i < count; i++) {
+            if (const Transform *parent = Resolve(m_parents[i])) {
+                parentIndices[i] = static_cast<uint32_t>(IndexOf(parent));
+                firstChild[parentIndices[i] + 1]++;
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            firstChild[i + 1] += firstChild[i];
+        }
+
+        std::vector<uint32_t> children(firstChild[count]);
+        std::vector<uint32_t> cursor(firstChild.begin(), firstChild.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            if (parentIndices[i] != m_noParent) {
+                children[cursor[parentIndices[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        m_order.clear();
+        m_orderParents.clear();
+        m_subtreeOf.clear();
+        m_subtrees.clear();
+        m_dirtySubtrees.clear();
+        m_positions.assign(count, m_noParent);
+        m_worldDirty.assign(count, 0);
+
+        std::vector<uint32_t> stack;
+        for (size_t root = 0; root < count; root++) {
+            if (parentIndices[root] != m_noParent) {
+                continue;
+            }
+
+            const auto begin = static_cast<uint32_t>(m_order.size());
+            const auto subtree = static_cast<uint32_t>(m_subtrees.size());
+
+            stack.push_back(static_cast<uint32_t>(root));
+            while (!stack.empty()) {
+                const uint32_t index = stack.back();
+                stack.pop_back();
+
+                m_positions[index] = static_cast<uint32_t>(m_order.size());
+                m_order.push_back(index);
+                m_orderParents.push_back(parentIndices[index] == m_noParent
+                                             ? m_noParent
+                                             : m_positions[parentIndices[index]]);
+                m_subtreeOf.push_back(subtree);
+
+                stack.insert(stack.end(), children.begin() + firstChild[index],
+                             children.begin() + firstChild[index + 1]);
+            }
+
+            const auto end = static_cast<uint32_t>(m_order.size());
+            const bool hasChildren = end - begin > 1;
+            if (hasChildren) {
+                std::fill(m_worldDirty.begin() + begin, m_worldDirty.begin() + end, 1);
+                m_dirtySubtrees.push_back(subtree);
+            }
+
+            m_subtrees.push_back({begin, end, hasChildren});
+        }
+
+        m_worlds.resize(count);
+        m_orderStale = false;
+    }
+
+    // marks the world matrices under a transform whose local matrix changed, a
+    // root without children has nothing under it
+    static void SetWorldDirty(const size_t index) {
+        if (!m_parents[index] && m_childCounts[index] == 0) {
+            return;
+        }
+
+        const uint32_t position = m_positions[index];
+        m_worldDirty[position] = 1;
+
+        const uint32_t subtree = m_subtreeOf[position];
+        if (!m_subtrees[subtree].dirty) {
+            m_subtrees[subtree].dirty = true;
+            m_dirtySubtrees.push_back(subtree);
+        }
+    }
+
+    static const glm::mat4 &GetWorld(const uint32_t position) {
+        return m_orderParents[position] == m_noParent ? m_matrices[m_order[position]]
+                                                      : m_worlds[position];
+    }
+
+    // a world matrix is recomputed when its own local matrix or its parent's world
+    // matrix changed, which the parent has already flagged by the time it is reached
+    static void UpdateSubtree(Subtree &subtree) {
+        for (uint32_t position = subtree.begin; position < subtree.end; position++) {
+            const uint32_t parent = m_orderParents[position];
+            if (parent != m_noParent && m_worldDirty[parent]) {
+                m_worldDirty[position] = 1;
+            }
+
+            if (m_worldDirty[position] && parent != m_noParent) {
+                m_worlds[position] = GetWorld(parent) * m_matrices[m_order[position]];
+            }
+        }
+
+        std::fill(m_worldDirty.begin() + subtree.begin,
+                  m_worldDirty.begin() + subtree.end, 0);
+        subtree.dirty = false;
+    }
+
+    static void UpdateRange(const size_t first, const size_t last) {
+        for (size_t i = first; i < last; i++) {
+            UpdateSubtree(m_subtrees[m_dirtySubtrees[i]]);
+        }
+    }
+
+    static void WorkerLoop(const size_t worker, uint64_t generation) {
+        while (true) {
+            std::pair<size_t, size_t> range;
+            {
+                std::unique_lock lock(m_workMutex);
+                m_workCondition.wait(lock, [generation] {
+                    return m_stopping || m_generation != generation;
+                });
+                if (m_stopping) {
+                    return;
+                }
+
+                generation = m_generation;
+                range = m_workRanges[worker];
+            }
+
+            UpdateRange(range.first, range.second);
+
+            std::lock_guard lock(m_workMutex);
+            if (--m_busyWorkers == 0) {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+
+    static void StartWorkers() {
+        // the main thread is the last of them
+        const size_t cores = std::thread::hardware_concurrency();
+        const size_t workerCount = cores > 1 ? cores - 1 : 0;
+
+        m_stopping = false;
+        m_workRanges.assign(workerCount, {0, 0});
+        for (size_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(WorkerLoop, i, m_generation);
+        }
+    }
+
+    static void StopWorkers() {
+        {
+            std::lock_guard lock(m_workMutex);
+            m_stopping = true;
+        }
+        m_workCondition.notify_all();
+
+        for (auto &worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+        m_workRanges.clear();
+        m_stopping = false;
+    }
+
+    // subtrees share nothing, each worker takes a run of them
+    static void UpdateWorldMatrices() {
+        const std::vector<uint32_t> &dirty = m_dirtySubtrees;
+        const auto size = [&dirty](const size_t i) {
+            return m_subtrees[dirty[i]].end - m_subtrees[dirty[i]].begin;
+        };
+
+        size_t total = 0;
+        for (size_t i = 0; i < dirty.size(); i++) {
+            total += size(i);
+        }
+
+        m_stats.propagated = static_cast<uint32_t>(total);
+
+        if (total >= m_parallelThreshold && dirty.size() > 1 && m_workers.empty()) {
+            StartWorkers();
+        }
+
+        if (total < m_parallelThreshold || dirty.size() < 2 || m_workers.empty()) {
+            UpdateRange(0, dirty.size());
+            m_dirtySubtrees.clear();
+            return;
+        }
+
+        const size_t share = total / (m_workers.size() + 1);
+
+        size_t first = 0;
+        {
+            std::lock_guard lock(m_workMutex);
+            for (auto &range : m_workRanges) {
+                size_t last = first;
+                for (size_t taken = 0; last < dirty.size() && taken < share; last++) {
+                    taken += size(last);
+                }
+
+                range = {first, last};
+                first = last;
+            }
+
+            m_busyWorkers = m_workers.size();
+            m_generation++;
+        }
+        m_workCondition.notify_all();
+
+        UpdateRange(first, dirty.size());
+
+        {
+            std::unique_lock lock(m_workMutex);
+            m_doneCondition.wait(lock, [] { return m_busyWorkers == 0; });
+        }
+
+        m_dirtySubtrees.clear();
+    }
 
     void Init() {
-        m_transforms.clear();
+        CleanUp();
     }
 
-    Transform *CreateTransform(const std::string &name) {
-        Transform transform{};
-        transform.isDirty = true;
+    static void StoreRotation(const size_t index, const glm::vec3 &rotation) {
+        const glm::vec3 radians = glm::radians(rotation);
 
-        m_transforms[name] = transform;
+        m_rotations[index] = rotation;
+        m_components[SinX][index] = std::sin(radians.x);
+        m_components[CosX][index] = std::cos(radians.x);
+        m_components[SinY][index] = std::sin(radians.y);
+        m_components[CosY][index] = std::cos(radians.y);
+        m_components[SinZ][index] = std::sin(radians.z);
+        m_components[CosZ][index] = std::cos(radians.z);
+    }
+
+    // the transform the slot map just added at index, which is a root
+    static void Append(const size_t index) {
+        ResetLane(index);
+        m_rotations.emplace_back(0.0f);
+        m_parents.emplace_back();
+        m_childCounts.push_back(0);
+        SetDirty(index);
 
-        return &m_transforms[name];
+        // a new root goes on the end of the hierarchy order as its own subtree
+        if (!m_orderStale) {
+            const auto position = static_cast<uint32_t>(m_order.size());
+            m_positions.push_back(position);
+            m_order.push_back(static_cast<uint32_t>(index));
+            m_orderParents.push_back(m_noParent);
+            m_subtreeOf.push_back(static_cast<uint32_t>(m_subtrees.size()));
+            m_subtrees.push_back({position, position + 1, false});
+            m_worlds.emplace_back(1.0f);
+            m_worldDirty.push_back(0);
+        }
     }
 
-    Transform *GetTransform(const std::string &name) {
-        const auto it = m_transforms.find(name);
-        return (it != m_transforms.end()) ? &it->second : nullptr;
+    TransformHandle CreateTransform() {
+        const TransformHandle handle = m_slots.Insert({});
+        if (!handle) {
+            return {};
+        }
+
+        const size_t index = m_slots.Size() - 1;
+        Grow(index + 1);
+        Append(index);
+
+        return handle;
     }
 
-    void SetPosition(Transform *transform, const glm::vec3 &position) {
-        if (transform) {
-            transform->position = position;
-            transform->isDirty = true;
+    std::vector<TransformHandle> CreateTransforms(const std::span<const Trs> values) {
+        std::vector<TransformHandle> handles;
+        handles.reserve(values.size());
+
+        const size_t count = m_slots.Size() + values.size();
+        m_slots.Reserve(count);
+        m_rotations.reserve(count);
+        m_parents.reserve(count);
+        m_childCounts.reserve(count);
+        Grow(count);
+
+        for (const Trs &value : values) {
+            const TransformHandle handle = m_slots.Insert({});
+            if (!handle) {
+                break;
+            }
+
+            const size_t index = m_slots.Size() - 1;
+            Append(index);
+
+            m_components[PositionX][index] = value.position.x;
+            m_components[PositionY][index] = value.position.y;
+            m_components[PositionZ][index] = value.position.z;
+            m_components[ScaleX][index] = value.scale.x;
+            m_components[ScaleY][index] = value.scale.y;
+            m_components[ScaleZ][index] = value.scale.z;
+            StoreRotation(index, value.rotation);
+
+            handles.push_back(handle);
         }
+
+        return handles;
     }
 
-    glm::vec3 GetPosition(const Transform *transform) {
+    void DestroyTransform(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
         if (!transform) {
-            return glm::vec3{};
+            return;
+        }
+
+        const size_t index = IndexOf(transform);
+        if (m_childCounts[index] > 0) {
+            for (TransformHandle &parent : m_parents) {
+                if (parent == handle) {
+                    parent = {};
+                }
+            }
+        }
+
+        if (const Transform *parent = Resolve(m_parents[index])) {
+            m_childCounts[IndexOf(parent)]--;
+        }
+
+        // mirrors the slot map, which moves its last entry into the hole
+        const size_t last = m_slots.Size() - 1;
+        m_slots.Remove(handle);
+
+        if (index != last) {
+            for (auto &component : m_components) {
+                component[index] = component[last];
+            }
+            m_matrices[index] = m_matrices[last];
+            m_rotations[index] = m_rotations[last];
+            m_parents[index] = m_parents[last];
+            m_childCounts[index] = m_childCounts[last];
+            SetDirty(index);
         }
 
-        return transform->position;
+        m_rotations.pop_back();
+        m_parents.pop_back();
+        m_childCounts.pop_back();
+        ResetLane(last);
+
+        m_orderStale = true;
+        m_pending = true;
+    }
+
+    bool IsValid(const TransformHandle handle) {
+        return m_slots.Contains(handle);
     }
 
-    void SetRotation(Transform *transform, const glm::vec3 &rotation) {
-        if (transform) {
-            transform->rotation = rotation;
-            transform->isDirty = true;
+    bool SetParent(const TransformHandle handle, const TransformHandle parent) {
+        const Transform *transform = Resolve(handle);
+        if (!transform || (parent && !m_slots.Contains(parent))) {
+            return false;
+        }
+
+        for (TransformHandle ancestor = parent; ancestor;
+             ancestor = m_parents[IndexOf(Resolve(ancestor))]) {
+            if (ancestor == handle) {
+                ErrorHandler::Warn("A transform can't be parented to its own descendant",
+                                   __FILE__, __func__, __LINE__);
+                return false;
+            }
+        }
+
+        const size_t index = IndexOf(transform);
+        if (m_parents[index] == parent) {
+            return true;
         }
+
+        if (const Transform *previous = Resolve(m_parents[index])) {
+            m_childCounts[IndexOf(previous)]--;
+        }
+        if (parent) {
+            m_childCounts[IndexOf(Resolve(parent))]++;
+        }
+
+        m_parents[index] = parent;
+        m_orderStale = true;
+        m_pending = true;
+
+        return true;
+    }
+
+    TransformHandle GetParent(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
+        return transform ? m_parents[IndexOf(transform)] : TransformHandle{};
     }
 
-    glm::vec3 GetRotation(const Transform *transform) {
+    void SetPosition(const TransformHandle handle, const glm::vec3 &position) {
+        if (const Transform *transform = Resolve(handle)) {
+            const size_t index = IndexOf(transform);
+            m_components[PositionX][index] = position.x;
+            m_components[PositionY][index] = position.y;
+            m_components[PositionZ][index] = position.z;
+            SetDirty(index);
+        }
+    }
+
+    glm::vec3 GetPosition(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
         if (!transform) {
             return glm::vec3{};
         }
 
-        return transform->rotation;
+        const size_t index = IndexOf(transform);
+        return {m_components[PositionX][index], m_components[PositionY][index],
+                m_components[PositionZ][index]};
+    }
+
+    void SetRotation(const TransformHandle handle, const glm::vec3 &rotation) {
+        if (const Transform *transform = Resolve(handle)) {
+            const size_t index = IndexOf(transform);
+            StoreRotation(index, rotation);
+            SetDirty(index);
+        }
+    }
+
+    glm::vec3 GetRotation(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
+        return transform ? m_rotations[IndexOf(transform)] : glm::vec3{};
     }
 
-    void SetScale(Transform *transform, const glm::vec3 &scale) {
-        if (transform) {
-            transform->scale = scale;
-            transform->isDirty = true;
+    void SetScale(const TransformHandle handle, const glm::vec3 &scale) {
+        if (const Transform *transform = Resolve(handle)) {
+            const size_t index = IndexOf(transform);
+            m_components[ScaleX][index] = scale.x;
+            m_components[ScaleY][index] = scale.y;
+            m_components[ScaleZ][index] = scale.z;
+            SetDirty(index);
         }
     }
 
-    glm::vec3 GetScale(const Transform *transform) {
+    glm::vec3 GetScale(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
         if (!transform) {
             return glm::vec3{};
         }
 
-        return transform->scale;
+        const size_t index = IndexOf(transform);
+        return {m_components[ScaleX][index], m_components[ScaleY][index],
+                m_components[ScaleZ][index]};
     }
 
-    const glm::mat4 &GetModelMatrix(Transform *transform) {
+    void UpdateMatrices() {
+        m_stats.composed = 0;
+        m_stats.propagated = 0;
+        if (!m_pending) {
+            return;
+        }
+
+        // a rebuilt order has every world matrix dirty already
+        const bool rebuilt = m_orderStale;
+        if (rebuilt) {
+            RebuildOrder();
+        }
+
+        for (size_t word = 0; word < m_dirty.size(); word++) {
+            uint64_t bits = m_dirty[word];
+            m_stats.composed += static_cast<uint32_t>(std::popcount(bits));
+
+            for (uint64_t changed = rebuilt ? 0 : bits; changed; changed &= changed - 1) {
+                SetWorldDirty(word * 64 + std::countr_zero(changed));
+            }
+
+            // a batch is composed whole, clean lanes in it just get the same matrix
+            while (bits) {
+                const size_t offset = std::countr_zero(bits) / m_width * m_width;
+                ComposeBatch(word * 64 + offset);
+                bits &= ~(m_batchMask << offset);
+            }
+
+            m_dirty[word] = 0;
+        }
+
+        UpdateWorldMatrices();
+        m_pending = false;
+    }
+
+    const glm::mat4 &GetModelMatrix(const TransformHandle handle) {
+        const Transform *transform = Resolve(handle);
         if (!transform) {
             static glm::mat4 identityMatrix(1.0f);
             return identityMatrix;
         }
 
-        if (transform->isDirty) {
-            glm::mat4 model(1.0f);
+        if (m_pending) {
+            UpdateMatrices();
+        }
 
-            model = glm::translate(model, transform->position);
-            model = glm::rotate(model, glm::radians(transform->rotation.x),
-                                glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(transform->rotation.y),
-                                glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(transform->rotation.z),
-                                glm::vec3(0.0f, 0.0f, 1.0f));
-            model = glm::scale(model, transform->scale);
+        const size_t index = IndexOf(transform);
+        return m_parents[index] ? m_worlds[m_positions[index]] : m_matrices[index];
+    }
 
-            transform->modelMatrix = model;
-            transform->isDirty = false;
-        }
+    Stats GetStats() {
+        Stats stats = m_stats;
+        stats.transforms = static_cast<uint32_t>(m_slots.Size());
+
+        return stats;
+    }
 
-        return transform->modelMatrix;
+    size_t GetBatchWidth() {
+        return m_width;
     }
 
     void CleanUp() {
-        m_transforms.clear();
+        StopWorkers();
+
+        m_slots.Clear();
+        for (auto &component : m_components) {
+            component.clear();
+        }
+        m_matrices.clear();
+        m_rotations.clear();
+        m_dirty.clear();
+        m_parents.clear();
+        m_childCounts.clear();
+        m_capacity = 0;
+
+        m_order.clear();
+        m_positions.clear();
+        m_orderParents.clear();
+        m_subtreeOf.clear();
+        m_worldDirty.clear();
+        m_worlds.clear();
+        m_subtrees.clear();
+        m_dirtySubtrees.clear();
+        m_orderStale = false;
+        m_pending = false;
+        m_stats = {};
     }
 }
@@ -2,17 +2,24 @@
 
 #include <renderer.h>
 
+#include "async_loader.h"
 #include "backend.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
+#include "camera_system.h"
 #include "cursor_manager.h"
+#include "derived_cache.h"
+#include "gpu_memory.h"
 #include "imgui.h"
 #include "input.h"
+#include "instance_format.h"
+#include "scene_loader.h"
 #include "scene_system.h"
 #include "serialisation.h"
+#include "texture_streaming.h"
 
 namespace Ui {
-    static int selectedEntityIndex = -1;
+    static SceneSystem::EntityId selectedEntity;
     static bool firstTime = true;
     static ImVec2 windowPos(20, 20);
 
@@ -20,6 +27,117 @@ namespace Ui {
         if (ImGui::CollapsingHeader("Performance", ImGuiTreeNodeFlags_DefaultOpen)) {
             ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
             ImGui::Text("Frametime: %.3f ms", 1000.0f / ImGui::GetIO().Framerate);
+
+            ImGui::Separator();
+
+            int layout = static_cast<int>(Renderer::GetInstanceLayout());
+            const char *layoutNames[] = {
+                InstanceFormat::GetName(InstanceLayout::Full),
+                InstanceFormat::GetName(InstanceLayout::Affine),
+                InstanceFormat::GetName(InstanceLayout::Trs),
+                InstanceFormat::GetName(InstanceLayout::TrsHalf),
+            };
+            if (ImGui::Combo("Instance Layout", &layout, layoutNames,
+                             IM_ARRAYSIZE(layoutNames))) {
+                Renderer::SetInstanceLayout(static_cast<InstanceLayout>(layout));
+            }
+
+            const Renderer::Stats &stats = Renderer::GetStats();
+            ImGui::Text("Instances: %u (%.1f KB, %.3f ms)", stats.instanceCount,
+                        static_cast<float>(stats.instanceBytes) / 1024.0f,
+                        stats.instanceUploadMs);
+            ImGui::Text("Batches: %u drawn, %u collapsed by aliasing", stats.batches,
+                        stats.collapsedBatches);
+
+            const Bvh::Stats spatial = SceneSystem::GetSpatialStats();
+            ImGui::Text("BVH: %u entities, %u nodes, %u builds (last %.1f ms), %u refits",
+                        spatial.items, spatial.nodes, spatial.builds, spatial.buildMs,
+                        spatial.refits);
+
+            const StaticGeometry::Stats baked = SceneSystem::GetStaticStats();
+            ImGui::Text("Static: %u entities, %u chunks (%.1f KB), %u bakes (%.2f ms)",
+                        baked.pieces, baked.chunks,
+                        static_cast<float>(baked.bakedBytes) / 1024.0f, baked.bakes,
+                        baked.lastBakeMs);
+            ImGui::Text("Static chunks: %u drawn, %u culled", stats.staticDrawn,
+                        stats.staticCulled);
+
+            ImGui::Separator();
+
+            const AsyncLoader::Stats loader = AsyncLoader::GetStats();
+            ImGui::Text("Loading: %u decoding, %u awaiting upload, %u uploading",
+                        loader.decoding, loader.waitingForUpload, loader.uploading);
+            ImGui::Text("Loaded: %u (%u failed), %.1f KB this frame", loader.completed,
+                        loader.failed,
+                        static_cast<float>(loader.uploadedBytes) / 1024.0f);
+
+            int budgetMb =
+                static_cast<int>(AsyncLoader::GetUploadBudget() / (1024 * 1024));
+            if (ImGui::SliderInt("Upload Budget (MB/frame)", &budgetMb, 1, 64)) {
+                AsyncLoader::SetUploadBudget(static_cast<size_t>(budgetMb) * 1024 * 1024);
+            }
+
+            ImGui::Separator();
+
+            const TextureStreaming::Stats streaming = TextureStreaming::GetStats();
+            ImGui::Text("Streamed textures: %u, %u reads pending", streaming.textures,
+                        streaming.pendingReads);
+            ImGui::Text("Mips resident: %.1f MB of %.1f MB wanted",
+                        static_cast<float>(streaming.residentBytes) / (1024.0f * 1024.0f),
+                        static_cast<float>(streaming.requestedBytes) /
+                            (1024.0f * 1024.0f));
+            ImGui::Text("Levels loaded: %u, evicted: %u", streaming.levelsLoaded,
+                        streaming.levelsEvicted);
+
+            int streamingMb =
+                static_cast<int>(TextureStreaming::GetBudget() / (1024 * 1024));
+            if (ImGui::SliderInt("Texture Budget (MB)", &streamingMb, 16, 2048)) {
+                TextureStreaming::SetBudget(static_cast<size_t>(streamingMb) * 1024 *
+                                            1024);
+            }
+
+            ImGui::Separator();
+
+            const DerivedCache::Stats cache = DerivedCache::GetStats();
+            ImGui::Text("Derived cache: %u hits, %u misses, %u stores", cache.hits,
+                        cache.misses, cache.stores);
+            ImGui::Text("Cache size: %.1f MB, %u evicted",
+                        static_cast<float>(cache.bytes) / (1024.0f * 1024.0f),
+                        cache.evictions);
+        }
+    }
+
+    static void RenderGpuMemorySection() {
+        if (ImGui::CollapsingHeader("GPU Memory")) {
+            constexpr float megabyte = 1024.0f * 1024.0f;
+            const GpuMemory::Stats stats = GpuMemory::GetStats();
+
+            for (size_t i = 0; i < static_cast<size_t>(GpuMemoryCategory::Count); i++) {
+                const GpuMemory::Usage &usage = stats.categories[i];
+                ImGui::Text("%s: %.1f MB in %u objects",
+                            GpuMemory::GetName(static_cast<GpuMemoryCategory>(i)),
+                            static_cast<float>(usage.bytes) / megabyte,
+                            usage.allocations);
+            }
+
+            const float used = static_cast<float>(stats.total) / megabyte;
+            const float budget = static_cast<float>(stats.budget) / megabyte;
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", used, budget);
+            ImGui::ProgressBar(budget > 0.0f ? std::min(used / budget, 1.0f) : 0.0f,
+                               ImVec2(-1.0f, 0.0f), overlay);
+
+            ImGui::Text("Evictions: %u (%.1f MB), reloads: %u", stats.evictions,
+                        static_cast<float>(stats.evictedBytes) / megabyte, stats.reloads);
+            if (stats.overBudget) {
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f),
+                                   "Working set exceeds the budget");
+            }
+
+            int budgetMb = static_cast<int>(stats.budget / (1024 * 1024));
+            if (ImGui::SliderInt("Budget (MB)", &budgetMb, 64, 8192)) {
+                GpuMemory::SetBudget(static_cast<size_t>(budgetMb) * 1024 * 1024);
+            }
         }
     }
 
@@ -36,123 +154,150 @@ namespace Ui {
         }
     }
 
-    static void RenderEntityProperties(SceneSystem::Entity *entity, bool isLight) {
-        if (entity->transform) {
-            const glm::vec3 position = TransformSystem::GetPosition(entity->transform);
+    static void RenderEntityProperties(const SceneSystem::EntityId entity) {
+        LightSystem::Light *light = SceneSystem::GetLight(entity);
+
+        if (const TransformSystem::TransformHandle transform =
+                SceneSystem::GetTransform(entity)) {
+            const glm::vec3 position = TransformSystem::GetPosition(transform);
             if (float pos[3] = {position.x, position.y, position.z};
                 ImGui::DragFloat3("Position", pos, 0.1f)) {
-                TransformSystem::SetPosition(entity->transform,
+                TransformSystem::SetPosition(transform,
                                              glm::vec3(pos[0], pos[1], pos[2]));
+                SceneSystem::MarkChanged(entity);
 
-                if (isLight) {
-                    for (const std::vector<LightSystem::Light *> &lights =
-                             LightSystem::GetAllLights();
-                         auto *light : lights) {
-                        if (light->name == entity->name ||
-                            light->name + "_visual" == entity->name) {
-                            light->position = glm::vec3(pos[0], pos[1], pos[2]);
-                            break;
-                        }
-                    }
+                if (light) {
+                    light->position = glm::vec3(pos[0], pos[1], pos[2]);
                 }
             }
 
-            const glm::vec3 scale = TransformSystem::GetScale(entity->transform);
+            const glm::vec3 scale = TransformSystem::GetScale(transform);
             if (float scl[3] = {scale.x, scale.y, scale.z};
                 ImGui::DragFloat3("Scale", scl, 0.1f, 0.1f, 10.0f)) {
-                TransformSystem::SetScale(entity->transform,
-                                          glm::vec3(scl[0], scl[1], scl[2]));
+                TransformSystem::SetScale(transform, glm::vec3(scl[0], scl[1], scl[2]));
+                SceneSystem::MarkChanged(entity);
             }
 
-            const glm::vec3 rotation = entity->transform->rotation;
+            const glm::vec3 rotation = TransformSystem::GetRotation(transform);
             if (float rot[3] = {rotation.x, rotation.y, rotation.z};
                 ImGui::DragFloat3("Rotation", rot, 1.0f, -180.0f, 180.0f)) {
-                TransformSystem::SetRotation(entity->transform,
+                TransformSystem::SetRotation(transform,
                                              glm::vec3(rot[0], rot[1], rot[2]));
+                SceneSystem::MarkChanged(entity);
             }
         }
 
-        float color[4] = {entity->color.r, entity->color.g, entity->color.b,
-                          entity->color.a};
+        bool active = SceneSystem::IsActive(entity);
+        if (ImGui::Checkbox("Active", &active)) {
+            SceneSystem::SetActive(entity, active);
+        }
+
+        bool isStatic = SceneSystem::IsStatic(entity);
+        if (ImGui::Checkbox("Static", &isStatic)) {
+            SceneSystem::SetStatic(entity, isStatic);
+        }
+
+        SceneSystem::Render *render = SceneSystem::GetRender(entity);
+        if (!render) {
+            return;
+        }
+
+        float color[4] = {render->color.r, render->color.g, render->color.b,
+                          render->color.a};
 
         if (ImGui::ColorEdit4("Color", color)) {
-            entity->color = glm::vec4(color[0], color[1], color[2], color[3]);
-
-            if (isLight) {
-                for (const std::vector<LightSystem::Light *> &lights =
-                         LightSystem::GetAllLights();
-                     auto *light : lights) {
-                    if (light->name == entity->name ||
-                        light->name + "_visual" == entity->name) {
-                        light->color = glm::vec3(color[0], color[1], color[2]);
-                        break;
-                    }
-                }
+            render->color = glm::vec4(color[0], color[1], color[2], color[3]);
+            SceneSystem::MarkChanged(entity);
+
+            if (light) {
+                light->color = glm::vec3(color[0], color[1], color[2]);
             }
         }
     }
 
-    static void RenderLightProperties(const std::string &entityName) {
-        for (const std::vector<LightSystem::Light *> &lights =
-                 LightSystem::GetAllLights();
-             auto *light : lights) {
-            if (light->name == entityName || light->name + "_visual" == entityName) {
-                float intensity = light->intensity;
-                if (ImGui::SliderFloat("Light Intensity", &intensity, 0.0f, 5.0f)) {
-                    light->intensity = intensity;
-                }
+    static void RenderLightProperties(LightSystem::Light *light) {
+        float intensity = light->intensity;
+        if (ImGui::SliderFloat("Light Intensity", &intensity, 0.0f, 5.0f)) {
+            light->intensity = intensity;
+        }
 
-                if (light->type == LightSystem::LightType::Directional) {
-                    float direction[3] = {light->direction.x, light->direction.y,
-                                          light->direction.z};
-
-                    if (ImGui::DragFloat3("Direction", direction, 0.1f, -1.0f, 1.0f)) {
-                        const float length = sqrtf(direction[0] * direction[0] +
-                                                   direction[1] * direction[1] +
-                                                   direction[2] * direction[2]);
-                        if (length > 0.0001f) {
-                            light->direction.x = direction[0] / length;
-                            light->direction.y = direction[1] / length;
-                            light->direction.z = direction[2] / length;
-                        }
-                    }
+        if (light->type == LightSystem::LightType::Directional) {
+            float direction[3] = {light->direction.x, light->direction.y,
+                                  light->direction.z};
+
+            if (ImGui::DragFloat3("Direction", direction, 0.1f, -1.0f, 1.0f)) {
+                const float length =
+                    sqrtf(direction[0] * direction[0] + direction[1] * direction[1] +
+                          direction[2] * direction[2]);
+                if (length > 0.0001f) {
+                    light->direction.x = direction[0] / length;
+                    light->direction.y = direction[1] / length;
+                    light->direction.z = direction[2] / length;
                 }
-
-                break;
             }
         }
     }
 
     static void RenderEntityControlsSection() {
         if (ImGui::CollapsingHeader("Entity Controls", ImGuiTreeNodeFlags_DefaultOpen)) {
-            const std::vector<SceneSystem::Entity *> &entities =
+            const std::vector<SceneSystem::EntityId> &entities =
                 SceneSystem::GetAllEntities();
 
+            std::vector<std::string> names;
             std::vector<const char *> entityNames;
+            names.reserve(entities.size());
             entityNames.reserve(entities.size());
 
-            for (const auto *entity : entities) {
-                entityNames.push_back(entity->name.c_str());
+            int selectedIndex = -1;
+            for (const SceneSystem::EntityId entity : entities) {
+                if (entity == selectedEntity) {
+                    selectedIndex = static_cast<int>(names.size());
+                }
+
+                names.push_back(SceneSystem::GetName(entity));
+                if (names.back().empty()) {
+                    names.back() = "#" + std::to_string(entity.GetIndex());
+                }
             }
 
-            if (ImGui::Combo("Select Entity", &selectedEntityIndex, entityNames.data(),
-                             static_cast<int>(entityNames.size()))) {
+            for (const std::string &name : names) {
+                entityNames.push_back(name.c_str());
             }
 
-            if (selectedEntityIndex >= 0 &&
-                selectedEntityIndex < static_cast<int>(entities.size())) {
-                SceneSystem::Entity *entity = entities[selectedEntityIndex];
+            if (ImGui::Combo("Select Entity", &selectedIndex, entityNames.data(),
+                             static_cast<int>(entityNames.size()))) {
+                selectedEntity = entities[selectedIndex];
+            }
 
-                const bool isLight = entity->name.find("light") != std::string::npos ||
-                                     entity->name.find("point") != std::string::npos;
+            if (SceneSystem::IsValid(selectedEntity)) {
+                const SceneSystem::EntityId entity = selectedEntity;
 
                 ImGui::Separator();
-                ImGui::Text("Entity: %s", entity->name.c_str());
+                ImGui::Text("Entity: %s", names[selectedIndex].c_str());
+
+                // the first entry is no parent, the rest follow the entity list
+                std::vector<const char *> parentNames{"None"};
+                parentNames.insert(parentNames.end(), entityNames.begin(),
+                                   entityNames.end());
+
+                int parentIndex = 0;
+                for (size_t i = 0; i < entities.size(); i++) {
+                    if (entities[i] == SceneSystem::GetParent(entity)) {
+                        parentIndex = static_cast<int>(i) + 1;
+                    }
+                }
+
+                if (ImGui::Combo("Parent", &parentIndex, parentNames.data(),
+                                 static_cast<int>(parentNames.size()))) {
+                    SceneSystem::SetParent(entity, parentIndex == 0
+                                                       ? SceneSystem::EntityId{}
+                                                       : entities[parentIndex - 1]);
+                }
 
-                RenderEntityProperties(entity, isLight);
+                RenderEntityProperties(entity);
 
-                if (isLight) {
-                    RenderLightProperties(entity->name);
+                if (LightSystem::Light *light = SceneSystem::GetLight(entity)) {
+                    RenderLightProperties(light);
                 }
             }
         }
@@ -161,24 +306,18 @@ namespace Ui {
     static void RenderMaterialPropertiesSection() {
         if (ImGui::CollapsingHeader("Material Properties",
                                     ImGuiTreeNodeFlags_DefaultOpen)) {
-            const std::vector<SceneSystem::Entity *> &entities =
-                SceneSystem::GetAllEntities();
-
-            if (selectedEntityIndex >= 0 &&
-                selectedEntityIndex < static_cast<int>(entities.size())) {
-                SceneSystem::Entity *entity = entities[selectedEntityIndex];
-
-                if (entity->material) {
+            if (const SceneSystem::Render *render =
+                    SceneSystem::GetRender(selectedEntity)) {
+                if (auto *material = MaterialSystem::Get(render->material)) {
                     bool updateMaterial = false;
 
-                    float ambientStrength = MaterialSystem::GetFloat(
-                        entity->material, "ambientStrength", 0.1f);
-                    float diffuseStrength = MaterialSystem::GetFloat(
-                        entity->material, "diffuseStrength", 0.7f);
-                    float specularStrength = MaterialSystem::GetFloat(
-                        entity->material, "specularStrength", 0.5f);
-                    float shininess =
-                        MaterialSystem::GetFloat(entity->material, "shininess");
+                    float ambientStrength =
+                        MaterialSystem::GetFloat(material, "ambientStrength"_id, 0.1f);
+                    float diffuseStrength =
+                        MaterialSystem::GetFloat(material, "diffuseStrength"_id, 0.7f);
+                    float specularStrength =
+                        MaterialSystem::GetFloat(material, "specularStrength"_id, 0.5f);
+                    float shininess = MaterialSystem::GetFloat(material, "shininess"_id);
 
                     updateMaterial |= ImGui::SliderFloat("Ambient Strength",
                                                          &ambientStrength, 0.0f, 1.0f);
@@ -189,33 +328,30 @@ namespace Ui {
                     updateMaterial |=
                         ImGui::SliderFloat("Shininess", &shininess, 0.0f, 10.0f);
 
-                    int useTexture =
-                        MaterialSystem::GetInt(entity->material, "useTexture", 0);
+                    int useTexture = MaterialSystem::GetInt(material, "useTexture"_id, 0);
                     bool useTextureChecked = useTexture > 0;
                     if (ImGui::Checkbox("Use Texture", &useTextureChecked)) {
-                        MaterialSystem::SetInt(entity->material, "useTexture",
+                        MaterialSystem::SetInt(material, "useTexture"_id,
                                                useTextureChecked ? 1 : 0);
                         updateMaterial = true;
                     }
 
-                    int isEmissive =
-                        MaterialSystem::GetInt(entity->material, "isEmissive", 0);
+                    int isEmissive = MaterialSystem::GetInt(material, "isEmissive"_id, 0);
                     bool isEmissiveChecked = isEmissive > 0;
                     if (ImGui::Checkbox("Is Emissive", &isEmissiveChecked)) {
-                        MaterialSystem::SetInt(entity->material, "isEmissive",
+                        MaterialSystem::SetInt(material, "isEmissive"_id,
                                                isEmissiveChecked ? 1 : 0);
                         updateMaterial = true;
                     }
 
                     if (updateMaterial) {
-                        MaterialSystem::SetFloat(entity->material, "ambientStrength",
+                        MaterialSystem::SetFloat(material, "ambientStrength"_id,
                                                  ambientStrength);
-                        MaterialSystem::SetFloat(entity->material, "diffuseStrength",
+                        MaterialSystem::SetFloat(material, "diffuseStrength"_id,
                                                  diffuseStrength);
-                        MaterialSystem::SetFloat(entity->material, "specularStrength",
+                        MaterialSystem::SetFloat(material, "specularStrength"_id,
                                                  specularStrength);
-                        MaterialSystem::SetFloat(entity->material, "shininess",
-                                                 shininess);
+                        MaterialSystem::SetFloat(material, "shininess"_id, shininess);
                     }
                 } else {
                     ImGui::Text("Selected entity has no material.");
@@ -262,6 +398,12 @@ namespace Ui {
                     ImGui::SetTooltip("File will be saved to the scenes directory");
                 }
 
+                static bool saveBinary = false;
+                ImGui::Checkbox("Binary (.scene)", &saveBinary);
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Faster to load, the TOML file stays the source");
+                }
+
                 static bool showSaveConfirmation = false;
                 if (ImGui::Button("Save Scene") && !showSaveConfirmation) {
                     if (strlen(sceneNameBuffer) > 0 && strlen(filenameBuffer) > 0) {
@@ -297,7 +439,12 @@ namespace Ui {
                     if (ImGui::Button("Save", ImVec2(120, 0))) {
                         SceneSystem::SetSceneName(sceneNameBuffer);
 
-                        if (Serialisation::Serialise(filenameBuffer, sceneNameBuffer)) {
+                        const bool saved =
+                            saveBinary ? Serialisation::SerialiseBinary(filenameBuffer,
+                                                                        sceneNameBuffer)
+                                       : Serialisation::Serialise(filenameBuffer,
+                                                                  sceneNameBuffer);
+                        if (saved) {
                             ImGui::CloseCurrentPopup();
                             showSaveConfirmation = false;
 
@@ -355,8 +502,8 @@ namespace Ui {
                 ImGui::InputText("Filename to Load", loadFilenameBuffer,
                                  IM_ARRAYSIZE(loadFilenameBuffer));
                 if (ImGui::IsItemHovered()) {
-                    ImGui::SetTooltip(
-                        "Enter the scene file to load (from scenes directory)");
+                    ImGui::SetTooltip("Enter the scene file to load (from scenes "
+                                      "directory), a .scene file loads as binary");
                 }
 
                 static bool showLoadConfirmation = false;
@@ -392,12 +539,11 @@ namespace Ui {
                     ImGui::Separator();
 
                     if (ImGui::Button("Load", ImVec2(120, 0))) {
-                        if (Serialisation::Deserialise(loadFilenameBuffer)) {
+                        // the progress bar below follows the load from here
+                        if (SceneLoader::Begin(loadFilenameBuffer)) {
                             ImGui::CloseCurrentPopup();
                             showLoadConfirmation = false;
                             loadFilenameBuffer[0] = '\0';
-
-                            ImGui::OpenPopup("Load Success");
                         } else {
                             ImGui::OpenPopup("Load Failed");
                         }
@@ -413,9 +559,10 @@ namespace Ui {
                     ImGui::EndPopup();
                 }
 
-                if (ImGui::BeginPopupModal("Load Success", NULL,
+                if (ImGui::BeginPopupModal("Load Failed", NULL,
                                            ImGuiWindowFlags_AlwaysAutoResize)) {
-                    ImGui::Text("Scene loaded successfully!");
+                    ImGui::Text("Failed to load scene!");
+                    ImGui::Text("Check if the file exists in the scenes directory.");
                     ImGui::Separator();
 
                     if (ImGui::Button("OK", ImVec2(120, 0))) {
@@ -425,17 +572,30 @@ namespace Ui {
                     ImGui::EndPopup();
                 }
 
-                if (ImGui::BeginPopupModal("Load Failed", NULL,
-                                           ImGuiWindowFlags_AlwaysAutoResize)) {
-                    ImGui::Text("Failed to load scene!");
-                    ImGui::Text("Check if the file exists in the scenes directory.");
-                    ImGui::Separator();
-
-                    if (ImGui::Button("OK", ImVec2(120, 0))) {
-                        ImGui::CloseCurrentPopup();
+                if (SceneLoader::IsLoading()) {
+                    const SceneLoader::Progress progress = SceneLoader::GetProgress();
+                    char overlay[160];
+                    if (progress.parsing) {
+                        std::snprintf(overlay, sizeof(overlay), "Parsing %s",
+                                      progress.filename.c_str());
+                    } else {
+                        std::snprintf(overlay, sizeof(overlay), "%s: %u / %u",
+                                      progress.filename.c_str(), progress.completed,
+                                      progress.total);
                     }
 
-                    ImGui::EndPopup();
+                    ImGui::ProgressBar(progress.total > 0
+                                           ? static_cast<float>(progress.completed) /
+                                                 static_cast<float>(progress.total)
+                                           : 0.0f,
+                                       ImVec2(-1.0f, 0.0f), overlay);
+                    ImGui::Text("Loading for %.0f ms", progress.elapsedMs);
+                }
+
+                float budgetMs = SceneLoader::GetFrameBudget();
+                if (ImGui::SliderFloat("Load Budget (ms/frame)", &budgetMs, 0.5f, 16.0f,
+                                       "%.1f")) {
+                    SceneLoader::SetFrameBudget(budgetMs);
                 }
 
                 ImGui::TreePop();
@@ -452,6 +612,7 @@ namespace Ui {
         ImGui::Begin("Controls", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
         RenderPerformanceSection();
+        RenderGpuMemorySection();
         RenderVisualSettingsSection();
         RenderEntityControlsSection();
         RenderMaterialPropertiesSection();
@@ -527,7 +688,37 @@ namespace Ui {
         }
     }
 
+    // selects the entity under the cursor on a click that no window took
+    static void PickEntity() {
+        const ImGuiIO &io = ImGui::GetIO();
+        CameraSystem::Camera *camera = CameraSystem::GetMainCamera();
+        if (!camera || CursorManager::IsInCameraMode() || io.WantCaptureMouse ||
+            !ImGui::IsMouseClicked(ImGuiMouseButton_Left) || io.DisplaySize.x <= 0.0f ||
+            io.DisplaySize.y <= 0.0f) {
+            return;
+        }
+
+        // the cursor's points on the near and far planes, so a distance of one
+        // spans the view
+        const float x = 2.0f * io.MousePos.x / io.DisplaySize.x - 1.0f;
+        const float y = 1.0f - 2.0f * io.MousePos.y / io.DisplaySize.y;
+        const glm::mat4 toWorld = glm::inverse(CameraSystem::GetProjectionMatrix(camera) *
+                                               CameraSystem::GetViewMatrix(camera));
+
+        glm::vec4 nearPoint = toWorld * glm::vec4(x, y, -1.0f, 1.0f);
+        glm::vec4 farPoint = toWorld * glm::vec4(x, y, 1.0f, 1.0f);
+        nearPoint /= nearPoint.w;
+        farPoint /= farPoint.w;
+
+        const SceneSystem::RayHit hit = SceneSystem::Raycast(
+            glm::vec3(nearPoint), glm::vec3(farPoint - nearPoint), 1.0f);
+        if (hit.entity) {
+            selectedEntity = hit.entity;
+        }
+    }
+
     void Render() {
+        PickEntity();
         RenderMainPanel();
     }
 
@@ -0,0 +1,338 @@
+#include "virtual_file_system.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "asset_pack.h"
+
+namespace VirtualFileSystem {
+    struct Entry {
+        std::string virtualPath;
+        std::filesystem::path path;
+
+        // set for files served out of a mounted pack rather than the disk
+        std::shared_ptr<const AssetPack::Pack> pack = nullptr;
+        const AssetPack::Entry *packed = nullptr;
+    };
+
+    struct MountPoint {
+        std::string prefix;
+        std::filesystem::path directory;
+        std::shared_ptr<const AssetPack::Pack> pack = nullptr;
+    };
+
+    // the index is read from loader threads, mounts and refreshes take it exclusively
+    static std::shared_mutex m_mutex;
+    static std::vector<MountPoint> m_mounts;
+    static std::unordered_map<uint64_t, Entry> m_index;
+
+    static uint64_t HashPath(const std::string &path) {
+        return AssetPack::HashPath(path);
+    }
+
+    static const Entry *FindEntry(const std::string &virtualPath) {
+        const auto it = m_index.find(HashPath(virtualPath));
+        if (it == m_index.end() || it->second.virtualPath != virtualPath) {
+            return nullptr;
+        }
+
+        return &it->second;
+    }
+
+    static void IndexFile(Entry entry) {
+        auto [it, inserted] = m_index.try_emplace(HashPath(entry.virtualPath));
+        if (!inserted && it->second.virtualPath != entry.virtualPath) {
+            ErrorHandler::Warn("Path hash collision between " + it->second.virtualPath +
+                                   " and " + entry.virtualPath + ", keeping the first",
+                               __FILE__, __func__, __LINE__);
+            return;
+        }
+
+        it->second = std::move(entry);
+    }
+
+    static void IndexMount(const MountPoint &mount) {
+        if (mount.pack) {
+            for (const AssetPack::Entry &packed : mount.pack->GetEntries()) {
+                const std::string virtualPath(mount.pack->GetPath(packed));
+                IndexFile({virtualPath, virtualPath, mount.pack, &packed});
+            }
+
+            return;
+        }
+
+        std::error_code error;
+        for (const auto &file :
+             std::filesystem::recursive_directory_iterator(mount.directory, error)) {
+            if (!file.is_regular_file(error)) {
+                continue;
+            }
+
+            const std::string relative =
+                std::filesystem::relative(file.path(), mount.directory, error)
+                    .generic_string();
+            IndexFile({mount.prefix + "/" + relative, file.path()});
+        }
+    }
+
+    static FileView MapPacked(const std::string &path) {
+        std::shared_ptr<const AssetPack::Pack> pack;
+        const AssetPack::Entry *packed = nullptr;
+        {
+            std::shared_lock lock(m_mutex);
+
+            const Entry *entry = FindEntry(path);
+            if (!entry || !entry->pack) {
+                return {};
+            }
+
+            pack = entry->pack;
+            packed = entry->packed;
+        }
+
+        // decompression runs unlocked, the pack outlives an unmount through pack
+        return pack->Read(*packed);
+    }
+
+    void Init() {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        CleanUp();
+
+        // the executable runs from the repository root or a build directory below it
+        static const std::filesystem::path roots[] = {"", "..", "../..", "gl-gfx"};
+        static const std::pair<const char *, const char *> mounts[] = {
+            {"Models", "Assets/Models"},
+            {"Textures", "Assets/Textures"},
+            {"Shaders", "src/Shaders"},
+            {"Scenes", "Scenes"},
+        };
+
+        for (const auto &[prefix, directory] : mounts) {
+            bool mounted = false;
+            for (const auto &root : roots) {
+                if (Mount(prefix, root / directory)) {
+                    mounted = true;
+                    break;
+                }
+            }
+
+            if (!mounted) {
+                ErrorHandler::Warn(std::string("Couldn't find the ") + directory +
+                                       " directory, " + prefix +
+                                       " paths resolve from the CWD",
+                                   __FILE__, __func__, __LINE__);
+            }
+        }
+
+        // a pack built by the asset-pack target sits next to the executable and
+        // shadows the loose Models and Textures it was built from
+        std::vector<std::filesystem::path> packs;
+        for (const auto &root : roots) {
+            packs.push_back(root / "Assets.pack");
+        }
+#ifdef ASSET_PACK_PATH
+        packs.emplace_back(ASSET_PACK_PATH);
+#endif
+
+        for (const auto &pack : packs) {
+            if (MountPack(pack)) {
+                break;
+            }
+        }
+
+        const float elapsedMs = std::chrono::duration<float, std::milli>(
+                                    std::chrono::high_resolution_clock::now() - start)
+                                    .count();
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(3) << "Indexed " << m_index.size()
+               << " files from " << m_mounts.size() << " mounts in " << elapsedMs
+               << " ms";
+        ErrorHandler::Info(report.str(), __FILE__, __func__, __LINE__);
+    }
+
+    bool Mount(const std::string &prefix, const std::filesystem::path &directory) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(directory, error)) {
+            return false;
+        }
+
+        std::unique_lock lock(m_mutex);
+
+        m_mounts.push_back({prefix, directory});
+        IndexMount(m_mounts.back());
+
+        return true;
+    }
+
+    bool MountPack(const std::filesystem::path &packPath) {
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(packPath, error)) {
+            return false;
+        }
+
+        std::shared_ptr<const AssetPack::Pack> pack = AssetPack::Pack::Open(packPath);
+        if (!pack) {
+            return false;
+        }
+
+        std::unique_lock lock(m_mutex);
+
+        m_mounts.push_back({"", packPath, std::move(pack)});
+        IndexMount(m_mounts.back());
+
+        return true;
+    }
+
+    void Unmount(const std::string &prefix) {
+        std::unique_lock lock(m_mutex);
+
+        std::erase_if(m_mounts, [&prefix](const MountPoint &mount) {
+            return mount.prefix == prefix;
+        });
+
+        // files the removed mount shadowed come back, so rebuild in mount order
+        m_index.clear();
+        for (const MountPoint &mount : m_mounts) {
+            IndexMount(mount);
+        }
+    }
+
+    std::filesystem::path GetMountPath(const std::string &prefix) {
+        std::shared_lock lock(m_mutex);
+
+        for (auto it = m_mounts.rbegin(); it != m_mounts.rend(); ++it) {
+            if (it->prefix == prefix && !it->pack) {
+                return it->directory;
+            }
+        }
+
+        return {};
+    }
+
+    std::string FindAsset(const std::string &prefix, const std::string &path) {
+        std::string virtualPath =
+            prefix + "/" + std::filesystem::path(path).filename().generic_string();
+
+        std::shared_lock lock(m_mutex);
+
+        return FindEntry(virtualPath) ? virtualPath : path;
+    }
+
+    std::string GetVirtualPath(const std::filesystem::path &realPath) {
+        std::shared_lock lock(m_mutex);
+
+        for (auto it = m_mounts.rbegin(); it != m_mounts.rend(); ++it) {
+            if (it->pack) {
+                continue;
+            }
+
+            const std::filesystem::path relative =
+                realPath.lexically_normal().lexically_relative(
+                    it->directory.lexically_normal());
+            if (!relative.empty() && *relative.begin() != "..") {
+                return it->prefix + "/" + relative.generic_string();
+            }
+        }
+
+        return {};
+    }
+
+    std::filesystem::path GetRealPath(const std::string &path) {
+        std::shared_lock lock(m_mutex);
+
+        const Entry *entry = FindEntry(path);
+        return entry ? entry->path : std::filesystem::path(path);
+    }
+
+    bool IsPacked(const std::string &path) {
+        std::shared_lock lock(m_mutex);
+
+        const Entry *entry = FindEntry(path);
+        return entry && entry->pack;
+    }
+
+    bool Exists(const std::string &path) {
+        {
+            std::shared_lock lock(m_mutex);
+            if (FindEntry(path)) {
+                return true;
+            }
+        }
+
+        std::error_code error;
+        return std::filesystem::exists(path, error);
+    }
+
+    bool Read(const std::string &path, std::vector<uint8_t> &buffer) {
+        if (const FileView packed = MapPacked(path)) {
+            buffer.assign(packed.Data(), packed.Data() + packed.Size());
+            return true;
+        }
+
+        std::ifstream file(GetRealPath(path), std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(buffer.data()),
+                                           static_cast<std::streamsize>(buffer.size())));
+    }
+
+    FileView Map(const std::string &path) {
+        if (FileView packed = MapPacked(path)) {
+            return packed;
+        }
+
+        auto file = std::make_shared<const MappedFile>(GetRealPath(path));
+        if (!file->Data()) {
+            return {};
+        }
+
+        const uint8_t *data = file->Data();
+        const size_t size = file->Size();
+
+        return {std::move(file), data, size};
+    }
+
+    void Refresh(const std::string &virtualPath) {
+        const size_t separator = virtualPath.find('/');
+        if (separator == std::string::npos) {
+            return;
+        }
+
+        const std::string prefix = virtualPath.substr(0, separator);
+        const std::filesystem::path directory = GetMountPath(prefix);
+        if (directory.empty()) {
+            return;
+        }
+
+        const std::filesystem::path path = directory / virtualPath.substr(separator + 1);
+
+        std::error_code error;
+        const bool exists = std::filesystem::is_regular_file(path, error);
+
+        std::unique_lock lock(m_mutex);
+
+        if (exists) {
+            IndexFile({virtualPath, path});
+        } else if (const Entry *entry = FindEntry(virtualPath); entry && !entry->pack) {
+            m_index.erase(HashPath(virtualPath));
+        }
+    }
+
+    void CleanUp() {
+        std::unique_lock lock(m_mutex);
+
+        m_mounts.clear();
+        m_index.clear();
+    }
+}
@@ -0,0 +1,256 @@
+// measures the entity BVH against testing every box, at a million random boxes
+//
+//   bvh-benchmark [box count] [queries]
+//
+// box, sphere and ray queries run the given number of times, frustum queries a
+// tenth as often. A sample of each is checked against brute force. Moves shift a
+// share of the boxes and time the Update that follows
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bvh.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double SecondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Report(const std::string &name, const size_t queries, const double seconds,
+                   const size_t found) {
+    std::cout << std::fixed << std::setprecision(2) << name << ": "
+              << seconds * 1e6 / static_cast<double>(queries) << " us per query, "
+              << static_cast<double>(queries) / seconds / 1e3 << " k/s, "
+              << static_cast<double>(found) / static_cast<double>(queries)
+              << " found on average\n";
+}
+
+static bool Overlaps(const Aabb &a, const Aabb &b) {
+    return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z &&
+           b.min.x <= a.max.x && b.min.y <= a.max.y && b.min.z <= a.max.z;
+}
+
+static bool TouchesSphere(const Aabb &box, const glm::vec3 &center, const float radius) {
+    const glm::vec3 offset = center - glm::min(glm::max(center, box.min), box.max);
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+static bool InFrustum(const Aabb &box, const Frustum &frustum) {
+    for (const glm::vec4 &plane : frustum.planes) {
+        const glm::vec3 farthest(plane.x > 0.0f ? box.max.x : box.min.x,
+                                 plane.y > 0.0f ? box.max.y : box.min.y,
+                                 plane.z > 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// every item for which the test holds, sorted so the two sides compare
+template <typename Test>
+static std::vector<uint32_t> BruteForce(const std::vector<Aabb> &boxes, Test test) {
+    std::vector<uint32_t> found;
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+        if (test(boxes[i])) {
+            found.push_back(i);
+        }
+    }
+
+    return found;
+}
+
+static bool Check(const char *name, std::vector<uint32_t> found,
+                  const std::vector<uint32_t> &expected) {
+    std::ranges::sort(found);
+    if (found != expected) {
+        std::cout << name << ": " << found.size() << " found, brute force found "
+                  << expected.size() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const size_t queries = argc > 2 ? std::stoul(argv[2]) : 100000;
+
+    // a million boxes of up to 2 units in a 1000 unit cube, ~1 per 1000 cubic
+    // units like a large open scene
+    const float worldSize = 1000.0f * std::cbrt(static_cast<float>(count) / 1e6f);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(0.0f, worldSize);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    const auto randomBox = [&](const glm::vec3 &center) {
+        const glm::vec3 half(size(random) * 0.5f, size(random) * 0.5f,
+                             size(random) * 0.5f);
+        return Aabb{center - half, center + half};
+    };
+    const auto randomPoint = [&] {
+        return glm::vec3(position(random), position(random), position(random));
+    };
+    const auto randomDirection = [&] {
+        glm::vec3 direction;
+        do {
+            direction = glm::vec3(unit(random), unit(random), unit(random));
+        } while (glm::dot(direction, direction) < 0.01f);
+        return glm::normalize(direction);
+    };
+
+    std::vector<Aabb> boxes(count);
+    for (Aabb &box : boxes) {
+        box = randomBox(randomPoint());
+    }
+
+    Bvh bvh;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < count; i++) {
+        bvh.Insert(i, boxes[i]);
+    }
+    bvh.Update();
+    std::cout << std::fixed << std::setprecision(1) << "build: " << count
+              << " boxes in " << SecondsSince(start) * 1e3 << " ms ("
+              << bvh.GetStats().buildMs << " ms binned SAH), "
+              << bvh.GetStats().nodes << " nodes\n";
+
+    // inputs are made up front so only the queries are timed
+    std::vector<Aabb> regions(queries);
+    std::vector<glm::vec3> centers(queries);
+    std::vector<glm::vec3> origins(queries);
+    std::vector<glm::vec3> directions(queries);
+    std::vector<Frustum> frustums(std::max<size_t>(queries / 10, 1));
+    for (size_t i = 0; i < queries; i++) {
+        const glm::vec3 center = randomPoint();
+        regions[i] = {center - 10.0f, center + 10.0f};
+        centers[i] = randomPoint();
+        origins[i] = randomPoint();
+        directions[i] = randomDirection();
+    }
+
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f,
+                                                  0.1f, 100.0f);
+    for (Frustum &frustum : frustums) {
+        const glm::vec3 eye = randomPoint();
+        frustum = MakeFrustum(projection * glm::lookAt(eye, eye + randomDirection(),
+                                                       glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    std::vector<uint32_t> results;
+    size_t found = 0;
+    constexpr float radius = 10.0f;
+
+    start = Clock::now();
+    for (const Aabb &region : regions) {
+        results.clear();
+        bvh.QueryBox(region, results);
+        found += results.size();
+    }
+    Report("box", queries, SecondsSince(start), found);
+
+    found = 0;
+    start = Clock::now();
+    for (const glm::vec3 &center : centers) {
+        results.clear();
+        bvh.QuerySphere(center, radius, results);
+        found += results.size();
+    }
+    Report("sphere", queries, SecondsSince(start), found);
+
+    found = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < queries; i++) {
+        found += bvh.Raycast(origins[i], directions[i]).item != Bvh::None;
+    }
+    Report("ray", queries, SecondsSince(start), found);
+
+    found = 0;
+    start = Clock::now();
+    for (const Frustum &frustum : frustums) {
+        results.clear();
+        bvh.QueryFrustum(frustum, results);
+        found += results.size();
+    }
+    Report("frustum", frustums.size(), SecondsSince(start), found);
+
+    // brute force is slow, a few queries of each are enough to compare
+    constexpr size_t samples = 20;
+    bool matches = true;
+    start = Clock::now();
+    for (size_t i = 0; i < std::min(samples, queries); i++) {
+        results.clear();
+        bvh.QueryBox(regions[i], results);
+        matches &= Check("box", results, BruteForce(boxes, [&](const Aabb &box) {
+                             return Overlaps(box, regions[i]);
+                         }));
+
+        results.clear();
+        bvh.QuerySphere(centers[i], radius, results);
+        matches &= Check("sphere", results, BruteForce(boxes, [&](const Aabb &box) {
+                             return TouchesSphere(box, centers[i], radius);
+                         }));
+
+        results.clear();
+        bvh.QueryFrustum(frustums[i % frustums.size()], results);
+        matches &= Check("frustum", results, BruteForce(boxes, [&](const Aabb &box) {
+                             return InFrustum(box, frustums[i % frustums.size()]);
+                         }));
+
+        float nearest = std::numeric_limits<float>::infinity();
+        for (const Aabb &box : boxes) {
+            nearest = std::min(nearest, RayEntry(box, origins[i], directions[i]));
+        }
+        if (bvh.Raycast(origins[i], directions[i]).distance != nearest) {
+            std::cout << "ray: nearest hit differs from brute force\n";
+            matches = false;
+        }
+    }
+    std::cout << std::setprecision(2) << "brute force: "
+              << SecondsSince(start) * 1e3 / static_cast<double>(samples)
+              << " ms per box, sphere, frustum and ray query together, "
+              << (matches ? "results match" : "RESULTS DIFFER") << "\n";
+
+    // a share of the boxes drift each frame, some leave their margins
+    for (const float share : {0.01f, 0.1f, 1.0f}) {
+        const auto moved = static_cast<size_t>(static_cast<float>(count) * share);
+        std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(count - 1));
+
+        constexpr int frames = 10;
+        double seconds = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            for (size_t i = 0; i < moved; i++) {
+                const uint32_t item = pick(random);
+                const glm::vec3 offset = randomDirection() * 0.2f;
+                boxes[item] = {boxes[item].min + offset, boxes[item].max + offset};
+                bvh.Move(item, boxes[item]);
+            }
+
+            start = Clock::now();
+            bvh.Update();
+            seconds += SecondsSince(start);
+        }
+
+        const Bvh::Stats stats = bvh.GetStats();
+        std::cout << std::setprecision(2) << "moving " << share * 100.0f
+                  << "% per frame: " << seconds * 1e3 / frames << " ms per Update, "
+                  << stats.builds << " builds, " << stats.refits << " refits\n";
+    }
+
+    results.clear();
+    bvh.QueryBox(regions[0], results);
+    matches &= Check("box after moves", results, BruteForce(boxes, [&](const Aabb &box) {
+                         return Overlaps(box, regions[0]);
+                     }));
+
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
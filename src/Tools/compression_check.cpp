@@ -0,0 +1,172 @@
+// encodes blocks of two colours in every block format and decodes them again,
+// failing when either colour doesn't come back. Colours with equal channel sums,
+// such as red against green, once collapsed to their mean
+//
+//   compression-check
+//
+// no GL is needed, only the CPU encoder runs
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "texture_compression.h"
+
+using Pixel = std::array<uint8_t, 4>;
+
+struct Case {
+    const char *name;
+    Pixel first;
+    Pixel second;
+};
+
+// per channel, BC1's 5 bits of red and blue are the coarsest
+static constexpr int m_tolerance = 8;
+
+static std::array<int, 3> From565(const uint16_t color) {
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// the colour half of BC1 and BC3, BC3 always uses the four colour ramp
+static void DecodeColors(const uint8_t *block, const bool alwaysFour,
+                         std::array<Pixel, 16> &pixels) {
+    uint16_t color0;
+    uint16_t color1;
+    uint32_t indices;
+    std::memcpy(&color0, block, sizeof(color0));
+    std::memcpy(&color1, block + 2, sizeof(color1));
+    std::memcpy(&indices, block + 4, sizeof(indices));
+
+    const auto a = From565(color0);
+    const auto b = From565(color1);
+    const bool four = alwaysFour || color0 > color1;
+
+    std::array<std::array<int, 3>, 4> palette{a, b};
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = four ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2;
+        palette[3][c] = four ? (a[c] + 2 * b[c]) / 3 : 0;
+    }
+
+    for (int i = 0; i < 16; i++) {
+        const auto &color = palette[(indices >> (2 * i)) & 3];
+        pixels[i] = {static_cast<uint8_t>(color[0]), static_cast<uint8_t>(color[1]),
+                     static_cast<uint8_t>(color[2]), 255};
+    }
+}
+
+static uint32_t ReadBits(const uint8_t *block, uint32_t &position, const uint32_t count) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++, position++) {
+        value |= ((block[position >> 3] >> (position & 7)) & 1u) << i;
+    }
+
+    return value;
+}
+
+// mode 6 only, the one the encoder writes
+static bool DecodeBc7(const uint8_t *block, std::array<Pixel, 16> &pixels) {
+    static constexpr int weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                        34, 38, 43, 47, 51, 55, 60, 64};
+
+    uint32_t position = 0;
+    if (ReadBits(block, position, 7) != 1u << 6) {
+        return false;
+    }
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = static_cast<int>(ReadBits(block, position, 7));
+        endpoints[1][c] = static_cast<int>(ReadBits(block, position, 7));
+    }
+
+    const int pBits[2] = {static_cast<int>(ReadBits(block, position, 1)),
+                          static_cast<int>(ReadBits(block, position, 1))};
+
+    for (int i = 0; i < 16; i++) {
+        const int weight = weights[ReadBits(block, position, i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) {
+            const int e0 = (endpoints[0][c] << 1) | pBits[0];
+            const int e1 = (endpoints[1][c] << 1) | pBits[1];
+            pixels[i][c] =
+                static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+        }
+    }
+
+    return true;
+}
+
+static bool Decode(const TextureFormat format, const uint8_t *block,
+                   std::array<Pixel, 16> &pixels) {
+    switch (format) {
+        case TextureFormat::BC1:
+            DecodeColors(block, false, pixels);
+            return true;
+        case TextureFormat::BC3:
+            DecodeColors(block + 8, true, pixels);
+            return true;
+        case TextureFormat::BC7:
+            return DecodeBc7(block, pixels);
+        default:
+            return false;
+    }
+}
+
+// the left half of the block is the first colour, the right half the second
+static bool Check(const TextureFormat format, const Case &test) {
+    std::vector<uint8_t> rgba(16 * 4);
+    for (int i = 0; i < 16; i++) {
+        const Pixel &pixel = i % 4 < 2 ? test.first : test.second;
+        std::memcpy(&rgba[i * 4], pixel.data(), 4);
+    }
+
+    const std::vector<uint8_t> encoded =
+        TextureCompression::Encode(format, rgba.data(), 4, 4);
+
+    std::array<Pixel, 16> decoded{};
+    if (encoded.size() != TextureCompression::GetBlockSize(format) ||
+        !Decode(format, encoded.data(), decoded)) {
+        std::cout << "FAILED: " << TextureCompression::GetName(format) << " " << test.name
+                  << ", unexpected block\n";
+        return false;
+    }
+
+    // BC3's alpha is a separate block and not checked here
+    const int channels = format == TextureFormat::BC7 ? 4 : 3;
+    int worst = 0;
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channels; c++) {
+            worst = std::max(worst, std::abs(decoded[i][c] - rgba[i * 4 + c]));
+        }
+    }
+
+    std::cout << (worst <= m_tolerance ? "ok: " : "FAILED: ")
+              << TextureCompression::GetName(format) << " " << test.name
+              << ", worst channel error " << worst << "\n";
+
+    return worst <= m_tolerance;
+}
+
+int main() {
+    static constexpr Case cases[] = {
+        {"red/green", {255, 0, 0, 255}, {0, 255, 0, 255}},
+        {"equal sums", {200, 30, 100, 255}, {30, 200, 100, 255}},
+        {"blue/yellow", {0, 0, 255, 255}, {255, 255, 0, 255}},
+        {"black/white", {0, 0, 0, 255}, {255, 255, 255, 255}},
+    };
+
+    int failed = 0;
+    for (const TextureFormat format :
+         {TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7}) {
+        for (const Case &test : cases) {
+            failed += Check(format, test) ? 0 : 1;
+        }
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
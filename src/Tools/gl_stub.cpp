@@ -0,0 +1,271 @@
+#include "gl_stub.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common.h"
+
+namespace GlStub {
+    static GLuint m_nextName = 1;
+    static std::unordered_set<GLuint> m_liveNames;
+
+    // glMapBufferRange hands this out, what is written to it is dropped
+    static std::vector<uint8_t> m_mapping;
+
+    // any address will do, fences are never waited on for real
+    static int m_fence;
+
+    static GLuint MakeName() {
+        const GLuint name = m_nextName++;
+        m_liveNames.insert(name);
+        return name;
+    }
+
+    static void GenNames(const GLsizei count, GLuint *names) {
+        for (GLsizei i = 0; i < count; i++) {
+            names[i] = MakeName();
+        }
+    }
+
+    static void DeleteNames(const GLsizei count, const GLuint *names) {
+        for (GLsizei i = 0; i < count; i++) {
+            m_liveNames.erase(names[i]);
+        }
+    }
+
+    static void APIENTRY GenBuffers(const GLsizei n, GLuint *names) {
+        GenNames(n, names);
+    }
+
+    static void APIENTRY GenTextures(const GLsizei n, GLuint *names) {
+        GenNames(n, names);
+    }
+
+    static void APIENTRY GenVertexArrays(const GLsizei n, GLuint *names) {
+        GenNames(n, names);
+    }
+
+    static void APIENTRY DeleteBuffers(const GLsizei n, const GLuint *names) {
+        DeleteNames(n, names);
+    }
+
+    static void APIENTRY DeleteTextures(const GLsizei n, const GLuint *names) {
+        DeleteNames(n, names);
+    }
+
+    static void APIENTRY DeleteVertexArrays(const GLsizei n, const GLuint *names) {
+        DeleteNames(n, names);
+    }
+
+    static GLuint APIENTRY CreateShader(GLenum) {
+        return MakeName();
+    }
+
+    static GLuint APIENTRY CreateProgram() {
+        return MakeName();
+    }
+
+    static void APIENTRY DeleteShader(const GLuint name) {
+        m_liveNames.erase(name);
+    }
+
+    static void APIENTRY DeleteProgram(const GLuint name) {
+        m_liveNames.erase(name);
+    }
+
+    // every shader compiles and links, with no log and no active uniforms
+    static void APIENTRY GetShaderiv(GLuint, const GLenum name, GLint *value) {
+        *value = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+
+    static void APIENTRY GetProgramiv(GLuint, const GLenum name, GLint *value) {
+        *value = name == GL_LINK_STATUS ? GL_TRUE : 0;
+    }
+
+    static void APIENTRY GetInfoLog(GLuint, const GLsizei size, GLsizei *length,
+                                    GLchar *log) {
+        if (length) {
+            *length = 0;
+        }
+        if (log && size > 0) {
+            log[0] = '\0';
+        }
+    }
+
+    static void APIENTRY GetActiveUniform(GLuint, GLuint, const GLsizei size,
+                                          GLsizei *length, GLint *count, GLenum *type,
+                                          GLchar *name) {
+        GetInfoLog(0, size, length, name);
+        *count = 0;
+        *type = 0;
+    }
+
+    static GLint APIENTRY GetUniformLocation(GLuint, const GLchar *) {
+        return -1;
+    }
+
+    // a bare 4.1 core context with no extensions, so textures stay uncompressed
+    static const GLubyte *APIENTRY GetString(const GLenum name) {
+        return reinterpret_cast<const GLubyte *>(name == GL_VERSION ? "4.1.0 stub"
+                                                                    : "stub");
+    }
+
+    static const GLubyte *APIENTRY GetStringi(GLenum, GLuint) {
+        return reinterpret_cast<const GLubyte *>("");
+    }
+
+    static void APIENTRY GetIntegerv(const GLenum name, GLint *value) {
+        switch (name) {
+            case GL_MAJOR_VERSION:
+                *value = 4;
+                break;
+            case GL_MINOR_VERSION:
+                *value = 1;
+                break;
+            default:
+                *value = 0;
+        }
+    }
+
+    static GLsync APIENTRY FenceSync(GLenum, GLbitfield) {
+        return reinterpret_cast<GLsync>(&m_fence);
+    }
+
+    static GLenum APIENTRY ClientWaitSync(GLsync, GLbitfield, GLuint64) {
+        return GL_ALREADY_SIGNALED;
+    }
+
+    static void *APIENTRY MapBufferRange(GLenum, GLintptr, const GLsizeiptr length,
+                                         GLbitfield) {
+        m_mapping.resize(static_cast<size_t>(length));
+        return m_mapping.data();
+    }
+
+    static GLboolean APIENTRY UnmapBuffer(GLenum) {
+        return GL_TRUE;
+    }
+
+    // buffer contents are not kept, read backs come back zeroed
+    static void APIENTRY GetBufferSubData(GLenum, GLintptr, const GLsizeiptr size,
+                                          void *data) {
+        std::memset(data, 0, static_cast<size_t>(size));
+    }
+
+    // the rest only change state a real context would keep
+
+    static void APIENTRY Enum(GLenum) {}
+    static void APIENTRY Name(GLuint) {}
+    static void APIENTRY EnumName(GLenum, GLuint) {}
+    static void APIENTRY TwoNames(GLuint, GLuint) {}
+    static void APIENTRY NoArguments() {}
+    static void APIENTRY Clear(GLbitfield) {}
+    static void APIENTRY ClearColor(GLfloat, GLfloat, GLfloat, GLfloat) {}
+    static void APIENTRY Viewport(GLint, GLint, GLsizei, GLsizei) {}
+    static void APIENTRY DeleteSync(GLsync) {}
+    static void APIENTRY PixelStorei(GLenum, GLint) {}
+    static void APIENTRY TexParameteri(GLenum, GLenum, GLint) {}
+    static void APIENTRY TexParameteriv(GLenum, GLenum, const GLint *) {}
+    static void APIENTRY BufferData(GLenum, GLsizeiptr, const void *, GLenum) {}
+    static void APIENTRY BufferSubData(GLenum, GLintptr, GLsizeiptr, const void *) {}
+    static void APIENTRY ShaderSource(GLuint, GLsizei, const GLchar *const *,
+                                      const GLint *) {}
+    static void APIENTRY TexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum,
+                                    GLenum, const void *) {}
+    static void APIENTRY CompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei,
+                                              GLint, GLsizei, const void *) {}
+    static void APIENTRY VertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei,
+                                             const void *) {}
+    static void APIENTRY VertexAttribDivisor(GLuint, GLuint) {}
+    static void APIENTRY DrawArraysInstanced(GLenum, GLint, GLsizei, GLsizei) {}
+    static void APIENTRY DrawElementsInstanced(GLenum, GLsizei, GLenum, const void *,
+                                               GLsizei) {}
+    static void APIENTRY Uniform1i(GLint, GLint) {}
+    static void APIENTRY Uniform1f(GLint, GLfloat) {}
+    static void APIENTRY UniformFloats(GLint, GLsizei, const GLfloat *) {}
+    static void APIENTRY UniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat *) {}
+
+    template <typename Function>
+    static void *ToProc(Function *function) {
+        return reinterpret_cast<void *>(function);
+    }
+
+    static const std::unordered_map<std::string, void *> m_procs = {
+        {"glGenBuffers", ToProc(GenBuffers)},
+        {"glGenTextures", ToProc(GenTextures)},
+        {"glGenVertexArrays", ToProc(GenVertexArrays)},
+        {"glDeleteBuffers", ToProc(DeleteBuffers)},
+        {"glDeleteTextures", ToProc(DeleteTextures)},
+        {"glDeleteVertexArrays", ToProc(DeleteVertexArrays)},
+        {"glCreateShader", ToProc(CreateShader)},
+        {"glCreateProgram", ToProc(CreateProgram)},
+        {"glDeleteShader", ToProc(DeleteShader)},
+        {"glDeleteProgram", ToProc(DeleteProgram)},
+        {"glGetShaderiv", ToProc(GetShaderiv)},
+        {"glGetProgramiv", ToProc(GetProgramiv)},
+        {"glGetShaderInfoLog", ToProc(GetInfoLog)},
+        {"glGetProgramInfoLog", ToProc(GetInfoLog)},
+        {"glGetActiveUniform", ToProc(GetActiveUniform)},
+        {"glGetUniformLocation", ToProc(GetUniformLocation)},
+        {"glGetString", ToProc(GetString)},
+        {"glGetStringi", ToProc(GetStringi)},
+        {"glGetIntegerv", ToProc(GetIntegerv)},
+        {"glFenceSync", ToProc(FenceSync)},
+        {"glClientWaitSync", ToProc(ClientWaitSync)},
+        {"glDeleteSync", ToProc(DeleteSync)},
+        {"glMapBufferRange", ToProc(MapBufferRange)},
+        {"glUnmapBuffer", ToProc(UnmapBuffer)},
+        {"glGetBufferSubData", ToProc(GetBufferSubData)},
+        {"glActiveTexture", ToProc(Enum)},
+        {"glEnable", ToProc(Enum)},
+        {"glGenerateMipmap", ToProc(Enum)},
+        {"glBindVertexArray", ToProc(Name)},
+        {"glUseProgram", ToProc(Name)},
+        {"glCompileShader", ToProc(Name)},
+        {"glLinkProgram", ToProc(Name)},
+        {"glEnableVertexAttribArray", ToProc(Name)},
+        {"glDisableVertexAttribArray", ToProc(Name)},
+        {"glBindBuffer", ToProc(EnumName)},
+        {"glBindTexture", ToProc(EnumName)},
+        {"glAttachShader", ToProc(TwoNames)},
+        {"glDetachShader", ToProc(TwoNames)},
+        {"glFinish", ToProc(NoArguments)},
+        {"glClear", ToProc(Clear)},
+        {"glClearColor", ToProc(ClearColor)},
+        {"glViewport", ToProc(Viewport)},
+        {"glPixelStorei", ToProc(PixelStorei)},
+        {"glTexParameteri", ToProc(TexParameteri)},
+        {"glTexParameteriv", ToProc(TexParameteriv)},
+        {"glBufferData", ToProc(BufferData)},
+        {"glBufferSubData", ToProc(BufferSubData)},
+        {"glShaderSource", ToProc(ShaderSource)},
+        {"glTexImage2D", ToProc(TexImage2D)},
+        {"glCompressedTexImage2D", ToProc(CompressedTexImage2D)},
+        {"glVertexAttribPointer", ToProc(VertexAttribPointer)},
+        {"glVertexAttribDivisor", ToProc(VertexAttribDivisor)},
+        {"glDrawArraysInstanced", ToProc(DrawArraysInstanced)},
+        {"glDrawElementsInstanced", ToProc(DrawElementsInstanced)},
+        {"glUniform1i", ToProc(Uniform1i)},
+        {"glUniform1f", ToProc(Uniform1f)},
+        {"glUniform2fv", ToProc(UniformFloats)},
+        {"glUniform3fv", ToProc(UniformFloats)},
+        {"glUniform4fv", ToProc(UniformFloats)},
+        {"glUniformMatrix4fv", ToProc(UniformMatrix4fv)},
+    };
+
+    static void *GetProcAddress(const char *name) {
+        const auto it = m_procs.find(name);
+        return it != m_procs.end() ? it->second : nullptr;
+    }
+
+    bool Load() {
+        m_liveNames.clear();
+        return gladLoadGLLoader(GetProcAddress) != 0;
+    }
+
+    size_t GetLiveNames() {
+        return m_liveNames.size();
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// stands in for an OpenGL context so tools can drive the engine's systems with
+// no window. GL names are handed out and counted, shaders compile and link, fences
+// signal at once and nothing is drawn. Only the entry points the engine calls are
+// provided, any other stays null
+namespace GlStub {
+    // points glad's function pointers at the stubs, false if glad rejected them
+    bool Load();
+
+    // buffers, textures, vertex arrays, shaders and programs generated and not yet
+    // deleted
+    size_t GetLiveNames();
+}
@@ -0,0 +1,130 @@
+// packs and uploads the same synthetic instances in every instance layout, in a
+// hidden window of its own so the waits on the GPU stay out of the engine
+//
+//   layout-benchmark [instance count] [sheared percent]
+//
+// a share of the instances can be given a non-uniform scale under a rotated
+// parent. Those have shear, and the TRS layouts fall back to affine for them
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "instance_format.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float ElapsedMs(const Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+static std::vector<InstanceData> MakeInstances(const uint32_t count,
+                                               const uint32_t shearedPercent) {
+    std::vector<InstanceData> instances(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const auto x = static_cast<float>(i % 1024);
+        const auto z = static_cast<float>(i / 1024);
+
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+        model = glm::rotate(model, x * 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(1.0f + z * 0.001f));
+
+        // a parent stretched along x with the child turned under it
+        if (i % 100 < shearedPercent) {
+            model = glm::scale(model, glm::vec3(2.0f, 1.0f, 1.0f));
+            model = glm::rotate(model, 0.5f, glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+
+        instances[i].modelMatrix = model;
+        instances[i].color = glm::vec4(0.2f, 0.6f, 0.2f, 1.0f);
+    }
+
+    return instances;
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t count = argc > 1 ? std::stoul(argv[1]) : 500000;
+    const uint32_t shearedPercent = argc > 2 ? std::min(std::stoul(argv[2]), 100ul) : 0;
+
+    if (!glfwInit()) {
+        std::cerr << "Couldn't initialise GLFW\n";
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow *window = glfwCreateWindow(64, 64, "layout-benchmark", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Couldn't create an OpenGL 4.1 context\n";
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+        std::cerr << "Couldn't load OpenGL\n";
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    const std::vector<InstanceData> instances = MakeInstances(count, shearedPercent);
+    std::vector<uint8_t> packed;
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    std::cout << count << " instances, " << shearedPercent << "% sheared\n";
+
+    for (const InstanceLayout requested :
+         {InstanceLayout::Full, InstanceLayout::Affine, InstanceLayout::Trs,
+          InstanceLayout::TrsHalf}) {
+        // the renderer's choice, made per chunk there and once here
+        auto start = Clock::now();
+        const InstanceLayout layout =
+            InstanceFormat::GetPackableLayout(requested, instances.data(), count);
+        const float checkMs = ElapsedMs(start);
+
+        const size_t size = count * InstanceFormat::GetStride(layout);
+        packed.resize(size);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+                     GL_DYNAMIC_DRAW);
+
+        start = Clock::now();
+        InstanceFormat::Pack(layout, instances.data(), count, packed.data());
+        const float packMs = ElapsedMs(start);
+
+        glFinish();
+        start = Clock::now();
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                        packed.data());
+        glFinish();
+        const float uploadMs = ElapsedMs(start);
+
+        const float megabytes = static_cast<float>(size) / (1024.0f * 1024.0f);
+        std::cout << std::fixed << std::setprecision(2)
+                  << InstanceFormat::GetName(requested);
+        if (layout != requested) {
+            std::cout << " (as " << InstanceFormat::GetName(layout) << ")";
+        }
+        std::cout << ": " << std::setprecision(1) << megabytes << " MB, check "
+                  << std::setprecision(2) << checkMs << " ms, pack " << packMs
+                  << " ms, upload " << uploadMs << " ms (" << std::setprecision(0)
+                  << megabytes / (uploadMs / 1000.0f) << " MB/s)\n";
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+// times a cold Assimp import of each shipped model against reading it back from
+// the mesh cache, the two paths a mesh load takes. No GL is needed, the cache hit
+// is the copy a loader thread makes
+//
+//   mesh-benchmark [iterations] [model...]
+//
+// models default to every file in Assets/Models. The first import of each also
+// refreshes its cache entry
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "derived_cache.h"
+#include "resource_manager.h"
+#include "virtual_file_system.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Timing {
+    float firstMs;
+    float bestMs;
+};
+
+static float ElapsedMs(const Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+// false if any pass fails to produce the mesh
+static bool Time(const std::string &model, const int iterations, const bool import,
+                 Timing &timing, MeshSystem::MeshData &data) {
+    timing = {0.0f, 0.0f};
+    for (int i = 0; i < iterations; i++) {
+        data = {};
+
+        const auto start = Clock::now();
+        if (!ResourceManager::DecodeMeshData(model, data, import)) {
+            return false;
+        }
+        const float elapsedMs = ElapsedMs(start);
+
+        timing.firstMs = i == 0 ? elapsedMs : timing.firstMs;
+        timing.bestMs = i == 0 ? elapsedMs : std::min(timing.bestMs, elapsedMs);
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    const int iterations = args.empty() ? 10 : std::max(std::stoi(args[0]), 1);
+
+    VirtualFileSystem::Init();
+    DerivedCache::Init();
+
+    std::vector<std::string> models;
+    if (args.size() > 1) {
+        models.assign(args.begin() + 1, args.end());
+    } else {
+        std::error_code error;
+        for (const auto &file : std::filesystem::directory_iterator(
+                 VirtualFileSystem::GetMountPath("Models"), error)) {
+            if (file.is_regular_file(error)) {
+                models.push_back(file.path().filename().string());
+            }
+        }
+        std::ranges::sort(models);
+    }
+
+    if (models.empty()) {
+        std::cerr << "No models to load\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::left << std::setw(24) << "model" << std::right << std::setw(10)
+              << "vertices" << std::setw(11) << "triangles" << std::setw(20)
+              << "import first/best" << std::setw(21) << "cache first/best"
+              << std::setw(9) << "speedup" << "\n";
+
+    int failed = 0;
+    for (const std::string &model : models) {
+        // importing first also leaves a fresh cache entry for the hits
+        Timing imported;
+        Timing cached;
+        MeshSystem::MeshData data;
+        if (!Time(model, iterations, true, imported, data) ||
+            !Time(model, iterations, false, cached, data)) {
+            std::cerr << "Couldn't load " << model << "\n";
+            failed++;
+            continue;
+        }
+
+        std::cout << std::left << std::setw(24) << model << std::right << std::setw(10)
+                  << data.vertexCount << std::setw(11) << data.indices.size() / 3
+                  << std::fixed << std::setprecision(3) << std::setw(11)
+                  << imported.firstMs << " /" << std::setw(7) << imported.bestMs
+                  << std::setw(12) << cached.firstMs << " /" << std::setw(7)
+                  << cached.bestMs << std::setprecision(1) << std::setw(8)
+                  << imported.bestMs / std::max(cached.bestMs, 0.001f) << "x\n";
+    }
+
+    DerivedCache::CleanUp();
+    VirtualFileSystem::CleanUp();
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,163 @@
+// builds Assets.pack from the loose asset tree, and times loading from either
+//
+//   pack-builder <assets dir> <output pack> [--compress]
+//   pack-builder --benchmark <assets dir> <pack> [loose|pack]
+//
+// a cold start is only measured with the page cache dropped before the run, e.g.
+// "sync && echo 3 > /proc/sys/vm/drop_caches" on Linux, one side per run
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+static std::vector<AssetPack::Source> CollectSources(const std::filesystem::path &root) {
+    std::vector<AssetPack::Source> sources;
+
+    std::error_code error;
+    for (const auto &file : std::filesystem::recursive_directory_iterator(root, error)) {
+        if (!file.is_regular_file(error)) {
+            continue;
+        }
+
+        // packed under the same virtual path the VFS mounts the loose file at
+        sources.push_back(
+            {std::filesystem::relative(file.path(), root, error).generic_string(),
+             file.path()});
+    }
+
+    std::ranges::sort(sources, {}, &AssetPack::Source::path);
+
+    return sources;
+}
+
+static int Build(const std::filesystem::path &root, const std::filesystem::path &output,
+                 const bool compress) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    AssetPack::BuildStats stats{};
+    if (!AssetPack::Build(CollectSources(root), output, compress, &stats)) {
+        return EXIT_FAILURE;
+    }
+
+    const float elapsedMs = std::chrono::duration<float, std::milli>(
+                                std::chrono::high_resolution_clock::now() - start)
+                                .count();
+
+    std::cout << std::fixed << std::setprecision(1) << "Packed " << stats.entries
+              << " files (" << stats.compressed << " compressed), "
+              << static_cast<double>(stats.inputBytes) / (1024.0 * 1024.0) << " MiB -> "
+              << static_cast<double>(stats.packBytes) / (1024.0 * 1024.0) << " MiB in "
+              << elapsedMs << " ms\n";
+
+    return EXIT_SUCCESS;
+}
+
+static void Report(const char *name, const uint32_t files, const uint64_t bytes,
+                   const std::chrono::high_resolution_clock::time_point start,
+                   const uint64_t checksum) {
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::high_resolution_clock::now() - start)
+                               .count();
+
+    std::cout << std::fixed << std::setprecision(1) << name << ": " << files
+              << " files, " << static_cast<double>(bytes) / (1024.0 * 1024.0)
+              << " MiB in " << seconds * 1000.0 << " ms ("
+              << static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds
+              << " MiB/s), checksum " << std::hex << checksum << std::dec << "\n";
+}
+
+// every byte is summed so neither side can skip touching the pages it maps
+static uint64_t Checksum(const uint8_t *data, const size_t size, uint64_t sum) {
+    for (size_t i = 0; i < size; i++) {
+        sum += data[i];
+    }
+
+    return sum;
+}
+
+static void BenchmarkLoose(const std::filesystem::path &root) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    uint32_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+    std::vector<char> buffer;
+    for (const AssetPack::Source &source : CollectSources(root)) {
+        std::ifstream file(source.file, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            continue;
+        }
+
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+        checksum = Checksum(reinterpret_cast<const uint8_t *>(buffer.data()),
+                            buffer.size(), checksum);
+        files++;
+        bytes += buffer.size();
+    }
+
+    Report("loose", files, bytes, start, checksum);
+}
+
+static bool BenchmarkPack(const std::filesystem::path &packPath) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const auto pack = AssetPack::Pack::Open(packPath);
+    if (!pack) {
+        std::cerr << "Couldn't open " << packPath.string() << "\n";
+        return false;
+    }
+
+    uint32_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+    for (const AssetPack::Entry &entry : pack->GetEntries()) {
+        const FileView file = pack->Read(entry);
+        checksum = Checksum(file.Data(), file.Size(), checksum);
+        files++;
+        bytes += file.Size();
+    }
+
+    Report("pack", files, bytes, start, checksum);
+
+    return true;
+}
+
+static int Benchmark(const std::filesystem::path &root, const std::filesystem::path &pack,
+                     const std::string &side) {
+    if (side.empty() || side == "loose") {
+        BenchmarkLoose(root);
+    }
+
+    if ((side.empty() || side == "pack") && !BenchmarkPack(pack)) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (args.size() >= 3 && args[0] == "--benchmark") {
+        return Benchmark(args[1], args[2], args.size() > 3 ? args[3] : "");
+    }
+
+    if (args.size() == 2 || (args.size() == 3 && args[2] == "--compress")) {
+        return Build(args[0], args[1], args.size() == 3);
+    }
+
+    std::cerr << "usage: pack-builder <assets dir> <output pack> [--compress]\n"
+                 "       pack-builder --benchmark <assets dir> <pack> [loose|pack]\n";
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+// hammers a NameIndex the way the resource systems use it: the main thread owns
+// the SlotMap and publishes names while loader threads look them up. Extra writer
+// threads rename their own handles to stress the shard locks. Build with the tsan
+// preset to have ThreadSanitizer check it
+//
+//   registry-stress [reader threads] [writer threads] [iterations]
+//
+// fails when a lookup returns a handle whose name does not match, or when the
+// names left at the end disagree with the slot map
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "slot_map.h"
+
+struct Resource {
+    std::string name;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+// names the main thread publishes, and a disjoint set per writer thread
+static constexpr uint32_t m_nameCount = 512;
+
+static std::string GetPublishedName(const uint32_t i) {
+    return "resource_" + std::to_string(i % m_nameCount);
+}
+
+static std::string GetWriterName(const uint32_t writer, const uint32_t i) {
+    return "writer_" + std::to_string(writer) + "_" + std::to_string(i % 64);
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t readerCount = argc > 1 ? std::stoul(argv[1]) : 4;
+    const uint32_t writerCount = argc > 2 ? std::stoul(argv[2]) : 2;
+    const uint32_t iterations = argc > 3 ? std::stoul(argv[3]) : 50000;
+
+    SlotMap<Resource> resources;
+    NameIndex<Resource> names;
+
+    std::atomic<bool> stopping = false;
+    std::atomic<uint64_t> lookups = 0;
+    std::atomic<uint64_t> mismatches = 0;
+
+    // readers only use the index, never the slot map, as a loader thread would
+    std::vector<std::thread> readers;
+    for (uint32_t r = 0; r < readerCount; r++) {
+        readers.emplace_back([&, r] {
+            uint64_t local = 0;
+            for (uint32_t i = r; !stopping.load(std::memory_order_relaxed); i++) {
+                const std::string name = GetPublishedName(i);
+                const Handle<Resource> handle = names.Find(name);
+                local++;
+
+                // a racing Add may publish the name before the handle's reverse entry,
+                // so only a different non-empty name is wrong
+                const std::string found = handle ? names.GetName(handle) : std::string();
+                if (!found.empty() && found != name) {
+                    mismatches++;
+                }
+            }
+            lookups += local;
+        });
+    }
+
+    // writer handles sit above the slot map's range so they never collide with it
+    std::vector<std::thread> writers;
+    for (uint32_t w = 0; w < writerCount; w++) {
+        writers.emplace_back([&, w] {
+            const uint32_t base = Handle<Resource>::IndexMask - (w + 1) * 64;
+            for (uint32_t i = 0; i < iterations; i++) {
+                const auto handle = Handle<Resource>::Make(base + i % 64, 1);
+                names.Add(GetWriterName(w, i), handle);
+                if (i % 3 == 0) {
+                    names.Remove(handle);
+                }
+            }
+        });
+    }
+
+    // the main thread inserts, renames and removes, replacing names as it goes
+    const auto start = Clock::now();
+    std::vector<Handle<Resource>> live;
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (live.size() >= m_nameCount || (i % 5 == 4 && !live.empty())) {
+            const Handle<Resource> victim = live[i % live.size()];
+            live[i % live.size()] = live.back();
+            live.pop_back();
+
+            names.Remove(victim);
+            resources.Remove(victim);
+            continue;
+        }
+
+        const std::string name = GetPublishedName(i);
+        const Handle<Resource> handle = resources.Insert({name});
+        names.Add(name, handle);
+        live.push_back(handle);
+    }
+    const double mainSeconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    stopping = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    // every name still indexed must lead to a live resource of that name
+    uint32_t inconsistent = 0;
+    for (uint32_t i = 0; i < m_nameCount; i++) {
+        const std::string name = GetPublishedName(i);
+        const Handle<Resource> handle = names.Find(name);
+        if (!handle) {
+            continue;
+        }
+
+        const Resource *resource = resources.Get(handle);
+        if (!resource || resource->name != name || names.GetName(handle) != name) {
+            inconsistent++;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1) << readerCount << " readers, "
+              << writerCount << " writers: " << lookups.load() / 1e6 << " M lookups, "
+              << iterations << " main thread updates in " << mainSeconds * 1000.0
+              << " ms, " << mismatches.load() << " mismatched lookups, " << inconsistent
+              << " inconsistent names\n";
+
+    return mismatches == 0 && inconsistent == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,173 @@
+// measures the scene's entity storage, the name-keyed map with a pointer list the
+// scene system used to keep against SceneSystem as it is now
+//
+//   scene-benchmark [entity count] [churn operations]
+//
+// iteration visits every active entity that is drawn, churn destroys an entity
+// not destroyed before and creates a new one. Both sides make a transform per
+// entity and hold no resources, nothing is drawn
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "scene_system.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+using SceneSystem::EntityId;
+
+static double SecondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Report(const std::string &name, const char *unit, const size_t operations,
+                   const double seconds, const uint64_t checksum) {
+    std::cout << std::fixed << std::setprecision(1) << name << ": "
+              << seconds * 1e9 / static_cast<double>(operations) << " ns per " << unit
+              << ", " << static_cast<double>(operations) / seconds / 1e6
+              << " M/s, checksum " << checksum << "\n";
+}
+
+// the layout SceneSystem had before its sparse sets
+namespace NameKeyed {
+    struct Entity {
+        std::string name;
+        MeshSystem::MeshHandle mesh;
+        MaterialSystem::MaterialHandle material;
+        TextureSystem::TextureHandle texture;
+        TransformSystem::TransformHandle transform;
+        bool isActive = true;
+        glm::vec4 color = glm::vec4(1.0f);
+    };
+
+    static std::unordered_map<std::string, Entity> m_entities;
+    static std::vector<Entity *> m_entityPtrs;
+
+    static std::string Create(const std::string &name) {
+        Entity entity;
+        entity.name = name;
+        entity.transform = TransformSystem::CreateTransform();
+
+        m_entities[name] = entity;
+        m_entityPtrs.push_back(&m_entities[name]);
+
+        return name;
+    }
+
+    static void Destroy(const std::string &name) {
+        const auto it = m_entities.find(name);
+        if (it != m_entities.end()) {
+            if (const auto vecIt = std::ranges::find(m_entityPtrs, &it->second);
+                vecIt != m_entityPtrs.end()) {
+                m_entityPtrs.erase(vecIt);
+            }
+
+            TransformSystem::DestroyTransform(it->second.transform);
+            m_entities.erase(it);
+        }
+    }
+
+    static uint64_t Iterate() {
+        uint64_t checksum = 0;
+        for (const Entity *entity : m_entityPtrs) {
+            if (entity->isActive) {
+                checksum += entity->transform.value;
+            }
+        }
+
+        return checksum;
+    }
+}
+
+// the scene system itself, none of these calls touch GL
+namespace Scene {
+    static EntityId Create(const std::string &name) {
+        return SceneSystem::CreateEntity(name, glm::vec4(1.0f));
+    }
+
+    static void Destroy(const EntityId entity) {
+        SceneSystem::DestroyEntity(entity);
+    }
+
+    // the lookups a system outside the scene makes per entity
+    static uint64_t Iterate() {
+        uint64_t checksum = 0;
+        for (const EntityId entity : SceneSystem::GetAllEntities()) {
+            if (SceneSystem::IsActive(entity) && SceneSystem::GetRender(entity)) {
+                checksum += SceneSystem::GetTransform(entity).value;
+            }
+        }
+
+        return checksum;
+    }
+}
+
+template <typename Create, typename Destroy, typename Iterate>
+static void Measure(const char *name, const size_t count, const size_t churn,
+                    Create create, Destroy destroy, Iterate iterate) {
+    using Key = decltype(create(std::string()));
+
+    std::vector<Key> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        keys.push_back(create("entity" + std::to_string(i)));
+    }
+
+    constexpr int iterations = 20;
+    uint64_t checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        checksum += iterate();
+    }
+    Report(std::string(name) + ", iteration", "entity", count * iterations,
+           SecondsSince(start), checksum);
+
+    // every victim is a distinct entity from the first pass, so each destroy
+    // finds one. Names are made up front so only the storage is timed
+    std::vector<size_t> victims(count);
+    for (size_t i = 0; i < count; i++) {
+        victims[i] = i;
+    }
+    std::ranges::shuffle(victims, std::mt19937(42));
+    victims.resize(std::min(churn, count));
+
+    std::vector<std::string> created(victims.size());
+    for (size_t i = 0; i < victims.size(); i++) {
+        created[i] = "churned" + std::to_string(i);
+    }
+
+    start = Clock::now();
+    for (size_t i = 0; i < victims.size(); i++) {
+        destroy(keys[victims[i]]);
+        create(created[i]);
+    }
+    Report(std::string(name) + ", churn", "destroy and create", victims.size(),
+           SecondsSince(start), iterate());
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const size_t churn = argc > 2 ? std::stoul(argv[2]) : 100000;
+
+    // every destroy searches the pointer list, so the old layout gets fewer
+    TransformSystem::Init();
+    Measure("name-keyed map", count, std::min<size_t>(churn, 1000), NameKeyed::Create,
+            NameKeyed::Destroy, NameKeyed::Iterate);
+    NameKeyed::m_entityPtrs.clear();
+    NameKeyed::m_entities.clear();
+
+    TransformSystem::Init();
+    SceneSystem::Init();
+    Measure("scene system", count, churn, Scene::Create, Scene::Destroy,
+            Scene::Iterate);
+    SceneSystem::CleanUp();
+    TransformSystem::CleanUp();
+
+    return EXIT_SUCCESS;
+}
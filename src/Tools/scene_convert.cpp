@@ -0,0 +1,197 @@
+// converts a scene between the TOML source and the binary format, either way by
+// the input's extension, and times loading the scene from each
+//
+//   scene-convert <input.toml> [output.scene]
+//   scene-convert <input.scene> [output.toml]
+//   scene-convert --generate <entities> <output.toml>
+//
+// the output defaults to the input with the other extension. --generate writes a
+// grid of textured cubes in both formats, to time scenes larger than Scenes/ has
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "scene_file.h"
+
+static float GetElapsedMs(const std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(
+               std::chrono::high_resolution_clock::now() - start)
+        .count();
+}
+
+// both loads end in the same SceneFile::Scene, what the engine builds from
+static void Compare(const std::filesystem::path &tomlPath,
+                    const std::filesystem::path &binaryPath) {
+    auto start = std::chrono::high_resolution_clock::now();
+    const MappedFile tomlFile(tomlPath);
+    const std::string_view document(reinterpret_cast<const char *>(tomlFile.Data()),
+                                    tomlFile.Size());
+    const SceneFile::Scene fromToml = SceneFile::FromToml(toml::parse(document));
+    const float tomlMs = GetElapsedMs(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    SceneFile::Scene fromBinary;
+    SceneFile::Read(binaryPath, fromBinary);
+    const float binaryMs = GetElapsedMs(start);
+
+    std::cout << std::fixed << std::setprecision(3) << fromToml.GetEntityCount()
+              << " entities, toml " << tomlFile.Size() << " bytes in " << tomlMs
+              << " ms, binary " << std::filesystem::file_size(binaryPath) << " bytes in "
+              << binaryMs << " ms (" << std::setprecision(1)
+              << tomlMs / std::max(binaryMs, 0.001f) << "x)\n";
+}
+
+static int ToBinary(const std::filesystem::path &input,
+                    const std::filesystem::path &output) {
+    toml::table document;
+    try {
+        document = toml::parse_file(input.string());
+    } catch (const toml::parse_error &error) {
+        std::cerr << "Couldn't parse " << input.string() << ": " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!SceneFile::Write(SceneFile::FromToml(document), output)) {
+        return EXIT_FAILURE;
+    }
+
+    Compare(input, output);
+
+    return EXIT_SUCCESS;
+}
+
+static int ToToml(const std::filesystem::path &input,
+                  const std::filesystem::path &output) {
+    SceneFile::Scene scene;
+    if (!SceneFile::Read(input, scene)) {
+        std::cerr << "Couldn't read " << input.string()
+                  << " as a binary scene of version " << SceneFile::Version << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Couldn't open " << output.string() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    file << SceneFile::ToToml(scene);
+    file.close();
+
+    Compare(output, input);
+
+    return EXIT_SUCCESS;
+}
+
+// the demo scene's cube and materials, shared by every entity as in a real scene
+static SceneFile::Scene MakeGrid(const uint32_t count) {
+    SceneFile::Scene scene;
+    scene.name = scene.AddString("generated");
+    scene.camera.name = scene.AddString("main");
+    scene.camera.position = glm::vec3(0.0f, 10.0f, 30.0f);
+
+    scene.meshes.push_back(
+        {scene.AddString("cube"), scene.AddString("../Assets/Models/cube.obj")});
+    scene.textures.push_back({scene.AddString("container"),
+                              scene.AddString("../Assets/Textures/container.png")});
+    scene.shaders.push_back({scene.AddString("default"),
+                             scene.AddString("../src/Shaders/default.vert"),
+                             scene.AddString("../src/Shaders/default.frag")});
+
+    const char *materialNames[] = {"container1", "container2", "container3",
+                                   "container4"};
+    const auto materialCount = static_cast<uint32_t>(std::size(materialNames));
+    for (uint32_t i = 0; i < materialCount; i++) {
+        scene.materials.push_back({scene.AddString(materialNames[i]), 0,
+                                   static_cast<uint32_t>(scene.properties.size()), 3});
+
+        const float shininess = 8.0f * static_cast<float>(i + 1);
+        scene.properties.push_back({scene.AddString("color"),
+                                    SceneFile::PropertyType::Vec3,
+                                    static_cast<uint32_t>(scene.values.size())});
+        for (int c = 0; c < 3; c++) {
+            scene.values.push_back(std::bit_cast<uint32_t>(1.0f));
+        }
+        scene.properties.push_back({scene.AddString("shininess"),
+                                    SceneFile::PropertyType::Float,
+                                    static_cast<uint32_t>(scene.values.size())});
+        scene.values.push_back(std::bit_cast<uint32_t>(shininess));
+        scene.properties.push_back({scene.AddString("useTexture"),
+                                    SceneFile::PropertyType::Int,
+                                    static_cast<uint32_t>(scene.values.size())});
+        scene.values.push_back(1);
+    }
+
+    const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(count)));
+    for (uint32_t i = 0; i < count; i++) {
+        SceneFile::Transform transform;
+        transform.position = glm::vec3(static_cast<float>(i % side) * 2.0f, 0.5f,
+                                       static_cast<float>(i / side) * -2.0f);
+        transform.rotation = glm::vec3(0.0f, static_cast<float>(i % 360), 0.0f);
+
+        scene.entityNames.push_back(scene.AddString("cube" + std::to_string(i)));
+        scene.parents.push_back(SceneFile::None);
+        scene.entityLights.push_back(SceneFile::None);
+        scene.flags.push_back(i % 2 == 0 ? SceneFile::Static : 0u);
+        scene.colors.push_back(glm::vec4(1.0f));
+        scene.transforms.push_back(transform);
+        scene.resources.push_back({0, 0, i % materialCount});
+    }
+
+    return scene;
+}
+
+static int Generate(const uint32_t count, const std::filesystem::path &output) {
+    const SceneFile::Scene scene = MakeGrid(count);
+
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Couldn't open " << output.string() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    file << SceneFile::ToToml(scene);
+    file.close();
+
+    std::filesystem::path binary = output;
+    binary.replace_extension(SceneFile::Extension);
+    if (!SceneFile::Write(scene, binary)) {
+        return EXIT_FAILURE;
+    }
+
+    Compare(output, binary);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() == 3 && args[0] == "--generate") {
+        return Generate(static_cast<uint32_t>(std::stoul(args[1])), args[2]);
+    }
+
+    if (args.empty() || args.size() > 2 || args[0] == "--generate") {
+        std::cerr << "usage: scene-convert <input.toml> [output.scene]\n"
+                     "       scene-convert <input.scene> [output.toml]\n"
+                     "       scene-convert --generate <entities> <output.toml>\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path input = args[0];
+    const bool toBinary = input.extension() != SceneFile::Extension;
+
+    std::filesystem::path output = args.size() == 2 ? args[1] : args[0];
+    if (args.size() == 1) {
+        output.replace_extension(toBinary ? SceneFile::Extension : ".toml");
+    }
+
+    return toBinary ? ToBinary(input, output) : ToToml(input, output);
+}
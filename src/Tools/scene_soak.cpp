@@ -0,0 +1,168 @@
+// loads scenes over and over with GL stubbed out and checks nothing piles up:
+// after each cycle of Deserialise, UnloadUnused and a drained release queue, the
+// live resources, tracked GPU bytes and GL names must be back where the first
+// cycle left them
+//
+//   scene-soak [cycles] [scene...]
+//
+// scenes default to demo. Fails when any count grows past the first cycle's
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "derived_cache.h"
+#include "gl_stub.h"
+#include "gpu_memory.h"
+#include "light_system.h"
+#include "release_queue.h"
+#include "resource_manager.h"
+#include "scene_system.h"
+#include "serialisation.h"
+#include "virtual_file_system.h"
+
+struct Snapshot {
+    size_t entities;
+    size_t transforms;
+    size_t meshes;
+    size_t textures;
+    size_t shaders;
+    size_t materials;
+    size_t allocations;
+    size_t trackedBytes;
+    size_t glNames;
+
+    bool Exceeds(const Snapshot &other) const {
+        return entities > other.entities || transforms > other.transforms ||
+               meshes > other.meshes || textures > other.textures ||
+               shaders > other.shaders || materials > other.materials ||
+               allocations > other.allocations || trackedBytes > other.trackedBytes ||
+               glNames > other.glNames;
+    }
+};
+
+// frames the loader threads and release queue get to finish before the cycle is
+// called stuck
+static constexpr uint32_t m_maxSettleFrames = 100000;
+
+static Snapshot TakeSnapshot() {
+    Snapshot snapshot{};
+    snapshot.entities = SceneSystem::GetAllEntities().size();
+    snapshot.transforms = TransformSystem::GetStats().transforms;
+    snapshot.meshes = MeshSystem::GetCount();
+    snapshot.textures = TextureSystem::GetCount();
+    snapshot.shaders = ShaderSystem::GetCount();
+    snapshot.materials = MaterialSystem::GetCount();
+    snapshot.trackedBytes = GpuMemory::GetTotal();
+    snapshot.glNames = GlStub::GetLiveNames();
+
+    for (size_t i = 0; i < static_cast<size_t>(GpuMemoryCategory::Count); i++) {
+        snapshot.allocations +=
+            GpuMemory::GetUsage(static_cast<GpuMemoryCategory>(i)).allocations;
+    }
+
+    return snapshot;
+}
+
+// runs frames until background loads have landed and every release is done
+static bool Settle() {
+    for (uint32_t frame = 0; frame < m_maxSettleFrames; frame++) {
+        ResourceManager::Update();
+        if (!ResourceManager::IsLoading() && ReleaseQueue::GetPending() == 0) {
+            return true;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+
+static void Print(const int cycle, const Snapshot &snapshot) {
+    std::cout << std::setw(5) << cycle << std::setw(10) << snapshot.entities
+              << std::setw(12) << snapshot.transforms << std::setw(8) << snapshot.meshes
+              << std::setw(10) << snapshot.textures << std::setw(9) << snapshot.shaders
+              << std::setw(11) << snapshot.materials << std::setw(13)
+              << snapshot.allocations << std::setw(14) << snapshot.trackedBytes
+              << std::setw(10) << snapshot.glNames << "\n";
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    const int cycles = args.empty() ? 50 : std::stoi(args[0]);
+
+    std::vector<std::string> scenes;
+    if (args.size() > 1) {
+        scenes.assign(args.begin() + 1, args.end());
+    } else {
+        scenes.emplace_back("demo");
+    }
+
+    if (!GlStub::Load()) {
+        std::cerr << "Couldn't load the GL stubs\n";
+        return EXIT_FAILURE;
+    }
+
+    VirtualFileSystem::Init();
+    DerivedCache::Init();
+    ResourceManager::Init();
+    SceneSystem::Init();
+    LightSystem::Init();
+
+    std::cout << "cycle  entities  transforms  meshes  textures  shaders  materials"
+                 "  allocations  trackedBytes  glNames\n";
+
+    Snapshot baseline{};
+    int grownCycles = 0;
+    for (int cycle = 1; cycle <= cycles; cycle++) {
+        for (const std::string &scene : scenes) {
+            if (!Serialisation::Deserialise(scene)) {
+                std::cerr << "Couldn't load " << scene << "\n";
+                return EXIT_FAILURE;
+            }
+
+            // the load unloads once itself, loads finishing after it free the
+            // placeholders they replace
+            if (!Settle()) {
+                std::cerr << "Loading " << scene << " never settled\n";
+                return EXIT_FAILURE;
+            }
+
+            ResourceManager::UnloadUnused();
+            if (!Settle()) {
+                std::cerr << "Releasing after " << scene << " never settled\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        const Snapshot snapshot = TakeSnapshot();
+        Print(cycle, snapshot);
+
+        // the first cycle makes the defaults and fills the caches
+        if (cycle == 1) {
+            baseline = snapshot;
+        } else if (snapshot.Exceeds(baseline)) {
+            grownCycles++;
+        }
+    }
+
+    SceneSystem::CleanUp();
+    TransformSystem::CleanUp();
+    ResourceManager::CleanUp();
+    LightSystem::CleanUp();
+    DerivedCache::CleanUp();
+    VirtualFileSystem::CleanUp();
+
+    if (grownCycles > 0) {
+        std::cout << "FAILED: counts grew past the first cycle in " << grownCycles
+                  << " of " << cycles - 1 << " cycles\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "ok: " << cycles << " cycles of " << scenes.size()
+              << " scene(s) with no growth\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// measures matrices composed per second, the per-transform glm path the system
+// used to take against the batched structure-of-arrays kernel
+//
+//   transform-benchmark [transform count] [iterations]
+//
+// every transform is dirtied before each pass, so both sides compose all of them
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "transform_system.h"
+
+struct ReferenceTransform {
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+    glm::mat4 modelMatrix;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double SecondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Report(const char *name, const size_t count, const int iterations,
+                   const double seconds, const float checksum) {
+    const double composed = static_cast<double>(count) * iterations;
+
+    std::cout << std::fixed << std::setprecision(1) << name << ": " << composed / 1e6
+              << " M matrices in " << seconds * 1000.0 << " ms ("
+              << composed / seconds / 1e6 << " M matrices/s), checksum " << checksum
+              << "\n";
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    std::vector<ReferenceTransform> reference(count);
+    std::vector<TransformSystem::TransformHandle> handles(count);
+
+    TransformSystem::Init();
+    for (size_t i = 0; i < count; i++) {
+        ReferenceTransform &transform = reference[i];
+        transform.position = {position(random), position(random), position(random)};
+        transform.rotation = {angle(random), angle(random), angle(random)};
+        transform.scale = {scale(random), scale(random), scale(random)};
+
+        handles[i] = TransformSystem::CreateTransform();
+        TransformSystem::SetPosition(handles[i], transform.position);
+        TransformSystem::SetRotation(handles[i], transform.rotation);
+        TransformSystem::SetScale(handles[i], transform.scale);
+    }
+
+    Clock::time_point start = Clock::now();
+    float checksum = 0.0f;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (ReferenceTransform &transform : reference) {
+            glm::mat4 model(1.0f);
+            model = glm::translate(model, transform.position);
+            model = glm::rotate(model, glm::radians(transform.rotation.x),
+                                glm::vec3(1.0f, 0.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(transform.rotation.y),
+                                glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(transform.rotation.z),
+                                glm::vec3(0.0f, 0.0f, 1.0f));
+            transform.modelMatrix = glm::scale(model, transform.scale);
+        }
+        checksum += reference[iteration % count].modelMatrix[0][0];
+    }
+    Report("glm per transform", count, iterations, SecondsSince(start), checksum);
+
+    start = Clock::now();
+    checksum = 0.0f;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        // a moved position dirties the transform without touching its rotation
+        for (const TransformSystem::TransformHandle handle : handles) {
+            TransformSystem::SetPosition(handle, TransformSystem::GetPosition(handle));
+        }
+
+        TransformSystem::UpdateMatrices();
+        checksum += TransformSystem::GetModelMatrix(handles[iteration % count])[0][0];
+    }
+    Report("batched, dirtying included", count, iterations, SecondsSince(start),
+           checksum);
+
+    double kernelSeconds = 0.0;
+    checksum = 0.0f;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (const TransformSystem::TransformHandle handle : handles) {
+            TransformSystem::SetScale(handle, TransformSystem::GetScale(handle));
+        }
+
+        start = Clock::now();
+        TransformSystem::UpdateMatrices();
+        kernelSeconds += SecondsSince(start);
+        checksum += TransformSystem::GetModelMatrix(handles[iteration % count])[0][0];
+    }
+    Report("batched, kernel only", count, iterations, kernelSeconds, checksum);
+
+    std::cout << "batch width " << TransformSystem::GetBatchWidth() << "\n";
+
+    TransformSystem::CleanUp();
+
+    return EXIT_SUCCESS;
+}